@@ -10,6 +10,10 @@
 #include "compiler.h"
 #include "matrix.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
 * \brief Decomposes a matrix into lower triangular form using Cholesky decomposition.
 * \param[in] mat The matrix to decompose in place into a lower triangular matrix.
@@ -17,6 +21,20 @@
 *
 * Kudos: https://code.google.com/p/efficient-java-matrix-library
 */
-int cholesky_decompose_lower(register const matrix_t *const mat) HOT;
+int cholesky_decompose_lower(const matrix_t *const mat) HOT;
+
+/**
+* \brief Solves {\ref x} * (L*L') = {\ref b'} for {\ref x} using forward and back substitution.
+* \param[in] lower The lower triangular Cholesky factor L ({\ref m} x {\ref m}) as calculated by {\ref cholesky_decompose_lower}.
+* \param[in] b Matrix B ({\ref m} x {\ref n})
+* \param[out] x Resulting matrix X = B' * (L*L')^-1 ({\ref n} x {\ref m}), will be overwritten
+*
+* This calculates the product with the inverse of a symmetric positive definite matrix without ever forming the inverse.
+*/
+void cholesky_solve_transb(const matrix_t *RESTRICT const lower, const matrix_t *RESTRICT const b, const matrix_t *RESTRICT x) HOT;
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
@@ -43,6 +43,28 @@
 #define COLD
 #endif
 
+/**
+* \def NOINLINE Keeps a function out of its callers, e.g. to confine a large stack frame to it
+*/
+#ifdef __GNUC__
+#define NOINLINE __attribute__ ((noinline))
+#elif defined(_MSC_VER)
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE
+#endif
+
+/**
+* \def ALIGNED Aligns a variable to the given number of bytes; placed in front of its type
+*/
+#ifdef __GNUC__
+#define ALIGNED(bytes) __attribute__ ((aligned(bytes)))
+#elif defined(_MSC_VER)
+#define ALIGNED(bytes) __declspec(align(bytes))
+#else
+#define ALIGNED(bytes)
+#endif
+
 /**
 * \def INLINE Marks a function as to be inlined
 */
@@ -9,6 +9,11 @@
 
 #include <stdint.h>
 #include "matrix.h"
+#include "kalman_profile.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 /*!
 * \def EXTERN_INLINE_KALMAN Helper inline to switch from local inline to extern inline
@@ -17,6 +22,64 @@
 #define EXTERN_INLINE_KALMAN EXTERN_INLINE
 #endif
 
+/*!
+* \def KALMAN_MEASUREMENT_FLAG_DIAGONAL_R Marks a measurement whose process noise matrix R is diagonal.
+*
+* Measurements with this flag are corrected one measured output at a time by {\ref kalman_correct_sequential}.
+*/
+#define KALMAN_MEASUREMENT_FLAG_DIAGONAL_R  (1u << 0)
+
+/*!
+* \def KALMAN_MEASUREMENT_FLAG_SCRATCH Marks a measurement whose temporaries are taken from the scratch area of the calling thread.
+* \see kalman_scratch_attach
+*/
+#define KALMAN_MEASUREMENT_FLAG_SCRATCH     (1u << 1)
+
+/*!
+* \def KALMAN_FLAG_SCRATCH Marks a filter whose temporaries are taken from the scratch area of the calling thread.
+* \see kalman_scratch_attach
+*/
+#define KALMAN_FLAG_SCRATCH                 (1u << 0)
+
+/*!
+* \def KALMAN_MEASUREMENT_FLAG_STEADY_STATE Marks a measurement whose Kalman gain K has converged.
+*
+* As long as its filter is flagged with {\ref KALMAN_FLAG_STEADY_STATE} as well, {\ref kalman_correct} applies the constant gain.
+*/
+#define KALMAN_MEASUREMENT_FLAG_STEADY_STATE (1u << 2)
+
+/*!
+* \def KALMAN_FLAG_STEADY_STATE Marks a filter whose state covariance P has converged.
+*
+* The prediction steps then leave P untouched and only {\ref kalman_predict_x} does work. The skipped propagations are
+* counted in {\ref kalman_t::pending} until the next steady-state correction, which returns P to its fixed point; if the
+* steady state is left in between, they run first. Predictions with a fading factor other than \c 1 leave it.
+* \see kalman_solve_steady_state
+* \see kalman_measurement_track_steady_state
+*/
+#define KALMAN_FLAG_STEADY_STATE            (1u << 1)
+
+/*!
+* \def KALMAN_FLAG_LAZY Marks a filter whose covariance propagations are deferred until P is needed.
+*
+* {\ref kalman_predict} then only advances x and counts the propagation; the pending propagations run in one step
+* when the filter is corrected or P is fetched through {\ref kalman_get_system_covariance}. {\ref kalman_predict_tuned}
+* defers alike with a fading factor of \c 1; any other factor applies to the propagated P, so the pending
+* propagations run first and the tuned one is not deferred.
+* \see kalman_set_lazy
+*/
+#define KALMAN_FLAG_LAZY                    (1u << 2)
+
+/*!
+* \def KALMAN_THREADS Enables the thread pool backend of the prediction and correction steps.
+*
+* When set to a nonzero value, {\ref kalman_pool_attach} from kalman_pool.h selects a pool that the covariance
+* updates of large filters are split across. The layout of {\ref kalman_t} does not change.
+*/
+#ifndef KALMAN_THREADS
+#define KALMAN_THREADS 0
+#endif
+
 /*!
 * \brief Kalman Filter structure
 * \see kalman_measurement_t
@@ -57,6 +120,69 @@ typedef struct
     */
     matrix_t Q;
 
+    /*!
+    * \brief Filter flags, e.g. {\ref KALMAN_FLAG_SCRATCH}
+    */
+    uint_fast8_t flags;
+
+    /*!
+    * \brief The number of covariance propagations deferred by {\ref KALMAN_FLAG_LAZY} or skipped in the steady state
+    * \see kalman_flush_covariance
+    */
+    uint_fast32_t pending;
+
+    /*!
+    * \brief Incremented whenever A, B or Q may have changed
+    * \see kalman_model_changed
+    */
+    uint_fast32_t model_version;
+
+    /*!
+    * \brief The measurement whose converged gain the steady state of this filter is bound to, or \c NULL
+    * \see kalman_measurement_track_steady_state
+    */
+    struct kalman_measurement_t *tracked;
+
+    /*!
+    * \brief Products derived from the model, kept until the model changes
+    */
+    struct
+    {
+        /*!
+        * \brief The input noise B*Q*B', stored like P; no buffer if not cached
+        * \see kalman_cache_input_noise
+        */
+        matrix_t BQB;
+
+        /*!
+        * \brief The model version {\ref BQB} was calculated for
+        */
+        uint_fast32_t BQB_version;
+
+        /*!
+        * \brief The fading factor {\ref lambda_scale} was calculated for
+        */
+        matrix_data_t lambda;
+
+        /*!
+        * \brief The covariance scale 1/lambda^2
+        * \see kalman_set_lambda
+        */
+        matrix_data_t lambda_scale;
+
+        /*!
+        * \brief The powers of A and accumulated noises of recent multi-step predictions, or \c NULL
+        * \see kalman_cache_multistep
+        */
+        struct kalman_multistep_t *multistep;
+
+        /*!
+        * \brief The continuous-time model and its discretizations for recent time steps, or \c NULL
+        * \see kalman_continuous_init
+        */
+        struct kalman_continuous_t *continuous;
+    } cache;
+
     /*!
     * \brief Temporary variables.
     */
@@ -97,13 +223,21 @@ typedef struct
 
     } temporary;
 
+#if KALMAN_PROFILE
+    /*!
+    * \brief Accumulated per-stage timings
+    * \see kalman_get_stats
+    */
+    kalman_stats_t stats;
+#endif
+
 } kalman_t;
 
 /*!
 * \brief Kalman Filter measurement structure
 * \see kalman_t
 */
-typedef struct
+typedef struct kalman_measurement_t
 {
     /*!
     * \brief Measurement vector
@@ -139,55 +273,55 @@ typedef struct
     matrix_t K;
 
     /*!
-    * \brief Temporary variables.
+    * \brief Measurement flags, e.g. {\ref KALMAN_MEASUREMENT_FLAG_DIAGONAL_R}
+    */
+    uint_fast8_t flags;
+
+    /*!
+    * \brief Convergence tracking of the Kalman gain
+    * \see kalman_measurement_track_steady_state
     */
     struct
     {
         /*!
-        * \brief Auxiliary array for matrix multiplication, needs to be MAX(num states, num measurements)
-        *
-        * This auxiliary field MUST NOT be aliased with either temporary HP, KHP, HPt or S_inverted.
+        * \brief The gain of the previous correction (number of states x number of measurements), or \c NULL if not tracked
         */
-        matrix_data_t *aux;
+        matrix_data_t *previous_K;
 
         /*!
-        * \brief S-Sized temporary matrix  (number of measurements x number of measurements)
-        *
-        * The backing field for this temporary MAY be aliased with temporary temp_KHP.
-        * The backing field for this temporary MAY be aliased with temporary temp_HP (if it is not aliased with temp_PHt).
-        * The backing field for this temporary MUST NOT be aliased with temporary temp_PHt.
-        * The backing field for this temporary MUST NOT be aliased with aux.
-        *
-        * \see S
+        * \brief Largest change of any gain, relative to the largest gain, that counts as converged
         */
-        matrix_t S_inv;
+        matrix_data_t tolerance;
 
         /*!
-        * \brief H-Sized temporary matrix  (number of measurements x number of states)
-        *
-        * The backing field for this temporary MAY be aliased with temporary S_inv.
-        * The backing field for this temporary MAY be aliased with temporary temp_PHt.
-        * The backing field for this temporary MUST NOT be aliased with temporary temp_KHP.
+        * \brief Number of consecutive converged corrections required to enter the steady state
         */
-        matrix_t HP;
+        uint_fast16_t required;
 
         /*!
-        * \brief P-Sized temporary matrix  (number of states x number of states)
+        * \brief Number of consecutive converged corrections so far
+        */
+        uint_fast16_t count;
+    } steady;
+
+    /*!
+    * \brief Temporary variables.
+    */
+    struct
+    {
+        /*!
+        * \brief Auxiliary array for matrix multiplication, needs to be MAX(num states, num measurements)
         *
-        * The backing field for this temporary MAY be aliased with temporary S_inv.
-        * The backing field for this temporary MAY be aliased with temporary temp_PHt.
-        * The backing field for this temporary MUST NOT be aliased with temporary temp_HP.
+        * This auxiliary field MAY be aliased with temporary HP.
         */
-        matrix_t KHP;
+        matrix_data_t *aux;
 
         /*!
-        * \brief PxH'-Sized (H'-Sized) temporary matrix  (number of states x number of measurements)
+        * \brief H-Sized temporary matrix  (number of measurements x number of states)
         *
-        * The backing field for this temporary MAY be aliased with temporary temp_HP.
-        * The backing field for this temporary MAY be aliased with temporary temp_KHP.
-        * The backing field for this temporary MUST NOT be aliased with temporary S_inv.
+        * The backing field for this temporary MAY be aliased with aux.
         */
-        matrix_t PHt;
+        matrix_t HP;
 
     } temporary;
 
@@ -208,8 +342,11 @@ typedef struct
 * \param[in] predictedX The temporary vector for predicted X ({\ref num_states} x \c 1)
 * \param[in] temp_P The temporary matrix for P calculation ({\ref num_states} x {\ref num_states})
 * \param[in] temp_BQ The temporary matrix for BQ calculation ({\ref num_states} x {\ref num_inputs})
+*
+* If \c aux is \c NULL, all temporaries must be \c NULL. The filter is then flagged with {\ref KALMAN_FLAG_SCRATCH}
+* and takes its temporaries from the scratch area attached to the calling thread (see kalman_scratch.h).
 */
-void kalman_filter_initialize(kalman_t *kf, uint_fast8_t num_states, uint_fast8_t num_inputs, matrix_data_t *A, matrix_data_t *x,
+void kalman_filter_initialize(kalman_t *kf, matrix_index_t num_states, matrix_index_t num_inputs, matrix_data_t *A, matrix_data_t *x,
                               matrix_data_t *B, matrix_data_t *u, matrix_data_t *P, matrix_data_t *Q,
                               matrix_data_t *aux, matrix_data_t *predictedX, matrix_data_t *temp_P, matrix_data_t *temp_BQ) COLD;
 
@@ -225,14 +362,14 @@ void kalman_filter_initialize(kalman_t *kf, uint_fast8_t num_states, uint_fast8_
 * \param[in] S The residual covariance ({\ref num_measurements} x {\ref num_measurements})
 * \param[in] K The Kalman gain ({\ref num_states} x {\ref num_measurements})
 * \param[in] aux The auxiliary buffer (length {\ref num_states} or {\ref num_measurements}, whichever is greater)
-* \param[in] S_inv The temporary matrix for the inverted residual covariance  ({\ref num_measurements} x {\ref num_measurements})
 * \param[in] temp_HP The temporary matrix for HxP ({\ref num_measurements} x {\ref num_states})
-* \param[in] temp_PHt The temporary matrix for PxH' ({\ref num_states} x {\ref num_measurements})
-* \param[in] temp_KHP The temporary matrix for KxHxP ({\ref num_states} x {\ref num_states})
+*
+* If \c aux is \c NULL, \c temp_HP must be \c NULL as well. The measurement is then flagged with {\ref KALMAN_MEASUREMENT_FLAG_SCRATCH}
+* and takes its temporaries from the scratch area attached to the calling thread (see kalman_scratch.h).
 */
-void kalman_measurement_initialize(kalman_measurement_t *kfm, uint_fast8_t num_states, uint_fast8_t num_measurements, matrix_data_t *H, matrix_data_t *z, matrix_data_t *R,
+void kalman_measurement_initialize(kalman_measurement_t *kfm, matrix_index_t num_states, matrix_index_t num_measurements, matrix_data_t *H, matrix_data_t *z, matrix_data_t *R,
                                    matrix_data_t *y, matrix_data_t *S, matrix_data_t *K,
-                                   matrix_data_t *aux, matrix_data_t *S_inv, matrix_data_t *temp_HP, matrix_data_t *temp_PHt, matrix_data_t *temp_KHP) COLD;
+                                   matrix_data_t *aux, matrix_data_t *temp_HP) COLD;
 
 /*!
 * \brief Performs the time update / prediction step of only the state vector
@@ -241,7 +378,7 @@ void kalman_measurement_initialize(kalman_measurement_t *kfm, uint_fast8_t num_s
 * \see kalman_predict
 * \see kalman_predict_tuned
 */
-void kalman_predict_x(register kalman_t *const kf) HOT;
+void kalman_predict_x(kalman_t *const kf) HOT;
 
 /*!
 * \brief Performs the time update / prediction step of only the state covariance matrix
@@ -250,16 +387,37 @@ void kalman_predict_x(register kalman_t *const kf) HOT;
 * \see kalman_predict
 * \see kalman_predict_Q_tuned
 */
-void kalman_predict_Q(register kalman_t *const kf) HOT;
+void kalman_predict_Q(kalman_t *const kf) HOT;
 
 /*!
 * \brief Performs the time update / prediction step of only the state covariance matrix
 * \param[in] kf The Kalman Filter structure to predict with.
+* \param[in] lambda Lambda factor (\c 0 < {\ref lambda} <= \c 1)
+*
+* A fading factor other than \c 1 leaves the steady state and restarts the convergence tracking of the gain, since
+* the skipped propagations are counted without it.
 *
 * \see kalman_predict_tuned
 * \see kalman_predict_Q
 */
-void kalman_predict_Q_tuned(register kalman_t *const kf, matrix_data_t lambda) HOT;
+void kalman_predict_Q_tuned(kalman_t *const kf, matrix_data_t lambda) HOT;
+
+/*!
+* \brief Runs the covariance propagations deferred by {\ref KALMAN_FLAG_LAZY}
+* \param[in] kf The Kalman Filter structure
+*
+* With a multi-step cache (see kalman_multistep.h), the pending propagations are coalesced into one. In the steady
+* state, the propagations are kept pending until it is left.
+*/
+void kalman_flush_covariance(kalman_t *kf) HOT;
+
+/*!
+* \brief Enables or disables the deferred covariance propagation of a filter
+* \param[in] kf The Kalman Filter structure
+* \param[in] lazy Nonzero to defer, zero to propagate in every prediction; the pending propagations run first.
+* \see KALMAN_FLAG_LAZY
+*/
+void kalman_set_lazy(kalman_t *kf, int lazy) COLD;
 
 /*!
 * \brief Performs the time update / prediction step.
@@ -268,6 +426,8 @@ void kalman_predict_Q_tuned(register kalman_t *const kf, matrix_data_t lambda) H
 *
 * This call assumes that the input covariance and variables are already set in the filter structure.
 *
+* If the filter is flagged with {\ref KALMAN_FLAG_LAZY}, the covariance propagation is only counted.
+*
 * \see kalman_predict_x
 * \see kalman_predict_Q
 */
@@ -285,6 +445,12 @@ EXTERN_INLINE_KALMAN void kalman_predict(kalman_t *kf)
     /* P = A*P*A' + B*Q*B'                                                  */
     /************************************************************************/
 
+    // deferred, or skipped while the covariance has converged
+    if (kf->flags & (KALMAN_FLAG_LAZY | KALMAN_FLAG_STEADY_STATE))
+    {
+        ++kf->pending;
+        return;
+    }
     kalman_predict_Q(kf);
 }
 
@@ -295,6 +461,8 @@ EXTERN_INLINE_KALMAN void kalman_predict(kalman_t *kf)
 *
 * This call assumes that the input covariance and variables are already set in the filter structure.
 *
+* If the filter is flagged with {\ref KALMAN_FLAG_LAZY} and \c lambda is \c 1, the covariance propagation is only counted.
+*
 * \see kalman_predict_x
 * \see kalman_predict_Q_tuned
 */
@@ -312,15 +480,145 @@ HOT EXTERN_INLINE_KALMAN void kalman_predict_tuned(kalman_t *kf, matrix_data_t l
     /* P = A*P*A' * 1/lambda^2 + B*Q*B'                                     */
     /************************************************************************/
 
+    // without fading, deferred or skipped like kalman_predict
+    if (lambda == 1 && (kf->flags & (KALMAN_FLAG_LAZY | KALMAN_FLAG_STEADY_STATE)))
+    {
+        ++kf->pending;
+        return;
+    }
     kalman_predict_Q_tuned(kf, lambda);
 }
 
 /*!
 * \brief Performs the measurement update step.
 * \param[in] kf The Kalman Filter structure to correct.
+* \param[in] kfm The Kalman Filter measurement structure to correct with.
+*
+* H*P is calculated once and reused for S, for the Kalman gain (as P*H' = (H*P)') and for the
+* covariance update, which is written straight into P. The Kalman gain is obtained by forward and
+* back substitution against the Cholesky factor of the residual covariance S; the inverse of S is
+* never formed.
+*
+* If the measurement is flagged with {\ref KALMAN_MEASUREMENT_FLAG_DIAGONAL_R}, this call forwards to {\ref kalman_correct_sequential}.
 */
 void kalman_correct(kalman_t *kf, kalman_measurement_t *kfm) HOT;
 
+/*!
+* \brief Performs the measurement update step one measured output at a time.
+* \param[in] kf The Kalman Filter structure to correct.
+* \param[in] kfm The Kalman Filter measurement structure to correct with; its R matrix must be diagonal.
+*
+* With a diagonal R the measured outputs are independent, so the update decomposes into one scalar update per
+* row of H, each of which only needs a rank-1 covariance update. Neither a Cholesky decomposition nor a matrix
+* product is required. On return, y holds the sequential innovations, the diagonal of S the scalar residual
+* variances and the columns of K the scalar gains.
+*
+* \see kalman_measurement_detect_diagonal_R
+*/
+void kalman_correct_sequential(kalman_t *kf, kalman_measurement_t *kfm) HOT;
+
+/*!
+* \brief Keeps the input noise B*Q*B' of a filter in a buffer until the model changes
+* \param[in] kf The Kalman Filter structure
+* \param[in] buffer The buffer (\c num_states x \c num_states elements, or {\ref MATRIX_PACKED_SIZE} of them if P is packed);
+*            \c NULL stops caching.
+*
+* With a cache, the prediction steps add the cached product to P instead of calculating B*Q and (B*Q)*B' every time.
+* The cache is recalculated on the first prediction after the model changed, i.e. after one of the setters
+* ({\ref kalman_set_input_transition}, {\ref kalman_set_input_covariance}, ...) or {\ref kalman_model_changed}. The getters
+* of A, B and Q do not mark the model as changed; writing to them through a pointer must be preceded by {\ref kalman_model_changed}.
+*/
+void kalman_cache_input_noise(kalman_t *kf, matrix_data_t *buffer) COLD;
+
+/*!
+* \brief Sets the fading factor used by {\ref kalman_predict_tuned} and {\ref kalman_predict_Q_tuned}
+* \param[in] kf The Kalman Filter structure
+* \param[in] lambda Lambda factor (\c 0 < {\ref lambda} <= \c 1)
+*
+* Precalculates 1/lambda^2. Predicting with the same lambda reuses it; predicting with another one recalculates it.
+*/
+void kalman_set_lambda(kalman_t *kf, matrix_data_t lambda) COLD;
+
+/*!
+* \brief Marks the model of a filter as changed
+* \param[in] kf The Kalman Filter structure
+*
+* Runs the pending covariance propagations with the previous model, invalidates the products derived from A, B and Q
+* and leaves the steady state. Call it before changing the model.
+*/
+EXTERN_INLINE_KALMAN void kalman_model_changed(kalman_t *kf)
+{
+    kf->flags &= (uint_fast8_t)~KALMAN_FLAG_STEADY_STATE;
+    if (kf->pending != 0)
+    {
+        kalman_flush_covariance(kf);
+    }
+
+    ++kf->model_version;
+}
+
+/*!
+* \brief Tracks the convergence of the Kalman gain of a measurement
+* \param[in] kfm The Kalman Filter measurement structure.
+* \param[in] previous_K Buffer for the previous gain ({\ref num_states} x {\ref num_measurements}); \c NULL stops tracking.
+* \param[in] tolerance Largest change of any gain between two corrections, relative to the largest gain, that counts as converged
+* \param[in] required Number of consecutive converged corrections after which the filter enters the steady state
+*
+* While tracked, every {\ref kalman_correct} with a full (not sequential) update compares the new gain to the previous one.
+* Once the gain has converged, the filter and the measurement are flagged with {\ref KALMAN_FLAG_STEADY_STATE} and
+* {\ref KALMAN_MEASUREMENT_FLAG_STEADY_STATE}: predictions then only calculate <tt>x = A*x</tt>, corrections only
+* <tt>x = x + K*(z - H*x)</tt>, and P keeps the converged a posteriori covariance. This is only valid for a time-invariant model
+* that is corrected by this one measurement; correcting with another measurement leaves the steady state, as does
+* {\ref kalman_leave_steady_state} or a prediction with a fading factor other than \c 1.
+*
+* The steady state holds a single gain: a filter supports only one tracked measurement, and its R must not be diagonal
+* ({\ref KALMAN_MEASUREMENT_FLAG_DIAGONAL_R} corrects sequentially, which does not track the gain). Both are asserted.
+* Filters corrected alternately by several measurements do not reach a steady state and should not be tracked.
+*/
+void kalman_measurement_track_steady_state(kalman_measurement_t *kfm, matrix_data_t *previous_K, matrix_data_t tolerance, uint_fast16_t required) COLD;
+
+/*!
+* \brief Solves the discrete algebraic Riccati equation of a filter and a measurement and enters the steady state
+* \param[in] kf The Kalman Filter structure; P holds the initial covariance.
+* \param[in] kfm The Kalman Filter measurement structure; it must be tracked (see {\ref kalman_measurement_track_steady_state}).
+* \param[in] max_iterations The largest number of Riccati iterations
+* \return Zero if the gain converged, nonzero otherwise.
+*
+* Iterates the covariance part of prediction and correction, <tt>P = A*P*A' + B*Q*B'</tt> followed by <tt>P = P - K*H*P</tt>,
+* without touching x, until the gain converges by the criterion of the tracking. On success, P holds the steady-state a posteriori
+* covariance, K the steady-state gain, and the filter is in the steady state. On failure, P and K hold the last iterate.
+*/
+int kalman_solve_steady_state(kalman_t *kf, kalman_measurement_t *kfm, uint_fast16_t max_iterations) COLD;
+
+/*!
+* \brief Leaves the steady state, e.g. after the model changed
+* \param[in] kf The Kalman Filter structure
+*
+* Runs the propagations skipped since the last steady-state correction, and the next prediction propagates P again.
+* Measurements leave the steady state on their next correction.
+*/
+void kalman_leave_steady_state(kalman_t *kf) COLD;
+
+/*!
+* \brief Checks whether the process noise matrix R is diagonal and updates {\ref KALMAN_MEASUREMENT_FLAG_DIAGONAL_R} accordingly.
+* \param[in] kfm The Kalman Filter measurement structure.
+* \return Nonzero if R is diagonal, zero otherwise.
+*/
+int kalman_measurement_detect_diagonal_R(kalman_measurement_t *kfm) COLD;
+
+/*!
+* \brief Gets the accumulated per-stage timings of a filter.
+* \param[in] kf The Kalman Filter structure
+* \param[out] stats Receives the timings; all zero unless compiled with {\ref KALMAN_PROFILE}.
+*/
+void kalman_get_stats(const kalman_t *kf, kalman_stats_t *stats) COLD;
+
+/*!
+* \brief Resets the accumulated per-stage timings of a filter.
+* \param[in] kf The Kalman Filter structure
+*/
+void kalman_reset_stats(kalman_t *kf) COLD;
+
 /*!
 * \brief Gets a pointer to the state vector x.
 * \param[in] kf The Kalman Filter structure
@@ -335,19 +633,37 @@ HOT PURE EXTERN_INLINE_KALMAN matrix_t* kalman_get_state_vector(kalman_t *kf)
 * \brief Gets a pointer to the state transition matrix A.
 * \param[in] kf The Kalman Filter structure
 * \return The state transition matrix A.
+*
+* Writing through the pointer must be preceded by {\ref kalman_model_changed}; {\ref kalman_set_state_transition} does both for single elements.
 */
 HOT PURE EXTERN_INLINE_KALMAN matrix_t* kalman_get_state_transition(kalman_t *kf)
 {
     return &(kf->A);
 }
 
+/*!
+* \brief Gets a read-only pointer to the state transition matrix A.
+* \param[in] kf The Kalman Filter structure
+* \return The state transition matrix A.
+*/
+HOT PURE EXTERN_INLINE_KALMAN const matrix_t* kalman_read_state_transition(const kalman_t *kf)
+{
+    return &(kf->A);
+}
+
 /*!
 * \brief Gets a pointer to the system covariance matrix P.
 * \param[in] kf The Kalman Filter structure
 * \return The system covariance matrix.
+*
+* Runs the covariance propagations deferred by {\ref KALMAN_FLAG_LAZY} first.
 */
-PURE EXTERN_INLINE_KALMAN matrix_t* kalman_get_system_covariance(kalman_t *kf)
+EXTERN_INLINE_KALMAN matrix_t* kalman_get_system_covariance(kalman_t *kf)
 {
+    if (kf->pending != 0)
+    {
+        kalman_flush_covariance(kf);
+    }
     return &(kf->P);
 }
 
@@ -365,6 +681,8 @@ HOT PURE EXTERN_INLINE_KALMAN matrix_t* kalman_get_input_vector(kalman_t *kf)
 * \brief Gets a pointer to the input transition matrix B.
 * \param[in] kf The Kalman Filter structure
 * \return The input transition matrix B.
+*
+* Writing through the pointer must be preceded by {\ref kalman_model_changed}; {\ref kalman_set_input_transition} does both for single elements.
 */
 HOT PURE EXTERN_INLINE_KALMAN matrix_t* kalman_get_input_transition(kalman_t *kf)
 {
@@ -372,15 +690,76 @@ HOT PURE EXTERN_INLINE_KALMAN matrix_t* kalman_get_input_transition(kalman_t *kf
 }
 
 /*!
-* \brief Gets a pointer to the input covariance matrix P.
+* \brief Gets a read-only pointer to the input transition matrix B.
+* \param[in] kf The Kalman Filter structure
+* \return The input transition matrix B.
+*/
+HOT PURE EXTERN_INLINE_KALMAN const matrix_t* kalman_read_input_transition(const kalman_t *kf)
+{
+    return &(kf->B);
+}
+
+/*!
+* \brief Gets a pointer to the input covariance matrix Q.
 * \param[in] kf The Kalman Filter structure
 * \return The input covariance matrix.
+*
+* Writing through the pointer must be preceded by {\ref kalman_model_changed}; {\ref kalman_set_input_covariance} does both for single elements.
 */
 HOT PURE EXTERN_INLINE_KALMAN matrix_t* kalman_get_input_covariance(kalman_t *kf)
 {
     return &(kf->Q);
 }
 
+/*!
+* \brief Gets a read-only pointer to the input covariance matrix Q.
+* \param[in] kf The Kalman Filter structure
+* \return The input covariance matrix.
+*/
+HOT PURE EXTERN_INLINE_KALMAN const matrix_t* kalman_read_input_covariance(const kalman_t *kf)
+{
+    return &(kf->Q);
+}
+
+/*!
+* \brief Sets an element of the state transition matrix A
+* \param[in] kf The Kalman Filter structure
+* \param[in] row The row
+* \param[in] column The column
+* \param[in] value The value
+*/
+EXTERN_INLINE_KALMAN void kalman_set_state_transition(kalman_t *kf, matrix_index_t row, matrix_index_t column, matrix_data_t value)
+{
+    kalman_model_changed(kf);
+    matrix_set(&kf->A, row, column, value);
+}
+
+/*!
+* \brief Sets an element of the input transition matrix B
+* \param[in] kf The Kalman Filter structure
+* \param[in] row The row
+* \param[in] column The column
+* \param[in] value The value
+*/
+EXTERN_INLINE_KALMAN void kalman_set_input_transition(kalman_t *kf, matrix_index_t row, matrix_index_t column, matrix_data_t value)
+{
+    kalman_model_changed(kf);
+    matrix_set(&kf->B, row, column, value);
+}
+
+/*!
+* \brief Sets an element and its mirror of the symmetric input covariance matrix Q
+* \param[in] kf The Kalman Filter structure
+* \param[in] row The row
+* \param[in] column The column
+* \param[in] value The value
+*/
+EXTERN_INLINE_KALMAN void kalman_set_input_covariance(kalman_t *kf, matrix_index_t row, matrix_index_t column, matrix_data_t value)
+{
+    kalman_model_changed(kf);
+    matrix_set_symmetric(&kf->Q, row, column, value);
+}
+
 /*!
 * \brief Gets a pointer to the measurement vector z.
 * \param[in] kfm The Kalman Filter measurement structure.
@@ -391,25 +770,92 @@ HOT PURE EXTERN_INLINE_KALMAN matrix_t* kalman_get_measurement_vector(kalman_mea
     return &(kfm->z);
 }
 
+/*!
+* \brief Marks the model of a measurement as changed
+* \param[in] kfm The Kalman Filter measurement structure.
+*
+* Leaves the steady state of the measurement, since the converged gain only holds for the previous H and R; the next
+* correction with it propagates P again and restarts the convergence tracking. Call it before changing H or R.
+*/
+EXTERN_INLINE_KALMAN void kalman_measurement_changed(kalman_measurement_t *kfm)
+{
+    kfm->flags &= (uint_fast8_t)~KALMAN_MEASUREMENT_FLAG_STEADY_STATE;
+    kfm->steady.count = 0;
+}
+
 /*!
 * \brief Gets a pointer to the measurement transformation matrix H.
 * \param[in] kfm The Kalman Filter measurement structure.
 * \return The measurement transformation matrix H.
+*
+* Writing through the pointer must be preceded by {\ref kalman_measurement_changed}; {\ref kalman_set_measurement_transformation} does both for single elements.
 */
 HOT PURE EXTERN_INLINE_KALMAN matrix_t* kalman_get_measurement_transformation(kalman_measurement_t *kfm)
 {
     return &(kfm->H);
 }
 
+/*!
+* \brief Gets a read-only pointer to the measurement transformation matrix H.
+* \param[in] kfm The Kalman Filter measurement structure.
+* \return The measurement transformation matrix H.
+*/
+HOT PURE EXTERN_INLINE_KALMAN const matrix_t* kalman_read_measurement_transformation(const kalman_measurement_t *kfm)
+{
+    return &(kfm->H);
+}
+
 /*!
 * \brief Gets a pointer to the process noise matrix R.
 * \param[in] kfm The Kalman Filter measurement structure.
 * \return The process noise matrix R.
+*
+* Writing through the pointer must be preceded by {\ref kalman_measurement_changed}; {\ref kalman_set_process_noise} does both for single elements.
 */
 HOT PURE EXTERN_INLINE_KALMAN matrix_t* kalman_get_process_noise(kalman_measurement_t *kfm)
 {
     return &(kfm->R);
 }
 
+/*!
+* \brief Gets a read-only pointer to the process noise matrix R.
+* \param[in] kfm The Kalman Filter measurement structure.
+* \return The process noise matrix R.
+*/
+HOT PURE EXTERN_INLINE_KALMAN const matrix_t* kalman_read_process_noise(const kalman_measurement_t *kfm)
+{
+    return &(kfm->R);
+}
+
+/*!
+* \brief Sets an element of the measurement transformation matrix H
+* \param[in] kfm The Kalman Filter measurement structure.
+* \param[in] row The row
+* \param[in] column The column
+* \param[in] value The value
+*/
+EXTERN_INLINE_KALMAN void kalman_set_measurement_transformation(kalman_measurement_t *kfm, matrix_index_t row, matrix_index_t column, matrix_data_t value)
+{
+    kalman_measurement_changed(kfm);
+    matrix_set(&kfm->H, row, column, value);
+}
+
+/*!
+* \brief Sets an element and its mirror of the symmetric process noise matrix R
+* \param[in] kfm The Kalman Filter measurement structure.
+* \param[in] row The row
+* \param[in] column The column
+* \param[in] value The value
+*/
+EXTERN_INLINE_KALMAN void kalman_set_process_noise(kalman_measurement_t *kfm, matrix_index_t row, matrix_index_t column, matrix_data_t value)
+{
+    kalman_measurement_changed(kfm);
+    matrix_set_symmetric(&kfm->R, row, column, value);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
 #undef EXTERN_INLINE_KALMAN
 #endif
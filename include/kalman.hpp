@@ -0,0 +1,535 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef KALMAN_HPP_
+#define KALMAN_HPP_
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#error kalman.hpp requires C++17
+#endif
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#ifndef EXTERN_INLINE_MATRIX
+#define EXTERN_INLINE_MATRIX static inline
+#endif
+
+#ifndef EXTERN_INLINE_KALMAN
+#define EXTERN_INLINE_KALMAN static inline
+#endif
+
+#include "compiler.h"
+#include "matrix.h"
+#include "kalman.h"
+
+/*!
+* \brief Header-only C++17 front end for filters of compile-time dimensions.
+*
+* The types in this namespace own their storage and run the filter equations with kernels whose
+* dimensions are template parameters, so that the compiler can fully unroll and vectorize them.
+* Every filter and measurement also carries a regular {\ref kalman_t} / {\ref kalman_measurement_t}
+* that points into the very same storage, so C code can operate on it at any time.
+*
+* \code
+* kalman::Filter<3> filter;
+* kalman::Measurement<decltype(filter), 1> position;
+*
+* filter.A()(0, 1) = T;
+* ...
+* filter.predict();
+* position.z()[0] = measured;
+* filter.correct(position);
+*
+* kalman_predict(&filter.c_filter()); // the C API sees the same state
+* \endcode
+*/
+namespace kalman
+{
+    /*!
+    * \brief Matrix element type, identical to {\ref matrix_data_t}
+    */
+    using data_t = matrix_data_t;
+
+    /*!
+    * \brief Row-major matrix of compile-time dimensions
+    *
+    * The layout is identical to the buffers the C API expects, i.e. {\ref data} can be handed to {\ref matrix_init} directly.
+    */
+    template <std::size_t Rows, std::size_t Cols>
+    struct Matrix
+    {
+        static constexpr std::size_t rows = Rows;
+        static constexpr std::size_t cols = Cols;
+
+        /*!
+        * \brief The elements in row-major order
+        */
+        std::array<data_t, Rows * Cols> elements;
+
+        constexpr data_t& operator()(std::size_t row, std::size_t column) noexcept { return elements[row * Cols + column]; }
+        constexpr const data_t& operator()(std::size_t row, std::size_t column) const noexcept { return elements[row * Cols + column]; }
+
+        constexpr data_t& operator[](std::size_t index) noexcept { return elements[index]; }
+        constexpr const data_t& operator[](std::size_t index) const noexcept { return elements[index]; }
+
+        constexpr data_t* data() noexcept { return elements.data(); }
+        constexpr const data_t* data() const noexcept { return elements.data(); }
+
+        /*!
+        * \brief Sets an element and its mirror across the diagonal
+        */
+        constexpr void set_symmetric(std::size_t row, std::size_t column, data_t value) noexcept
+        {
+            elements[row * Cols + column] = value;
+            elements[column * Cols + row] = value;
+        }
+    };
+
+    static_assert(std::is_standard_layout<Matrix<3, 3>>::value, "Matrix must be layout-compatible with a C array");
+    static_assert(sizeof(Matrix<3, 3>) == 9 * sizeof(data_t), "Matrix must not carry padding");
+
+    /*!
+    * \brief Kernels with compile-time dimensions; these mirror the C kernels in matrix.c and cholesky.c.
+    */
+    namespace detail
+    {
+        constexpr std::size_t max(std::size_t a, std::size_t b) noexcept { return a > b ? a : b; }
+
+        /*!
+        * \brief c = a * b, with a (R x K), b (K x C) and c (R x C)
+        */
+        template <std::size_t R, std::size_t K, std::size_t C>
+        inline void mult(const data_t *RESTRICT a, const data_t *RESTRICT b, data_t *RESTRICT c) noexcept
+        {
+            for (std::size_t i = 0; i < R; ++i)
+            {
+                data_t *RESTRICT const crow = &c[i * C];
+                for (std::size_t j = 0; j < C; ++j)
+                {
+                    crow[j] = 0;
+                }
+
+                for (std::size_t k = 0; k < K; ++k)
+                {
+                    const data_t factor = a[i * K + k];
+                    const data_t *RESTRICT const brow = &b[k * C];
+                    for (std::size_t j = 0; j < C; ++j)
+                    {
+                        crow[j] += factor * brow[j];
+                    }
+                }
+            }
+        }
+
+        /*!
+        * \brief c = a * b', with a (R x K), b (C x K) and c (R x C)
+        */
+        template <std::size_t R, std::size_t K, std::size_t C>
+        inline void mult_transb(const data_t *RESTRICT a, const data_t *RESTRICT b, data_t *RESTRICT c) noexcept
+        {
+            for (std::size_t i = 0; i < R; ++i)
+            {
+                for (std::size_t j = 0; j < C; ++j)
+                {
+                    data_t total = 0;
+                    for (std::size_t k = 0; k < K; ++k)
+                    {
+                        total += a[i * K + k] * b[j * K + k];
+                    }
+                    c[i * C + j] = total;
+                }
+            }
+        }
+
+        /*!
+        * \brief c = scale * a * b' (or c += a * b' if Accumulate is set) for a symmetric result, with a and b (R x K) and c (R x R)
+        *
+        * Only the upper triangle is calculated and mirrored.
+        */
+        template <std::size_t R, std::size_t K, bool Accumulate>
+        inline void mult_transb_symmetric(const data_t *RESTRICT a, const data_t *RESTRICT b, const data_t scale, data_t *RESTRICT c) noexcept
+        {
+            for (std::size_t i = 0; i < R; ++i)
+            {
+                for (std::size_t j = i; j < R; ++j)
+                {
+                    data_t total = 0;
+                    for (std::size_t k = 0; k < K; ++k)
+                    {
+                        total += a[i * K + k] * b[j * K + k];
+                    }
+
+                    const data_t value = Accumulate ? c[i * R + j] + total : total * scale;
+                    c[i * R + j] = value;
+                    c[j * R + i] = value;
+                }
+            }
+        }
+
+        /*!
+        * \brief c = c - a * b for a symmetric product, with a (R x K), b (K x R) and c (R x R)
+        */
+        template <std::size_t R, std::size_t K>
+        inline void multsub_symmetric(const data_t *RESTRICT a, const data_t *RESTRICT b, data_t *RESTRICT c) noexcept
+        {
+            for (std::size_t i = 0; i < R; ++i)
+            {
+                data_t *RESTRICT const crow = &c[i * R];
+                for (std::size_t k = 0; k < K; ++k)
+                {
+                    const data_t factor = a[i * K + k];
+                    const data_t *RESTRICT const brow = &b[k * R];
+                    for (std::size_t j = i; j < R; ++j)
+                    {
+                        crow[j] -= factor * brow[j];
+                    }
+                }
+
+                for (std::size_t j = i + 1; j < R; ++j)
+                {
+                    c[j * R + i] = crow[j];
+                }
+            }
+        }
+
+        /*!
+        * \brief Decomposes a (N x N) matrix in place into its lower triangular Cholesky factor.
+        * \return \c false if the matrix is not positive definite.
+        */
+        template <std::size_t N>
+        inline bool cholesky_decompose_lower(data_t *RESTRICT t) noexcept
+        {
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                data_t div_el_ii = 0;
+                for (std::size_t j = i; j < N; ++j)
+                {
+                    data_t sum = t[i * N + j];
+                    for (std::size_t k = 0; k < i; ++k)
+                    {
+                        sum -= t[i * N + k] * t[j * N + k];
+                    }
+
+                    if (i == j)
+                    {
+                        // is it positive-definite?
+                        if (sum <= 0) return false;
+
+                        const data_t el_ii = static_cast<data_t>(std::sqrt(sum));
+                        t[i * N + i] = el_ii;
+                        div_el_ii = static_cast<data_t>(1) / el_ii;
+                    }
+                    else
+                    {
+                        t[j * N + i] = sum * div_el_ii;
+                    }
+                }
+            }
+
+            // zero the top right corner.
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                for (std::size_t j = i + 1; j < N; ++j)
+                {
+                    t[i * N + j] = 0;
+                }
+            }
+
+            return true;
+        }
+
+        /*!
+        * \brief x = b' * (L * L')^-1, with L (M x M), b (M x N) and x (N x M)
+        */
+        template <std::size_t M, std::size_t N>
+        inline void cholesky_solve_transb(const data_t *RESTRICT t, const data_t *RESTRICT b, data_t *RESTRICT x) noexcept
+        {
+            for (std::size_t r = 0; r < N; ++r)
+            {
+                data_t *RESTRICT const xr = &x[r * M];
+
+                // forward substitution: L * z = b_r
+                for (std::size_t i = 0; i < M; ++i)
+                {
+                    data_t sum = b[i * N + r];
+                    for (std::size_t k = 0; k < i; ++k)
+                    {
+                        sum -= t[i * M + k] * xr[k];
+                    }
+                    xr[i] = sum / t[i * M + i];
+                }
+
+                // back substitution: L' * x_r' = z
+                for (std::size_t i = M; i-- > 0;)
+                {
+                    data_t sum = xr[i];
+                    for (std::size_t k = i + 1; k < M; ++k)
+                    {
+                        sum -= t[k * M + i] * xr[k];
+                    }
+                    xr[i] = sum / t[i * M + i];
+                }
+            }
+        }
+    }
+
+    template <typename FilterType, std::size_t Outputs>
+    class Measurement;
+
+    /*!
+    * \brief Kalman filter with compile-time dimensions
+    * \tparam States The number of states
+    * \tparam Inputs The number of inputs
+    *
+    * The equivalent of a filter created by kalman_factory_filter.h. All matrices are zero-initialized.
+    * Since the embedded {\ref kalman_t} points into the object itself, filters can be neither copied nor moved.
+    */
+    template <std::size_t States, std::size_t Inputs = 0>
+    class Filter
+    {
+        static_assert(States > 0, "a filter requires at least one state");
+        static_assert(States <= MATRIX_MAX_DIMENSION && Inputs <= MATRIX_MAX_DIMENSION, "the C structures limit dimensions to MATRIX_MAX_DIMENSION");
+
+    public:
+        static constexpr std::size_t num_states = States;
+        static constexpr std::size_t num_inputs = Inputs;
+
+        Filter() noexcept
+            : x_{}, A_{}, P_{}, u_{}, B_{}, Q_{}, aux_{}, temp_PBQ_{}
+        {
+            // the predicted x vector shares its backing field with aux, just like in the filter factory
+            kalman_filter_initialize(&filter_, States, Inputs, A_.data(), x_.data(), B_.data(), u_.data(), P_.data(), Q_.data(),
+                                     aux_.data(), aux_.data(), temp_PBQ_.data(), temp_PBQ_.data());
+        }
+
+        Filter(const Filter&) = delete;
+        Filter& operator=(const Filter&) = delete;
+
+        /*!
+        * \brief Gets the C structure that shares its storage with this filter.
+        */
+        kalman_t& c_filter() noexcept { return filter_; }
+        const kalman_t& c_filter() const noexcept { return filter_; }
+
+        Matrix<States, 1>& x() noexcept { return x_; }
+        const Matrix<States, 1>& x() const noexcept { return x_; }
+
+        Matrix<States, States>& A() noexcept { return A_; }
+        const Matrix<States, States>& A() const noexcept { return A_; }
+
+        Matrix<States, States>& P() noexcept { return P_; }
+        const Matrix<States, States>& P() const noexcept { return P_; }
+
+        Matrix<Inputs, 1>& u() noexcept { return u_; }
+        const Matrix<Inputs, 1>& u() const noexcept { return u_; }
+
+        Matrix<States, Inputs>& B() noexcept { return B_; }
+        const Matrix<States, Inputs>& B() const noexcept { return B_; }
+
+        Matrix<Inputs, Inputs>& Q() noexcept { return Q_; }
+        const Matrix<Inputs, Inputs>& Q() const noexcept { return Q_; }
+
+        /*!
+        * \brief Performs the time update / prediction step.
+        * \see kalman_predict
+        */
+        void predict() noexcept
+        {
+            predict_x();
+            predict_Q_scaled(1);
+        }
+
+        /*!
+        * \brief Performs the time update / prediction step with a lambda factor (\c 0 < \c lambda <= \c 1).
+        * \see kalman_predict_tuned
+        */
+        void predict_tuned(data_t lambda) noexcept
+        {
+            predict_x();
+            predict_Q_scaled(static_cast<data_t>(1) / (lambda * lambda));
+        }
+
+        /*!
+        * \brief Performs the time update / prediction step of only the state vector.
+        * \see kalman_predict_x
+        */
+        void predict_x() noexcept
+        {
+            // x = A*x
+            detail::mult<States, States, 1>(A_.data(), x_.data(), aux_.data());
+            for (std::size_t i = 0; i < States; ++i)
+            {
+                x_[i] = aux_[i];
+            }
+        }
+
+        /*!
+        * \brief Performs the time update / prediction step of only the state covariance matrix.
+        * \see kalman_predict_Q
+        */
+        void predict_Q() noexcept
+        {
+            predict_Q_scaled(1);
+        }
+
+        /*!
+        * \brief Performs the measurement update step.
+        * \param[in] measurement The measurement to correct with.
+        * \return \c false if the residual covariance was not positive definite; state and covariance are then left unchanged.
+        *
+        * Measurements flagged with {\ref KALMAN_MEASUREMENT_FLAG_DIAGONAL_R} are forwarded to {\ref kalman_correct_sequential}.
+        *
+        * \see kalman_correct
+        */
+        template <std::size_t Outputs>
+        bool correct(Measurement<Filter, Outputs>& measurement) noexcept
+        {
+            kalman_measurement_t& kfm = measurement.c_measurement();
+            if (kfm.flags & KALMAN_MEASUREMENT_FLAG_DIAGONAL_R)
+            {
+                kalman_correct_sequential(&filter_, &kfm);
+                return true;
+            }
+
+            const data_t *const H = measurement.H().data();
+            data_t *const y = measurement.y_.data();
+            data_t *const S = measurement.S_.data();
+            data_t *const K = measurement.K_.data();
+            data_t *const HP = measurement.temp_HP_.data();
+
+            // y = z - H*x
+            detail::mult<Outputs, States, 1>(H, x_.data(), y);
+            for (std::size_t i = 0; i < Outputs; ++i)
+            {
+                y[i] = measurement.z()[i] - y[i];
+            }
+
+            // S = H*P*H' + R, with H*P = H*P' since P is symmetric
+            detail::mult_transb<Outputs, States, States>(H, P_.data(), HP);
+            detail::mult_transb_symmetric<Outputs, States, false>(HP, H, 1, S);
+            for (std::size_t i = 0; i < Outputs * Outputs; ++i)
+            {
+                S[i] += measurement.R()[i];
+            }
+
+            // K = P*H' * S^-1 = (H*P)' * (L*L')^-1
+            if (!detail::cholesky_decompose_lower<Outputs>(S)) return false;
+            detail::cholesky_solve_transb<Outputs, States>(S, HP, K);
+
+            // x = x + K*y
+            for (std::size_t i = 0; i < States; ++i)
+            {
+                data_t total = 0;
+                for (std::size_t j = 0; j < Outputs; ++j)
+                {
+                    total += K[i * Outputs + j] * y[j];
+                }
+                x_[i] += total;
+            }
+
+            // P = P - K*(H*P)
+            detail::multsub_symmetric<States, Outputs>(K, HP, P_.data());
+            return true;
+        }
+
+    private:
+        void predict_Q_scaled(const data_t scale) noexcept
+        {
+            // P = A*P*A' * scale
+            detail::mult<States, States, States>(A_.data(), P_.data(), temp_PBQ_.data());
+            detail::mult_transb_symmetric<States, States, false>(temp_PBQ_.data(), A_.data(), scale, P_.data());
+
+            // P = P + B*Q*B'
+            if constexpr (Inputs > 0)
+            {
+                detail::mult<States, Inputs, Inputs>(B_.data(), Q_.data(), temp_PBQ_.data());
+                detail::mult_transb_symmetric<States, Inputs, true>(temp_PBQ_.data(), B_.data(), 1, P_.data());
+            }
+        }
+
+        kalman_t filter_;
+
+        Matrix<States, 1> x_;
+        Matrix<States, States> A_;
+        Matrix<States, States> P_;
+        Matrix<Inputs, 1> u_;
+        Matrix<States, Inputs> B_;
+        Matrix<Inputs, Inputs> Q_;
+
+        std::array<data_t, detail::max(States, Inputs)> aux_;
+        std::array<data_t, detail::max(States * States, States * Inputs)> temp_PBQ_;
+    };
+
+    /*!
+    * \brief Kalman filter measurement with compile-time dimensions
+    * \tparam FilterType The {\ref Filter} this measurement corrects
+    * \tparam Outputs The number of measured outputs
+    *
+    * The equivalent of a measurement created by kalman_factory_measurement.h. All matrices are zero-initialized.
+    */
+    template <typename FilterType, std::size_t Outputs>
+    class Measurement
+    {
+        static constexpr std::size_t States = FilterType::num_states;
+
+        static_assert(Outputs > 0, "a measurement requires at least one output");
+        static_assert(Outputs <= MATRIX_MAX_DIMENSION, "the C structures limit dimensions to MATRIX_MAX_DIMENSION");
+
+        template <std::size_t, std::size_t>
+        friend class Filter;
+
+    public:
+        static constexpr std::size_t num_measurements = Outputs;
+
+        Measurement() noexcept
+            : z_{}, H_{}, R_{}, y_{}, S_{}, K_{}, aux_{}, temp_HP_{}
+        {
+            kalman_measurement_initialize(&measurement_, States, Outputs, H_.data(), z_.data(), R_.data(), y_.data(), S_.data(), K_.data(),
+                                          aux_.data(), temp_HP_.data());
+        }
+
+        Measurement(const Measurement&) = delete;
+        Measurement& operator=(const Measurement&) = delete;
+
+        /*!
+        * \brief Gets the C structure that shares its storage with this measurement.
+        */
+        kalman_measurement_t& c_measurement() noexcept { return measurement_; }
+        const kalman_measurement_t& c_measurement() const noexcept { return measurement_; }
+
+        Matrix<Outputs, 1>& z() noexcept { return z_; }
+        const Matrix<Outputs, 1>& z() const noexcept { return z_; }
+
+        Matrix<Outputs, States>& H() noexcept { return H_; }
+        const Matrix<Outputs, States>& H() const noexcept { return H_; }
+
+        Matrix<Outputs, Outputs>& R() noexcept { return R_; }
+        const Matrix<Outputs, Outputs>& R() const noexcept { return R_; }
+
+        const Matrix<Outputs, 1>& y() const noexcept { return y_; }
+        const Matrix<Outputs, Outputs>& S() const noexcept { return S_; }
+        const Matrix<States, Outputs>& K() const noexcept { return K_; }
+
+    private:
+        kalman_measurement_t measurement_;
+
+        Matrix<Outputs, 1> z_;
+        Matrix<Outputs, States> H_;
+        Matrix<Outputs, Outputs> R_;
+        Matrix<Outputs, 1> y_;
+        Matrix<Outputs, Outputs> S_;
+        Matrix<States, Outputs> K_;
+
+        std::array<data_t, detail::max(States, Outputs)> aux_;
+        std::array<data_t, Outputs * States> temp_HP_;
+    };
+}
+
+#endif
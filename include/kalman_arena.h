@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef KALMAN_ARENA_H_
+#define KALMAN_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "compiler.h"
+#include "kalman.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+* \def KALMAN_ARENA_ALIGNMENT Alignment of every block and every matrix carved from an arena, in bytes
+*
+* Matches the cache line size of common targets and the width of an AVX-512 register.
+*/
+#define KALMAN_ARENA_ALIGNMENT      (64u)
+
+/*!
+* \def KALMAN_ARENA_NUM_CLASSES Number of block size classes
+*
+* Class \c c holds blocks of <tt>KALMAN_ARENA_ALIGNMENT << c</tt> bytes.
+*/
+#define KALMAN_ARENA_NUM_CLASSES    (26u)
+
+/*!
+* \brief Memory arena for filters and measurements created at runtime
+*
+* The arena hands out blocks from a caller-supplied buffer. Block sizes are rounded up to a power of two
+* (at least {\ref KALMAN_ARENA_ALIGNMENT} bytes); released blocks go to a free list per size class and are
+* reused by the next allocation of the same class, so both allocation and release take constant time and
+* never call \c malloc. Released memory is not coalesced.
+*
+* An arena is not thread-safe.
+*/
+typedef struct
+{
+    /*!
+    * \brief Start of the usable, aligned buffer
+    */
+    uint8_t *base;
+
+    /*!
+    * \brief Size of the usable buffer in bytes
+    */
+    size_t size;
+
+    /*!
+    * \brief Number of bytes handed out from the buffer so far
+    */
+    size_t used;
+
+    /*!
+    * \brief Heads of the free lists, one per size class
+    */
+    void *free_list[KALMAN_ARENA_NUM_CLASSES];
+} kalman_arena_t;
+
+/*!
+* \brief Initializes an arena over a buffer
+* \param[in] arena The arena to initialize
+* \param[in] buffer The backing buffer; it need not be aligned.
+* \param[in] size The size of the buffer in bytes
+*/
+void kalman_arena_init(kalman_arena_t *arena, void *buffer, size_t size) COLD;
+
+/*!
+* \brief Allocates a block from an arena
+* \param[in] arena The arena
+* \param[in] size The requested size in bytes
+* \return The block, aligned to {\ref KALMAN_ARENA_ALIGNMENT}, or \c NULL if the arena is exhausted.
+*/
+void* kalman_arena_alloc(kalman_arena_t *arena, size_t size);
+
+/*!
+* \brief Releases a block to its free list
+* \param[in] arena The arena the block was allocated from
+* \param[in] block The block; may be \c NULL.
+* \param[in] size The size the block was requested with
+*/
+void kalman_arena_free(kalman_arena_t *arena, void *block, size_t size);
+
+/*!
+* \brief Gets the number of bytes {\ref kalman_create} requests for a filter
+* \param[in] num_states The number of states
+* \param[in] num_inputs The number of inputs
+* \return The size of the block holding the structure and all matrices.
+*/
+size_t kalman_create_size(matrix_index_t num_states, matrix_index_t num_inputs) PURE;
+
+/*!
+* \brief Gets the number of bytes {\ref kalman_measurement_create} requests for a measurement
+* \param[in] num_states The number of states
+* \param[in] num_measurements The number of measured outputs
+* \return The size of the block holding the structure and all matrices.
+*/
+size_t kalman_measurement_create_size(matrix_index_t num_states, matrix_index_t num_measurements) PURE;
+
+/*!
+* \brief Gets the number of bytes {\ref kalman_create_shared} requests for a filter
+* \param[in] num_states The number of states
+* \param[in] num_inputs The number of inputs
+* \return The size of the block holding the structure and the persistent matrices.
+*/
+size_t kalman_create_shared_size(matrix_index_t num_states, matrix_index_t num_inputs) PURE;
+
+/*!
+* \brief Gets the number of bytes {\ref kalman_measurement_create_shared} requests for a measurement
+* \param[in] num_states The number of states
+* \param[in] num_measurements The number of measured outputs
+* \return The size of the block holding the structure and the persistent matrices.
+*/
+size_t kalman_measurement_create_shared_size(matrix_index_t num_states, matrix_index_t num_measurements) PURE;
+
+/*!
+* \brief Creates a filter in an arena
+* \param[in] arena The arena to allocate from
+* \param[in] num_states The number of states
+* \param[in] num_inputs The number of inputs
+* \return The filter with all matrices zeroed, or \c NULL if the arena is exhausted.
+*
+* The structure, all matrices and all temporaries are placed in one contiguous block; every matrix starts
+* on its own cache line. The temporaries are aliased just like in the filter factory.
+*
+* \see kalman_destroy
+*/
+kalman_t* kalman_create(kalman_arena_t *arena, matrix_index_t num_states, matrix_index_t num_inputs);
+
+/*!
+* \brief Creates a filter without temporaries in an arena
+* \param[in] arena The arena to allocate from
+* \param[in] num_states The number of states
+* \param[in] num_inputs The number of inputs
+* \return The filter with all matrices zeroed, or \c NULL if the arena is exhausted.
+*
+* Only the structure and the persistent matrices x, A, B, u, P and Q are placed in the block. The filter is
+* flagged with {\ref KALMAN_FLAG_SCRATCH} and takes its temporaries from the scratch area of the calling thread.
+*
+* \see kalman_scratch_attach
+* \see kalman_destroy
+*/
+kalman_t* kalman_create_shared(kalman_arena_t *arena, matrix_index_t num_states, matrix_index_t num_inputs);
+
+/*!
+* \brief Releases a filter created by {\ref kalman_create} or {\ref kalman_create_shared}
+* \param[in] arena The arena the filter was created in
+* \param[in] kf The filter; may be \c NULL.
+*/
+void kalman_destroy(kalman_arena_t *arena, kalman_t *kf);
+
+/*!
+* \brief Creates a measurement in an arena
+* \param[in] arena The arena to allocate from
+* \param[in] num_states The number of states of the filter to be corrected
+* \param[in] num_measurements The number of measured outputs
+* \return The measurement with all matrices zeroed, or \c NULL if the arena is exhausted.
+*
+* \see kalman_measurement_destroy
+*/
+kalman_measurement_t* kalman_measurement_create(kalman_arena_t *arena, matrix_index_t num_states, matrix_index_t num_measurements);
+
+/*!
+* \brief Creates a measurement without temporaries in an arena
+* \param[in] arena The arena to allocate from
+* \param[in] num_states The number of states of the filter to be corrected
+* \param[in] num_measurements The number of measured outputs
+* \return The measurement with all matrices zeroed, or \c NULL if the arena is exhausted.
+*
+* The measurement is flagged with {\ref KALMAN_MEASUREMENT_FLAG_SCRATCH} and takes its auxiliary vector and
+* temporary HP from the scratch area of the calling thread.
+*
+* \see kalman_measurement_destroy
+*/
+kalman_measurement_t* kalman_measurement_create_shared(kalman_arena_t *arena, matrix_index_t num_states, matrix_index_t num_measurements);
+
+/*!
+* \brief Releases a measurement created by {\ref kalman_measurement_create} or {\ref kalman_measurement_create_shared}
+* \param[in] arena The arena the measurement was created in
+* \param[in] kfm The measurement; may be \c NULL.
+*/
+void kalman_measurement_destroy(kalman_arena_t *arena, kalman_measurement_t *kfm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,306 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef KALMAN_BATCH_H_
+#define KALMAN_BATCH_H_
+
+#include <stdint.h>
+#include "compiler.h"
+#include "matrix.h"
+#include "kalman.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+* \def KALMAN_BATCH_LANES The number of filters processed side by side in one batch.
+*
+* Pick the SIMD width of the target in elements of {\ref matrix_data_t}, e.g. 4 for SSE/NEON,
+* 8 for AVX2 or 16 for AVX-512. Must not exceed 32.
+*/
+#ifndef KALMAN_BATCH_LANES
+#define KALMAN_BATCH_LANES 8
+#endif
+
+#if KALMAN_BATCH_LANES <= 0 || KALMAN_BATCH_LANES > 32
+#error KALMAN_BATCH_LANES must be in the range 1..32
+#endif
+
+/*!
+* \brief One matrix element of all filters in a batch.
+*
+* Element \c [l] belongs to the filter in lane \c l.
+*/
+typedef matrix_data_t kalman_batch_lane_t[KALMAN_BATCH_LANES];
+
+/*!
+* \brief Lane-interleaved matrix
+*
+* Stores the same matrix of {\ref KALMAN_BATCH_LANES} filters such that every element is a contiguous
+* vector of lanes, i.e. element (row, column) of the filter in lane \c l is found at
+* <tt>data[row * cols + column][l]</tt>.
+*/
+typedef struct
+{
+    /*!
+    * \brief Number of rows
+    */
+    matrix_index_t rows;
+
+    /*!
+    * \brief Number of columns
+    */
+    matrix_index_t cols;
+
+    /*!
+    * \brief Pointer to the lane vectors of size {\see rows} x {\see cols}.
+    */
+    kalman_batch_lane_t *data;
+} kalman_batch_matrix_t;
+
+/*!
+* \brief Batch of {\ref KALMAN_BATCH_LANES} Kalman filters of identical shape
+*
+* All filters of a batch share the number of states, inputs and measurements and are stored
+* structure-of-arrays style, so that every arithmetic operation runs over all lanes at once.
+* To run more filters than there are lanes, use an array of batches (array-of-structures-of-arrays).
+*
+* \see kalman_t
+* \see kalman_measurement_t
+*/
+typedef struct
+{
+    /*!
+    * \brief Number of states
+    */
+    matrix_index_t num_states;
+
+    /*!
+    * \brief Number of inputs
+    */
+    matrix_index_t num_inputs;
+
+    /*!
+    * \brief Number of measurements
+    */
+    matrix_index_t num_measurements;
+
+    /*!
+    * \brief State vector
+    */
+    kalman_batch_matrix_t x;
+
+    /*!
+    * \brief System matrix
+    */
+    kalman_batch_matrix_t A;
+
+    /*!
+    * \brief System covariance matrix
+    */
+    kalman_batch_matrix_t P;
+
+    /*!
+    * \brief Input matrix
+    */
+    kalman_batch_matrix_t B;
+
+    /*!
+    * \brief Input covariance/uncertainty matrix
+    */
+    kalman_batch_matrix_t Q;
+
+    /*!
+    * \brief Measurement vector
+    */
+    kalman_batch_matrix_t z;
+
+    /*!
+    * \brief Measurement transformation matrix
+    */
+    kalman_batch_matrix_t H;
+
+    /*!
+    * \brief Process noise covariance matrix
+    */
+    kalman_batch_matrix_t R;
+
+    /*!
+    * \brief Innovation vector
+    */
+    kalman_batch_matrix_t y;
+
+    /*!
+    * \brief Residual covariance matrix
+    */
+    kalman_batch_matrix_t S;
+
+    /*!
+    * \brief Kalman gain matrix
+    */
+    kalman_batch_matrix_t K;
+
+    /*!
+    * \brief Temporary variables.
+    */
+    struct
+    {
+        /*!
+        * \brief x-sized temporary vector
+        */
+        kalman_batch_matrix_t x;
+
+        /*!
+        * \brief P-sized temporary matrix, shares its backing field with BQ
+        */
+        kalman_batch_matrix_t P;
+
+        /*!
+        * \brief BxQ-sized temporary matrix, shares its backing field with P
+        */
+        kalman_batch_matrix_t BQ;
+
+        /*!
+        * \brief H-sized temporary matrix for HxP
+        */
+        kalman_batch_matrix_t HP;
+
+        /*!
+        * \brief S-sized temporary matrix for the inverted residual covariance
+        */
+        kalman_batch_matrix_t S_inv;
+    } temporary;
+
+} kalman_batch_t;
+
+/*!
+* \def KALMAN_BATCH_TEMP_P_SIZE Number of lane vectors of the shared temporary P/BQ backing field
+*/
+#define KALMAN_BATCH_TEMP_P_SIZE(num_states, num_inputs) \
+    (((num_states) > (num_inputs)) ? (num_states) * (num_states) : (num_states) * (num_inputs))
+
+/*!
+* \def KALMAN_BATCH_BUFFER_SIZE Number of {\ref kalman_batch_lane_t} elements required for the backing buffer of a batch
+* \param[in] num_states The number of states
+* \param[in] num_inputs The number of inputs
+* \param[in] num_measurements The number of measurements
+*/
+#define KALMAN_BATCH_BUFFER_SIZE(num_states, num_inputs, num_measurements)                              \
+    (  2 * (num_states)                                 /* x, temporary x */                            \
+     + 2 * (num_states) * (num_states)                  /* A, P */                                      \
+     + (num_states) * (num_inputs)                      /* B */                                         \
+     + (num_inputs) * (num_inputs)                      /* Q */                                         \
+     + 2 * (num_measurements)                           /* z, y */                                      \
+     + 3 * (num_measurements) * (num_states)            /* H, K, temporary HP */                        \
+     + 3 * (num_measurements) * (num_measurements)      /* R, S, temporary S_inv */                     \
+     + KALMAN_BATCH_TEMP_P_SIZE(num_states, num_inputs) /* temporary P/BQ */)
+
+/*!
+* \brief Initializes a batch of Kalman filters
+* \param[in] batch The batch structure to initialize
+* \param[in] num_states The number of state variables
+* \param[in] num_inputs The number of input variables
+* \param[in] num_measurements The number of measured outputs
+* \param[in] buffer The backing buffer of {\ref KALMAN_BATCH_BUFFER_SIZE} lane vectors; all elements will be zeroed.
+*
+* Aligning \c buffer to the SIMD width (or the cache line size) allows the compiler to use aligned loads.
+*/
+void kalman_batch_initialize(kalman_batch_t *batch, matrix_index_t num_states, matrix_index_t num_inputs, matrix_index_t num_measurements,
+                             kalman_batch_lane_t *buffer) COLD;
+
+/*!
+* \brief Copies a filter and its measurement into one lane of a batch
+* \param[in] batch The batch
+* \param[in] lane The lane to load into
+* \param[in] kf The filter; its dimensions must match the batch, and deferred propagations must have been flushed (see {\ref kalman_flush_covariance}).
+* \param[in] kfm The measurement; its dimensions must match the batch. May be \c NULL.
+*/
+void kalman_batch_load(kalman_batch_t *batch, matrix_index_t lane, const kalman_t *kf, const kalman_measurement_t *kfm) COLD;
+
+/*!
+* \brief Copies state, covariance and gain of one lane of a batch back into a filter and its measurement
+* \param[in] batch The batch
+* \param[in] lane The lane to store from
+* \param[in] kf The filter to receive x and P
+* \param[in] kfm The measurement to receive y, S and K. May be \c NULL.
+*/
+void kalman_batch_store(const kalman_batch_t *batch, matrix_index_t lane, kalman_t *kf, kalman_measurement_t *kfm) COLD;
+
+/*!
+* \brief Performs the time update / prediction step for all filters of the batch.
+* \param[in] batch The batch to predict with.
+*
+* \see kalman_predict
+*/
+void kalman_batch_predict(kalman_batch_t *batch) HOT;
+
+/*!
+* \brief Performs the time update / prediction step for all filters of the batch.
+* \param[in] batch The batch to predict with.
+* \param[in] lambda Lambda factor (\c 0 < {\ref lambda} <= \c 1) to forcibly reduce prediction certainty.
+*
+* \see kalman_predict_tuned
+*/
+void kalman_batch_predict_tuned(kalman_batch_t *batch, matrix_data_t lambda) HOT;
+
+/*!
+* \brief Performs the measurement update step for all filters of the batch.
+* \param[in] batch The batch to correct.
+* \return Bit mask of the lanes whose residual covariance was not positive definite; these lanes are left unchanged.
+*
+* \see kalman_correct
+*/
+uint_fast32_t kalman_batch_correct(kalman_batch_t *batch) HOT;
+
+/*!
+* \brief Gets an element of one lane of a batch matrix
+* \param[in] mat The matrix to get from
+* \param[in] row The row
+* \param[in] column The column
+* \param[in] lane The lane
+* \return The value at the given cell.
+*/
+STATIC_INLINE matrix_data_t kalman_batch_get(const kalman_batch_matrix_t *const mat, const matrix_index_t row, const matrix_index_t column, const matrix_index_t lane)
+{
+    return mat->data[(matrix_offset_t)row * mat->cols + column][lane];
+}
+
+/*!
+* \brief Sets an element of one lane of a batch matrix
+* \param[in] mat The matrix to set
+* \param[in] row The row
+* \param[in] column The column
+* \param[in] lane The lane
+* \param[in] value The value to set
+*/
+STATIC_INLINE void kalman_batch_set(kalman_batch_matrix_t *const mat, const matrix_index_t row, const matrix_index_t column, const matrix_index_t lane, const matrix_data_t value)
+{
+    mat->data[(matrix_offset_t)row * mat->cols + column][lane] = value;
+}
+
+/*!
+* \brief Sets an element of all lanes of a batch matrix
+* \param[in] mat The matrix to set
+* \param[in] row The row
+* \param[in] column The column
+* \param[in] value The value to set
+*/
+STATIC_INLINE void kalman_batch_set_all(kalman_batch_matrix_t *const mat, const matrix_index_t row, const matrix_index_t column, const matrix_data_t value)
+{
+    matrix_index_t l;
+    matrix_data_t *RESTRICT const lanes = mat->data[(matrix_offset_t)row * mat->cols + column];
+    for (l = 0; l < KALMAN_BATCH_LANES; ++l)
+    {
+        lanes[l] = value;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef KALMAN_CONTINUOUS_H_
+#define KALMAN_CONTINUOUS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "compiler.h"
+#include "matrix.h"
+#include "kalman.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+* \def KALMAN_CONTINUOUS_SLOTS The number of quantized time steps a continuous-time model keeps discretizations of
+*/
+#ifndef KALMAN_CONTINUOUS_SLOTS
+#define KALMAN_CONTINUOUS_SLOTS     (8u)
+#endif
+
+/*!
+* \def KALMAN_CONTINUOUS_TAYLOR_ORDER The order of the Taylor series of the matrix exponential after scaling
+*/
+#ifndef KALMAN_CONTINUOUS_TAYLOR_ORDER
+#define KALMAN_CONTINUOUS_TAYLOR_ORDER  (8u)
+#endif
+
+/*!
+* \def KALMAN_CONTINUOUS_MAX_SQUARINGS The largest number of squarings of the matrix exponential
+*
+* Bounds the work of a discretization. The Van Loan matrix of a time step must have an infinity norm of at most
+* 2^(KALMAN_CONTINUOUS_MAX_SQUARINGS - 1); with the default, 32768 is far beyond the range of \c float anyway.
+*/
+#ifndef KALMAN_CONTINUOUS_MAX_SQUARINGS
+#define KALMAN_CONTINUOUS_MAX_SQUARINGS (16u)
+#endif
+
+/*!
+* \def KALMAN_CONTINUOUS_SIZE Gets the number of elements of the buffer of a continuous-time model for a filter of the given shape
+*
+* F, the slots with A and Qd each, the three 2n x 2n matrices of the matrix exponential, a product and two vectors.
+*/
+#define KALMAN_CONTINUOUS_SIZE(num_states, num_inputs) \
+    ((1u + 2u * KALMAN_CONTINUOUS_SLOTS + 12u) * (size_t)(num_states) * (num_states) \
+     + (size_t)(num_states) * (((num_states) > (num_inputs)) ? (num_states) : (num_inputs)) \
+     + 3u * (size_t)(num_states))
+
+/*!
+* \brief The discretization of the model for one quantized time step
+*/
+typedef struct
+{
+    /*!
+    * \brief The time step in multiples of the resolution, or zero if the slot is empty
+    */
+    uint_fast32_t ticks;
+
+    /*!
+    * \brief The model version the slot was calculated for
+    * \see kalman_t::model_version
+    */
+    uint_fast32_t model_version;
+
+    /*!
+    * \brief The use counter of the model at the last use of the slot
+    */
+    uint_fast32_t last_used;
+
+    /*!
+    * \brief The state transition A = e^(F*dt)
+    */
+    matrix_t A;
+
+    /*!
+    * \brief The process noise Qd, the integral of e^(F*t)*G*Qc*G'*e^(F*t)' over the time step; stored like P
+    */
+    matrix_t Q;
+} kalman_continuous_slot_t;
+
+/*!
+* \brief A continuous-time model dx/dt = F*x + G*w, with w of spectral density Qc
+*
+* G and Qc are the input transition B and input covariance Q of the filter the model is attached to; F is kept here.
+* The model is discretized for every time step by Van Loan's method, and the discretizations of recent time steps are
+* kept in a least recently used table keyed by the time step rounded to the resolution.
+*/
+typedef struct kalman_continuous_t
+{
+    /*!
+    * \brief The continuous-time system matrix F
+    * \see kalman_set_continuous_transition
+    */
+    matrix_t F;
+
+    /*!
+    * \brief The resolution time steps are rounded to
+    */
+    matrix_data_t resolution;
+
+    /*!
+    * \brief The slots
+    */
+    kalman_continuous_slot_t slots[KALMAN_CONTINUOUS_SLOTS];
+
+    /*!
+    * \brief Counts the uses of the table
+    */
+    uint_fast32_t clock;
+
+    /*!
+    * \brief The number of hits
+    */
+    uint_fast32_t hits;
+
+    /*!
+    * \brief The number of misses, i.e. of matrix exponentials
+    */
+    uint_fast32_t misses;
+
+    /*!
+    * \brief The Van Loan matrix and the two matrices of the matrix exponential (2n x 2n each)
+    */
+    matrix_t temporary[3];
+
+    /*!
+    * \brief Temporary product (\c num_states x \c num_states, or \c num_states x \c num_inputs)
+    */
+    matrix_t temp;
+
+    /*!
+    * \brief Auxiliary vector that can hold a column of any operand
+    */
+    matrix_data_t *aux;
+
+    /*!
+    * \brief Temporary state vector
+    */
+    matrix_t x;
+} kalman_continuous_t;
+
+/*!
+* \brief Attaches a continuous-time model to a filter
+* \param[in] kf The Kalman Filter structure; its B and Q are G and Qc of the model.
+* \param[in] ct The model to initialize; F starts as zero. \c NULL detaches the current one.
+* \param[in] resolution The resolution time steps are rounded to
+* \param[in] buffer The buffer of {\ref KALMAN_CONTINUOUS_SIZE} elements
+* \param[in] size The number of elements of the buffer
+*/
+void kalman_continuous_init(kalman_t *kf, kalman_continuous_t *ct, matrix_data_t resolution, matrix_data_t *buffer, size_t size) COLD;
+
+/*!
+* \brief Sets an element of the continuous-time system matrix F
+* \param[in] kf The Kalman Filter structure with a continuous-time model
+* \param[in] row The row
+* \param[in] column The column
+* \param[in] value The value
+*/
+void kalman_set_continuous_transition(kalman_t *kf, matrix_index_t row, matrix_index_t column, matrix_data_t value);
+
+/*!
+* \brief Performs the time update / prediction step over a time step of the continuous-time model
+* \param[in] kf The Kalman Filter structure with a continuous-time model
+* \param[in] dt The time step, rounded to the resolution of the model; finite and less than 2^32 resolutions.
+*
+* Applies x = A*x and P = A*P*A' + Qd with the discretization of the rounded time step. Time steps seen recently
+* are looked up; others are discretized through the matrix exponential of the Van Loan matrix
+* [-F G*Qc*G'; 0 F']*dt, which yields A' and A^-1*Qd. The filter's A is left untouched. A time step rounding to
+* zero does nothing. Any other leaves the steady state, whose gain only holds for the discrete model. The infinity
+* norm of the Van Loan matrix, i.e. about dt times the norms of F and G*Qc*G', must be finite and at most
+* 2^({\ref KALMAN_CONTINUOUS_MAX_SQUARINGS} - 1); this is asserted, and without assertions a larger one yields an
+* inaccurate discretization after the largest number of squarings.
+*/
+void kalman_predict_dt(kalman_t *kf, matrix_data_t dt) HOT;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -4,6 +4,103 @@
 // Part of kalman-clib — https://github.com/sunsided/kalman-clib
 // Licensed under the MIT License. See LICENSE.md in the project root for details.
 
+/*!
+* \brief Creates the temporary buffers shared by a filter and its measurements, and reports its static footprint
+*
+* The auxiliary and temporary buffers are sized for the largest need of the filter and all measurements defined
+* since kalman_factory_filter.h was included. The total number of bytes of all buffers and structures of the
+* filter and all of its instances is then available as KALMAN_FILTER_BYTES(). If KALMAN_FOOTPRINT_LIMIT is
+* defined, every filter whose footprint exceeds that number of bytes fails to compile. The footprint of the filter alone,
+* including the shared temporaries, is KALMAN_FILTER_ONLY_BYTES(). If KALMAN_REGISTRY is set, the descriptor the
+* initialization function registers is created here as well.
+*/
+
+/************************************************************************/
+/* Construct shared temporary buffers                                   */
+/************************************************************************/
+
+#if !KALMAN_SHARED_SCRATCH
+
+#define __KALMAN_aux_total      KALMAN_TOTAL_NAME(aux_elements_, __KALMAN_MEASUREMENT_COUNT)
+#define __KALMAN_temp_total     KALMAN_TOTAL_NAME(temp_elements_, __KALMAN_MEASUREMENT_COUNT)
+
+#pragma message("Creating Kalman filter shared aux buffer: " STRINGIFY(KALMAN_BUFFER_NAME(aux)))
+static matrix_data_t KALMAN_BUFFER_NAME(aux)[__KALMAN_aux_total];
+
+#pragma message("Creating Kalman filter shared temporary P/BQ/HxP buffer: " STRINGIFY(KALMAN_BUFFER_NAME(tempPBQ)))
+static matrix_data_t KALMAN_BUFFER_NAME(tempPBQ)[__KALMAN_temp_total];
+
+static matrix_data_t* KALMAN_FUNCTION_NAME(get_aux_buffer)(void)
+{
+    return KALMAN_BUFFER_NAME(aux);
+}
+
+static matrix_data_t* KALMAN_FUNCTION_NAME(get_temp_buffer)(void)
+{
+    return KALMAN_BUFFER_NAME(tempPBQ);
+}
+
+#endif
+
+/************************************************************************/
+/* Report static footprint                                              */
+/************************************************************************/
+
+#pragma message("Static footprint of Kalman filter \"" STRINGIFY(KALMAN_NAME) "\" and its " STRINGIFY(__KALMAN_MEASUREMENT_COUNT) " measurement(s) available as KALMAN_FILTER_BYTES(" STRINGIFY(KALMAN_NAME) ")")
+
+#if KALMAN_SHARED_SCRATCH
+#define __KALMAN_shared_bytes   0
+#else
+#define __KALMAN_shared_bytes   (sizeof(matrix_data_t) * ((size_t)__KALMAN_aux_total + __KALMAN_temp_total))
+#endif
+
+/*!
+* \brief A byte array as large as all buffers and structures of the filter and its measurements
+* \see KALMAN_FILTER_BYTES
+*/
+typedef uint8_t KALMAN_FUNCTION_NAME(footprint_t)[sizeof(KALMAN_TOTAL_NAME(footprint_, __KALMAN_MEASUREMENT_COUNT)) + __KALMAN_shared_bytes];
+
+/*!
+* \brief A byte array as large as the buffers and structures of the filter alone
+* \see KALMAN_FILTER_ONLY_BYTES
+*
+* The footprint of the filter alone includes the temporaries it shares with its measurements, so that it adds up with the
+* footprints of the measurements (KALMAN_MEASUREMENT_BYTES()) to the total.
+*/
+typedef uint8_t KALMAN_FUNCTION_NAME(filter_footprint_t)[sizeof(KALMAN_TOTAL_NAME(footprint_, 0)) + __KALMAN_shared_bytes];
+
+#undef __KALMAN_shared_bytes
+
+#ifdef KALMAN_FOOTPRINT_LIMIT
+KALMAN_STATIC_ASSERT_FOOTPRINT(sizeof(KALMAN_FUNCTION_NAME(footprint_t)), KALMAN_FOOTPRINT_LIMIT);
+#endif
+
+/************************************************************************/
+/* Register filter                                                      */
+/************************************************************************/
+
+#if KALMAN_REGISTRY
+
+/*!
+* \brief The descriptor of the filter in the runtime registry
+*/
+static kalman_registry_entry_t KALMAN_FUNCTION_NAME(registry_entry) =
+{
+    STRINGIFY(KALMAN_NAME), 0, &KALMAN_STRUCT_NAME,
+    KALMAN_NUM_STATES, KALMAN_NUM_INPUTS, 0, KALMAN_NUM_INSTANCES,
+    sizeof(KALMAN_FUNCTION_NAME(filter_footprint_t)), 0, 0
+};
+
+static void KALMAN_FUNCTION_NAME(register_entry)(void)
+{
+    kalman_registry_add(&KALMAN_FUNCTION_NAME(registry_entry));
+}
+
+#endif
+
+#undef __KALMAN_aux_total
+#undef __KALMAN_temp_total
+
 /************************************************************************/
 /* Clean up                                                             */
 /************************************************************************/
@@ -12,6 +109,9 @@
 #undef KALMAN_NAME
 #undef KALMAN_NUM_STATES
 #undef KALMAN_NUM_INPUTS
+#undef KALMAN_PACKED_COVARIANCE
+#undef KALMAN_SHARED_SCRATCH
+#undef KALMAN_NUM_INSTANCES
 
 // remove x macros
 #undef __KALMAN_x_ROWS
@@ -31,6 +131,7 @@
 // remove P macros
 #undef __KALMAN_P_ROWS
 #undef __KALMAN_P_COLS
+#undef __KALMAN_P_size
 #undef __KALMAN_BUFFER_P
 
 // remove B macros
@@ -61,10 +162,18 @@
 // remove auxiliaries
 #undef __KALMAN_BUFFER_aux
 #undef __KALMAN_BUFFER_tempPBQ
+#undef __KALMAN_aux_size
 #undef __KALMAN_tempP_size
 #undef __KALMAN_tempBQ_size
 #undef __KALMAN_tempPBQ_size
 
+// remove measurement counting
+#undef __KALMAN_MEASUREMENT_COUNT
+#undef __KALMAN_INDEX_HELPER
+#undef __KALMAN_INDEX_HELPER2
+#undef KALMAN_TOTAL_NAME
+
 // remove measurement defines just because we can
 #undef KALMAN_MEASUREMENT_NAME
-#undef KALMAN_NUM_MEASUREMENTS
\ No newline at end of file
+#undef KALMAN_NUM_MEASUREMENTS
+#undef KALMAN_MEASUREMENT_DIAGONAL_R
\ No newline at end of file
@@ -61,8 +61,43 @@
 *   kalman_filter_example.x.data[0] = 1;
 * }
 * \endcode
+*
+* If KALMAN_PACKED_COVARIANCE is defined to 1 prior to inclusion of this file, the state covariance P is stored
+* as its packed upper triangle (see matrix_init_packed()), which nearly halves its buffer. Access P through
+* matrix_get_packed() and matrix_set_packed() in that case. This define is removed by kalman_factory_cleanup.h.
+*
+* The auxiliary and temporary buffers of the filter are shared with all of its measurements and created by
+* kalman_factory_cleanup.h, which also defines the total static footprint of the filter, available as
+* KALMAN_FILTER_BYTES() (see there). If KALMAN_REGISTRY is set, the initialization function adds the filter
+* to the runtime registry (see kalman_registry_first()).
+*
+* If KALMAN_SHARED_SCRATCH is defined to 1 prior to inclusion of this file, no temporary buffers are created for the
+* filter and its measurements. They are taken from the scratch area attached to the calling thread instead (see
+* kalman_scratch_attach()), which must hold at least KALMAN_SCRATCH_SIZE() elements for the largest filter using it.
+* This define is removed by kalman_factory_cleanup.h.
+*
+* If KALMAN_NUM_INSTANCES is defined to a number N greater than 1 prior to inclusion of this file, N identical filters are
+* created instead of one: \c kalman_filter_<name> becomes an array of N filters, the initialization function takes the
+* index of the filter (\c {kalman_filter_<name>_init(i)}) and \c {kalman_filter_<name>_get(i)} returns a filter by index.
+* The persistent buffers of all filters (A, P, x and B, Q, u) live in one cache-line aligned array
+* \c kalman_filter_<name>_instances_buffer of \c kalman_filter_<name>_instance_t, one record per filter, so that updating
+* the filters in index order streams through memory. Measurements defined for the filter are instantiated N times as well.
+* All instances share the temporary buffers, so they must be updated from one thread at a time unless KALMAN_SHARED_SCRATCH
+* is set. This define is removed by kalman_factory_cleanup.h.
 */
 
+#ifndef KALMAN_NUM_INSTANCES
+#define KALMAN_NUM_INSTANCES 1
+#endif
+
+#ifndef KALMAN_PACKED_COVARIANCE
+#define KALMAN_PACKED_COVARIANCE 0
+#endif
+
+#ifndef KALMAN_SHARED_SCRATCH
+#define KALMAN_SHARED_SCRATCH 0
+#endif
+
 /************************************************************************/
 /* Check for inputs                                                     */
 /************************************************************************/
@@ -83,6 +118,10 @@
 #error KALMAN_NUM_INPUTS must be a positive integer or zero if no inputs are used
 #endif
 
+#if KALMAN_NUM_INSTANCES <= 0
+#error KALMAN_NUM_INSTANCES must be a positive integer
+#endif
+
 /************************************************************************/
 /* Prepare dimensions                                                   */
 /************************************************************************/
@@ -93,6 +132,12 @@
 #define __KALMAN_P_ROWS     KALMAN_NUM_STATES
 #define __KALMAN_P_COLS     KALMAN_NUM_STATES
 
+#if KALMAN_PACKED_COVARIANCE
+#define __KALMAN_P_size     MATRIX_PACKED_SIZE(KALMAN_NUM_STATES)
+#else
+#define __KALMAN_P_size     (__KALMAN_P_ROWS * __KALMAN_P_COLS)
+#endif
+
 #define __KALMAN_x_ROWS     KALMAN_NUM_STATES
 #define __KALMAN_x_COLS     1
 
@@ -125,6 +170,18 @@
 
 #pragma message("** Instantiating Kalman filter \"" STRINGIFY(KALMAN_NAME) "\" with " STRINGIFY(KALMAN_NUM_STATES) " states and " STRINGIFY(KALMAN_NUM_INPUTS) " inputs")
 
+#if KALMAN_PACKED_COVARIANCE
+#pragma message("KALMAN_PACKED_COVARIANCE was set. P will be stored as a packed upper triangle.")
+#endif
+
+#if KALMAN_NUM_INSTANCES > 1
+#pragma message("KALMAN_NUM_INSTANCES was set. Creating " STRINGIFY(KALMAN_NUM_INSTANCES) " instances of the filter.")
+#endif
+
+#if KALMAN_SHARED_SCRATCH
+#pragma message("KALMAN_SHARED_SCRATCH was set. Temporaries will be taken from the scratch area of the calling thread.")
+#endif
+
 #define __CONCAT(x, y)                                  x ## y
 
 #define KALMAN_FILTER_BASENAME_HELPER(name)             __CONCAT(kalman_filter_, name)
@@ -149,9 +206,38 @@
 /* Construct Kalman filter buffers: State                               */
 /************************************************************************/
 
+#include <assert.h>
 #include "compiler.h"
 #include "matrix.h"
 #include "kalman.h"
+#include "kalman_registry.h"
+
+#if KALMAN_NUM_INSTANCES > 1
+
+/*!
+* \brief The persistent buffers of one instance of the filter
+*/
+typedef struct
+{
+    matrix_data_t A[__KALMAN_A_ROWS * __KALMAN_A_COLS];
+    matrix_data_t P[__KALMAN_P_size];
+    matrix_data_t x[__KALMAN_x_ROWS * __KALMAN_x_COLS];
+#if KALMAN_NUM_INPUTS > 0
+    matrix_data_t B[__KALMAN_B_ROWS * __KALMAN_B_COLS];
+    matrix_data_t Q[__KALMAN_Q_ROWS * __KALMAN_Q_COLS];
+    matrix_data_t u[__KALMAN_x_ROWS * __KALMAN_u_COLS];
+#endif
+} KALMAN_FUNCTION_NAME(instance_t);
+
+// the buffers of instance i are addressed through the index parameter of the initialization function
+#define __KALMAN_BUFFER_A   KALMAN_BUFFER_NAME(instances)[index].A
+#define __KALMAN_BUFFER_P   KALMAN_BUFFER_NAME(instances)[index].P
+#define __KALMAN_BUFFER_x   KALMAN_BUFFER_NAME(instances)[index].x
+
+#pragma message("Creating Kalman filter instance buffers: " STRINGIFY(KALMAN_BUFFER_NAME(instances)))
+static ALIGNED(64) KALMAN_FUNCTION_NAME(instance_t) KALMAN_BUFFER_NAME(instances)[KALMAN_NUM_INSTANCES];
+
+#else
 
 #define __KALMAN_BUFFER_A   KALMAN_BUFFER_NAME(A)
 #define __KALMAN_BUFFER_P   KALMAN_BUFFER_NAME(P)
@@ -161,16 +247,24 @@
 static matrix_data_t __KALMAN_BUFFER_A[__KALMAN_A_ROWS * __KALMAN_A_COLS];
 
 #pragma message("Creating Kalman filter P buffer: " STRINGIFY(__KALMAN_BUFFER_P))
-static matrix_data_t __KALMAN_BUFFER_P[__KALMAN_P_ROWS * __KALMAN_P_COLS];
+static matrix_data_t __KALMAN_BUFFER_P[__KALMAN_P_size];
 
 #pragma message("Creating Kalman filter x buffer: " STRINGIFY(__KALMAN_BUFFER_x))
 static matrix_data_t __KALMAN_BUFFER_x[__KALMAN_x_ROWS * __KALMAN_x_COLS];
 
+#endif
+
 /************************************************************************/
 /* Construct Kalman filter buffers: Inputs                              */
 /************************************************************************/
 
-#if KALMAN_NUM_INPUTS > 0
+#if KALMAN_NUM_INPUTS > 0 && KALMAN_NUM_INSTANCES > 1
+
+#define __KALMAN_BUFFER_B   KALMAN_BUFFER_NAME(instances)[index].B
+#define __KALMAN_BUFFER_Q   KALMAN_BUFFER_NAME(instances)[index].Q
+#define __KALMAN_BUFFER_u   KALMAN_BUFFER_NAME(instances)[index].u
+
+#elif KALMAN_NUM_INPUTS > 0
 
 #define __KALMAN_BUFFER_B   KALMAN_BUFFER_NAME(B)
 #define __KALMAN_BUFFER_Q   KALMAN_BUFFER_NAME(Q)
@@ -202,32 +296,115 @@ static matrix_data_t __KALMAN_BUFFER_u[__KALMAN_x_ROWS * __KALMAN_u_COLS];
 /* Construct Kalman filter buffers: Temporaries                         */
 /************************************************************************/
 
-#define __KALMAN_BUFFER_aux     KALMAN_BUFFER_NAME(aux)
-#define __KALMAN_BUFFER_tempPBQ KALMAN_BUFFER_NAME(tempPBQ)
-
 #define __KALMAN_aux_size       (__KALMAN_aux_ROWS * __KALMAN_aux_COLS)
 #define __KALMAN_tempP_size     (__KALMAN_tempP_ROWS * __KALMAN_tempP_COLS)
 #define __KALMAN_tempBQ_size    (__KALMAN_tempBQ_ROWS * __KALMAN_tempBQ_COLS)
 
 #define __KALMAN_tempPBQ_size   ((__KALMAN_tempP_size > __KALMAN_tempBQ_size) ? __KALMAN_tempP_size : __KALMAN_tempBQ_size)
 
-#pragma message("Creating Kalman filter aux buffer: " STRINGIFY(__KALMAN_BUFFER_aux))
-static matrix_data_t __KALMAN_BUFFER_aux[__KALMAN_aux_size];
+// measurements are counted so that every one of them can extend the running totals below
+#define __KALMAN_MEASUREMENT_COUNT      0
+
+#define __KALMAN_INDEX_HELPER2(name, index)             name ## index
+#define __KALMAN_INDEX_HELPER(name, index)              __KALMAN_INDEX_HELPER2(name, index)
+#define KALMAN_TOTAL_NAME(name, index)                  KALMAN_FUNCTION_NAME(__KALMAN_INDEX_HELPER(name, index))
 
-#pragma message("Creating Kalman filter temporary P/BQ buffer: " STRINGIFY(__KALMAN_BUFFER_tempPBQ))
-static matrix_data_t __KALMAN_BUFFER_tempPBQ[__KALMAN_tempPBQ_size];
+#if KALMAN_SHARED_SCRATCH
+
+#pragma message("Skipping Kalman filter temporary buffers: (shared scratch)")
+#define __KALMAN_BUFFER_aux     ((matrix_data_t*)0)
+#define __KALMAN_BUFFER_tempPBQ ((matrix_data_t*)0)
+
+#else
+
+// the buffers are created by kalman_factory_cleanup.h, sized for the filter and all of its measurements
+#define __KALMAN_BUFFER_aux     KALMAN_FUNCTION_NAME(get_aux_buffer)()
+#define __KALMAN_BUFFER_tempPBQ KALMAN_FUNCTION_NAME(get_temp_buffer)()
+
+/*!
+* \brief Gets the auxiliary buffer shared by the filter and its measurements
+*/
+static matrix_data_t* KALMAN_FUNCTION_NAME(get_aux_buffer)(void);
+
+/*!
+* \brief Gets the temporary matrix buffer shared by the filter (P, BQ) and its measurements (HP)
+*/
+static matrix_data_t* KALMAN_FUNCTION_NAME(get_temp_buffer)(void);
+
+#endif
+
+/*!
+* \brief Running totals of the filter: elements of the shared auxiliary and temporary buffers
+*
+* Every measurement defines the next set, kalman_factory_cleanup.h sizes the shared buffers from the last one.
+*/
+enum
+{
+    KALMAN_TOTAL_NAME(aux_elements_, 0) = KALMAN_SHARED_SCRATCH ? 0 : __KALMAN_aux_size,
+    KALMAN_TOTAL_NAME(temp_elements_, 0) = KALMAN_SHARED_SCRATCH ? 0 : __KALMAN_tempPBQ_size
+};
+
+/*!
+* \brief Running total of the filter: a byte array as large as all other buffers and structures of all instances
+*
+* The byte count is the \c size_t size of the type, which unlike an enumeration constant does not overflow on 16 bit targets.
+*/
+typedef uint8_t KALMAN_TOTAL_NAME(footprint_, 0)[KALMAN_NUM_INSTANCES * (sizeof(kalman_t) + sizeof(matrix_data_t) * ((size_t)__KALMAN_A_ROWS * __KALMAN_A_COLS + __KALMAN_P_size + __KALMAN_x_ROWS * __KALMAN_x_COLS
+#if KALMAN_NUM_INPUTS > 0
+                                         + (size_t)__KALMAN_B_ROWS * __KALMAN_B_COLS + (size_t)__KALMAN_Q_ROWS * __KALMAN_Q_COLS + __KALMAN_x_ROWS * __KALMAN_u_COLS
+#endif
+                                         ))];
+
+#if KALMAN_REGISTRY
+
+/*!
+* \brief Adds the filter to the runtime registry; created by kalman_factory_cleanup.h once the footprint is known
+*/
+static void KALMAN_FUNCTION_NAME(register_entry)(void);
+
+#endif
 
 /************************************************************************/
 /* Construct Kalman filter                                              */
 /************************************************************************/
 
+/*!
+* \brief The number of instances of the filter
+*/
+enum
+{
+    KALMAN_FUNCTION_NAME(num_instances) = KALMAN_NUM_INSTANCES
+};
+
 #pragma message("Creating Kalman filter structure: " STRINGIFY(KALMAN_STRUCT_NAME))
 
+#if KALMAN_NUM_INSTANCES > 1
+
+/*!
+* \brief The Kalman filter structures, one per instance
+*/
+static kalman_t KALMAN_STRUCT_NAME[KALMAN_NUM_INSTANCES];
+
+#define __KALMAN_STRUCT     KALMAN_STRUCT_NAME[index]
+
+#pragma message ("Creating Kalman filter initialization function: " STRINGIFY(KALMAN_FUNCTION_NAME(init(index)) ))
+
+/*!
+* \brief Initializes an instance of the Kalman Filter
+* \param[in] index The index of the instance
+* \return Pointer to the filter.
+*/
+static kalman_t* KALMAN_FUNCTION_NAME(init)(int index)
+
+#else
+
 /*!
 * \brief The Kalman filter structure
 */
 static kalman_t KALMAN_STRUCT_NAME;
 
+#define __KALMAN_STRUCT     KALMAN_STRUCT_NAME
+
 #pragma message ("Creating Kalman filter initialization function: " STRINGIFY(KALMAN_FUNCTION_NAME(init()) ))
 
 /*!
@@ -235,11 +412,17 @@ static kalman_t KALMAN_STRUCT_NAME;
 * \return Pointer to the filter.
 */
 static kalman_t* KALMAN_FUNCTION_NAME(init)()
+
+#endif
 {
     int i;
+#if KALMAN_NUM_INSTANCES > 1
+    assert(index >= 0 && index < KALMAN_NUM_INSTANCES);
+#endif
+
     for (i = 0; i < __KALMAN_x_ROWS * __KALMAN_x_COLS; ++i) { __KALMAN_BUFFER_x[i] = 0; }
     for (i = 0; i < __KALMAN_A_ROWS * __KALMAN_A_COLS; ++i) { __KALMAN_BUFFER_A[i] = 0; }
-    for (i = 0; i < __KALMAN_P_ROWS * __KALMAN_P_COLS; ++i) { __KALMAN_BUFFER_P[i] = 0; }
+    for (i = 0; i < __KALMAN_P_size; ++i) { __KALMAN_BUFFER_P[i] = 0; }
 
 #if KALMAN_NUM_INPUTS > 0
     for (i = 0; i < __KALMAN_B_ROWS * __KALMAN_B_COLS; ++i) { __KALMAN_BUFFER_B[i] = 0; }
@@ -247,9 +430,34 @@ static kalman_t* KALMAN_FUNCTION_NAME(init)()
     for (i = 0; i < __KALMAN_u_ROWS * __KALMAN_x_COLS; ++i) { __KALMAN_BUFFER_u[i] = 0; }
 #endif
 
-    kalman_filter_initialize(&KALMAN_STRUCT_NAME, KALMAN_NUM_STATES, KALMAN_NUM_INPUTS, __KALMAN_BUFFER_A, __KALMAN_BUFFER_x,
+    kalman_filter_initialize(&__KALMAN_STRUCT, KALMAN_NUM_STATES, KALMAN_NUM_INPUTS, __KALMAN_BUFFER_A, __KALMAN_BUFFER_x,
                             __KALMAN_BUFFER_B, __KALMAN_BUFFER_u, __KALMAN_BUFFER_P, __KALMAN_BUFFER_Q,
                             __KALMAN_BUFFER_aux, __KALMAN_BUFFER_aux, __KALMAN_BUFFER_tempPBQ, __KALMAN_BUFFER_tempPBQ);
-    return &KALMAN_STRUCT_NAME;
+
+#if KALMAN_PACKED_COVARIANCE
+    matrix_init_packed(&__KALMAN_STRUCT.P, KALMAN_NUM_STATES, __KALMAN_BUFFER_P);
+#endif
+
+#if KALMAN_REGISTRY
+    KALMAN_FUNCTION_NAME(register_entry)();
+#endif
+
+    return &__KALMAN_STRUCT;
+}
+
+#if KALMAN_NUM_INSTANCES > 1
+
+/*!
+* \brief Gets an instance of the Kalman Filter
+* \param[in] index The index of the instance
+* \return Pointer to the filter.
+*/
+static kalman_t* KALMAN_FUNCTION_NAME(get)(int index)
+{
+    assert(index >= 0 && index < KALMAN_NUM_INSTANCES);
+    return &KALMAN_STRUCT_NAME[index];
 }
 
+#endif
+
+#undef __KALMAN_STRUCT
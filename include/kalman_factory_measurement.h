@@ -59,14 +59,33 @@
 * }
 * \endcode
 *
+* The auxiliary vector and the temporary HxP matrix of all measurements of a filter share the filter's auxiliary and temporary
+* buffers. These are only created by kalman_factory_cleanup.h, once the largest need of the filter and its measurements is known.
 * In order to force creation of separate auxiliary buffers (thus preventing buffer reuse), MEASUREMENT_FORCE_NEW_BUFFERS can be defined
-* prior to inclusion of this file.
+* prior to inclusion of this file. At most 64 measurements can be defined per filter.
+*
+* If the process noise matrix R of the measurement is diagonal, KALMAN_MEASUREMENT_DIAGONAL_R can be defined to 1 prior to
+* inclusion of this file. The measurement is then flagged with KALMAN_MEASUREMENT_FLAG_DIAGONAL_R and kalman_correct()
+* processes its outputs one at a time (see kalman_correct_sequential()). Like the name and number of measurements, this define
+* is removed at the end of this file.
+*
+* If the filter was created with KALMAN_NUM_INSTANCES greater than 1, the measurement is created once per instance: the structure
+* becomes an array, the initialization function takes the index of the instance and \c {..._get(i)} returns a measurement by index.
+* The persistent buffers (H, R, z, K, S, y) of all instances live in one cache-line aligned array of \c {..._instance_t} records.
+*
+* The static footprint of the measurement (all instances, without the temporaries shared with the filter) is available as
+* KALMAN_MEASUREMENT_BYTES(). If KALMAN_REGISTRY
+* is set, the initialization function adds the measurement to the runtime registry.
 */
 
 #ifndef MEASUREMENT_FORCE_NEW_BUFFERS
 #define MEASUREMENT_FORCE_NEW_BUFFERS 0
 #endif
 
+#ifndef KALMAN_MEASUREMENT_DIAGONAL_R
+#define KALMAN_MEASUREMENT_DIAGONAL_R 0
+#endif
+
 /************************************************************************/
 /* Check for inputs                                                     */
 /************************************************************************/
@@ -97,6 +116,278 @@
 #pragma message("MEASUREMENT_FORCE_NEW_BUFFERS was set. Forcing separate auxiliary buffers.")
 #endif
 
+#if KALMAN_MEASUREMENT_DIAGONAL_R
+#pragma message("KALMAN_MEASUREMENT_DIAGONAL_R was set. Measured outputs will be processed sequentially.")
+#endif
+
+/************************************************************************/
+/* Count measurements                                                   */
+/************************************************************************/
+
+// the count is spelled out for up to 64 measurements per filter
+
+#if !defined(__KALMAN_MEASUREMENT_COUNT)
+#error __KALMAN_MEASUREMENT_COUNT is not defined. Did you include kalman_factory_filter.h?
+#elif __KALMAN_MEASUREMENT_COUNT == 0
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      1
+#define __KALMAN_MEASUREMENT_PREVIOUS   0
+#elif __KALMAN_MEASUREMENT_COUNT == 1
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      2
+#define __KALMAN_MEASUREMENT_PREVIOUS   1
+#elif __KALMAN_MEASUREMENT_COUNT == 2
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      3
+#define __KALMAN_MEASUREMENT_PREVIOUS   2
+#elif __KALMAN_MEASUREMENT_COUNT == 3
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      4
+#define __KALMAN_MEASUREMENT_PREVIOUS   3
+#elif __KALMAN_MEASUREMENT_COUNT == 4
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      5
+#define __KALMAN_MEASUREMENT_PREVIOUS   4
+#elif __KALMAN_MEASUREMENT_COUNT == 5
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      6
+#define __KALMAN_MEASUREMENT_PREVIOUS   5
+#elif __KALMAN_MEASUREMENT_COUNT == 6
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      7
+#define __KALMAN_MEASUREMENT_PREVIOUS   6
+#elif __KALMAN_MEASUREMENT_COUNT == 7
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      8
+#define __KALMAN_MEASUREMENT_PREVIOUS   7
+#elif __KALMAN_MEASUREMENT_COUNT == 8
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      9
+#define __KALMAN_MEASUREMENT_PREVIOUS   8
+#elif __KALMAN_MEASUREMENT_COUNT == 9
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      10
+#define __KALMAN_MEASUREMENT_PREVIOUS   9
+#elif __KALMAN_MEASUREMENT_COUNT == 10
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      11
+#define __KALMAN_MEASUREMENT_PREVIOUS   10
+#elif __KALMAN_MEASUREMENT_COUNT == 11
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      12
+#define __KALMAN_MEASUREMENT_PREVIOUS   11
+#elif __KALMAN_MEASUREMENT_COUNT == 12
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      13
+#define __KALMAN_MEASUREMENT_PREVIOUS   12
+#elif __KALMAN_MEASUREMENT_COUNT == 13
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      14
+#define __KALMAN_MEASUREMENT_PREVIOUS   13
+#elif __KALMAN_MEASUREMENT_COUNT == 14
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      15
+#define __KALMAN_MEASUREMENT_PREVIOUS   14
+#elif __KALMAN_MEASUREMENT_COUNT == 15
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      16
+#define __KALMAN_MEASUREMENT_PREVIOUS   15
+#elif __KALMAN_MEASUREMENT_COUNT == 16
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      17
+#define __KALMAN_MEASUREMENT_PREVIOUS   16
+#elif __KALMAN_MEASUREMENT_COUNT == 17
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      18
+#define __KALMAN_MEASUREMENT_PREVIOUS   17
+#elif __KALMAN_MEASUREMENT_COUNT == 18
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      19
+#define __KALMAN_MEASUREMENT_PREVIOUS   18
+#elif __KALMAN_MEASUREMENT_COUNT == 19
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      20
+#define __KALMAN_MEASUREMENT_PREVIOUS   19
+#elif __KALMAN_MEASUREMENT_COUNT == 20
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      21
+#define __KALMAN_MEASUREMENT_PREVIOUS   20
+#elif __KALMAN_MEASUREMENT_COUNT == 21
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      22
+#define __KALMAN_MEASUREMENT_PREVIOUS   21
+#elif __KALMAN_MEASUREMENT_COUNT == 22
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      23
+#define __KALMAN_MEASUREMENT_PREVIOUS   22
+#elif __KALMAN_MEASUREMENT_COUNT == 23
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      24
+#define __KALMAN_MEASUREMENT_PREVIOUS   23
+#elif __KALMAN_MEASUREMENT_COUNT == 24
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      25
+#define __KALMAN_MEASUREMENT_PREVIOUS   24
+#elif __KALMAN_MEASUREMENT_COUNT == 25
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      26
+#define __KALMAN_MEASUREMENT_PREVIOUS   25
+#elif __KALMAN_MEASUREMENT_COUNT == 26
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      27
+#define __KALMAN_MEASUREMENT_PREVIOUS   26
+#elif __KALMAN_MEASUREMENT_COUNT == 27
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      28
+#define __KALMAN_MEASUREMENT_PREVIOUS   27
+#elif __KALMAN_MEASUREMENT_COUNT == 28
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      29
+#define __KALMAN_MEASUREMENT_PREVIOUS   28
+#elif __KALMAN_MEASUREMENT_COUNT == 29
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      30
+#define __KALMAN_MEASUREMENT_PREVIOUS   29
+#elif __KALMAN_MEASUREMENT_COUNT == 30
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      31
+#define __KALMAN_MEASUREMENT_PREVIOUS   30
+#elif __KALMAN_MEASUREMENT_COUNT == 31
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      32
+#define __KALMAN_MEASUREMENT_PREVIOUS   31
+#elif __KALMAN_MEASUREMENT_COUNT == 32
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      33
+#define __KALMAN_MEASUREMENT_PREVIOUS   32
+#elif __KALMAN_MEASUREMENT_COUNT == 33
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      34
+#define __KALMAN_MEASUREMENT_PREVIOUS   33
+#elif __KALMAN_MEASUREMENT_COUNT == 34
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      35
+#define __KALMAN_MEASUREMENT_PREVIOUS   34
+#elif __KALMAN_MEASUREMENT_COUNT == 35
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      36
+#define __KALMAN_MEASUREMENT_PREVIOUS   35
+#elif __KALMAN_MEASUREMENT_COUNT == 36
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      37
+#define __KALMAN_MEASUREMENT_PREVIOUS   36
+#elif __KALMAN_MEASUREMENT_COUNT == 37
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      38
+#define __KALMAN_MEASUREMENT_PREVIOUS   37
+#elif __KALMAN_MEASUREMENT_COUNT == 38
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      39
+#define __KALMAN_MEASUREMENT_PREVIOUS   38
+#elif __KALMAN_MEASUREMENT_COUNT == 39
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      40
+#define __KALMAN_MEASUREMENT_PREVIOUS   39
+#elif __KALMAN_MEASUREMENT_COUNT == 40
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      41
+#define __KALMAN_MEASUREMENT_PREVIOUS   40
+#elif __KALMAN_MEASUREMENT_COUNT == 41
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      42
+#define __KALMAN_MEASUREMENT_PREVIOUS   41
+#elif __KALMAN_MEASUREMENT_COUNT == 42
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      43
+#define __KALMAN_MEASUREMENT_PREVIOUS   42
+#elif __KALMAN_MEASUREMENT_COUNT == 43
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      44
+#define __KALMAN_MEASUREMENT_PREVIOUS   43
+#elif __KALMAN_MEASUREMENT_COUNT == 44
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      45
+#define __KALMAN_MEASUREMENT_PREVIOUS   44
+#elif __KALMAN_MEASUREMENT_COUNT == 45
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      46
+#define __KALMAN_MEASUREMENT_PREVIOUS   45
+#elif __KALMAN_MEASUREMENT_COUNT == 46
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      47
+#define __KALMAN_MEASUREMENT_PREVIOUS   46
+#elif __KALMAN_MEASUREMENT_COUNT == 47
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      48
+#define __KALMAN_MEASUREMENT_PREVIOUS   47
+#elif __KALMAN_MEASUREMENT_COUNT == 48
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      49
+#define __KALMAN_MEASUREMENT_PREVIOUS   48
+#elif __KALMAN_MEASUREMENT_COUNT == 49
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      50
+#define __KALMAN_MEASUREMENT_PREVIOUS   49
+#elif __KALMAN_MEASUREMENT_COUNT == 50
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      51
+#define __KALMAN_MEASUREMENT_PREVIOUS   50
+#elif __KALMAN_MEASUREMENT_COUNT == 51
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      52
+#define __KALMAN_MEASUREMENT_PREVIOUS   51
+#elif __KALMAN_MEASUREMENT_COUNT == 52
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      53
+#define __KALMAN_MEASUREMENT_PREVIOUS   52
+#elif __KALMAN_MEASUREMENT_COUNT == 53
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      54
+#define __KALMAN_MEASUREMENT_PREVIOUS   53
+#elif __KALMAN_MEASUREMENT_COUNT == 54
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      55
+#define __KALMAN_MEASUREMENT_PREVIOUS   54
+#elif __KALMAN_MEASUREMENT_COUNT == 55
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      56
+#define __KALMAN_MEASUREMENT_PREVIOUS   55
+#elif __KALMAN_MEASUREMENT_COUNT == 56
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      57
+#define __KALMAN_MEASUREMENT_PREVIOUS   56
+#elif __KALMAN_MEASUREMENT_COUNT == 57
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      58
+#define __KALMAN_MEASUREMENT_PREVIOUS   57
+#elif __KALMAN_MEASUREMENT_COUNT == 58
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      59
+#define __KALMAN_MEASUREMENT_PREVIOUS   58
+#elif __KALMAN_MEASUREMENT_COUNT == 59
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      60
+#define __KALMAN_MEASUREMENT_PREVIOUS   59
+#elif __KALMAN_MEASUREMENT_COUNT == 60
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      61
+#define __KALMAN_MEASUREMENT_PREVIOUS   60
+#elif __KALMAN_MEASUREMENT_COUNT == 61
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      62
+#define __KALMAN_MEASUREMENT_PREVIOUS   61
+#elif __KALMAN_MEASUREMENT_COUNT == 62
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      63
+#define __KALMAN_MEASUREMENT_PREVIOUS   62
+#elif __KALMAN_MEASUREMENT_COUNT == 63
+#undef __KALMAN_MEASUREMENT_COUNT
+#define __KALMAN_MEASUREMENT_COUNT      64
+#define __KALMAN_MEASUREMENT_PREVIOUS   63
+#else
+#error At most 64 measurements per filter are supported. Merge measurements that are corrected together, or extend the count in kalman_factory_measurement.h.
+#endif
+
 /************************************************************************/
 /* Prepare dimensions                                                   */
 /************************************************************************/
@@ -128,24 +419,11 @@
 // auxiliary buffer size
 #define __KALMAN_maux_ROWS      ((KALMAN_NUM_STATES > KALMAN_NUM_MEASUREMENTS) ? KALMAN_NUM_STATES : KALMAN_NUM_MEASUREMENTS)
 #define __KALMAN_maux_COLS      1
-#define __USE_BUFFER_AUX        ((__KALMAN_maux_ROWS * __KALMAN_maux_COLS) <= __KALMAN_aux_size)
-
-// inverted S buffer
-#define __KALMAN_Sinv_ROWS      __KALMAN_S_ROWS
-#define __KALMAN_Sinv_COLS      __KALMAN_S_COLS
 
 // temporary HxP buffer
 #define __KALMAN_tempHP_ROWS    __KALMAN_H_ROWS
 #define __KALMAN_tempHP_COLS    __KALMAN_H_COLS
 
-// temporary PxH' buffer
-#define __KALMAN_tempPHt_ROWS    __KALMAN_H_COLS // [sic]
-#define __KALMAN_tempPHt_COLS    __KALMAN_H_ROWS // [sic]
-
-// temporary Kx(HxP) buffer
-#define __KALMAN_tempKHP_ROWS   __KALMAN_P_ROWS
-#define __KALMAN_tempKHP_COLS   __KALMAN_P_COLS
-
 /************************************************************************/
 /* Name macro                                                           */
 /************************************************************************/
@@ -170,9 +448,40 @@
 /* Construct Kalman filter measurement buffers                          */
 /************************************************************************/
 
+#include <assert.h>
 #include "compiler.h"
 #include "matrix.h"
 #include "kalman.h"
+#include "kalman_registry.h"
+
+#if KALMAN_NUM_INSTANCES > 1
+
+/*!
+* \brief The persistent buffers of one instance of the measurement
+*/
+typedef struct
+{
+    matrix_data_t H[__KALMAN_H_ROWS * __KALMAN_H_COLS];
+    matrix_data_t R[__KALMAN_R_ROWS * __KALMAN_R_COLS];
+    matrix_data_t z[__KALMAN_z_ROWS * __KALMAN_z_COLS];
+    matrix_data_t K[__KALMAN_K_ROWS * __KALMAN_K_COLS];
+    matrix_data_t S[__KALMAN_S_ROWS * __KALMAN_S_COLS];
+    matrix_data_t y[__KALMAN_y_ROWS * __KALMAN_y_COLS];
+} KALMAN_MEASUREMENT_FUNCTION_NAME(instance_t);
+
+// the buffers of instance i are addressed through the index parameter of the initialization function
+#define __KALMAN_BUFFER_H   KALMAN_MEASUREMENT_BUFFER_NAME(instances)[index].H
+#define __KALMAN_BUFFER_R   KALMAN_MEASUREMENT_BUFFER_NAME(instances)[index].R
+#define __KALMAN_BUFFER_z   KALMAN_MEASUREMENT_BUFFER_NAME(instances)[index].z
+
+#define __KALMAN_BUFFER_K   KALMAN_MEASUREMENT_BUFFER_NAME(instances)[index].K
+#define __KALMAN_BUFFER_S   KALMAN_MEASUREMENT_BUFFER_NAME(instances)[index].S
+#define __KALMAN_BUFFER_y   KALMAN_MEASUREMENT_BUFFER_NAME(instances)[index].y
+
+#pragma message("Creating Kalman measurement instance buffers: " STRINGIFY(KALMAN_MEASUREMENT_BUFFER_NAME(instances)))
+static ALIGNED(64) KALMAN_MEASUREMENT_FUNCTION_NAME(instance_t) KALMAN_MEASUREMENT_BUFFER_NAME(instances)[KALMAN_NUM_INSTANCES];
+
+#else
 
 #define __KALMAN_BUFFER_H   KALMAN_MEASUREMENT_BUFFER_NAME(H)
 #define __KALMAN_BUFFER_R   KALMAN_MEASUREMENT_BUFFER_NAME(R)
@@ -200,87 +509,119 @@ static matrix_data_t __KALMAN_BUFFER_S[__KALMAN_S_ROWS * __KALMAN_S_COLS];
 #pragma message("Creating Kalman measurement y buffer: " STRINGIFY(__KALMAN_BUFFER_y))
 static matrix_data_t __KALMAN_BUFFER_y[__KALMAN_y_ROWS * __KALMAN_y_COLS];
 
+#endif
+
 /************************************************************************/
 /* Construct Kalman filter measurement buffers: Temporaries             */
 /************************************************************************/
 
-// re-use filter auxiliary buffer if it is large enough
-#if __USE_BUFFER_AUX && !MEASUREMENT_FORCE_NEW_BUFFERS
+#define __KALMAN_maux_size      (__KALMAN_maux_ROWS * __KALMAN_maux_COLS)
+#define __KALMAN_tempHP_size    (__KALMAN_tempHP_ROWS * __KALMAN_tempHP_COLS)
 
-#define __KALMAN_BUFFER_maux     __KALMAN_BUFFER_aux
-#pragma message("Re-using Kalman aux buffer for measurement aux buffer: " STRINGIFY(__KALMAN_BUFFER_maux))
+#if KALMAN_SHARED_SCRATCH
 
-#else
+// take the temporaries from the scratch area along with the filter's
+#define __KALMAN_BUFFER_maux     ((matrix_data_t*)0)
+#define __KALMAN_BUFFER_tempHP   ((matrix_data_t*)0)
+#define __KALMAN_maux_shared     0
+#define __KALMAN_tempHP_shared   0
+#define __KALMAN_temp_own        0
+#pragma message("Skipping Kalman measurement temporary buffers: (shared scratch)")
+
+#elif MEASUREMENT_FORCE_NEW_BUFFERS
 
 #define __KALMAN_BUFFER_maux     KALMAN_MEASUREMENT_BUFFER_NAME(aux)
-#define __KALMAN_maux_size       (__KALMAN_maux_ROWS * __KALMAN_maux_COLS)
+#define __KALMAN_BUFFER_tempHP   KALMAN_MEASUREMENT_BUFFER_NAME(tempHP)
+#define __KALMAN_maux_shared     0
+#define __KALMAN_tempHP_shared   0
+#define __KALMAN_temp_own        (__KALMAN_maux_size + __KALMAN_tempHP_size)
 
 #pragma message("Creating Kalman measurement aux buffer: " STRINGIFY(__KALMAN_BUFFER_maux))
 static matrix_data_t __KALMAN_BUFFER_maux[__KALMAN_maux_size];
 
-#endif
-
-// create buffer for inverted s
-#define __KALMAN_Sinv_size      (__KALMAN_Sinv_ROWS * __KALMAN_Sinv_COLS)
-
-#if __KALMAN_Sinv_size <= __KALMAN_tempPBQ_size && !MEASUREMENT_FORCE_NEW_BUFFERS
-
-#define __KALMAN_BUFFER_Sinv  __KALMAN_BUFFER_tempPBQ
-#pragma message("Re-using Kalman filter temporary P/BQ buffer for temporary S-inverted buffer: " STRINGIFY(__KALMAN_BUFFER_Sinv))
+#pragma message("Creating Kalman measurement temporary HxP buffer: " STRINGIFY(__KALMAN_BUFFER_tempHP))
+static matrix_data_t __KALMAN_BUFFER_tempHP[__KALMAN_tempHP_size];
 
 #else
 
-#define __KALMAN_BUFFER_Sinv     KALMAN_MEASUREMENT_BUFFER_NAME(Sinv)
-#pragma message("Creating Kalman measurement temporary S-inverted buffer: " STRINGIFY(__KALMAN_BUFFER_Sinv))
-static matrix_data_t __KALMAN_BUFFER_Sinv[__KALMAN_Sinv_size];
+// all measurements of the filter share its buffers, which are grown to the largest need in kalman_factory_cleanup.h
+#define __KALMAN_BUFFER_maux     __KALMAN_BUFFER_aux
+#define __KALMAN_BUFFER_tempHP   __KALMAN_BUFFER_tempPBQ
+#define __KALMAN_maux_shared     __KALMAN_maux_size
+#define __KALMAN_tempHP_shared   __KALMAN_tempHP_size
+#define __KALMAN_temp_own        0
+#pragma message("Re-using Kalman filter aux and temporary buffers for measurement aux and temporary HxP buffers")
 
 #endif
 
-// create buffer for HxP
-#define __KALMAN_tempHP_size    (__KALMAN_tempHP_ROWS * __KALMAN_tempHP_COLS)
-
-#define __KALMAN_BUFFER_tempHP  KALMAN_MEASUREMENT_BUFFER_NAME(tempHP)
-#pragma message("Creating Kalman measurement temporary HxP buffer: " STRINGIFY(__KALMAN_BUFFER_tempHP))
-static matrix_data_t __KALMAN_BUFFER_tempHP[__KALMAN_tempHP_size];
+/*!
+* \brief Running totals of the filter including this measurement
+*/
+enum
+{
+    KALMAN_TOTAL_NAME(aux_elements_, __KALMAN_MEASUREMENT_COUNT) =
+        (KALMAN_TOTAL_NAME(aux_elements_, __KALMAN_MEASUREMENT_PREVIOUS) > __KALMAN_maux_shared) ? KALMAN_TOTAL_NAME(aux_elements_, __KALMAN_MEASUREMENT_PREVIOUS) : __KALMAN_maux_shared,
+    KALMAN_TOTAL_NAME(temp_elements_, __KALMAN_MEASUREMENT_COUNT) =
+        (KALMAN_TOTAL_NAME(temp_elements_, __KALMAN_MEASUREMENT_PREVIOUS) > __KALMAN_tempHP_shared) ? KALMAN_TOTAL_NAME(temp_elements_, __KALMAN_MEASUREMENT_PREVIOUS) : __KALMAN_tempHP_shared
+};
 
-// create buffer for PxH'
-#define __KALMAN_tempPHt_size    (__KALMAN_tempPHt_ROWS * __KALMAN_tempPHt_COLS)
+/*!
+* \brief Running total of the bytes of the filter including this measurement
+*/
+typedef uint8_t KALMAN_TOTAL_NAME(footprint_, __KALMAN_MEASUREMENT_COUNT)[sizeof(KALMAN_TOTAL_NAME(footprint_, __KALMAN_MEASUREMENT_PREVIOUS))
+        + KALMAN_NUM_INSTANCES * (sizeof(kalman_measurement_t) + sizeof(matrix_data_t) * ((size_t)__KALMAN_H_ROWS * __KALMAN_H_COLS
+                + (size_t)__KALMAN_R_ROWS * __KALMAN_R_COLS + __KALMAN_z_ROWS * __KALMAN_z_COLS + (size_t)__KALMAN_K_ROWS * __KALMAN_K_COLS
+                + (size_t)__KALMAN_S_ROWS * __KALMAN_S_COLS + __KALMAN_y_ROWS * __KALMAN_y_COLS))
+        + sizeof(matrix_data_t) * __KALMAN_temp_own];
 
-#if !MEASUREMENT_FORCE_NEW_BUFFERS
+#pragma message("Static footprint of Kalman measurement \"" STRINGIFY(KALMAN_MEASUREMENT_NAME) "\" available as KALMAN_MEASUREMENT_BYTES(" STRINGIFY(KALMAN_NAME) ", " STRINGIFY(KALMAN_MEASUREMENT_NAME) ")")
 
-#define __KALMAN_BUFFER_tempPHt  __KALMAN_BUFFER_tempHP
-#pragma message("Re-using Kalman measurement temporary HxP for temporary PxH' buffer: " STRINGIFY(__KALMAN_BUFFER_tempPHt))
+/*!
+* \brief A byte array as large as all buffers and structures of the measurement, excluding the temporaries shared with the filter
+* \see KALMAN_MEASUREMENT_BYTES
+*/
+typedef uint8_t KALMAN_MEASUREMENT_FUNCTION_NAME(footprint_t)[sizeof(KALMAN_TOTAL_NAME(footprint_, __KALMAN_MEASUREMENT_COUNT)) - sizeof(KALMAN_TOTAL_NAME(footprint_, __KALMAN_MEASUREMENT_PREVIOUS))];
 
-#else
+/************************************************************************/
+/* Construct Kalman filter measurement                                  */
+/************************************************************************/
 
-#define __KALMAN_BUFFER_tempPHt  KALMAN_MEASUREMENT_BUFFER_NAME(tempPHt)
-#pragma message("Creating Kalman measurement temporary PxH' buffer: " STRINGIFY(__KALMAN_BUFFER_tempPHt))           // TODO: reuse HxP buffer!
-static matrix_data_t __KALMAN_BUFFER_tempPHt[__KALMAN_tempPHt_size];
+#pragma message("Creating Kalman measurement structure: " STRINGIFY(KALMAN_MEASUREMENT_BASENAME))
 
+#if KALMAN_NUM_INSTANCES > 1
+static kalman_measurement_t KALMAN_MEASUREMENT_BASENAME[KALMAN_NUM_INSTANCES];
+#define __KALMAN_MEASUREMENT_STRUCT     KALMAN_MEASUREMENT_BASENAME[index]
+#else
+static kalman_measurement_t KALMAN_MEASUREMENT_BASENAME;
+#define __KALMAN_MEASUREMENT_STRUCT     KALMAN_MEASUREMENT_BASENAME
 #endif
 
-// create Kx(HxP) buffer
-#define __KALMAN_tempKHP_size    (__KALMAN_tempKHP_ROWS * __KALMAN_tempKHP_COLS)
-
-#if (__KALMAN_tempKHP_size <= __KALMAN_tempPBQ_size) && !MEASUREMENT_FORCE_NEW_BUFFERS
+#if KALMAN_REGISTRY
 
-#define __KALMAN_BUFFER_tempKHP     __KALMAN_BUFFER_tempPBQ
-#pragma message("Re-using Kalman filter temporary P/BQ buffer for measurement temporary Kx(HxP)  buffer: " STRINGIFY(__KALMAN_BUFFER_tempKHP))
+/*!
+* \brief The descriptor of the measurement in the runtime registry
+*/
+static kalman_registry_entry_t KALMAN_MEASUREMENT_FUNCTION_NAME(registry_entry) =
+{
+    STRINGIFY(KALMAN_NAME), STRINGIFY(KALMAN_MEASUREMENT_NAME), &KALMAN_MEASUREMENT_BASENAME,
+    KALMAN_NUM_STATES, 0, KALMAN_NUM_MEASUREMENTS, KALMAN_NUM_INSTANCES,
+    sizeof(KALMAN_MEASUREMENT_FUNCTION_NAME(footprint_t)), 0, 0
+};
 
-#else
+#endif
 
-#define __KALMAN_BUFFER_tempKHP  KALMAN_MEASUREMENT_BUFFER_NAME(tempKHP)
-#pragma message("Creating Kalman measurement temporary Kx(HxP) buffer: " STRINGIFY(__KALMAN_BUFFER_tempKHP))
-static matrix_data_t __KALMAN_BUFFER_tempKHP[__KALMAN_tempKHP_size];
+#if KALMAN_NUM_INSTANCES > 1
 
-#endif
+#pragma message ("Creating Kalman measurement initialization function: " STRINGIFY(KALMAN_MEASUREMENT_FUNCTION_NAME(init(index)) ))
 
-/************************************************************************/
-/* Construct Kalman filter measurement                                  */
-/************************************************************************/
+/*!
+* \brief Initializes an instance of the Kalman Filter measurement
+* \param[in] index The index of the instance
+* \return Pointer to the measurement.
+*/
+static kalman_measurement_t* KALMAN_MEASUREMENT_FUNCTION_NAME(init)(int index)
 
-#pragma message("Creating Kalman measurement structure: " STRINGIFY(KALMAN_MEASUREMENT_BASENAME))
-static kalman_measurement_t KALMAN_MEASUREMENT_BASENAME;
+#else
 
 #pragma message ("Creating Kalman measurement initialization function: " STRINGIFY(KALMAN_MEASUREMENT_FUNCTION_NAME(init()) ))
 
@@ -289,8 +630,14 @@ static kalman_measurement_t KALMAN_MEASUREMENT_BASENAME;
 * \return Pointer to the measurement.
 */
 static kalman_measurement_t* KALMAN_MEASUREMENT_FUNCTION_NAME(init)()
+
+#endif
 {
     int i;
+#if KALMAN_NUM_INSTANCES > 1
+    assert(index >= 0 && index < KALMAN_NUM_INSTANCES);
+#endif
+
     for (i = 0; i < __KALMAN_z_ROWS * __KALMAN_z_COLS; ++i) { __KALMAN_BUFFER_z[i] = 0; }
     for (i = 0; i < __KALMAN_H_ROWS * __KALMAN_H_COLS; ++i) { __KALMAN_BUFFER_H[i] = 0; }
     for (i = 0; i < __KALMAN_R_ROWS * __KALMAN_R_COLS; ++i) { __KALMAN_BUFFER_R[i] = 0; }
@@ -298,18 +645,43 @@ static kalman_measurement_t* KALMAN_MEASUREMENT_FUNCTION_NAME(init)()
     for (i = 0; i < __KALMAN_S_ROWS * __KALMAN_S_COLS; ++i) { __KALMAN_BUFFER_S[i] = 0; }
     for (i = 0; i < __KALMAN_K_ROWS * __KALMAN_K_COLS; ++i) { __KALMAN_BUFFER_K[i] = 0; }
 
-    kalman_measurement_initialize(&KALMAN_MEASUREMENT_BASENAME, KALMAN_NUM_STATES, KALMAN_NUM_MEASUREMENTS, __KALMAN_BUFFER_H, __KALMAN_BUFFER_z, __KALMAN_BUFFER_R, 
+    kalman_measurement_initialize(&__KALMAN_MEASUREMENT_STRUCT, KALMAN_NUM_STATES, KALMAN_NUM_MEASUREMENTS, __KALMAN_BUFFER_H, __KALMAN_BUFFER_z, __KALMAN_BUFFER_R, 
                                   __KALMAN_BUFFER_y, __KALMAN_BUFFER_S, __KALMAN_BUFFER_K,
-                                  __KALMAN_BUFFER_maux, __KALMAN_BUFFER_Sinv, __KALMAN_BUFFER_tempHP, __KALMAN_BUFFER_tempPHt, __KALMAN_BUFFER_tempKHP);
-    return &KALMAN_MEASUREMENT_BASENAME;
+                                  __KALMAN_BUFFER_maux, __KALMAN_BUFFER_tempHP);
+
+#if KALMAN_MEASUREMENT_DIAGONAL_R
+    __KALMAN_MEASUREMENT_STRUCT.flags |= KALMAN_MEASUREMENT_FLAG_DIAGONAL_R;
+#endif
+
+#if KALMAN_REGISTRY
+    kalman_registry_add(&KALMAN_MEASUREMENT_FUNCTION_NAME(registry_entry));
+#endif
+
+    return &__KALMAN_MEASUREMENT_STRUCT;
 }
 
+#if KALMAN_NUM_INSTANCES > 1
+
+/*!
+* \brief Gets an instance of the Kalman Filter measurement
+* \param[in] index The index of the instance
+* \return Pointer to the measurement.
+*/
+static kalman_measurement_t* KALMAN_MEASUREMENT_FUNCTION_NAME(get)(int index)
+{
+    assert(index >= 0 && index < KALMAN_NUM_INSTANCES);
+    return &KALMAN_MEASUREMENT_BASENAME[index];
+}
+
+#endif
+
 /************************************************************************/
 /* Clean up                                                             */
 /************************************************************************/
 
 #undef KALMAN_MEASUREMENT_NAME
 #undef KALMAN_NUM_MEASUREMENTS
+#undef KALMAN_MEASUREMENT_DIAGONAL_R
 
 #undef KALMAN_MEASUREMENT_BASENAME_HELPER2
 #undef KALMAN_MEASUREMENT_BASENAME_HELPER
@@ -334,32 +706,20 @@ static kalman_measurement_t* KALMAN_MEASUREMENT_FUNCTION_NAME(init)()
 #undef __KALMAN_BUFFER_S
 #undef __KALMAN_BUFFER_y
 
-// TODO: instead of cleaning up the temporary buffers here, clean them up in kalman_factory_cleanup.h. This way, the largest buffers can be reused in other measurement definitions.
-
-#undef __KALMAN_tempKHP_ROWS
-#undef __KALMAN_tempKHP_COLS
-
-#undef __KALMAN_tempPHt_ROWS
-#undef __KALMAN_tempPHt_COLS
+#undef __KALMAN_MEASUREMENT_PREVIOUS
+#undef __KALMAN_MEASUREMENT_STRUCT
 
 #undef __KALMAN_tempHP_ROWS
 #undef __KALMAN_tempHP_COLS
 
 #undef __KALMAN_maux_ROWS
 #undef __KALMAN_maux_COLS
-#undef __USE_BUFFER_AUX
-
-#undef __KALMAN_tempKHP_size
-#undef __KALMAN_BUFFER_tempKHP
 
 #undef __KALMAN_BUFFER_tempHP
 #undef __KALMAN_tempHP_size
-
-#undef __KALMAN_BUFFER_tempPHt
-#undef __KALMAN_tempPHt_size
-
-#undef __KALMAN_BUFFER_Sinv
-#undef __KALMAN_Sinv_size
+#undef __KALMAN_tempHP_shared
 
 #undef __KALMAN_BUFFER_maux
 #undef __KALMAN_maux_size
+#undef __KALMAN_maux_shared
+#undef __KALMAN_temp_own
@@ -0,0 +1,308 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef KALMAN_FLEET_H_
+#define KALMAN_FLEET_H_
+
+#include <stdint.h>
+#include <pthread.h>
+#include "compiler.h"
+#include "kalman.h"
+#include "kalman_arena.h"
+#include "kalman_pool.h"
+#include "kalman_scratch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+* \def KALMAN_FLEET_INVALID The id returned by {\ref kalman_fleet_register} if the fleet is full
+*/
+#define KALMAN_FLEET_INVALID        (UINT32_MAX)
+
+/*!
+* \def KALMAN_FLEET_PREDICT Job flag: predict the filter before it is corrected
+*/
+#define KALMAN_FLEET_PREDICT        (1u << 0)
+
+/*!
+* \def KALMAN_FLEET_GRAIN Number of filters per task of {\ref kalman_fleet_run}
+*
+* Filters are ordered by shape before they are dealt out, so that a task mostly runs filters of one shape.
+*/
+#ifndef KALMAN_FLEET_GRAIN
+#define KALMAN_FLEET_GRAIN          (8u)
+#endif
+
+/*!
+* \brief A filter registered with a fleet
+*/
+typedef struct
+{
+    /*!
+    * \brief The filter
+    */
+    kalman_t *kf;
+
+    /*!
+    * \brief The measurement used by jobs that do not name one
+    */
+    kalman_measurement_t *kfm;
+
+    /*!
+    * \brief The shape of the filter, ordering the run list: the number of states in the upper, the number of measured outputs in the lower 16 bits.
+    */
+    uint_fast32_t shape;
+
+    /*!
+    * \brief Index of the first pending job, or {\ref KALMAN_FLEET_INVALID}
+    */
+    uint_fast32_t head;
+
+    /*!
+    * \brief Index of the last pending job, or {\ref KALMAN_FLEET_INVALID}
+    */
+    uint_fast32_t tail;
+} kalman_fleet_filter_t;
+
+/*!
+* \brief A measurement queued for a filter
+*/
+typedef struct
+{
+    /*!
+    * \brief The measurement structure to correct with
+    */
+    kalman_measurement_t *kfm;
+
+    /*!
+    * \brief The measured values, one per measured output; referenced, not copied.
+    */
+    const matrix_data_t *z;
+
+    /*!
+    * \brief Index of the next job of the same filter, or {\ref KALMAN_FLEET_INVALID}
+    */
+    uint_fast32_t next;
+
+    /*!
+    * \brief Combination of {\ref KALMAN_FLEET_PREDICT}
+    */
+    uint_fast8_t flags;
+} kalman_fleet_job_t;
+
+/*!
+* \brief An entry of the run list of a fleet
+*/
+typedef struct
+{
+    /*!
+    * \brief The shape of the filter
+    */
+    uint_fast32_t shape;
+
+    /*!
+    * \brief The id of the filter
+    */
+    uint_fast32_t id;
+
+    /*!
+    * \brief Index of the first job of the filter; set when the run takes over the run list
+    */
+    uint_fast32_t head;
+} kalman_fleet_slot_t;
+
+/*!
+* \brief Per-thread state of {\ref kalman_fleet_run}
+*
+* Every record occupies its own cache line, so that threads updating their records do not invalidate each other's lines.
+*/
+typedef struct
+{
+    /*!
+    * \brief Number of jobs executed
+    */
+    uint_fast32_t jobs;
+
+    /*!
+    * \brief Number of filters executed
+    */
+    uint_fast32_t filters;
+
+    /*!
+    * \brief Number of times a filter of a different shape than the previous one was executed
+    */
+    uint_fast32_t shape_changes;
+
+    /*!
+    * \brief The shape of the previously executed filter
+    */
+    uint_fast32_t shape;
+
+    /*!
+    * \brief The scratch area attached while the thread executes jobs, or \c NULL
+    * \see kalman_fleet_set_scratch
+    */
+    kalman_scratch_t *scratch;
+} __attribute__((aligned(64))) kalman_fleet_worker_t;
+
+/*!
+* \brief A set of filters of arbitrary shapes that are corrected by queued jobs
+*
+* Jobs may be submitted from any thread. {\ref kalman_fleet_run} executes all queued jobs on a pool: the
+* jobs of one filter run on one thread in submission order, different filters run in parallel. The run list
+* and the job storage are double-buffered, so jobs submitted during a run are queued for the next one.
+*/
+typedef struct
+{
+    /*!
+    * \brief Guards the registration and the job queues
+    */
+    pthread_mutex_t lock;
+
+    /*!
+    * \brief Held for the duration of a run, and guards the scratch areas of {\ref workers}
+    */
+    pthread_mutex_t run_lock;
+
+    /*!
+    * \brief The per-thread records: the counts of the last run and the scratch areas
+    */
+    kalman_fleet_worker_t workers[KALMAN_POOL_MAX_THREADS];
+
+    /*!
+    * \brief The registered filters, indexed by id
+    */
+    kalman_fleet_filter_t *filters;
+
+    /*!
+    * \brief The run list, one slot per filter with pending jobs
+    */
+    kalman_fleet_slot_t *slots;
+
+    /*!
+    * \brief The job storage
+    */
+    kalman_fleet_job_t *jobs;
+
+    /*!
+    * \brief The run list of the run in progress; swapped with {\ref slots} when a run starts
+    */
+    kalman_fleet_slot_t *running_slots;
+
+    /*!
+    * \brief The job storage of the run in progress; swapped with {\ref jobs} when a run starts
+    */
+    kalman_fleet_job_t *running_jobs;
+
+    /*!
+    * \brief The number of registered filters
+    */
+    uint_fast32_t num_filters;
+
+    /*!
+    * \brief The largest number of filters
+    */
+    uint_fast32_t max_filters;
+
+    /*!
+    * \brief The number of filters with pending jobs
+    */
+    uint_fast32_t num_pending;
+
+    /*!
+    * \brief The number of queued jobs
+    */
+    uint_fast32_t num_jobs;
+
+    /*!
+    * \brief The largest number of queued jobs
+    */
+    uint_fast32_t max_jobs;
+} kalman_fleet_t;
+
+/*!
+* \brief Gets the number of bytes {\ref kalman_fleet_create} requests for a fleet
+* \param[in] max_filters The largest number of filters
+* \param[in] max_jobs The largest number of jobs queued between two runs
+* \return The size of the block holding the structure, the filter table, and two run lists and job storages.
+*/
+size_t kalman_fleet_create_size(uint_fast32_t max_filters, uint_fast32_t max_jobs) PURE;
+
+/*!
+* \brief Creates a fleet in an arena
+* \param[in] arena The arena to allocate from
+* \param[in] max_filters The largest number of filters; at most the largest {\ref matrix_offset_t}.
+* \param[in] max_jobs The largest number of jobs queued between two runs
+* \return The empty fleet, or \c NULL if the arena is exhausted.
+*/
+kalman_fleet_t* kalman_fleet_create(kalman_arena_t *arena, uint_fast32_t max_filters, uint_fast32_t max_jobs) COLD;
+
+/*!
+* \brief Releases a fleet created by {\ref kalman_fleet_create}
+* \param[in] arena The arena the fleet was created in
+* \param[in] fleet The fleet; may be \c NULL. The registered filters are not released.
+*/
+void kalman_fleet_destroy(kalman_arena_t *arena, kalman_fleet_t *fleet) COLD;
+
+/*!
+* \brief Registers a filter and its measurement with a fleet
+* \param[in] fleet The fleet
+* \param[in] kf The filter; it must only be updated through the fleet from now on.
+* \param[in] kfm The measurement used by jobs that do not name one; it must not belong to another filter.
+* \return The id of the filter, or {\ref KALMAN_FLEET_INVALID} if the fleet is full or \c kfm is registered with another filter.
+*
+* The jobs of different filters run in parallel and write into their measurement structures, so every
+* measurement structure belongs to exactly one filter.
+*/
+uint_fast32_t kalman_fleet_register(kalman_fleet_t *fleet, kalman_t *kf, kalman_measurement_t *kfm) COLD;
+
+/*!
+* \brief Queues a measurement for a filter
+* \param[in] fleet The fleet
+* \param[in] id The id of the filter
+* \param[in] kfm The measurement structure to correct with; \c NULL uses the registered one. It must not be
+*            used for jobs of other filters.
+* \param[in] z The measured values; they must stay valid until the {\ref kalman_fleet_run} executing the job returns.
+* \param[in] flags Combination of {\ref KALMAN_FLEET_PREDICT}
+* \return Zero in case of success, nonzero if the id is unknown, the job storage is full or \c kfm is registered
+*         with another filter.
+*
+* May be called from any thread, also while a run is in progress; the job then runs in the next run.
+*/
+int kalman_fleet_submit(kalman_fleet_t *fleet, uint_fast32_t id, kalman_measurement_t *kfm, const matrix_data_t *z, uint_fast8_t flags);
+
+/*!
+* \brief Sets the scratch area a thread attaches while it executes jobs
+* \param[in] fleet The fleet
+* \param[in] thread The index of the thread within the pool
+* \param[in] scratch The scratch area; \c NULL keeps the one attached to the thread.
+*
+* Filters and measurements created with shared temporaries need a scratch area on every thread of the pool;
+* with one area per thread, the temporaries of all filters of a thread stay in its cache.
+*/
+void kalman_fleet_set_scratch(kalman_fleet_t *fleet, uint_fast8_t thread, kalman_scratch_t *scratch) COLD;
+
+/*!
+* \brief Executes all queued jobs
+* \param[in] fleet The fleet
+* \param[in] pool The pool to execute on; if \c NULL, the jobs run on the calling thread.
+*
+* The filters with pending jobs are ordered by shape and dealt out to the threads in runs of
+* {\ref KALMAN_FLEET_GRAIN}. A thread executes all jobs of a filter in submission order, so no filter
+* is ever updated by two threads at once. Large filters are not split further while the pool is busy
+* with the fleet. The queues are only locked while the run takes them over; runs started concurrently
+* execute one after another. Returns after all jobs taken over have been executed; {\ref workers} then
+* holds the per-thread counts.
+*/
+void kalman_fleet_run(kalman_fleet_t *fleet, kalman_pool_t *pool) HOT;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
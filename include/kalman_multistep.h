@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef KALMAN_MULTISTEP_H_
+#define KALMAN_MULTISTEP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "compiler.h"
+#include "matrix.h"
+#include "kalman.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+* \def KALMAN_MULTISTEP_SLOTS The number of step counts a multi-step cache keeps
+*/
+#ifndef KALMAN_MULTISTEP_SLOTS
+#define KALMAN_MULTISTEP_SLOTS      (4u)
+#endif
+
+/*!
+* \def KALMAN_MULTISTEP_SIZE Gets the number of elements of the buffer of a multi-step cache for a filter of the given shape
+*
+* Every slot holds A^k and the accumulated noise; the squaring needs one more of each, a product and two vectors.
+*/
+#define KALMAN_MULTISTEP_SIZE(num_states, num_inputs) \
+    ((KALMAN_MULTISTEP_SLOTS + 1u) * 2u * (size_t)(num_states) * (num_states) \
+     + (size_t)(num_states) * (((num_states) > (num_inputs)) ? (num_states) : (num_inputs)) \
+     + 2u * (size_t)(((num_states) > (num_inputs)) ? (num_states) : (num_inputs)))
+
+/*!
+* \brief The propagation of a number of prediction steps
+*/
+typedef struct
+{
+    /*!
+    * \brief The number of steps, or zero if the slot is empty
+    */
+    uint_fast32_t steps;
+
+    /*!
+    * \brief The model version the slot was calculated for
+    * \see kalman_t::model_version
+    */
+    uint_fast32_t model_version;
+
+    /*!
+    * \brief The use counter of the cache at the last use of the slot
+    */
+    uint_fast32_t last_used;
+
+    /*!
+    * \brief The state transition A^k
+    */
+    matrix_t A;
+
+    /*!
+    * \brief The accumulated input noise, sum of A^i*B*Q*B'*A^i' for i < k; stored like P
+    */
+    matrix_t N;
+} kalman_multistep_slot_t;
+
+/*!
+* \brief A least recently used cache of multi-step propagations
+*/
+typedef struct kalman_multistep_t
+{
+    /*!
+    * \brief The slots
+    */
+    kalman_multistep_slot_t slots[KALMAN_MULTISTEP_SLOTS];
+
+    /*!
+    * \brief Counts the uses of the cache
+    */
+    uint_fast32_t clock;
+
+    /*!
+    * \brief The number of hits
+    */
+    uint_fast32_t hits;
+
+    /*!
+    * \brief The number of misses, i.e. of calculated slots
+    */
+    uint_fast32_t misses;
+
+    /*!
+    * \brief The current power of two of the squaring, A^(2^j) and its accumulated noise
+    */
+    kalman_multistep_slot_t power;
+
+    /*!
+    * \brief Temporary product (\c num_states x \c num_states, or \c num_states x \c num_inputs)
+    */
+    matrix_t temp;
+
+    /*!
+    * \brief Auxiliary vector that can hold a column of any operand
+    */
+    matrix_data_t *aux;
+
+    /*!
+    * \brief Temporary state vector
+    */
+    matrix_t x;
+} kalman_multistep_t;
+
+/*!
+* \brief Attaches a multi-step cache to a filter
+* \param[in] kf The Kalman Filter structure
+* \param[in] ms The cache to initialize; \c NULL detaches the current one.
+* \param[in] buffer The buffer of {\ref KALMAN_MULTISTEP_SIZE} elements
+* \param[in] size The number of elements of the buffer
+*/
+void kalman_cache_multistep(kalman_t *kf, kalman_multistep_t *ms, matrix_data_t *buffer, size_t size) COLD;
+
+/*!
+* \brief Performs a number of prediction steps at once
+* \param[in] kf The Kalman Filter structure to predict with.
+* \param[in] steps The number of steps
+*
+* Equivalent to calling {\ref kalman_predict} \c steps times, e.g. to bridge a sensor outage. With a cache attached
+* by {\ref kalman_cache_multistep}, x = A^k*x and P = A^k*P*A^k' + N_k are applied in one propagation; A^k and the
+* accumulated noise N_k are calculated by repeated squaring in O(log k) products and kept for the next call with
+* the same \c steps until the model changes. Without a cache, the steps are predicted one by one. If the filter is
+* flagged with {\ref KALMAN_FLAG_LAZY}, the covariance propagation is deferred like in {\ref kalman_predict}.
+*/
+void kalman_predict_n(kalman_t *kf, uint_fast32_t steps) HOT;
+
+/*!
+* \brief Performs a number of prediction steps of only the state covariance matrix at once
+* \param[in] kf The Kalman Filter structure to predict with.
+* \param[in] steps The number of steps
+*
+* Equivalent to calling {\ref kalman_predict_Q} \c steps times; coalesced into one propagation with a cache.
+* {\ref kalman_flush_covariance} runs the propagations deferred by {\ref KALMAN_FLAG_LAZY} through it.
+*/
+void kalman_predict_Q_n(kalman_t *kf, uint_fast32_t steps) HOT;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,247 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef KALMAN_POOL_H_
+#define KALMAN_POOL_H_
+
+#include <stdint.h>
+#include <pthread.h>
+#include "compiler.h"
+#include "matrix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+* \def KALMAN_POOL_MAX_THREADS The largest number of threads of a pool, including the calling thread
+*/
+#ifndef KALMAN_POOL_MAX_THREADS
+#define KALMAN_POOL_MAX_THREADS     (32u)
+#endif
+
+/*!
+* \def KALMAN_POOL_THRESHOLD Smallest number of states from which on the prediction and correction steps use the attached pool
+*/
+#ifndef KALMAN_POOL_THRESHOLD
+#define KALMAN_POOL_THRESHOLD       (96u)
+#endif
+
+/*!
+* \def KALMAN_POOL_GRAIN Number of rows of the state covariance per task
+*
+* Defaults to {\ref MATRIX_BLOCK_THRESHOLD}, so that the product of every row block still uses the cache-blocked kernel,
+* or to 16 rows if blocking is disabled, as it is without {\ref KALMAN_LARGE_MATRICES}.
+*/
+#ifndef KALMAN_POOL_GRAIN
+#define KALMAN_POOL_GRAIN           ((MATRIX_BLOCK_THRESHOLD > 0) ? MATRIX_BLOCK_THRESHOLD : 16u)
+#endif
+
+/*!
+* \brief A task of a parallel loop
+* \param[in] context The context passed to {\ref kalman_pool_parallel_for}
+* \param[in] begin The first index of the range
+* \param[in] end One past the last index of the range
+*/
+typedef void (*kalman_pool_task_t)(void *context, matrix_offset_t begin, matrix_offset_t end);
+
+/*!
+* \brief The task queue of one thread of a pool
+*
+* The owner takes chunks from the front, idle threads steal from the back. Every queue occupies its own
+* cache lines, so that owners and thieves of different queues do not invalidate each other's lines.
+*/
+typedef struct
+{
+    /*!
+    * \brief Guards {\ref head} and {\ref tail}
+    */
+    pthread_mutex_t lock;
+
+    /*!
+    * \brief Index of the next chunk the owner takes
+    */
+    matrix_offset_t head;
+
+    /*!
+    * \brief One past the index of the chunk a thief takes next
+    */
+    matrix_offset_t tail;
+} __attribute__((aligned(64))) kalman_pool_queue_t;
+
+/*!
+* \brief A pool of threads that execute parallel loops by work stealing
+*
+* The thread calling {\ref kalman_pool_parallel_for} takes part as thread 0, so a pool of \c n threads
+* starts <tt>n - 1</tt> additional ones. A pool runs one loop at a time.
+*/
+typedef struct
+{
+    /*!
+    * \brief The task queues, one per thread
+    */
+    kalman_pool_queue_t queues[KALMAN_POOL_MAX_THREADS];
+
+    /*!
+    * \brief The started threads; entry 0 is unused.
+    */
+    pthread_t threads[KALMAN_POOL_MAX_THREADS];
+
+    /*!
+    * \brief The number of threads including the calling thread
+    */
+    uint_fast8_t num_threads;
+
+    /*!
+    * \brief Held by the thread whose loop the pool is executing
+    */
+    pthread_mutex_t submit;
+
+    /*!
+    * \brief Guards the loop description, {\ref generation}, {\ref busy} and {\ref shutdown}
+    */
+    pthread_mutex_t lock;
+
+    /*!
+    * \brief Signals the start of a loop, or the shutdown
+    */
+    pthread_cond_t start;
+
+    /*!
+    * \brief Signals that the last started thread finished a loop
+    */
+    pthread_cond_t done;
+
+    /*!
+    * \brief Incremented per loop
+    */
+    uint_fast32_t generation;
+
+    /*!
+    * \brief Number of started threads still working on the current loop
+    */
+    uint_fast8_t busy;
+
+    /*!
+    * \brief Nonzero if the threads are to exit
+    */
+    uint_fast8_t shutdown;
+
+    /*!
+    * \brief The task of the current loop
+    */
+    kalman_pool_task_t task;
+
+    /*!
+    * \brief The context of the current loop
+    */
+    void *context;
+
+    /*!
+    * \brief The number of indices of the current loop
+    */
+    matrix_offset_t count;
+
+    /*!
+    * \brief The number of indices per chunk of the current loop
+    */
+    matrix_offset_t grain;
+} kalman_pool_t;
+
+/*!
+* \brief Initializes a pool and starts its threads
+* \param[in] pool The pool to initialize
+* \param[in] num_threads The number of threads including the calling thread, at most {\ref KALMAN_POOL_MAX_THREADS}.
+* \return Zero in case of success, nonzero if the threads could not be started.
+*/
+int kalman_pool_init(kalman_pool_t *pool, uint_fast8_t num_threads) COLD;
+
+/*!
+* \brief Stops the threads of a pool
+* \param[in] pool The pool; it must not be attached.
+*/
+void kalman_pool_destroy(kalman_pool_t *pool) COLD;
+
+/*!
+* \brief Gets the built-in pool with one thread per online CPU, starting it on first use
+* \return The pool, or \c NULL if it could not be started.
+*/
+kalman_pool_t* kalman_pool_default(void) COLD;
+
+/*!
+* \brief Runs a task over the range <tt>[0, count)</tt> in chunks of \c grain indices on all threads of a pool
+* \param[in] pool The pool; if \c NULL, the task runs on the calling thread.
+* \param[in] count The number of indices
+* \param[in] grain The number of indices per chunk
+* \param[in] task The task
+* \param[in] context The context passed to the task
+*
+* The chunks are dealt out to the threads in contiguous runs; a thread that runs out of chunks steals from
+* the back of the other queues, which balances uneven chunks such as the rows of a triangle. Returns after
+* all chunks have been completed. A loop started from within a task, or while another thread's loop occupies
+* the pool, runs on the calling thread.
+*/
+void kalman_pool_parallel_for(kalman_pool_t *pool, matrix_offset_t count, matrix_offset_t grain, kalman_pool_task_t task, void *context) HOT;
+
+/*!
+* \brief Gets the index of the calling thread within the loop it is executing
+* \return The index in <tt>[0, num_threads)</tt>, or -1 if the thread is not executing a task.
+*
+* Tasks use the index to address per-thread data without synchronization.
+*/
+int kalman_pool_thread_index(void);
+
+/*!
+* \brief Attaches a pool to the prediction and correction steps
+* \param[in] pool The pool; \c NULL detaches.
+*
+* While a pool is attached, {\ref kalman_predict_Q}, {\ref kalman_predict_Q_tuned} and {\ref kalman_correct} split
+* <tt>A*P*A'</tt>, <tt>H*P</tt> and <tt>P - K*(H*P)</tt> of filters with at least {\ref KALMAN_POOL_THRESHOLD} states
+* and a dense covariance into row blocks executed on the pool. Filters updated from several threads at once share
+* the pool; whoever finds it busy updates on its own thread.
+*/
+void kalman_pool_attach(kalman_pool_t *pool) COLD;
+
+/*!
+* \brief Gets the pool to use for a filter
+* \param[in] num_states The number of states of the filter
+* \return The attached pool, or \c NULL if none is attached, the filter is too small or the calling thread already executes a task.
+*/
+kalman_pool_t* kalman_pool_for(matrix_index_t num_states);
+
+/*!
+* \brief Calculates P = A*P*A' * scale for a dense, symmetric P on a pool
+* \param[in] pool The pool
+* \param[in] A The state transition matrix
+* \param[in] P The state covariance matrix
+* \param[in] temp The temporary matrix of the size of P
+* \param[in] scale Scaling factor
+*/
+void kalman_pool_predict_P(kalman_pool_t *pool, const matrix_t *A, const matrix_t *P, const matrix_t *temp, matrix_data_t scale) HOT;
+
+/*!
+* \brief Calculates HP = H*P for a dense, symmetric P on a pool
+* \param[in] pool The pool
+* \param[in] H The measurement transformation matrix
+* \param[in] P The state covariance matrix
+* \param[in] HP The result
+*/
+void kalman_pool_mult_HP(kalman_pool_t *pool, const matrix_t *H, const matrix_t *P, const matrix_t *HP) HOT;
+
+/*!
+* \brief Calculates P = P - K*HP for a dense P on a pool, assuming that K*HP is symmetric
+* \param[in] pool The pool
+* \param[in] K The Kalman gain
+* \param[in] HP The product H*P
+* \param[in] P The state covariance matrix
+*/
+void kalman_pool_update_P(kalman_pool_t *pool, const matrix_t *K, const matrix_t *HP, const matrix_t *P) HOT;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
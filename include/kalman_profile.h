@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef KALMAN_PROFILE_H_
+#define KALMAN_PROFILE_H_
+
+#include <stdint.h>
+#include "compiler.h"
+
+/*!
+* \def KALMAN_PROFILE Enables the per-stage cycle counters of the filter.
+*
+* When set to a nonzero value, every {\ref kalman_t} carries a {\ref kalman_stats_t} that the prediction
+* and correction steps add their per-stage timings to. Since this changes the layout of {\ref kalman_t},
+* the library and all code using it must be compiled with the same setting.
+*/
+#ifndef KALMAN_PROFILE
+#define KALMAN_PROFILE 0
+#endif
+
+#if KALMAN_PROFILE
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define KALMAN_PROFILE_TSC 1
+#else
+#include <time.h>
+#define KALMAN_PROFILE_TSC 0
+#endif
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+* \brief Instrumented stages of the prediction and correction steps
+*/
+typedef enum
+{
+    /*!
+    * \brief x = A*x
+    */
+    KALMAN_STAGE_PREDICT_X = 0,
+
+    /*!
+    * \brief P = A*P*A' + B*Q*B'
+    */
+    KALMAN_STAGE_PREDICT_Q,
+
+    /*!
+    * \brief y = z - H*x
+    */
+    KALMAN_STAGE_INNOVATION,
+
+    /*!
+    * \brief H*P and S = H*P*H' + R
+    */
+    KALMAN_STAGE_RESIDUAL_COVARIANCE,
+
+    /*!
+    * \brief S = L*L'
+    */
+    KALMAN_STAGE_CHOLESKY,
+
+    /*!
+    * \brief K = P*H' * S^-1 by forward and back substitution
+    */
+    KALMAN_STAGE_GAIN,
+
+    /*!
+    * \brief x = x + K*y
+    */
+    KALMAN_STAGE_STATE_UPDATE,
+
+    /*!
+    * \brief P = P - K*(H*P)
+    */
+    KALMAN_STAGE_COVARIANCE_UPDATE,
+
+    /*!
+    * \brief The number of stages
+    */
+    KALMAN_STAGE_COUNT
+} kalman_stage_t;
+
+/*!
+* \brief Accumulated per-stage timings of a filter
+*
+* The unit of {\ref ticks} is CPU cycles (the time stamp counter) on x86 and nanoseconds elsewhere.
+*/
+typedef struct
+{
+    /*!
+    * \brief Accumulated ticks per stage
+    */
+    uint64_t ticks[KALMAN_STAGE_COUNT];
+
+    /*!
+    * \brief Number of times each stage ran
+    */
+    uint64_t calls[KALMAN_STAGE_COUNT];
+} kalman_stats_t;
+
+/*!
+* \brief Gets the name of a stage, e.g. for reports
+* \param[in] stage The stage
+* \return The name, or \c "unknown".
+*/
+const char* kalman_profile_stage_name(kalman_stage_t stage) COLD;
+
+#if KALMAN_PROFILE
+
+/*!
+* \brief Reads the profiling clock.
+* \return The current tick count.
+*/
+STATIC_INLINE uint64_t kalman_profile_now(void)
+{
+#if KALMAN_PROFILE_TSC
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/*!
+* \brief Adds the ticks elapsed since \c start to a stage.
+* \param[in] stats The statistics to add to
+* \param[in] stage The stage that just finished
+* \param[in] start The tick count at which the stage started
+* \return The current tick count, i.e. the start of the next stage.
+*/
+STATIC_INLINE uint64_t kalman_profile_record(kalman_stats_t *stats, kalman_stage_t stage, uint64_t start)
+{
+    const uint64_t now = kalman_profile_now();
+    stats->ticks[stage] += now - start;
+    ++stats->calls[stage];
+    return now;
+}
+
+/*!
+* \def KALMAN_PROFILE_BEGIN Starts timing the first stage of a function.
+*/
+#define KALMAN_PROFILE_BEGIN() \
+    uint64_t kalman_profile_start = kalman_profile_now()
+
+/*!
+* \def KALMAN_PROFILE_STAGE Ends the given stage of filter \c kf and starts timing the next one.
+*/
+#define KALMAN_PROFILE_STAGE(kf, stage) \
+    kalman_profile_start = kalman_profile_record(&(kf)->stats, (stage), kalman_profile_start)
+
+#else
+
+#define KALMAN_PROFILE_BEGIN()              do { } while (0)
+#define KALMAN_PROFILE_STAGE(kf, stage)     do { } while (0)
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
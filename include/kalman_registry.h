@@ -0,0 +1,143 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef KALMAN_REGISTRY_H_
+#define KALMAN_REGISTRY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "compiler.h"
+
+/*!
+* \def KALMAN_REGISTRY Enables the runtime registry of factory filters.
+*
+* When set to a nonzero value, the initialization functions created by the factory headers add a descriptor of
+* their filter or measurement to the registry (see {\ref kalman_registry_first}). Without it, the factory creates
+* no descriptors, so the registry costs nothing on builds that do not use it.
+*/
+#ifndef KALMAN_REGISTRY
+#define KALMAN_REGISTRY 0
+#endif
+
+/*!
+* \def KALMAN_FILTER_BYTES Gets the static footprint in bytes of a factory filter, its measurements and its temporaries
+*
+* The footprints are \c size_t constant expressions, the sizes of byte array types defined by the factory, since an
+* enumeration constant is limited to the range of \c int, i.e. 32767 bytes on 16 bit targets.
+*/
+#define KALMAN_FILTER_BYTES(name)                           sizeof(kalman_filter_ ## name ## _footprint_t)
+
+/*!
+* \def KALMAN_FILTER_ONLY_BYTES Gets the static footprint in bytes of a factory filter and the temporaries it shares with its measurements
+*/
+#define KALMAN_FILTER_ONLY_BYTES(name)                      sizeof(kalman_filter_ ## name ## _filter_footprint_t)
+
+/*!
+* \def KALMAN_MEASUREMENT_BYTES Gets the static footprint in bytes of a measurement of a factory filter
+*
+* The temporaries shared with the filter are counted by the filter (see {\ref KALMAN_FILTER_ONLY_BYTES}).
+*/
+#define KALMAN_MEASUREMENT_BYTES(name, measurement)         sizeof(kalman_filter_ ## name ## _measurement_ ## measurement ## _footprint_t)
+
+/*!
+* \def KALMAN_STATIC_ASSERT_FOOTPRINT Fails compilation if a footprint exceeds a number of bytes
+*
+* \code{.c}
+* KALMAN_STATIC_ASSERT_FOOTPRINT(KALMAN_FILTER_BYTES(gravity), 2048);
+* KALMAN_STATIC_ASSERT_FOOTPRINT(KALMAN_MEASUREMENT_BYTES(gravity, position), 256);
+* \endcode
+*/
+#ifdef __cplusplus
+#define KALMAN_STATIC_ASSERT_FOOTPRINT(bytes, limit)        static_assert((bytes) <= (limit), "Kalman footprint exceeds its limit: " #bytes)
+#else
+#define KALMAN_STATIC_ASSERT_FOOTPRINT(bytes, limit)        _Static_assert((bytes) <= (limit), "Kalman footprint exceeds its limit: " #bytes)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+* \brief Descriptor of a factory filter or measurement in the registry
+*/
+typedef struct kalman_registry_entry_t
+{
+    /*!
+    * \brief The name of the filter
+    */
+    const char *filter;
+
+    /*!
+    * \brief The name of the measurement, or \c NULL if the entry describes the filter
+    */
+    const char *measurement;
+
+    /*!
+    * \brief The filter structure, or the first one of its instances
+    */
+    const void *structure;
+
+    /*!
+    * \brief The number of states
+    */
+    uint_fast16_t num_states;
+
+    /*!
+    * \brief The number of inputs of a filter; zero for measurements
+    */
+    uint_fast16_t num_inputs;
+
+    /*!
+    * \brief The number of measured outputs of a measurement; zero for filters
+    */
+    uint_fast16_t num_measurements;
+
+    /*!
+    * \brief The number of instances
+    */
+    uint_fast16_t num_instances;
+
+    /*!
+    * \brief The static footprint in bytes of all instances; for a filter including the temporaries shared with its measurements
+    */
+    size_t bytes;
+
+    /*!
+    * \brief The next registered entry, or \c NULL
+    */
+    const struct kalman_registry_entry_t *next;
+
+    /*!
+    * \brief Nonzero once the entry is registered
+    */
+    uint_fast8_t registered;
+} kalman_registry_entry_t;
+
+/*!
+* \brief Adds an entry to the registry
+* \param[in] entry The entry; it must stay valid for the lifetime of the program. Entries already registered are skipped.
+*
+* Called by the factory initialization functions if {\ref KALMAN_REGISTRY} is set.
+*/
+void kalman_registry_add(kalman_registry_entry_t *entry) COLD;
+
+/*!
+* \brief Gets the first registered entry
+* \return The entry registered first, or \c NULL. Further entries follow through {\ref kalman_registry_entry_t::next} in registration order.
+*/
+const kalman_registry_entry_t* kalman_registry_first(void);
+
+/*!
+* \brief Gets the number of bytes of all registered entries
+* \return The sum of the footprints of all registered filters and measurements.
+*/
+size_t kalman_registry_total_bytes(void) COLD;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef KALMAN_SCRATCH_H_
+#define KALMAN_SCRATCH_H_
+
+#include <stddef.h>
+#include "compiler.h"
+#include "matrix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+* \def KALMAN_SCRATCH_ALIGNMENT The number of elements the matrix temporaries are offset by a multiple of
+*/
+#define KALMAN_SCRATCH_ALIGNMENT    (16u)
+
+/*!
+* \def KALMAN_SCRATCH_MAX Gets the largest of three dimensions
+*/
+#define KALMAN_SCRATCH_MAX(a, b, c) (((a) > (b)) ? (((a) > (c)) ? (a) : (c)) : (((b) > (c)) ? (b) : (c)))
+
+/*!
+* \def KALMAN_SCRATCH_AUX Gets the number of elements of the auxiliary vector region, rounded up to {\ref KALMAN_SCRATCH_ALIGNMENT}
+*/
+#define KALMAN_SCRATCH_AUX(length)  ((((size_t)(length)) + KALMAN_SCRATCH_ALIGNMENT - 1) & ~(size_t)(KALMAN_SCRATCH_ALIGNMENT - 1))
+
+/*!
+* \def KALMAN_SCRATCH_SIZE Gets the number of elements a scratch area needs for filters up to the given shape
+*
+* The temporaries of the prediction (\c aux, <tt>A*P</tt>, <tt>B*Q</tt>) and of the correction (\c aux, <tt>H*P</tt>)
+* are never live at the same time, so they share the area.
+*/
+#define KALMAN_SCRATCH_SIZE(num_states, num_inputs, num_measurements) \
+    (KALMAN_SCRATCH_AUX(KALMAN_SCRATCH_MAX(num_states, num_inputs, num_measurements)) \
+     + (size_t)(num_states) * KALMAN_SCRATCH_MAX(num_states, num_inputs, num_measurements))
+
+/*!
+* \brief A buffer the temporaries of filters and measurements are taken from during a call
+*
+* Filters and measurements initialized without temporaries (see {\ref kalman_filter_initialize}) point them into
+* the scratch area attached to the calling thread at the start of every prediction and correction. One area sized
+* with {\ref KALMAN_SCRATCH_SIZE} for the largest shape serves any number of filters on that thread.
+*/
+typedef struct
+{
+    /*!
+    * \brief The buffer
+    */
+    matrix_data_t *buffer;
+
+    /*!
+    * \brief The number of elements of the buffer
+    */
+    size_t size;
+} kalman_scratch_t;
+
+/*!
+* \brief Initializes a scratch area over a buffer
+* \param[in] scratch The scratch area to initialize
+* \param[in] buffer The buffer
+* \param[in] size The number of elements of the buffer, e.g. {\ref KALMAN_SCRATCH_SIZE}
+*/
+void kalman_scratch_init(kalman_scratch_t *scratch, matrix_data_t *buffer, size_t size) COLD;
+
+/*!
+* \brief Attaches a scratch area to the calling thread
+* \param[in] scratch The scratch area; \c NULL detaches.
+* \return The previously attached scratch area.
+*
+* Without {\ref KALMAN_THREADS}, there is one scratch area for the whole program.
+*/
+kalman_scratch_t* kalman_scratch_attach(kalman_scratch_t *scratch);
+
+/*!
+* \brief Gets the scratch area attached to the calling thread
+* \return The scratch area, or \c NULL if none is attached.
+*/
+kalman_scratch_t* kalman_scratch_current(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -10,6 +10,10 @@
 #include <stdint.h>
 #include "compiler.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /*!
 * \def EXTERN_INLINE_MATRIX Helper inline to switch from local inline to extern inline
 */
@@ -22,6 +26,114 @@
 */
 typedef float matrix_data_t;
 
+/*!
+* \def KALMAN_LARGE_MATRICES Lifts the limit of 255 rows and columns per matrix.
+*
+* When set to a nonzero value, matrix dimensions are \c uint_fast16_t and element offsets \c uint_fast32_t,
+* i.e. at least 16 and 32 bit wide, allowing filters with several hundred states. Since this changes the layout of {\ref matrix_t}, the library and
+* all code using it must be compiled with the same setting.
+*/
+#ifndef KALMAN_LARGE_MATRICES
+#define KALMAN_LARGE_MATRICES 0
+#endif
+
+#if KALMAN_LARGE_MATRICES
+
+/**
+* Matrix dimension type definition, i.e. the type of a row or column count or index.
+*/
+typedef uint_fast16_t matrix_index_t;
+
+/**
+* Matrix element offset type definition, e.g. for strides and linear element indices.
+*/
+typedef uint_fast32_t matrix_offset_t;
+
+/**
+* Signed matrix element offset type definition, for loops counting down.
+*/
+typedef int_fast32_t matrix_soffset_t;
+
+/*!
+* \def MATRIX_MAX_DIMENSION The largest number of rows or columns of a matrix
+*/
+#define MATRIX_MAX_DIMENSION    (UINT16_MAX)
+
+#else
+
+/**
+* Matrix dimension type definition, i.e. the type of a row or column count or index.
+*/
+typedef uint_fast8_t matrix_index_t;
+
+/**
+* Matrix element offset type definition, e.g. for strides and linear element indices.
+*/
+typedef uint_fast16_t matrix_offset_t;
+
+/**
+* Signed matrix element offset type definition, for loops counting down.
+*/
+typedef int_fast16_t matrix_soffset_t;
+
+/*!
+* \def MATRIX_MAX_DIMENSION The largest number of rows or columns of a matrix
+*/
+#define MATRIX_MAX_DIMENSION    (UINT8_MAX)
+
+#endif
+
+/*!
+* \def MATRIX_BLOCK_THRESHOLD Smallest dimension from which on the products use the cache-blocked kernel
+*
+* {\ref matrix_mult}, {\ref matrix_mult_transb} and their accumulating, scaling and symmetric variants
+* switch to a cache-tiled, register-blocked kernel if all of M, N and K are at least this large, since the
+* row-by-row kernels stream whole operands through the cache once they no longer fit into it.
+* Set to \c 0 to disable blocking. The kernel packs its panels into about 64 KiB of stack, so it is only
+* enabled by default with {\ref KALMAN_LARGE_MATRICES}, which targets hosts with large stacks.
+*/
+#ifndef MATRIX_BLOCK_THRESHOLD
+#if KALMAN_LARGE_MATRICES
+#define MATRIX_BLOCK_THRESHOLD  (48u)
+#else
+#define MATRIX_BLOCK_THRESHOLD  (0u)
+#endif
+#endif
+
+/*!
+* \def MATRIX_BLOCK_KC Depth of a packed panel, i.e. the number of shared dimension elements per pass
+*/
+#ifndef MATRIX_BLOCK_KC
+#define MATRIX_BLOCK_KC         (128u)
+#endif
+
+/*!
+* \def MATRIX_BLOCK_MC Number of rows of A packed per block; an MC x KC panel is meant to stay in L2
+*/
+#ifndef MATRIX_BLOCK_MC
+#define MATRIX_BLOCK_MC         (64u)
+#endif
+
+/*!
+* \def MATRIX_BLOCK_NC Number of columns of the result packed per block; a KC x NC panel is meant to stay in L2
+*
+* The packed panels of A and B live on the stack and take
+* <tt>(MATRIX_BLOCK_MC + MATRIX_BLOCK_NC) * MATRIX_BLOCK_KC</tt> elements.
+*/
+#ifndef MATRIX_BLOCK_NC
+#define MATRIX_BLOCK_NC         (64u)
+#endif
+
+/*!
+* \def MATRIX_BLOCK_MR Number of rows of a register block of the blocked products; fixed by the micro-kernels
+*/
+#define MATRIX_BLOCK_MR         (4u)
+
+/*!
+* \def MATRIX_BLOCK_NR Number of columns of a register block of the blocked products; fixed by the micro-kernels
+*/
+#define MATRIX_BLOCK_NR         (16u)
+
 /**
 * \brief Matrix definition
 */
@@ -29,19 +141,40 @@ typedef struct {
     /**
     * \brief Number of rows
     */
-    uint_fast8_t rows;
+    matrix_index_t rows;
 
     /**
     * \brief Number of columns
     */
-    uint_fast8_t cols;
+    matrix_index_t cols;
 
     /**
-    * \brief Pointer to the data array of size {\see rows} x {\see cols}.
+    * \brief Leading dimension, i.e. the distance in elements between the starts of two consecutive rows
+    *
+    * Equal to {\see cols} for dense storage. A larger stride pads every row, e.g. to the SIMD width,
+    * or describes a view into a larger matrix.
+    */
+    matrix_offset_t stride;
+
+    /**
+    * \brief Pointer to the first element of the data array of size {\see rows} x {\see stride}.
     */
     matrix_data_t *data;
 } matrix_t;
 
+/*!
+* \def MATRIX_STRIDE_PACKED Stride value that marks a square matrix stored as its packed upper triangle
+*
+* Row \c i of a packed matrix holds the elements <tt>(i, i) .. (i, n-1)</tt> and directly follows row <tt>i-1</tt>.
+* The largest offset is no valid stride, so packed storage cannot be mistaken for a dense matrix, e.g. one without columns.
+*/
+#define MATRIX_STRIDE_PACKED    ((matrix_offset_t)-1)
+
+/*!
+* \def MATRIX_PACKED_SIZE Number of elements of a packed symmetric {\ref n} x {\ref n} matrix
+*/
+#define MATRIX_PACKED_SIZE(n)   (((n) * ((n) + 1)) / 2)
+
 /**
 * \brief Initializes a matrix structure.
 * \param[in] mat The matrix to initialize
@@ -49,7 +182,62 @@ typedef struct {
 * \param[in] cols The number of columns
 * \param[in] buffer The data buffer (of size {\see rows} x {\see cols}).
 */
-void matrix_init(matrix_t *const  mat, const uint_fast8_t rows, const uint_fast8_t cols, matrix_data_t *const buffer);
+void matrix_init(matrix_t *const  mat, const matrix_index_t rows, const matrix_index_t cols, matrix_data_t *const buffer);
+
+/**
+* \brief Initializes a matrix structure with padded rows.
+* \param[in] mat The matrix to initialize
+* \param[in] rows The number of rows
+* \param[in] cols The number of columns
+* \param[in] stride The distance in elements between the starts of two consecutive rows; must not be less than {\see cols}.
+* \param[in] buffer The data buffer (of size {\see rows} x {\see stride}).
+*/
+void matrix_init_strided(matrix_t *const mat, const matrix_index_t rows, const matrix_index_t cols, const matrix_offset_t stride, matrix_data_t *const buffer);
+
+/**
+* \brief Creates a view of a rectangular block of a matrix without copying.
+* \param[in] mat The matrix to view into
+* \param[in] row The first row of the block
+* \param[in] col The first column of the block
+* \param[in] rows The number of rows of the block
+* \param[in] cols The number of columns of the block
+* \param[out] view The view; it shares the data and the stride of {\ref mat}.
+*
+* All kernels accept views as operands and results. There is no transpose view; transposed
+* operands are expressed through the <tt>_transb</tt> kernels instead.
+*/
+void matrix_view_submatrix(const matrix_t *const mat, const matrix_index_t row, const matrix_index_t col, const matrix_index_t rows, const matrix_index_t cols, matrix_t *const view);
+
+/**
+* \brief Creates a view of consecutive rows of a matrix without copying.
+* \param[in] mat The matrix to view into
+* \param[in] row The first row of the block
+* \param[in] rows The number of rows of the block
+* \param[out] view The view; it shares the data and the stride of {\ref mat}.
+*/
+void matrix_view_rows(const matrix_t *const mat, const matrix_index_t row, const matrix_index_t rows, matrix_t *const view);
+
+/**
+* \brief Creates a view of consecutive columns of a matrix without copying.
+* \param[in] mat The matrix to view into
+* \param[in] col The first column of the block
+* \param[in] cols The number of columns of the block
+* \param[out] view The view; it shares the data and the stride of {\ref mat}.
+*/
+void matrix_view_columns(const matrix_t *const mat, const matrix_index_t col, const matrix_index_t cols, matrix_t *const view);
+
+/**
+* \brief Initializes a symmetric matrix structure stored as its packed upper triangle.
+* \param[in] mat The matrix to initialize
+* \param[in] n The number of rows and columns
+* \param[in] buffer The data buffer (of size {\ref MATRIX_PACKED_SIZE} of {\see n}).
+*
+* Single elements are accessed through {\ref matrix_get_packed} and {\ref matrix_set_packed}. {\ref matrix_set_symmetric},
+* the row and column copies, {\ref matrix_copy} and {\ref matrix_add_inplace} accept packed matrices, as does
+* {\ref matrix_mult} for its operand B. Results are written by the <tt>_packed</tt> kernels. All other kernels and
+* accessors require dense or strided storage.
+*/
+void matrix_init_packed(matrix_t *const mat, const matrix_index_t n, matrix_data_t *const buffer);
 
 /**
 * \brief Inverts a lower triangular matrix.
@@ -122,43 +310,179 @@ void matrix_multadd_transb(const matrix_t *const a, const matrix_t *const b, con
 *
 * Kudos: https://code.google.com/p/efficient-java-matrix-library
 */
-void matrix_multscale_transb(const matrix_t *const a, const matrix_t *const b, register const matrix_data_t scale, const matrix_t *RESTRICT c) HOT;
+void matrix_multscale_transb(const matrix_t *const a, const matrix_t *const b, const matrix_data_t scale, const matrix_t *RESTRICT c) HOT;
+
+/*!
+* \brief Performs a matrix multiplication with transposed B with a symmetric result such that {\ref c} = {\ref a} * {\ref b'}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting symmetric matrix C (will be overwritten)
+*
+* Only the upper triangle is calculated and mirrored; {\ref a} * {\ref b'} must be symmetric, e.g. (A*P)*A' for a symmetric P.
+*/
+void matrix_mult_transb_symmetric(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c) HOT;
+
+/*!
+* \brief Performs a matrix multiplication with transposed B with a symmetric result and adds it to {\ref c} such that {\ref c} = {\ref c} + {\ref a} * {\ref b'}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting symmetric matrix C (will be added to)
+*
+* Only the upper triangle is calculated and mirrored; {\ref a} * {\ref b'} must be symmetric, e.g. (B*Q)*B' for a symmetric Q.
+*/
+void matrix_multadd_transb_symmetric(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c) HOT;
+
+/*!
+* \brief Performs a matrix multiplication with transposed B with a symmetric result and scales it such that {\ref c} = {\ref a} * {\ref b'} * {\ref scale}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] scale Scaling factor
+* \param[in] c Resulting symmetric matrix C (will be overwritten)
+*
+* Only the upper triangle is calculated and mirrored; {\ref a} * {\ref b'} must be symmetric, e.g. (A*P)*A' for a symmetric P.
+*/
+void matrix_multscale_transb_symmetric(const matrix_t *const a, const matrix_t *const b, const matrix_data_t scale, const matrix_t *RESTRICT c) HOT;
+
+/*!
+* \brief Performs a matrix multiplication with a symmetric result and subtracts it from {\ref c} such that {\ref c} = {\ref c} - {\ref a} * {\ref b}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting symmetric matrix C (will be subtracted from)
+*
+* Only the upper triangle is calculated and mirrored; {\ref a} * {\ref b} must be symmetric, e.g. K*(H*P) in the covariance update.
+*/
+void matrix_multsub_symmetric(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c) HOT;
+
+/*!
+* \brief Performs a matrix multiplication with transposed B into a packed symmetric result such that {\ref c} = {\ref a} * {\ref b'}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting packed symmetric matrix C (will be overwritten)
+*
+* Like {\ref matrix_mult_transb_symmetric}, but only the upper triangle is stored.
+*/
+void matrix_mult_transb_packed(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c) HOT;
+
+/*!
+* \brief Performs a matrix multiplication with transposed B and adds it to a packed symmetric result such that {\ref c} = {\ref c} + {\ref a} * {\ref b'}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting packed symmetric matrix C (will be added to)
+*
+* Like {\ref matrix_multadd_transb_symmetric}, but only the upper triangle is stored.
+*/
+void matrix_multadd_transb_packed(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c) HOT;
+
+/*!
+* \brief Performs a matrix multiplication with transposed B into a scaled packed symmetric result such that {\ref c} = {\ref a} * {\ref b'} * {\ref scale}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] scale Scaling factor
+* \param[in] c Resulting packed symmetric matrix C (will be overwritten)
+*
+* Like {\ref matrix_multscale_transb_symmetric}, but only the upper triangle is stored.
+*/
+void matrix_multscale_transb_packed(const matrix_t *const a, const matrix_t *const b, const matrix_data_t scale, const matrix_t *RESTRICT c) HOT;
+
+/*!
+* \brief Performs a matrix multiplication and subtracts it from a packed symmetric matrix such that {\ref c} = {\ref c} - {\ref a} * {\ref b}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting packed symmetric matrix C (will be subtracted from)
+*
+* Like {\ref matrix_multsub_symmetric}, but only the upper triangle is stored.
+*/
+void matrix_multsub_packed(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c) HOT;
+
+/*!
+* \brief Determines whether a matrix is stored as a packed upper triangle
+* \param[in] mat The matrix to test
+* \return Nonzero if the matrix was initialized by {\ref matrix_init_packed}.
+*/
+PURE EXTERN_INLINE_MATRIX int matrix_is_packed(const matrix_t *const mat)
+{
+    return mat->stride == MATRIX_STRIDE_PACKED;
+}
+
+/*!
+* \brief Gets a row of a packed matrix
+* \param[in] mat The packed matrix
+* \param[in] row The row
+* \return A pointer that, indexed by a column \c j >= {\ref row}, yields the element (row, j).
+*/
+PURE EXTERN_INLINE_MATRIX matrix_data_t* matrix_packed_row(const matrix_t *const mat, const matrix_index_t row)
+{
+    const matrix_offset_t offset = (matrix_offset_t)row * mat->rows - ((matrix_offset_t)row * (row + 1u)) / 2u;
+    return &mat->data[offset];
+}
 
 /*!
 * \brief Gets a matrix element
-* \param[in] mat The matrix to get from
+* \param[in] mat The matrix to get from; not packed, see {\ref matrix_get_packed}.
 * \param[in] rows The row
 * \param[in] cols The column
 * \return The value at the given cell.
 */
-PURE EXTERN_INLINE_MATRIX matrix_data_t matrix_get(const matrix_t *const mat, const register uint_fast8_t row, const register uint_fast8_t column)
+PURE EXTERN_INLINE_MATRIX matrix_data_t matrix_get(const matrix_t *const mat, const matrix_index_t row, const matrix_index_t column)
 {
-    register uint_fast16_t address = row * mat->cols + column;
+    matrix_offset_t address = row * mat->stride + column;
     return mat->data[address];
 }
 
 /*!
 * \brief Sets a matrix element
-* \param[in] mat The matrix to set
+* \param[in] mat The matrix to set; not packed, see {\ref matrix_set_packed}.
 * \param[in] rows The row
 * \param[in] cols The column
 * \param[in] value The value to set
 */
-EXTERN_INLINE_MATRIX void matrix_set(matrix_t *mat, const register uint_fast8_t row, const register uint_fast8_t column, const register matrix_data_t value)
+EXTERN_INLINE_MATRIX void matrix_set(matrix_t *mat, const matrix_index_t row, const matrix_index_t column, const matrix_data_t value)
 {
-    register uint_fast16_t address = row * mat->cols + column;
+    matrix_offset_t address = row * mat->stride + column;
     mat->data[address] = value;
 }
 
+/*!
+* \brief Gets an element of a packed symmetric matrix
+* \param[in] mat The packed matrix to get from
+* \param[in] rows The row
+* \param[in] cols The column
+* \return The value at the given cell, or at its mirror in the upper triangle.
+*/
+PURE EXTERN_INLINE_MATRIX matrix_data_t matrix_get_packed(const matrix_t *const mat, const matrix_index_t row, const matrix_index_t column)
+{
+    return (row <= column) ? matrix_packed_row(mat, row)[column] : matrix_packed_row(mat, column)[row];
+}
+
+/*!
+* \brief Sets an element and its mirror of a packed symmetric matrix
+* \param[in] mat The packed matrix to set
+* \param[in] rows The row
+* \param[in] cols The column
+* \param[in] value The value to set
+*/
+EXTERN_INLINE_MATRIX void matrix_set_packed(matrix_t *mat, const matrix_index_t row, const matrix_index_t column, const matrix_data_t value)
+{
+    // both triangles share their storage
+    if (row <= column) matrix_packed_row(mat, row)[column] = value;
+    else matrix_packed_row(mat, column)[row] = value;
+}
+
 /*!
 * \brief Sets matrix elements in a symmetric matrix
-* \param[in] mat The matrix to set
+* \param[in] mat The matrix to set, dense or packed
 * \param[in] rows The row
 * \param[in] cols The column
 * \param[in] value The value to set
 */
-EXTERN_INLINE_MATRIX void matrix_set_symmetric(matrix_t *mat, const register uint_fast8_t row, const register uint_fast8_t column, const register matrix_data_t value)
+EXTERN_INLINE_MATRIX void matrix_set_symmetric(matrix_t *mat, const matrix_index_t row, const matrix_index_t column, const matrix_data_t value)
 {
+    if (matrix_is_packed(mat))
+    {
+        matrix_set_packed(mat, row, column, value);
+        return;
+    }
+
     matrix_set(mat, row, column, value);
     matrix_set(mat, column, row, value);
 }
@@ -168,10 +492,12 @@ EXTERN_INLINE_MATRIX void matrix_set_symmetric(matrix_t *mat, const register uin
 * \param[in] mat The matrix to get from
 * \param[in] rows The row
 * \param[out] row_data A pointer to the given matrix row
+*
+* Not applicable to packed matrices; see {\ref matrix_packed_row}.
 */
-EXTERN_INLINE_MATRIX void matrix_get_row_pointer(const matrix_t *const mat, const register uint_fast8_t row, matrix_data_t **row_data)
+EXTERN_INLINE_MATRIX void matrix_get_row_pointer(const matrix_t *const mat, const matrix_index_t row, matrix_data_t **row_data)
 {
-    register uint_fast16_t address = row * mat->cols;
+    matrix_offset_t address = row * mat->stride;
     *row_data = &mat->data[address];
 }
 
@@ -181,14 +507,30 @@ EXTERN_INLINE_MATRIX void matrix_get_row_pointer(const matrix_t *const mat, cons
 * \param[in] rows The column
 * \param[in] row_data Pointer to an array of the correct length to hold a column of matrix {\ref mat}.
 */
-HOT EXTERN_INLINE_MATRIX void matrix_get_column_copy(const matrix_t *const mat, const register uint_fast8_t column, register matrix_data_t *const row_data)
+HOT EXTERN_INLINE_MATRIX void matrix_get_column_copy(const matrix_t *const mat, const matrix_index_t column, matrix_data_t *const row_data)
 {
+    // the column of a symmetric matrix is its row
+    if (matrix_is_packed(mat))
+    {
+        matrix_index_t k;
+        const matrix_data_t *const prow = matrix_packed_row(mat, column);
+        for (k = 0; k < column; ++k)
+        {
+            row_data[k] = matrix_packed_row(mat, k)[column];
+        }
+        for (k = column; k < mat->rows; ++k)
+        {
+            row_data[k] = prow[k];
+        }
+        return;
+    }
+
     // start from the back, so target index is equal to the index of the last row.
-    register uint_fast8_t target_index = mat->rows - 1;
+    matrix_index_t target_index = mat->rows - 1;
 
     // also, the source index is the column..th index
-    const register int_fast16_t stride = mat->cols;
-    register int_fast16_t source_index = target_index * stride + column;
+    const matrix_soffset_t stride = mat->stride;
+    matrix_soffset_t source_index = target_index * stride + column;
 
     // fetch data
     row_data[target_index] = mat->data[source_index];
@@ -207,10 +549,16 @@ HOT EXTERN_INLINE_MATRIX void matrix_get_column_copy(const matrix_t *const mat,
 * \param[in] rows The row
 * \param[in] row_data Pointer to an array of the correct length to hold a row of matrix {\ref mat}.
 */
-EXTERN_INLINE_MATRIX void matrix_get_row_copy(const matrix_t *const mat, const register uint_fast8_t row, register matrix_data_t *const row_data)
+EXTERN_INLINE_MATRIX void matrix_get_row_copy(const matrix_t *const mat, const matrix_index_t row, matrix_data_t *const row_data)
 {
-    register uint_fast8_t target_index = mat->cols - 1;
-    register int_fast16_t source_index = (row + 1) * mat->cols - 1;
+    if (matrix_is_packed(mat))
+    {
+        matrix_get_column_copy(mat, row, row_data);
+        return;
+    }
+
+    matrix_index_t target_index = mat->cols - 1;
+    matrix_soffset_t source_index = row * mat->stride + target_index;
 
     // fetch data
     row_data[target_index] = mat->data[source_index];
@@ -222,23 +570,58 @@ EXTERN_INLINE_MATRIX void matrix_get_row_copy(const matrix_t *const mat, const r
     }
 }
 
+/*!
+* \brief Determines whether the rows of a matrix are stored without padding
+* \param[in] mat The matrix to test
+* \return Nonzero if the elements occupy one contiguous range of memory.
+*/
+PURE EXTERN_INLINE_MATRIX int matrix_is_dense(const matrix_t *const mat)
+{
+    return (mat->stride == mat->cols) || (mat->rows == 1);
+}
+
 /*!
 * \brief Copies the matrix from {\ref mat} to {\ref target}
 * \param[in] mat The matrix to copy
 * \param[in] target The matrix to copy to
+*
+* Both matrices must use the same storage, i.e. both packed or neither.
 */
 EXTERN_INLINE_MATRIX void matrix_copy(const matrix_t *const mat, matrix_t *const target)
 {
-    register const uint_fast16_t count = mat->cols * mat->rows;
-    register int_fast16_t index = 0;
+    matrix_soffset_t row, index;
+    const matrix_index_t cols = mat->cols;
 
     const matrix_data_t *RESTRICT const A = mat->data;
     matrix_data_t *RESTRICT const B = target->data;
 
     // fetch data
-    for (index = count - 1; index >= 0; --index)
+    if (matrix_is_packed(mat) && matrix_is_packed(target))
+    {
+        for (index = (matrix_soffset_t)MATRIX_PACKED_SIZE((matrix_offset_t)cols) - 1; index >= 0; --index)
+        {
+            B[index] = A[index];
+        }
+        return;
+    }
+
+    if (matrix_is_dense(mat) && matrix_is_dense(target))
+    {
+        for (index = (matrix_soffset_t)((matrix_offset_t)cols * mat->rows) - 1; index >= 0; --index)
+        {
+            B[index] = A[index];
+        }
+        return;
+    }
+
+    for (row = mat->rows - 1; row >= 0; --row)
     {
-        B[index] = A[index];
+        const matrix_data_t *RESTRICT const a = &A[row * mat->stride];
+        matrix_data_t *RESTRICT const b = &B[row * target->stride];
+        for (index = cols - 1; index >= 0; --index)
+        {
+            b[index] = a[index];
+        }
     }
 }
 
@@ -250,17 +633,32 @@ EXTERN_INLINE_MATRIX void matrix_copy(const matrix_t *const mat, matrix_t *const
 */
 HOT EXTERN_INLINE_MATRIX void matrix_sub(const matrix_t *const a, matrix_t *const b, const matrix_t *c)
 {
-    register const uint_fast16_t count = a->cols * a->rows;
-    register int_fast16_t index = 0;
+    matrix_soffset_t row, index;
+    const matrix_index_t cols = a->cols;
 
     matrix_data_t *RESTRICT const A = a->data;
     matrix_data_t *const B = b->data;
     matrix_data_t *C = c->data;
 
     // subtract data
-    for (index = count - 1; index >= 0; --index)
+    if (matrix_is_dense(a) && matrix_is_dense(b) && matrix_is_dense(c))
+    {
+        for (index = (matrix_soffset_t)((matrix_offset_t)cols * a->rows) - 1; index >= 0; --index)
+        {
+            C[index] = A[index] - B[index];
+        }
+        return;
+    }
+
+    for (row = a->rows - 1; row >= 0; --row)
     {
-        C[index] = A[index] - B[index];
+        const matrix_data_t *RESTRICT const ar = &A[row * a->stride];
+        const matrix_data_t *const br = &B[row * b->stride];
+        matrix_data_t *const cr = &C[row * c->stride];
+        for (index = cols - 1; index >= 0; --index)
+        {
+            cr[index] = ar[index] - br[index];
+        }
     }
 }
 
@@ -271,16 +669,30 @@ HOT EXTERN_INLINE_MATRIX void matrix_sub(const matrix_t *const a, matrix_t *cons
 */
 HOT EXTERN_INLINE_MATRIX void matrix_sub_inplace_b(const matrix_t *RESTRICT const a, const matrix_t *RESTRICT b)
 {
-    register const uint_fast16_t count = a->cols * a->rows;
-    register int_fast16_t index = 0;
+    matrix_soffset_t row, index;
+    const matrix_index_t cols = a->cols;
 
     matrix_data_t *RESTRICT const A = a->data;
     matrix_data_t *RESTRICT B = b->data;
 
     // subtract data
-    for (index = count - 1; index >= 0; --index)
+    if (matrix_is_dense(a) && matrix_is_dense(b))
     {
-        B[index] = A[index] - B[index];
+        for (index = (matrix_soffset_t)((matrix_offset_t)cols * a->rows) - 1; index >= 0; --index)
+        {
+            B[index] = A[index] - B[index];
+        }
+        return;
+    }
+
+    for (row = a->rows - 1; row >= 0; --row)
+    {
+        const matrix_data_t *RESTRICT const ar = &A[row * a->stride];
+        matrix_data_t *RESTRICT const br = &B[row * b->stride];
+        for (index = cols - 1; index >= 0; --index)
+        {
+            br[index] = ar[index] - br[index];
+        }
     }
 }
 
@@ -291,18 +703,73 @@ HOT EXTERN_INLINE_MATRIX void matrix_sub_inplace_b(const matrix_t *RESTRICT cons
 */
 HOT EXTERN_INLINE_MATRIX void matrix_add_inplace(const matrix_t * a, const matrix_t *const b)
 {
-    register const uint_fast16_t count = a->cols * a->rows;
-    register int_fast16_t index = 0;
+    matrix_soffset_t row, index;
+    const matrix_index_t cols = a->cols;
 
     matrix_data_t *RESTRICT A = a->data;
     matrix_data_t *RESTRICT const B = b->data;
 
-    // subtract data
-    for (index = count - 1; index >= 0; --index)
+    // add data
+    if (matrix_is_packed(a) && matrix_is_packed(b))
+    {
+        for (index = (matrix_soffset_t)MATRIX_PACKED_SIZE((matrix_offset_t)cols) - 1; index >= 0; --index)
+        {
+            A[index] += B[index];
+        }
+        return;
+    }
+
+    // mixed storage, e.g. a packed R added to a dense S
+    if (matrix_is_packed(a))
+    {
+        for (row = a->rows - 1; row >= 0; --row)
+        {
+            matrix_data_t *RESTRICT const ar = matrix_packed_row(a, (matrix_index_t)row);
+            const matrix_data_t *RESTRICT const br = &B[row * b->stride];
+            for (index = cols - 1; index >= row; --index)
+            {
+                ar[index] += br[index];
+            }
+        }
+        return;
+    }
+
+    if (matrix_is_packed(b))
+    {
+        for (row = a->rows - 1; row >= 0; --row)
+        {
+            matrix_data_t *RESTRICT const ar = &A[row * a->stride];
+            for (index = cols - 1; index >= 0; --index)
+            {
+                ar[index] += matrix_get_packed(b, (matrix_index_t)row, (matrix_index_t)index);
+            }
+        }
+        return;
+    }
+
+    if (matrix_is_dense(a) && matrix_is_dense(b))
     {
-        A[index] += B[index];
+        for (index = (matrix_soffset_t)((matrix_offset_t)cols * a->rows) - 1; index >= 0; --index)
+        {
+            A[index] += B[index];
+        }
+        return;
+    }
+
+    for (row = a->rows - 1; row >= 0; --row)
+    {
+        matrix_data_t *RESTRICT const ar = &A[row * a->stride];
+        const matrix_data_t *RESTRICT const br = &B[row * b->stride];
+        for (index = cols - 1; index >= 0; --index)
+        {
+            ar[index] += br[index];
+        }
     }
 }
 
+#ifdef __cplusplus
+}
+#endif
+
 #undef EXTERN_INLINE_MATRIX
 #endif
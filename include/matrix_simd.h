@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef MATRIX_SIMD_H_
+#define MATRIX_SIMD_H_
+
+#include <stdint.h>
+#include "compiler.h"
+#include "matrix.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+* \def KALMAN_SIMD Enables the SIMD kernels (SSE2, AVX2, AVX-512) and their runtime dispatch.
+*
+* When set to a nonzero value on a GCC-compatible x86 compiler, the multiplication kernels in matrix.c
+* forward to the fastest vectorized implementation supported by the executing CPU. On all other
+* targets the scalar kernels are used unconditionally.
+*/
+#ifndef KALMAN_SIMD
+#define KALMAN_SIMD 0
+#endif
+
+/*!
+* \def MATRIX_SIMD_X86 Evaluates to 1 if the x86 SIMD kernels are compiled in.
+*/
+#if KALMAN_SIMD && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MATRIX_SIMD_X86 1
+#else
+#define MATRIX_SIMD_X86 0
+#endif
+
+/*!
+* \brief SIMD instruction set levels
+*
+* The vectorized kernels reassociate the inner dot products, so their results are not bit-identical
+* to the scalar kernels. For an inner dimension of \c n, every element of the result differs from
+* the scalar result by at most <tt>n * FLT_EPSILON * sum(|a_ik * b_kj|)</tt>.
+*/
+typedef enum
+{
+    /*!
+    * \brief Portable scalar kernels
+    */
+    MATRIX_SIMD_SCALAR = 0,
+
+    /*!
+    * \brief 4-wide SSE2 kernels
+    */
+    MATRIX_SIMD_SSE2 = 1,
+
+    /*!
+    * \brief 8-wide AVX2 kernels using fused multiply-add
+    */
+    MATRIX_SIMD_AVX2 = 2,
+
+    /*!
+    * \brief 16-wide AVX-512F kernels using masked tail loads
+    */
+    MATRIX_SIMD_AVX512 = 3
+} matrix_simd_level_t;
+
+/*!
+* \brief Table of vectorized kernels the public matrix functions dispatch to.
+*
+* A \c NULL entry selects the scalar implementation in matrix.c. The tables are an implementation detail;
+* matrix.c copies the one of the detected level into its own private table once at program start.
+*/
+typedef struct
+{
+    void (*mult)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c, matrix_data_t *const baux);
+    void (*mult_transb)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c);
+    void (*multadd_transb)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c);
+    void (*multscale_transb)(const matrix_t *const a, const matrix_t *const b, const matrix_data_t scale, const matrix_t *RESTRICT c);
+    void (*mult_transb_symmetric)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c);
+    void (*multadd_transb_symmetric)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c);
+    void (*multscale_transb_symmetric)(const matrix_t *const a, const matrix_t *const b, const matrix_data_t scale, const matrix_t *RESTRICT c);
+    void (*mult_transb_packed)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c);
+    void (*multadd_transb_packed)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c);
+    void (*multscale_transb_packed)(const matrix_t *const a, const matrix_t *const b, const matrix_data_t scale, const matrix_t *RESTRICT c);
+    void (*mult_rowvector)(const matrix_t *RESTRICT const a, const matrix_t *RESTRICT const x, matrix_t *RESTRICT const c);
+    void (*multadd_rowvector)(const matrix_t *RESTRICT const a, const matrix_t *RESTRICT const x, matrix_t *RESTRICT const c);
+    void (*gemm_micro)(matrix_offset_t depth, const matrix_data_t *RESTRICT apanel, const matrix_data_t *RESTRICT bpanel, matrix_data_t *RESTRICT acc);
+} matrix_simd_kernels_t;
+
+/*!
+* \brief Determines the best SIMD level supported by both the build and the executing CPU.
+* \return The detected level; \ref MATRIX_SIMD_SCALAR if SIMD support was not compiled in.
+*/
+matrix_simd_level_t matrix_simd_detect(void) COLD;
+
+/*!
+* \brief Gets the kernels of the given SIMD level.
+* \param[in] level The level to look up.
+* \return The kernel table; all \c NULL for \ref MATRIX_SIMD_SCALAR, \c NULL if the level is not supported.
+*/
+const matrix_simd_kernels_t *matrix_simd_kernels_of(matrix_simd_level_t level) COLD;
+
+/*!
+* \brief Gets the SIMD level selected at program start.
+* \return The selected level.
+*/
+matrix_simd_level_t matrix_simd_get_level(void);
+
+/*!
+* \def KALMAN_SIMD_TESTING Exports \ref matrix_simd_select to switch the kernels at runtime.
+*
+* Switching is not synchronized with threads that multiply matrices at the same time, so the
+* library only provides it to the unit tests and benchmarks, which select a level while single-threaded.
+*/
+#ifndef KALMAN_SIMD_TESTING
+#define KALMAN_SIMD_TESTING 0
+#endif
+
+#if KALMAN_SIMD_TESTING
+
+/*!
+* \brief Selects the kernels of the given SIMD level.
+* \param[in] level The level to select.
+* \return Zero in case of success, nonzero if the level is not supported. In that case the selection is left unchanged.
+*
+* Must not be called while other threads use the matrix functions.
+*/
+int matrix_simd_select(matrix_simd_level_t level) COLD;
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
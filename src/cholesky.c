@@ -20,8 +20,9 @@
 */
 int cholesky_decompose_lower(register const matrix_t *const mat)
 {
-    uint_fast8_t i, j;
-    uint_fast8_t n = mat->rows;
+    matrix_index_t i, j;
+    matrix_index_t n = mat->rows;
+    const matrix_offset_t stride = mat->stride;
     matrix_data_t *t = mat->data;
 
     matrix_data_t el_ii;
@@ -35,15 +36,15 @@ int cholesky_decompose_lower(register const matrix_t *const mat)
     {
         for( j = i; j < n; ++j )
         {
-            matrix_data_t sum = t[i*n+j];
+            matrix_data_t sum = t[i*stride+j];
 
-            uint_fast16_t iEl = i*n;
-            uint_fast16_t jEl = j*n;
-            uint_fast16_t end = iEl+i;
+            matrix_offset_t iEl = i*stride;
+            matrix_offset_t jEl = j*stride;
+            matrix_offset_t end = iEl+i;
             // k = 0:i-1
             for( ; iEl<end; ++iEl,++jEl )
             {
-                // sum -= el[i*n+k]*el[j*n+k];
+                // sum -= el[i*stride+k]*el[j*stride+k];
                 sum -= t[iEl]* t[jEl];
             }
 
@@ -53,12 +54,12 @@ int cholesky_decompose_lower(register const matrix_t *const mat)
                 if( sum <= 0.0 ) return 1;
 
                 el_ii = (matrix_data_t)sqrt(sum);
-                t[i*n+i] = el_ii;
+                t[i*stride+i] = el_ii;
                 div_el_ii = (matrix_data_t)1.0/el_ii;
             }
             else
             {
-                t[j*n+i] = sum*div_el_ii;
+                t[j*stride+i] = sum*div_el_ii;
             }
         }
     }
@@ -68,9 +69,60 @@ int cholesky_decompose_lower(register const matrix_t *const mat)
     {
         for( j = i+1; j < n; ++j )
         {
-            t[i*n+j] = 0.0;
+            t[i*stride+j] = 0.0;
         }
     }
 
     return 0;
 }
+
+/**
+* \brief Solves {\ref x} * (L*L') = {\ref b'} for {\ref x} using forward and back substitution.
+* \param[in] lower The lower triangular Cholesky factor L ({\ref m} x {\ref m}) as calculated by {\ref cholesky_decompose_lower}.
+* \param[in] b Matrix B ({\ref m} x {\ref n})
+* \param[out] x Resulting matrix X = B' * (L*L')^-1 ({\ref n} x {\ref m}), will be overwritten
+*/
+void cholesky_solve_transb(const matrix_t *RESTRICT const lower, const matrix_t *RESTRICT const b, const matrix_t *RESTRICT x)
+{
+    matrix_soffset_t i, k;
+    matrix_offset_t r;
+    const matrix_index_t m = lower->rows;
+    const matrix_index_t n = b->cols;
+    const matrix_offset_t tstride = lower->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t xstride = x->stride;
+    const matrix_data_t *RESTRICT const t = lower->data;
+    const matrix_data_t *RESTRICT const bdata = b->data;
+
+    assert(lower->rows == lower->cols);
+    assert(b->rows == m);
+    assert(x->rows == n && x->cols == m);
+
+    // every row of X solves (L*L') * x_r' = b_r, where b_r is the r-th column of B
+    for (r = 0; r < n; ++r)
+    {
+        matrix_data_t *RESTRICT const xr = &x->data[r * xstride];
+
+        // forward substitution: L * z = b_r
+        for (i = 0; i < (matrix_soffset_t)m; ++i)
+        {
+            matrix_data_t sum = bdata[i * bstride + r];
+            for (k = 0; k < i; ++k)
+            {
+                sum -= t[i * tstride + k] * xr[k];
+            }
+            xr[i] = sum / t[i * tstride + i];
+        }
+
+        // back substitution: L' * x_r' = z
+        for (i = m - 1; i >= 0; --i)
+        {
+            matrix_data_t sum = xr[i];
+            for (k = i + 1; k < (matrix_soffset_t)m; ++k)
+            {
+                sum -= t[k * tstride + i] * xr[k];
+            }
+            xr[i] = sum / t[i * tstride + i];
+        }
+    }
+}
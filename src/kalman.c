@@ -12,6 +12,12 @@
 #define EXTERN_INLINE_MATRIX static INLINE
 #define EXTERN_INLINE_KALMAN static INLINE
 #include "kalman.h"
+#include "kalman_scratch.h"
+#include "kalman_multistep.h"
+
+#if KALMAN_THREADS
+#include "kalman_pool.h"
+#endif
 
 /*!
 * \brief Initializes the Kalman Filter
@@ -28,8 +34,10 @@
 * \param[in] predictedX The temporary vector for predicted X ({\ref num_states} x \c 1)
 * \param[in] temp_P The temporary matrix for P calculation ({\ref num_states} x {\ref num_states})
 * \param[in] temp_BQ The temporary matrix for BQ calculation ({\ref num_states} x {\ref num_inputs})
+*
+* If \c aux is \c NULL, the temporaries are taken from the scratch area of the calling thread.
 */
-void kalman_filter_initialize(kalman_t *kf, uint_fast8_t num_states, uint_fast8_t num_inputs, matrix_data_t *A, matrix_data_t *x,
+void kalman_filter_initialize(kalman_t *kf, matrix_index_t num_states, matrix_index_t num_inputs, matrix_data_t *A, matrix_data_t *x,
     matrix_data_t *B, matrix_data_t *u, matrix_data_t *P, matrix_data_t *Q,
     matrix_data_t *aux, matrix_data_t *predictedX, matrix_data_t *temp_P, matrix_data_t *temp_BQ)
 {
@@ -52,6 +60,23 @@ void kalman_filter_initialize(kalman_t *kf, uint_fast8_t num_states, uint_fast8_
 
     // set temporary BQ matrix
     matrix_init(&kf->temporary.BQ, num_states, num_inputs, temp_BQ);
+
+    // without an auxiliary buffer, all temporaries are bound per call
+    assert(aux != 0 || (predictedX == 0 && temp_P == 0 && temp_BQ == 0));
+    kf->flags = (aux == 0) ? KALMAN_FLAG_SCRATCH : 0;
+
+    // nothing is deferred or cached yet
+    kf->pending = 0;
+    kf->model_version = 0;
+    kf->tracked = 0;
+    matrix_init(&kf->cache.BQB, num_states, num_states, 0);
+    kf->cache.BQB_version = 0;
+    kf->cache.lambda = 1;
+    kf->cache.lambda_scale = 1;
+    kf->cache.multistep = 0;
+    kf->cache.continuous = 0;
+
+    kalman_reset_stats(kf);
 }
 
 
@@ -67,14 +92,13 @@ void kalman_filter_initialize(kalman_t *kf, uint_fast8_t num_states, uint_fast8_
 * \param[in] S The residual covariance ({\ref num_measurements} x {\ref num_measurements})
 * \param[in] K The Kalman gain ({\ref num_states} x {\ref num_measurements})
 * \param[in] aux The auxiliary buffer (length {\ref num_states} or {\ref num_measurements}, whichever is greater)
-* \param[in] S_inv The temporary matrix for the inverted residual covariance  ({\ref num_measurements} x {\ref num_measurements})
 * \param[in] temp_HP The temporary matrix for HxP ({\ref num_measurements} x {\ref num_states})
-* \param[in] temp_PHt The temporary matrix for PxH' ({\ref num_states} x {\ref num_measurements})
-* \param[in] temp_KHP The temporary matrix for KxHxP ({\ref num_states} x {\ref num_states})
+*
+* If \c aux is \c NULL, the temporaries are taken from the scratch area of the calling thread.
 */
-void kalman_measurement_initialize(kalman_measurement_t *kfm, uint_fast8_t num_states, uint_fast8_t num_measurements, matrix_data_t *H, matrix_data_t *z, matrix_data_t *R,
+void kalman_measurement_initialize(kalman_measurement_t *kfm, matrix_index_t num_states, matrix_index_t num_measurements, matrix_data_t *H, matrix_data_t *z, matrix_data_t *R,
     matrix_data_t *y, matrix_data_t *S, matrix_data_t *K,
-    matrix_data_t *aux, matrix_data_t *S_inv, matrix_data_t *temp_HP, matrix_data_t *temp_PHt, matrix_data_t *temp_KHP)
+    matrix_data_t *aux, matrix_data_t *temp_HP)
 {
     matrix_init(&kfm->H, num_measurements, num_states, H);
     matrix_init(&kfm->R, num_measurements, num_measurements, R);
@@ -84,20 +108,59 @@ void kalman_measurement_initialize(kalman_measurement_t *kfm, uint_fast8_t num_s
     matrix_init(&kfm->S, num_measurements, num_measurements, S);
     matrix_init(&kfm->y, num_measurements, 1, y);
 
+    // without an auxiliary buffer, all temporaries are bound per call
+    assert(aux != 0 || temp_HP == 0);
+    kfm->flags = (aux == 0) ? KALMAN_MEASUREMENT_FLAG_SCRATCH : 0;
+
     // set auxiliary vector
     kfm->temporary.aux = aux;
 
-    // set inverted S matrix
-    matrix_init(&kfm->temporary.S_inv, num_measurements, num_measurements, S_inv);
-
     // set temporary HxP matrix
     matrix_init(&kfm->temporary.HP, num_measurements, num_states, temp_HP);
 
-    // set temporary PxH' matrix
-    matrix_init(&kfm->temporary.PHt, num_states, num_measurements, temp_PHt);
+    // the gain is not tracked
+    kfm->steady.previous_K = 0;
+    kfm->steady.tolerance = 0;
+    kfm->steady.required = 0;
+    kfm->steady.count = 0;
+}
+
+/*!
+* \brief Points the temporaries of a filter into the scratch area of the calling thread
+* \param[in] kf The Kalman Filter structure flagged with {\ref KALMAN_FLAG_SCRATCH}
+*
+* The predicted x vector shares the auxiliary region, temporary P and temporary BQ share the matrix region.
+*/
+static void kalman_bind_scratch(kalman_t *kf)
+{
+    const kalman_scratch_t *const scratch = kalman_scratch_current();
+    const matrix_index_t n = kf->A.rows;
+    const matrix_index_t i = kf->B.cols;
+    const size_t aux = KALMAN_SCRATCH_AUX((n > i) ? n : i);
+
+    assert(scratch != 0 && scratch->size >= aux + (size_t)n * ((n > i) ? n : i));
+
+    kf->temporary.aux = scratch->buffer;
+    kf->temporary.predicted_x.data = scratch->buffer;
+    kf->temporary.P.data = scratch->buffer + aux;
+    kf->temporary.BQ.data = scratch->buffer + aux;
+}
+
+/*!
+* \brief Points the temporaries of a measurement into the scratch area of the calling thread
+* \param[in] kfm The Kalman Filter measurement structure flagged with {\ref KALMAN_MEASUREMENT_FLAG_SCRATCH}
+*/
+static void kalman_measurement_bind_scratch(kalman_measurement_t *kfm)
+{
+    const kalman_scratch_t *const scratch = kalman_scratch_current();
+    const matrix_index_t n = kfm->H.cols;
+    const matrix_index_t m = kfm->H.rows;
+    const size_t aux = KALMAN_SCRATCH_AUX((n > m) ? n : m);
+
+    assert(scratch != 0 && scratch->size >= aux + (size_t)m * n);
 
-    // set temporary KxHxP matrix
-    matrix_init(&kfm->temporary.KHP, num_states, num_states, temp_KHP);
+    kfm->temporary.aux = scratch->buffer;
+    kfm->temporary.HP.data = scratch->buffer + aux;
 }
 
 /*!
@@ -106,6 +169,11 @@ void kalman_measurement_initialize(kalman_measurement_t *kfm, uint_fast8_t num_s
 */
 void kalman_predict_x(register kalman_t *const kf)
 {
+    if (kf->flags & KALMAN_FLAG_SCRATCH)
+    {
+        kalman_bind_scratch(kf);
+    }
+
     // matrices and vectors
     const matrix_t *RESTRICT const A = &kf->A;
     matrix_t *RESTRICT const x = &kf->x;
@@ -118,9 +186,61 @@ void kalman_predict_x(register kalman_t *const kf)
     /* x = A*x                                                              */
     /************************************************************************/
 
+    KALMAN_PROFILE_BEGIN();
+
     // x = A*x
     matrix_mult_rowvector(A, x, xpredicted);
     matrix_copy(xpredicted, x);
+
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_PREDICT_X);
+}
+
+/*!
+* \brief Adds the input noise B*Q*B' to the state covariance, from the cache if there is one
+* \param[in] kf The Kalman Filter structure with bound temporaries
+*/
+static void kalman_add_input_noise(kalman_t *kf)
+{
+    const matrix_t *RESTRICT const B = &kf->B;
+    matrix_t *RESTRICT const P = &kf->P;
+    matrix_t *RESTRICT const BQ_temp = &kf->temporary.BQ;
+    matrix_t *RESTRICT const BQB = &kf->cache.BQB;
+
+    if (B->cols == 0)
+    {
+        return;
+    }
+
+    // P = P + B*Q*B'
+    if (BQB->data == 0)
+    {
+        matrix_mult(B, &kf->Q, BQ_temp, kf->temporary.aux); // temp = B*Q, Q may be packed
+        if (matrix_is_packed(P))
+        {
+            matrix_multadd_transb_packed(BQ_temp, B, P);    // P += temp*B'
+        }
+        else
+        {
+            matrix_multadd_transb_symmetric(BQ_temp, B, P); // P += temp*B'
+        }
+        return;
+    }
+
+    // the cache only changes with the model
+    if (kf->cache.BQB_version != kf->model_version)
+    {
+        matrix_mult(B, &kf->Q, BQ_temp, kf->temporary.aux); // temp = B*Q, Q may be packed
+        if (matrix_is_packed(BQB))
+        {
+            matrix_mult_transb_packed(BQ_temp, B, BQB);     // BQB = temp*B'
+        }
+        else
+        {
+            matrix_mult_transb_symmetric(BQ_temp, B, BQB);  // BQB = temp*B'
+        }
+        kf->cache.BQB_version = kf->model_version;
+    }
+    matrix_add_inplace(P, BQB);                             // P += BQB, both stored alike
 }
 
 /*!
@@ -129,30 +249,96 @@ void kalman_predict_x(register kalman_t *const kf)
 */
 void kalman_predict_Q(register kalman_t *const kf)
 {
+    // a converged covariance does not change until the steady state is left
+    if (kf->flags & KALMAN_FLAG_STEADY_STATE)
+    {
+        ++kf->pending;
+        return;
+    }
+
+    if (kf->flags & KALMAN_FLAG_SCRATCH)
+    {
+        kalman_bind_scratch(kf);
+    }
+
     // matrices and vectors
     const matrix_t *RESTRICT const A = &kf->A;
-    const matrix_t *RESTRICT const B = &kf->B;
     matrix_t *RESTRICT const P = &kf->P;
 
     // temporaries
     matrix_data_t *RESTRICT const aux = kf->temporary.aux;
     matrix_t *RESTRICT const P_temp = &kf->temporary.P;
-    matrix_t *RESTRICT const BQ_temp = &kf->temporary.BQ;
 
     /************************************************************************/
     /* Predict next covariance using system dynamics and input              */
     /* P = A*P*A' + B*Q*B'                                                  */
     /************************************************************************/
 
+    KALMAN_PROFILE_BEGIN();
+
     // P = A*P*A'
-    matrix_mult(A, P, P_temp, aux);                 // temp = A*P
-    matrix_mult_transb(P_temp, A, P);               // P = temp*A'
+#if KALMAN_THREADS
+    kalman_pool_t *const pool = kalman_pool_for(P->rows);
+    if (pool != 0 && !matrix_is_packed(P))
+    {
+        kalman_pool_predict_P(pool, A, P, P_temp, (matrix_data_t)1);
+    }
+    else
+#endif
+    {
+        matrix_mult(A, P, P_temp, aux);                     // temp = A*P, P may be packed
+        if (matrix_is_packed(P))
+        {
+            matrix_mult_transb_packed(P_temp, A, P);        // P = temp*A'
+        }
+        else
+        {
+            matrix_mult_transb_symmetric(P_temp, A, P);     // P = temp*A'
+        }
+    }
 
     // P = P + B*Q*B'
-    if (kf->B.rows > 0)
+    kalman_add_input_noise(kf);
+
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_PREDICT_Q);
+}
+
+/*!
+* \brief Runs the covariance propagations deferred by {\ref KALMAN_FLAG_LAZY}
+* \param[in] kf The Kalman Filter structure
+*/
+void kalman_flush_covariance(kalman_t *kf)
+{
+    // the skipped propagations only run once the steady state is left
+    if (kf->flags & KALMAN_FLAG_STEADY_STATE)
+    {
+        return;
+    }
+
+    const uint_fast32_t pending = kf->pending;
+    kf->pending = 0;
+
+    // P = A^k*P*A^k' + sum A^i*B*Q*B'*A^i'
+    kalman_predict_Q_n(kf, pending);
+}
+
+/*!
+* \brief Enables or disables the deferred covariance propagation of a filter
+* \param[in] kf The Kalman Filter structure
+* \param[in] lazy Nonzero to defer, zero to propagate in every prediction
+*/
+void kalman_set_lazy(kalman_t *kf, int lazy)
+{
+    if (lazy)
     {
-        matrix_mult(B, &kf->Q, BQ_temp, aux);       // temp = B*Q
-        matrix_multadd_transb(BQ_temp, B, P);       // P += temp*B'
+        kf->flags |= KALMAN_FLAG_LAZY;
+        return;
+    }
+
+    kf->flags &= (uint_fast8_t)~KALMAN_FLAG_LAZY;
+    if (kf->pending != 0)
+    {
+        kalman_flush_covariance(kf);
     }
 }
 
@@ -162,41 +348,87 @@ void kalman_predict_Q(register kalman_t *const kf)
 */
 void kalman_predict_Q_tuned(register kalman_t *const kf, matrix_data_t lambda)
 {
+    // a converged covariance does not change until the steady state is left; only plain propagations are skipped
+    if (lambda == 1 && (kf->flags & KALMAN_FLAG_STEADY_STATE))
+    {
+        ++kf->pending;
+        return;
+    }
+
+    // fading keeps P from converging, so it leaves the steady state and restarts the tracking of the gain
+    if (lambda != 1 && kf->tracked != 0)
+    {
+        kf->flags &= (uint_fast8_t)~KALMAN_FLAG_STEADY_STATE;
+        kalman_measurement_changed(kf->tracked);
+    }
+
+    // the fading factor applies after the deferred propagations
+    if (kf->pending != 0)
+    {
+        kalman_flush_covariance(kf);
+    }
+
+    if (kf->flags & KALMAN_FLAG_SCRATCH)
+    {
+        kalman_bind_scratch(kf);
+    }
+
     // matrices and vectors
     const matrix_t *RESTRICT const A = &kf->A;
-    const matrix_t *RESTRICT const B = &kf->B;
     matrix_t *RESTRICT const P = &kf->P;
 
     // temporaries
     matrix_data_t *RESTRICT const aux = kf->temporary.aux;
     matrix_t *RESTRICT const P_temp = &kf->temporary.P;
-    matrix_t *RESTRICT const BQ_temp = &kf->temporary.BQ;
 
     /************************************************************************/
     /* Predict next covariance using system dynamics and input              */
     /* P = A*P*A' * 1/lambda^2 + B*Q*B'                                     */
     /************************************************************************/
 
-    // lambda = 1/lambda^2
-    lambda = (matrix_data_t)1.0 / (lambda * lambda); // TODO: This should be precalculated, e.g. using kalman_set_lambda(...);
+    KALMAN_PROFILE_BEGIN();
 
-    // P = A*P*A'
-    matrix_mult(A, P, P_temp, aux);                 // temp = A*P
-    matrix_multscale_transb(P_temp, A, lambda, P);   // P = temp*A' * 1/(lambda^2)
+    // lambda = 1/lambda^2, precalculated by kalman_set_lambda
+    if (lambda != kf->cache.lambda)
+    {
+        kalman_set_lambda(kf, lambda);
+    }
+    lambda = kf->cache.lambda_scale;
 
-    // P = P + B*Q*B'
-    if (kf->B.rows > 0)
+    // P = A*P*A'
+#if KALMAN_THREADS
+    kalman_pool_t *const pool = kalman_pool_for(P->rows);
+    if (pool != 0 && !matrix_is_packed(P))
+    {
+        kalman_pool_predict_P(pool, A, P, P_temp, lambda);      // P = temp*A' * 1/(lambda^2)
+    }
+    else
+#endif
     {
-        matrix_mult(B, &kf->Q, BQ_temp, aux);       // temp = B*Q
-        matrix_multadd_transb(BQ_temp, B, P);        // P += temp*B'
+        matrix_mult(A, P, P_temp, aux);                         // temp = A*P, P may be packed
+        if (matrix_is_packed(P))
+        {
+            matrix_multscale_transb_packed(P_temp, A, lambda, P); // P = temp*A' * 1/(lambda^2)
+        }
+        else
+        {
+            matrix_multscale_transb_symmetric(P_temp, A, lambda, P); // P = temp*A' * 1/(lambda^2)
+        }
     }
+
+    // P = P + B*Q*B'
+    kalman_add_input_noise(kf);
+
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_PREDICT_Q);
 }
 
 /*!
-* \brief Performs the measurement update step.
+* \brief Calculates the residual covariance, the Kalman gain and the corrected state covariance
 * \param[in] kf The Kalman Filter structure to correct.
+* \param[in] kfm The Kalman Filter measurement structure to correct with; its temporaries must be bound.
+* \param[in] update_state Nonzero to also correct the state with the innovation y
 */
-void kalman_correct(kalman_t *kf, kalman_measurement_t *kfm)
+static void kalman_correct_covariance(kalman_t *kf, kalman_measurement_t *kfm, int update_state)
 {
     matrix_t *RESTRICT const P = &kf->P;
     const matrix_t *RESTRICT const H = &kfm->H;
@@ -206,38 +438,45 @@ void kalman_correct(kalman_t *kf, kalman_measurement_t *kfm)
     matrix_t *RESTRICT const x = &kf->x;
 
     // temporaries
-    matrix_data_t *RESTRICT const aux = kfm->temporary.aux;
-    matrix_t *RESTRICT const Sinv = &kfm->temporary.S_inv;
     matrix_t *RESTRICT const temp_HP = &kfm->temporary.HP;
-    matrix_t *RESTRICT const temp_KHP = &kfm->temporary.KHP;
-    matrix_t *RESTRICT const temp_PHt = &kfm->temporary.PHt;
 
-    /************************************************************************/
-    /* Calculate innovation and residual covariance                         */
-    /* y = z - H*x                                                          */
-    /* S = H*P*H' + R                                                       */
-    /************************************************************************/
-
-    // y = z - H*x
-    matrix_mult_rowvector(H, x, y);
-    matrix_sub_inplace_b(&kfm->z, y);
+    KALMAN_PROFILE_BEGIN();
 
     // S = H*P*H' + R
-    matrix_mult(H, P, temp_HP, aux);            // temp = H*P
-    matrix_mult_transb(temp_HP, H, S);          // S = temp*H'
-    matrix_add_inplace(S, &kfm->R);             // S += R
+#if KALMAN_THREADS
+    kalman_pool_t *const pool = matrix_is_packed(P) ? 0 : kalman_pool_for(P->rows);
+#endif
+    if (matrix_is_packed(P))
+    {
+        matrix_mult(H, P, temp_HP, kfm->temporary.aux); // temp = H*P, gathering the columns of packed P
+    }
+#if KALMAN_THREADS
+    else if (pool != 0)
+    {
+        kalman_pool_mult_HP(pool, H, P, temp_HP);   // temp = H*P' = H*P, by blocks of columns
+    }
+#endif
+    else
+    {
+        matrix_mult_transb(H, P, temp_HP);      // temp = H*P' = H*P, without column copies
+    }
+    matrix_mult_transb_symmetric(temp_HP, H, S); // S = temp*H'
+    matrix_add_inplace(S, &kfm->R);             // S += R, R may be packed
+
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_RESIDUAL_COVARIANCE);
 
     /************************************************************************/
     /* Calculate Kalman gain                                                */
     /* K = P*H' * S^-1                                                      */
+    /*   = (H*P)' * (L*L')^-1                                               */
     /************************************************************************/
 
     // K = P*H' * S^-1
-    cholesky_decompose_lower(S);
-    matrix_invert_lower(S, Sinv);               // Sinv = S^-1
-    // NOTE that to allow aliasing of Sinv and temp_PHt, a copy must be performed here
-    matrix_mult_transb(P, H, temp_PHt);         // temp = P*H'
-    matrix_mult(temp_PHt, Sinv, K, aux);        // K = temp*Sinv
+    cholesky_decompose_lower(S);                // S = L*L'
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_CHOLESKY);
+
+    cholesky_solve_transb(S, temp_HP, K);       // K = temp_HP' * (L*L')^-1, using P = P'
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_GAIN);
 
     /************************************************************************/
     /* Correct state prediction                                             */
@@ -245,7 +484,11 @@ void kalman_correct(kalman_t *kf, kalman_measurement_t *kfm)
     /************************************************************************/
 
     // x = x + K*y
-    matrix_multadd_rowvector(K, y, x);
+    if (update_state)
+    {
+        matrix_multadd_rowvector(K, y, x);
+        KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_STATE_UPDATE);
+    }
 
     /************************************************************************/
     /* Correct state covariances                                            */
@@ -254,7 +497,529 @@ void kalman_correct(kalman_t *kf, kalman_measurement_t *kfm)
     /************************************************************************/
 
     // P = P - K*(H*P)
-    matrix_mult(H, P, temp_HP, aux);            // temp_HP = H*P
-    matrix_mult(K, temp_HP, temp_KHP, aux);     // temp_KHP = K*temp_HP
-    matrix_sub(P, temp_KHP, P);                 // P -= temp_KHP
+    if (matrix_is_packed(P))
+    {
+        matrix_multsub_packed(K, temp_HP, P);   // P -= K*temp_HP
+    }
+#if KALMAN_THREADS
+    else if (pool != 0)
+    {
+        kalman_pool_update_P(pool, K, temp_HP, P); // P -= K*temp_HP, by blocks of rows
+    }
+#endif
+    else
+    {
+        matrix_multsub_symmetric(K, temp_HP, P); // P -= K*temp_HP
+    }
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_COVARIANCE_UPDATE);
+}
+
+/*!
+* \brief Compares the gain of a tracked measurement to the previous one and keeps it for the next comparison
+* \param[in] kfm The Kalman Filter measurement structure with {\ref previous_K} set
+* \return Nonzero once the gain has converged for the required number of consecutive corrections.
+*/
+static int kalman_measurement_gain_converged(kalman_measurement_t *kfm)
+{
+    const matrix_t *const K = &kfm->K;
+    matrix_data_t *const previous = kfm->steady.previous_K;
+    matrix_data_t largest = 0, change = 0;
+    matrix_offset_t index = 0;
+
+    for (matrix_index_t row = 0; row < K->rows; ++row)
+    {
+        const matrix_data_t *const k = &K->data[row * K->stride];
+        for (matrix_index_t col = 0; col < K->cols; ++col, ++index)
+        {
+            const matrix_data_t value = k[col];
+            const matrix_data_t magnitude = (value < 0) ? -value : value;
+            const matrix_data_t delta = (value > previous[index]) ? value - previous[index] : previous[index] - value;
+
+            if (magnitude > largest) largest = magnitude;
+            if (delta > change) change = delta;
+            previous[index] = value;
+        }
+    }
+
+    if (change <= kfm->steady.tolerance * largest)
+    {
+        if (kfm->steady.count < kfm->steady.required) ++kfm->steady.count;
+    }
+    else
+    {
+        kfm->steady.count = 0;
+    }
+    return kfm->steady.count >= kfm->steady.required;
+}
+
+/*!
+* \brief Binds the steady state of a filter to a tracked measurement
+* \param[in] kf The Kalman Filter structure
+* \param[in] kfm The Kalman Filter measurement structure with {\ref previous_K} set
+*/
+static void kalman_bind_tracked(kalman_t *kf, kalman_measurement_t *kfm)
+{
+    // a single converged gain; several tracked measurements would only take turns leaving the steady state
+    assert(kf->tracked == 0 || kf->tracked == kfm);
+    assert(!(kfm->flags & KALMAN_MEASUREMENT_FLAG_DIAGONAL_R));
+    kf->tracked = kfm;
+}
+
+/*!
+* \brief Performs the measurement update step with the converged gain
+* \param[in] kf The Kalman Filter structure to correct.
+* \param[in] kfm The Kalman Filter measurement structure to correct with.
+*/
+static void kalman_correct_steady(kalman_t *kf, kalman_measurement_t *kfm)
+{
+    matrix_t *RESTRICT const y = &kfm->y;
+    matrix_t *RESTRICT const x = &kf->x;
+
+    KALMAN_PROFILE_BEGIN();
+
+    // y = z - H*x
+    matrix_mult_rowvector(&kfm->H, x, y);
+    matrix_sub_inplace_b(&kfm->z, y);
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_INNOVATION);
+
+    // x = x + K*y
+    matrix_multadd_rowvector(&kfm->K, y, x);
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_STATE_UPDATE);
+}
+
+/*!
+* \brief Performs the measurement update step.
+* \param[in] kf The Kalman Filter structure to correct.
+* \param[in] kfm The Kalman Filter measurement structure to correct with.
+*/
+void kalman_correct(kalman_t *kf, kalman_measurement_t *kfm)
+{
+    if (kf->pending != 0)
+    {
+        kalman_flush_covariance(kf);
+    }
+
+    // the converged gain only holds as long as the filter is in the steady state with this measurement
+    if (kfm->flags & KALMAN_MEASUREMENT_FLAG_STEADY_STATE)
+    {
+        if (kf->flags & KALMAN_FLAG_STEADY_STATE)
+        {
+            // the converged correction returns P to its fixed point
+            kalman_correct_steady(kf, kfm);
+            kf->pending = 0;
+            return;
+        }
+        kfm->flags &= (uint_fast8_t)~KALMAN_MEASUREMENT_FLAG_STEADY_STATE;
+        kfm->steady.count = 0;
+    }
+
+    // the propagations skipped since the last steady-state correction
+    kf->flags &= (uint_fast8_t)~KALMAN_FLAG_STEADY_STATE;
+    if (kf->pending != 0)
+    {
+        kalman_flush_covariance(kf);
+    }
+
+    if (kfm->flags & KALMAN_MEASUREMENT_FLAG_SCRATCH)
+    {
+        kalman_measurement_bind_scratch(kfm);
+    }
+
+    // independent measurements can be processed one by one
+    if (kfm->flags & KALMAN_MEASUREMENT_FLAG_DIAGONAL_R)
+    {
+        kalman_correct_sequential(kf, kfm);
+        return;
+    }
+
+    /************************************************************************/
+    /* Calculate innovation and residual covariance                         */
+    /* y = z - H*x                                                          */
+    /* S = H*P*H' + R                                                       */
+    /************************************************************************/
+
+    KALMAN_PROFILE_BEGIN();
+
+    // y = z - H*x
+    matrix_mult_rowvector(&kfm->H, &kf->x, &kfm->y);
+    matrix_sub_inplace_b(&kfm->z, &kfm->y);
+
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_INNOVATION);
+
+    kalman_correct_covariance(kf, kfm, 1);
+
+    // switch to the constant gain once it stopped changing
+    if (kfm->steady.previous_K != 0)
+    {
+        kalman_bind_tracked(kf, kfm);
+        if (kalman_measurement_gain_converged(kfm))
+        {
+            kf->flags |= KALMAN_FLAG_STEADY_STATE;
+            kfm->flags |= KALMAN_MEASUREMENT_FLAG_STEADY_STATE;
+        }
+    }
+}
+
+/*!
+* \brief Performs the measurement update step one measured output at a time.
+* \param[in] kf The Kalman Filter structure to correct.
+* \param[in] kfm The Kalman Filter measurement structure to correct with; its R matrix must be diagonal.
+*/
+void kalman_correct_sequential(kalman_t *kf, kalman_measurement_t *kfm)
+{
+    // the sequential update has no joint gain to track
+    assert(kfm->steady.previous_K == 0);
+
+    kf->flags &= (uint_fast8_t)~KALMAN_FLAG_STEADY_STATE;
+    kfm->flags &= (uint_fast8_t)~KALMAN_MEASUREMENT_FLAG_STEADY_STATE;
+
+    if (kf->pending != 0)
+    {
+        kalman_flush_covariance(kf);
+    }
+
+    if (kfm->flags & KALMAN_MEASUREMENT_FLAG_SCRATCH)
+    {
+        kalman_measurement_bind_scratch(kfm);
+    }
+
+    matrix_offset_t i, a, b;
+    const matrix_index_t n = kf->P.rows;
+    const matrix_index_t m = kfm->H.rows;
+    const matrix_offset_t ps = kf->P.stride;
+    const matrix_offset_t hs = kfm->H.stride;
+    const matrix_offset_t ss = kfm->S.stride;
+    const matrix_offset_t ks = kfm->K.stride;
+    const int packed = matrix_is_packed(&kf->P);
+
+    matrix_data_t *RESTRICT const P = kf->P.data;
+    matrix_data_t *RESTRICT const x = kf->x.data;
+    const matrix_data_t *RESTRICT const H = kfm->H.data;
+    const matrix_data_t *RESTRICT const z = kfm->z.data;
+    matrix_data_t *RESTRICT const y = kfm->y.data;
+    matrix_data_t *RESTRICT const S = kfm->S.data;
+    matrix_data_t *RESTRICT const K = kfm->K.data;
+
+    // temporaries
+    matrix_data_t *RESTRICT const PHt = kfm->temporary.aux;
+
+    // the vectors are indexed directly
+    assert(matrix_is_dense(&kf->x) && matrix_is_dense(&kfm->z) && matrix_is_dense(&kfm->y));
+
+    KALMAN_PROFILE_BEGIN();
+
+    for (a = 0; a < m; ++a)
+    {
+        for (b = 0; b < m; ++b)
+        {
+            S[a * ss + b] = 0;
+        }
+    }
+
+    for (i = 0; i < m; ++i)
+    {
+        const matrix_data_t *RESTRICT const h = &H[i * hs];
+
+        /************************************************************************/
+        /* Calculate scalar innovation and residual variance                    */
+        /* y_i = z_i - h*x                                                      */
+        /* s = h*P*h' + R_ii                                                    */
+        /************************************************************************/
+
+        matrix_data_t innovation = z[i];
+        for (a = 0; a < n; ++a)
+        {
+            innovation -= h[a] * x[a];
+        }
+        y[i] = innovation;
+        KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_INNOVATION);
+
+        // PHt = P*h', s = h*PHt + R_ii
+        matrix_data_t s = matrix_get(&kfm->R, i, i);
+        if (packed)
+        {
+            // every stored element P(a,b), b > a, also stands in for P(b,a)
+            for (a = 0; a < n; ++a)
+            {
+                PHt[a] = 0;
+            }
+            for (a = 0; a < n; ++a)
+            {
+                const matrix_data_t *RESTRICT const row = matrix_packed_row(&kf->P, a);
+                matrix_data_t total = row[a] * h[a];
+                for (b = a + 1; b < n; ++b)
+                {
+                    total += row[b] * h[b];
+                    PHt[b] += row[b] * h[a];
+                }
+                PHt[a] += total;
+            }
+            for (a = 0; a < n; ++a)
+            {
+                s += h[a] * PHt[a];
+            }
+        }
+        else
+        {
+            for (a = 0; a < n; ++a)
+            {
+                const matrix_data_t *RESTRICT const row = &P[a * ps];
+                matrix_data_t total = 0;
+                for (b = 0; b < n; ++b)
+                {
+                    total += row[b] * h[b];
+                }
+                PHt[a] = total;
+                s += h[a] * total;
+            }
+        }
+        S[i * ss + i] = s;
+        KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_RESIDUAL_COVARIANCE);
+
+        // skip outputs that carry no information
+        if (s <= 0)
+        {
+            for (a = 0; a < n; ++a)
+            {
+                K[a * ks + i] = 0;
+            }
+            continue;
+        }
+
+        /************************************************************************/
+        /* Calculate gain and correct state prediction                          */
+        /* k = P*h' / s                                                         */
+        /* x = x + k*y_i                                                        */
+        /************************************************************************/
+
+        const matrix_data_t inv_s = (matrix_data_t)1.0 / s;
+        for (a = 0; a < n; ++a)
+        {
+            const matrix_data_t k = PHt[a] * inv_s;
+            K[a * ks + i] = k;
+            x[a] += k * innovation;
+        }
+
+        // gain and state update are fused
+        KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_STATE_UPDATE);
+
+        /************************************************************************/
+        /* Correct state covariances using a symmetric rank-1 update           */
+        /* P = P - k*(h*P) = P - PHt*PHt' / s                                   */
+        /************************************************************************/
+
+        for (a = 0; a < n; ++a)
+        {
+            const matrix_data_t k = PHt[a] * inv_s;
+            matrix_data_t *const row = packed ? matrix_packed_row(&kf->P, a) : &P[a * ps];
+            for (b = a; b < n; ++b)
+            {
+                row[b] -= k * PHt[b];
+            }
+
+            // a packed P has no lower triangle
+            if (packed) continue;
+            for (b = a + 1; b < n; ++b)
+            {
+                P[b * ps + a] = row[b];
+            }
+        }
+        KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_COVARIANCE_UPDATE);
+    }
+}
+
+/*!
+* \brief Keeps the input noise B*Q*B' of a filter in a buffer until the model changes
+* \param[in] kf The Kalman Filter structure
+* \param[in] buffer The buffer, stored like P; \c NULL stops caching.
+*/
+void kalman_cache_input_noise(kalman_t *kf, matrix_data_t *buffer)
+{
+    const matrix_index_t n = kf->P.rows;
+    if (matrix_is_packed(&kf->P))
+    {
+        matrix_init_packed(&kf->cache.BQB, n, buffer);
+    }
+    else
+    {
+        matrix_init(&kf->cache.BQB, n, n, buffer);
+    }
+
+    // calculated on the next prediction
+    kf->cache.BQB_version = kf->model_version - 1;
+}
+
+/*!
+* \brief Sets the fading factor used by {\ref kalman_predict_tuned} and {\ref kalman_predict_Q_tuned}
+* \param[in] kf The Kalman Filter structure
+* \param[in] lambda Lambda factor (\c 0 < {\ref lambda} <= \c 1)
+*/
+void kalman_set_lambda(kalman_t *kf, matrix_data_t lambda)
+{
+    assert(lambda > 0);
+
+    kf->cache.lambda = lambda;
+    kf->cache.lambda_scale = (matrix_data_t)1.0 / (lambda * lambda);
+}
+
+/*!
+* \brief Tracks the convergence of the Kalman gain of a measurement
+* \param[in] kfm The Kalman Filter measurement structure.
+* \param[in] previous_K Buffer for the previous gain ({\ref num_states} x {\ref num_measurements}); \c NULL stops tracking.
+* \param[in] tolerance Largest change of any gain between two corrections, relative to the largest gain, that counts as converged
+* \param[in] required Number of consecutive converged corrections after which the filter enters the steady state
+*/
+void kalman_measurement_track_steady_state(kalman_measurement_t *kfm, matrix_data_t *previous_K, matrix_data_t tolerance, uint_fast16_t required)
+{
+    kfm->steady.previous_K = previous_K;
+    kfm->steady.tolerance = tolerance;
+    kfm->steady.required = (required > 0) ? required : 1;
+    kfm->steady.count = 0;
+    kfm->flags &= (uint_fast8_t)~KALMAN_MEASUREMENT_FLAG_STEADY_STATE;
+
+    if (previous_K != 0)
+    {
+        const matrix_offset_t count = (matrix_offset_t)kfm->K.rows * kfm->K.cols;
+        for (matrix_offset_t i = 0; i < count; ++i)
+        {
+            previous_K[i] = 0;
+        }
+    }
+}
+
+/*!
+* \brief Solves the discrete algebraic Riccati equation of a filter and a measurement and enters the steady state
+* \param[in] kf The Kalman Filter structure; P holds the initial covariance.
+* \param[in] kfm The Kalman Filter measurement structure; it must be tracked.
+* \param[in] max_iterations The largest number of Riccati iterations
+* \return Zero if the gain converged, nonzero otherwise.
+*/
+int kalman_solve_steady_state(kalman_t *kf, kalman_measurement_t *kfm, uint_fast16_t max_iterations)
+{
+    assert(kfm->steady.previous_K != 0);
+    kalman_bind_tracked(kf, kfm);
+
+    kf->flags &= (uint_fast8_t)~KALMAN_FLAG_STEADY_STATE;
+    kfm->flags &= (uint_fast8_t)~KALMAN_MEASUREMENT_FLAG_STEADY_STATE;
+    kfm->steady.count = 0;
+    if (kf->pending != 0)
+    {
+        kalman_flush_covariance(kf);
+    }
+
+    for (uint_fast16_t iteration = 0; iteration < max_iterations; ++iteration)
+    {
+        // P = A*P*A' + B*Q*B'
+        kalman_predict_Q(kf);
+
+        // P = P - K*(H*P), always with the joint gain that the steady-state correction applies
+        if (kfm->flags & KALMAN_MEASUREMENT_FLAG_SCRATCH)
+        {
+            kalman_measurement_bind_scratch(kfm);
+        }
+        kalman_correct_covariance(kf, kfm, 0);
+
+        if (kalman_measurement_gain_converged(kfm))
+        {
+            kf->flags |= KALMAN_FLAG_STEADY_STATE;
+            kfm->flags |= KALMAN_MEASUREMENT_FLAG_STEADY_STATE;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/*!
+* \brief Leaves the steady state, e.g. after the model changed
+* \param[in] kf The Kalman Filter structure
+*/
+void kalman_leave_steady_state(kalman_t *kf)
+{
+    kf->flags &= (uint_fast8_t)~KALMAN_FLAG_STEADY_STATE;
+    if (kf->pending != 0)
+    {
+        kalman_flush_covariance(kf);
+    }
+}
+
+/*!
+* \brief Checks whether the process noise matrix R is diagonal and updates {\ref KALMAN_MEASUREMENT_FLAG_DIAGONAL_R} accordingly.
+* \param[in] kfm The Kalman Filter measurement structure.
+* \return Nonzero if R is diagonal, zero otherwise.
+*/
+int kalman_measurement_detect_diagonal_R(kalman_measurement_t *kfm)
+{
+    matrix_index_t i, j;
+    const matrix_index_t m = kfm->R.rows;
+
+    for (i = 0; i < m; ++i)
+    {
+        for (j = 0; j < m; ++j)
+        {
+            if (i != j && matrix_get(&kfm->R, i, j) != 0)
+            {
+                kfm->flags &= (uint_fast8_t)~KALMAN_MEASUREMENT_FLAG_DIAGONAL_R;
+                return 0;
+            }
+        }
+    }
+
+    kfm->flags |= KALMAN_MEASUREMENT_FLAG_DIAGONAL_R;
+    return 1;
+}
+
+/*!
+* \brief Gets the accumulated per-stage timings of a filter.
+* \param[in] kf The Kalman Filter structure
+* \param[out] stats Receives the timings; all zero unless compiled with {\ref KALMAN_PROFILE}.
+*/
+void kalman_get_stats(const kalman_t *kf, kalman_stats_t *stats)
+{
+#if KALMAN_PROFILE
+    *stats = kf->stats;
+#else
+    static const kalman_stats_t zero = { { 0 }, { 0 } };
+    (void)kf;
+    *stats = zero;
+#endif
+}
+
+/*!
+* \brief Resets the accumulated per-stage timings of a filter.
+* \param[in] kf The Kalman Filter structure
+*/
+void kalman_reset_stats(kalman_t *kf)
+{
+#if KALMAN_PROFILE
+    uint_fast8_t stage;
+    for (stage = 0; stage < KALMAN_STAGE_COUNT; ++stage)
+    {
+        kf->stats.ticks[stage] = 0;
+        kf->stats.calls[stage] = 0;
+    }
+#else
+    (void)kf;
+#endif
+}
+
+/*!
+* \brief Gets the name of a stage, e.g. for reports
+* \param[in] stage The stage
+* \return The name, or \c "unknown".
+*/
+const char* kalman_profile_stage_name(kalman_stage_t stage)
+{
+    static const char *const names[KALMAN_STAGE_COUNT] = {
+        "predict_x",
+        "predict_Q",
+        "innovation",
+        "residual_covariance",
+        "cholesky",
+        "gain",
+        "state_update",
+        "covariance_update"
+    };
+
+    return ((unsigned)stage < KALMAN_STAGE_COUNT) ? names[stage] : "unknown";
 }
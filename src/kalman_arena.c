@@ -0,0 +1,362 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#define EXTERN_INLINE_MATRIX static INLINE
+#define EXTERN_INLINE_KALMAN static INLINE
+#include "kalman_arena.h"
+
+/*!
+* \brief Rounds a size up to a multiple of {\ref KALMAN_ARENA_ALIGNMENT}
+*/
+#define KALMAN_ARENA_ROUND(size)    (((size) + KALMAN_ARENA_ALIGNMENT - 1) & ~(size_t)(KALMAN_ARENA_ALIGNMENT - 1))
+
+/*!
+* \brief Gets the size in bytes of a cache line aligned matrix buffer
+*/
+#define KALMAN_ARENA_MATRIX(rows, cols)  KALMAN_ARENA_ROUND(sizeof(matrix_data_t) * (size_t)(rows) * (size_t)(cols))
+
+/*!
+* \brief Determines the size class of a block
+* \param[in] size The requested size in bytes
+* \return The size class, or {\ref KALMAN_ARENA_NUM_CLASSES} if the block is too large.
+*/
+static uint_fast8_t kalman_arena_class(size_t size)
+{
+    uint_fast8_t size_class = 0;
+    size_t capacity = KALMAN_ARENA_ALIGNMENT;
+
+    while (capacity < size && size_class < KALMAN_ARENA_NUM_CLASSES)
+    {
+        capacity <<= 1;
+        ++size_class;
+    }
+
+    return size_class;
+}
+
+/*!
+* \brief Initializes an arena over a buffer
+* \param[in] arena The arena to initialize
+* \param[in] buffer The backing buffer; it need not be aligned.
+* \param[in] size The size of the buffer in bytes
+*/
+void kalman_arena_init(kalman_arena_t *arena, void *buffer, size_t size)
+{
+    uint_fast8_t i;
+    const uintptr_t address = (uintptr_t)buffer;
+    const uintptr_t aligned = (address + KALMAN_ARENA_ALIGNMENT - 1) & ~(uintptr_t)(KALMAN_ARENA_ALIGNMENT - 1);
+    const size_t padding = (size_t)(aligned - address);
+
+    arena->base = (uint8_t*)aligned;
+    arena->size = (size > padding) ? size - padding : 0;
+    arena->used = 0;
+
+    for (i = 0; i < KALMAN_ARENA_NUM_CLASSES; ++i)
+    {
+        arena->free_list[i] = NULL;
+    }
+}
+
+/*!
+* \brief Allocates a block from an arena
+* \param[in] arena The arena
+* \param[in] size The requested size in bytes
+* \return The block, aligned to {\ref KALMAN_ARENA_ALIGNMENT}, or \c NULL if the arena is exhausted.
+*/
+void* kalman_arena_alloc(kalman_arena_t *arena, size_t size)
+{
+    const uint_fast8_t size_class = kalman_arena_class(size);
+    if (size_class >= KALMAN_ARENA_NUM_CLASSES) return NULL;
+
+    // reuse a released block of the same class
+    void *block = arena->free_list[size_class];
+    if (block != NULL)
+    {
+        arena->free_list[size_class] = *(void**)block;
+        return block;
+    }
+
+    // carve a new block
+    const size_t capacity = (size_t)KALMAN_ARENA_ALIGNMENT << size_class;
+    if (capacity > arena->size - arena->used) return NULL;
+
+    block = arena->base + arena->used;
+    arena->used += capacity;
+    return block;
+}
+
+/*!
+* \brief Releases a block to its free list
+* \param[in] arena The arena the block was allocated from
+* \param[in] block The block; may be \c NULL.
+* \param[in] size The size the block was requested with
+*/
+void kalman_arena_free(kalman_arena_t *arena, void *block, size_t size)
+{
+    if (block == NULL) return;
+
+    const uint_fast8_t size_class = kalman_arena_class(size);
+    assert(size_class < KALMAN_ARENA_NUM_CLASSES);
+    assert((uint8_t*)block >= arena->base && (uint8_t*)block < arena->base + arena->used);
+
+    *(void**)block = arena->free_list[size_class];
+    arena->free_list[size_class] = block;
+}
+
+/*!
+* \brief Gets the number of bytes of the block of a filter
+* \param[in] num_states The number of states
+* \param[in] num_inputs The number of inputs
+* \param[in] shared Nonzero if the temporaries are taken from the scratch area
+* \return The size of the block holding the structure and all matrices.
+*/
+static size_t kalman_block_size(matrix_index_t num_states, matrix_index_t num_inputs, int shared)
+{
+    const size_t n = num_states;
+    const size_t i = num_inputs;
+
+    const size_t persistent = KALMAN_ARENA_ROUND(sizeof(kalman_t))
+         + KALMAN_ARENA_MATRIX(n, n)                            // A
+         + KALMAN_ARENA_MATRIX(n, 1)                            // x
+         + KALMAN_ARENA_MATRIX(n, i)                            // B
+         + KALMAN_ARENA_MATRIX(i, 1)                            // u
+         + KALMAN_ARENA_MATRIX(n, n)                            // P
+         + KALMAN_ARENA_MATRIX(i, i);                           // Q
+
+    if (shared) return persistent;
+    return persistent
+         + KALMAN_ARENA_MATRIX((n > i) ? n : i, 1)              // aux, predicted x
+         + KALMAN_ARENA_MATRIX(n, (n > i) ? n : i);             // temporary P, BQ
+}
+
+/*!
+* \brief Gets the number of bytes of the block of a measurement
+* \param[in] num_states The number of states
+* \param[in] num_measurements The number of measured outputs
+* \param[in] shared Nonzero if the temporaries are taken from the scratch area
+* \return The size of the block holding the structure and all matrices.
+*/
+static size_t kalman_measurement_block_size(matrix_index_t num_states, matrix_index_t num_measurements, int shared)
+{
+    const size_t n = num_states;
+    const size_t m = num_measurements;
+
+    const size_t persistent = KALMAN_ARENA_ROUND(sizeof(kalman_measurement_t))
+         + KALMAN_ARENA_MATRIX(m, n)                            // H
+         + KALMAN_ARENA_MATRIX(m, 1)                            // z
+         + KALMAN_ARENA_MATRIX(m, m)                            // R
+         + KALMAN_ARENA_MATRIX(m, 1)                            // y
+         + KALMAN_ARENA_MATRIX(m, m)                            // S
+         + KALMAN_ARENA_MATRIX(n, m);                           // K
+
+    if (shared) return persistent;
+    return persistent
+         + KALMAN_ARENA_MATRIX((n > m) ? n : m, 1)              // aux
+         + KALMAN_ARENA_MATRIX(m, n);                           // temporary HP
+}
+
+/*!
+* \brief Gets the number of bytes {\ref kalman_create} requests for a filter
+* \param[in] num_states The number of states
+* \param[in] num_inputs The number of inputs
+* \return The size of the block holding the structure and all matrices.
+*/
+size_t kalman_create_size(matrix_index_t num_states, matrix_index_t num_inputs)
+{
+    return kalman_block_size(num_states, num_inputs, 0);
+}
+
+/*!
+* \brief Gets the number of bytes {\ref kalman_create_shared} requests for a filter
+* \param[in] num_states The number of states
+* \param[in] num_inputs The number of inputs
+* \return The size of the block holding the structure and the persistent matrices.
+*/
+size_t kalman_create_shared_size(matrix_index_t num_states, matrix_index_t num_inputs)
+{
+    return kalman_block_size(num_states, num_inputs, 1);
+}
+
+/*!
+* \brief Gets the number of bytes {\ref kalman_measurement_create} requests for a measurement
+* \param[in] num_states The number of states
+* \param[in] num_measurements The number of measured outputs
+* \return The size of the block holding the structure and all matrices.
+*/
+size_t kalman_measurement_create_size(matrix_index_t num_states, matrix_index_t num_measurements)
+{
+    return kalman_measurement_block_size(num_states, num_measurements, 0);
+}
+
+/*!
+* \brief Gets the number of bytes {\ref kalman_measurement_create_shared} requests for a measurement
+* \param[in] num_states The number of states
+* \param[in] num_measurements The number of measured outputs
+* \return The size of the block holding the structure and the persistent matrices.
+*/
+size_t kalman_measurement_create_shared_size(matrix_index_t num_states, matrix_index_t num_measurements)
+{
+    return kalman_measurement_block_size(num_states, num_measurements, 1);
+}
+
+/*!
+* \brief Takes the next matrix buffer from a block
+* \param[in] cursor The current position in the block, will be advanced
+* \param[in] rows The number of rows
+* \param[in] cols The number of columns
+* \return The buffer.
+*/
+static matrix_data_t* kalman_arena_take(uint8_t **cursor, size_t rows, size_t cols)
+{
+    matrix_data_t *buffer = (matrix_data_t*)*cursor;
+    *cursor += KALMAN_ARENA_MATRIX(rows, cols);
+    return buffer;
+}
+
+/*!
+* \brief Creates a filter in a block of an arena
+* \param[in] arena The arena to allocate from
+* \param[in] num_states The number of states
+* \param[in] num_inputs The number of inputs
+* \param[in] shared Nonzero if the temporaries are taken from the scratch area
+* \return The filter with all matrices zeroed, or \c NULL if the arena is exhausted.
+*/
+static kalman_t* kalman_create_block(kalman_arena_t *arena, matrix_index_t num_states, matrix_index_t num_inputs, int shared)
+{
+    const size_t n = num_states;
+    const size_t i = num_inputs;
+    const size_t size = kalman_block_size(num_states, num_inputs, shared);
+
+    uint8_t *block = (uint8_t*)kalman_arena_alloc(arena, size);
+    if (block == NULL) return NULL;
+    memset(block, 0, size);
+
+    kalman_t *kf = (kalman_t*)block;
+    uint8_t *cursor = block + KALMAN_ARENA_ROUND(sizeof(kalman_t));
+
+    matrix_data_t *A = kalman_arena_take(&cursor, n, n);
+    matrix_data_t *x = kalman_arena_take(&cursor, n, 1);
+    matrix_data_t *B = kalman_arena_take(&cursor, n, i);
+    matrix_data_t *u = kalman_arena_take(&cursor, i, 1);
+    matrix_data_t *P = kalman_arena_take(&cursor, n, n);
+    matrix_data_t *Q = kalman_arena_take(&cursor, i, i);
+    matrix_data_t *aux = shared ? NULL : kalman_arena_take(&cursor, (n > i) ? n : i, 1);
+    matrix_data_t *tempPBQ = shared ? NULL : kalman_arena_take(&cursor, n, (n > i) ? n : i);
+    assert(cursor == block + size);
+
+    // the predicted x vector shares its backing field with aux, temporary P with temporary BQ
+    kalman_filter_initialize(kf, num_states, num_inputs, A, x, B, u, P, Q, aux, aux, tempPBQ, tempPBQ);
+    return kf;
+}
+
+/*!
+* \brief Creates a filter in an arena
+* \param[in] arena The arena to allocate from
+* \param[in] num_states The number of states
+* \param[in] num_inputs The number of inputs
+* \return The filter with all matrices zeroed, or \c NULL if the arena is exhausted.
+*/
+kalman_t* kalman_create(kalman_arena_t *arena, matrix_index_t num_states, matrix_index_t num_inputs)
+{
+    return kalman_create_block(arena, num_states, num_inputs, 0);
+}
+
+/*!
+* \brief Creates a filter without temporaries in an arena
+* \param[in] arena The arena to allocate from
+* \param[in] num_states The number of states
+* \param[in] num_inputs The number of inputs
+* \return The filter with all matrices zeroed, or \c NULL if the arena is exhausted.
+*/
+kalman_t* kalman_create_shared(kalman_arena_t *arena, matrix_index_t num_states, matrix_index_t num_inputs)
+{
+    return kalman_create_block(arena, num_states, num_inputs, 1);
+}
+
+/*!
+* \brief Releases a filter created by {\ref kalman_create} or {\ref kalman_create_shared}
+* \param[in] arena The arena the filter was created in
+* \param[in] kf The filter; may be \c NULL.
+*/
+void kalman_destroy(kalman_arena_t *arena, kalman_t *kf)
+{
+    if (kf == NULL) return;
+    kalman_arena_free(arena, kf, kalman_block_size(kf->A.rows, kf->B.cols, (kf->flags & KALMAN_FLAG_SCRATCH) != 0));
+}
+
+/*!
+* \brief Creates a measurement in a block of an arena
+* \param[in] arena The arena to allocate from
+* \param[in] num_states The number of states of the filter to be corrected
+* \param[in] num_measurements The number of measured outputs
+* \param[in] shared Nonzero if the temporaries are taken from the scratch area
+* \return The measurement with all matrices zeroed, or \c NULL if the arena is exhausted.
+*/
+static kalman_measurement_t* kalman_measurement_create_block(kalman_arena_t *arena, matrix_index_t num_states, matrix_index_t num_measurements, int shared)
+{
+    const size_t n = num_states;
+    const size_t m = num_measurements;
+    const size_t size = kalman_measurement_block_size(num_states, num_measurements, shared);
+
+    uint8_t *block = (uint8_t*)kalman_arena_alloc(arena, size);
+    if (block == NULL) return NULL;
+    memset(block, 0, size);
+
+    kalman_measurement_t *kfm = (kalman_measurement_t*)block;
+    uint8_t *cursor = block + KALMAN_ARENA_ROUND(sizeof(kalman_measurement_t));
+
+    matrix_data_t *H = kalman_arena_take(&cursor, m, n);
+    matrix_data_t *z = kalman_arena_take(&cursor, m, 1);
+    matrix_data_t *R = kalman_arena_take(&cursor, m, m);
+    matrix_data_t *y = kalman_arena_take(&cursor, m, 1);
+    matrix_data_t *S = kalman_arena_take(&cursor, m, m);
+    matrix_data_t *K = kalman_arena_take(&cursor, n, m);
+    matrix_data_t *aux = shared ? NULL : kalman_arena_take(&cursor, (n > m) ? n : m, 1);
+    matrix_data_t *tempHP = shared ? NULL : kalman_arena_take(&cursor, m, n);
+    assert(cursor == block + size);
+
+    kalman_measurement_initialize(kfm, num_states, num_measurements, H, z, R, y, S, K, aux, tempHP);
+    return kfm;
+}
+
+/*!
+* \brief Creates a measurement in an arena
+* \param[in] arena The arena to allocate from
+* \param[in] num_states The number of states of the filter to be corrected
+* \param[in] num_measurements The number of measured outputs
+* \return The measurement with all matrices zeroed, or \c NULL if the arena is exhausted.
+*/
+kalman_measurement_t* kalman_measurement_create(kalman_arena_t *arena, matrix_index_t num_states, matrix_index_t num_measurements)
+{
+    return kalman_measurement_create_block(arena, num_states, num_measurements, 0);
+}
+
+/*!
+* \brief Creates a measurement without temporaries in an arena
+* \param[in] arena The arena to allocate from
+* \param[in] num_states The number of states of the filter to be corrected
+* \param[in] num_measurements The number of measured outputs
+* \return The measurement with all matrices zeroed, or \c NULL if the arena is exhausted.
+*/
+kalman_measurement_t* kalman_measurement_create_shared(kalman_arena_t *arena, matrix_index_t num_states, matrix_index_t num_measurements)
+{
+    return kalman_measurement_create_block(arena, num_states, num_measurements, 1);
+}
+
+/*!
+* \brief Releases a measurement created by {\ref kalman_measurement_create} or {\ref kalman_measurement_create_shared}
+* \param[in] arena The arena the measurement was created in
+* \param[in] kfm The measurement; may be \c NULL.
+*/
+void kalman_measurement_destroy(kalman_arena_t *arena, kalman_measurement_t *kfm)
+{
+    if (kfm == NULL) return;
+    kalman_arena_free(arena, kfm, kalman_measurement_block_size(kfm->H.cols, kfm->H.rows, (kfm->flags & KALMAN_MEASUREMENT_FLAG_SCRATCH) != 0));
+}
@@ -0,0 +1,573 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#include <stdint.h>
+#include <assert.h>
+#include <math.h>
+
+#define EXTERN_INLINE_MATRIX static INLINE
+#define EXTERN_INLINE_KALMAN static INLINE
+#include "kalman_batch.h"
+
+/*!
+* \def KALMAN_BATCH_FOREACH_LANE Iterates \c l over all lanes of a batch
+*
+* Every kernel in this file keeps the lane loop innermost so that the compiler can map it onto SIMD registers.
+*/
+#define KALMAN_BATCH_FOREACH_LANE(l) for ((l) = 0; (l) < KALMAN_BATCH_LANES; ++(l))
+
+/*!
+* \brief Initializes a batch matrix structure.
+* \param[in] mat The matrix to initialize
+* \param[in] rows The number of rows
+* \param[in] cols The number of columns
+* \param[in] buffer The lane buffer (of size {\see rows} x {\see cols}).
+*/
+static void kalman_batch_matrix_init(kalman_batch_matrix_t *const mat, const matrix_index_t rows, const matrix_index_t cols, kalman_batch_lane_t *const buffer)
+{
+    mat->rows = rows;
+    mat->cols = cols;
+    mat->data = buffer;
+}
+
+/*!
+* \brief Performs a lane-wise matrix multiplication such that {\ref c} = {\ref a} * {\ref b}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting matrix C (will be overwritten)
+*/
+static void kalman_batch_mult(const kalman_batch_matrix_t *const a, const kalman_batch_matrix_t *const b, const kalman_batch_matrix_t *RESTRICT c)
+{
+    matrix_offset_t i, j, k, l;
+    const matrix_index_t arows = a->rows;
+    const matrix_index_t acols = a->cols;
+    const matrix_index_t bcols = b->cols;
+
+    for (i = 0; i < arows; ++i)
+    {
+        for (j = 0; j < bcols; ++j)
+        {
+            matrix_data_t *RESTRICT const total = c->data[i * bcols + j];
+            KALMAN_BATCH_FOREACH_LANE(l) total[l] = 0;
+
+            for (k = 0; k < acols; ++k)
+            {
+                const matrix_data_t *RESTRICT const av = a->data[i * acols + k];
+                const matrix_data_t *RESTRICT const bv = b->data[k * bcols + j];
+                KALMAN_BATCH_FOREACH_LANE(l) total[l] += av[l] * bv[l];
+            }
+        }
+    }
+}
+
+/*!
+* \brief Performs a lane-wise matrix multiplication with transposed B such that {\ref c} = {\ref c0} + {\ref a} * {\ref b'} * {\ref scale}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] scale Scaling factor
+* \param[in] accumulate Nonzero to add to the current contents of {\ref c}, zero to overwrite them
+* \param[in] c Resulting matrix C
+*/
+static void kalman_batch_mult_transb(const kalman_batch_matrix_t *const a, const kalman_batch_matrix_t *const b, const matrix_data_t scale, const int accumulate, const kalman_batch_matrix_t *RESTRICT c)
+{
+    matrix_offset_t i, j, k, l;
+    const matrix_index_t arows = a->rows;
+    const matrix_index_t acols = a->cols;
+    const matrix_index_t brows = b->rows;
+
+    for (i = 0; i < arows; ++i)
+    {
+        for (j = 0; j < brows; ++j)
+        {
+            matrix_data_t total[KALMAN_BATCH_LANES];
+            KALMAN_BATCH_FOREACH_LANE(l) total[l] = 0;
+
+            for (k = 0; k < acols; ++k)
+            {
+                const matrix_data_t *RESTRICT const av = a->data[i * acols + k];
+                const matrix_data_t *RESTRICT const bv = b->data[j * acols + k];
+                KALMAN_BATCH_FOREACH_LANE(l) total[l] += av[l] * bv[l];
+            }
+
+            matrix_data_t *RESTRICT const cv = c->data[i * brows + j];
+            if (accumulate)
+            {
+                KALMAN_BATCH_FOREACH_LANE(l) cv[l] += total[l] * scale;
+            }
+            else
+            {
+                KALMAN_BATCH_FOREACH_LANE(l) cv[l] = total[l] * scale;
+            }
+        }
+    }
+}
+
+/*!
+* \brief Decomposes the matrices of all lanes into lower triangular form using Cholesky decomposition.
+* \param[in] mat The matrix to decompose in place into lower triangular matrices.
+* \return Bit mask of the lanes that are not positive definite.
+*
+* Lanes that fail the decomposition continue with a unit pivot so that they produce finite values.
+*
+* \see cholesky_decompose_lower
+*/
+static uint_fast32_t kalman_batch_cholesky_decompose_lower(const kalman_batch_matrix_t *const mat)
+{
+    matrix_offset_t i, j, k, l;
+    const matrix_index_t n = mat->rows;
+    kalman_batch_lane_t *const t = mat->data;
+
+    matrix_data_t div_el_ii[KALMAN_BATCH_LANES];
+    uint_fast32_t failed = 0;
+
+    for (i = 0; i < n; ++i)
+    {
+        for (j = i; j < n; ++j)
+        {
+            matrix_data_t sum[KALMAN_BATCH_LANES];
+            KALMAN_BATCH_FOREACH_LANE(l) sum[l] = t[i*n+j][l];
+
+            for (k = 0; k < i; ++k)
+            {
+                const matrix_data_t *RESTRICT const ik = t[i*n+k];
+                const matrix_data_t *RESTRICT const jk = t[j*n+k];
+                KALMAN_BATCH_FOREACH_LANE(l) sum[l] -= ik[l] * jk[l];
+            }
+
+            if (i == j)
+            {
+                // is it positive-definite?
+                KALMAN_BATCH_FOREACH_LANE(l)
+                {
+                    if (sum[l] <= 0)
+                    {
+                        failed |= (uint_fast32_t)1 << l;
+                        sum[l] = 1;
+                    }
+                }
+
+                KALMAN_BATCH_FOREACH_LANE(l)
+                {
+                    const matrix_data_t el_ii = (matrix_data_t)sqrt(sum[l]);
+                    t[i*n+i][l] = el_ii;
+                    div_el_ii[l] = (matrix_data_t)1.0 / el_ii;
+                }
+            }
+            else
+            {
+                KALMAN_BATCH_FOREACH_LANE(l) t[j*n+i][l] = sum[l] * div_el_ii[l];
+            }
+        }
+    }
+
+    // zero the top right corner.
+    for (i = 0; i < n; ++i)
+    {
+        for (j = i + 1; j < n; ++j)
+        {
+            KALMAN_BATCH_FOREACH_LANE(l) t[i*n+j][l] = 0;
+        }
+    }
+
+    return failed;
+}
+
+/*!
+* \brief Inverts the lower triangular matrices of all lanes, yielding the inverse of the original symmetric matrices.
+* \param[in] lower The lower triangular matrices to be inverted.
+* \param[out] inverse The inverse of the original symmetric matrices.
+*
+* \see matrix_invert_lower
+*/
+static void kalman_batch_invert_lower(const kalman_batch_matrix_t *RESTRICT const lower, const kalman_batch_matrix_t *RESTRICT inverse)
+{
+    matrix_soffset_t i, j, k;
+    matrix_offset_t l;
+    const matrix_soffset_t n = lower->rows;
+    const matrix_data_t (*const t)[KALMAN_BATCH_LANES] = (const matrix_data_t (*)[KALMAN_BATCH_LANES])lower->data;
+    kalman_batch_lane_t *const a = inverse->data;
+
+    // inverts the lower triangular system and saves the result
+    // in the upper triangle to minimize cache misses
+    for (i = 0; i < n; ++i)
+    {
+        const matrix_data_t *RESTRICT const el_ii = t[i*n+i];
+        for (j = 0; j <= i; ++j)
+        {
+            matrix_data_t sum[KALMAN_BATCH_LANES];
+            const matrix_data_t init = (i == j) ? (matrix_data_t)1.0 : (matrix_data_t)0;
+            KALMAN_BATCH_FOREACH_LANE(l) sum[l] = init;
+
+            for (k = i - 1; k >= j; --k)
+            {
+                const matrix_data_t *RESTRICT const tv = t[i*n+k];
+                const matrix_data_t *RESTRICT const av = a[j*n+k];
+                KALMAN_BATCH_FOREACH_LANE(l) sum[l] -= tv[l] * av[l];
+            }
+
+            KALMAN_BATCH_FOREACH_LANE(l) a[j*n+i][l] = sum[l] / el_ii[l];
+        }
+    }
+
+    // solve the system and handle the previous solution being in the upper triangle
+    // takes advantage of symmetry
+    for (i = n - 1; i >= 0; --i)
+    {
+        const matrix_data_t *RESTRICT const el_ii = t[i*n+i];
+        for (j = 0; j <= i; ++j)
+        {
+            matrix_data_t sum[KALMAN_BATCH_LANES];
+            KALMAN_BATCH_FOREACH_LANE(l) sum[l] = a[j*n+i][l];
+
+            for (k = i + 1; k < n; ++k)
+            {
+                const matrix_data_t *RESTRICT const tv = t[k*n+i];
+                const matrix_data_t *RESTRICT const av = a[j*n+k];
+                KALMAN_BATCH_FOREACH_LANE(l) sum[l] -= tv[l] * av[l];
+            }
+
+            KALMAN_BATCH_FOREACH_LANE(l) a[i*n+j][l] = a[j*n+i][l] = sum[l] / el_ii[l];
+        }
+    }
+}
+
+/*!
+* \brief Initializes a batch of Kalman filters
+* \param[in] batch The batch structure to initialize
+* \param[in] num_states The number of state variables
+* \param[in] num_inputs The number of input variables
+* \param[in] num_measurements The number of measured outputs
+* \param[in] buffer The backing buffer of {\ref KALMAN_BATCH_BUFFER_SIZE} lane vectors; all elements will be zeroed.
+*/
+void kalman_batch_initialize(kalman_batch_t *batch, matrix_index_t num_states, matrix_index_t num_inputs, matrix_index_t num_measurements,
+                             kalman_batch_lane_t *buffer)
+{
+    uint_fast32_t i, l;
+    const uint_fast32_t size = KALMAN_BATCH_BUFFER_SIZE(num_states, num_inputs, num_measurements);
+    kalman_batch_lane_t *next = buffer;
+
+    assert(batch != (kalman_batch_t*)0);
+    assert(buffer != (kalman_batch_lane_t*)0);
+
+    for (i = 0; i < size; ++i)
+    {
+        KALMAN_BATCH_FOREACH_LANE(l) buffer[i][l] = 0;
+    }
+
+    batch->num_states = num_states;
+    batch->num_inputs = num_inputs;
+    batch->num_measurements = num_measurements;
+
+    kalman_batch_matrix_init(&batch->x, num_states, 1, next);                  next += num_states;
+    kalman_batch_matrix_init(&batch->A, num_states, num_states, next);         next += (matrix_offset_t)num_states * num_states;
+    kalman_batch_matrix_init(&batch->P, num_states, num_states, next);         next += (matrix_offset_t)num_states * num_states;
+    kalman_batch_matrix_init(&batch->B, num_states, num_inputs, next);         next += (matrix_offset_t)num_states * num_inputs;
+    kalman_batch_matrix_init(&batch->Q, num_inputs, num_inputs, next);         next += (matrix_offset_t)num_inputs * num_inputs;
+
+    kalman_batch_matrix_init(&batch->z, num_measurements, 1, next);            next += num_measurements;
+    kalman_batch_matrix_init(&batch->H, num_measurements, num_states, next);   next += (matrix_offset_t)num_measurements * num_states;
+    kalman_batch_matrix_init(&batch->R, num_measurements, num_measurements, next); next += (matrix_offset_t)num_measurements * num_measurements;
+    kalman_batch_matrix_init(&batch->y, num_measurements, 1, next);            next += num_measurements;
+    kalman_batch_matrix_init(&batch->S, num_measurements, num_measurements, next); next += (matrix_offset_t)num_measurements * num_measurements;
+    kalman_batch_matrix_init(&batch->K, num_states, num_measurements, next);   next += (matrix_offset_t)num_states * num_measurements;
+
+    // temporary P and BQ share their backing field, just like in kalman_t
+    kalman_batch_matrix_init(&batch->temporary.x, num_states, 1, next);        next += num_states;
+    kalman_batch_matrix_init(&batch->temporary.P, num_states, num_states, next);
+    kalman_batch_matrix_init(&batch->temporary.BQ, num_states, num_inputs, next);
+    next += KALMAN_BATCH_TEMP_P_SIZE(num_states, num_inputs);
+    kalman_batch_matrix_init(&batch->temporary.HP, num_measurements, num_states, next); next += (matrix_offset_t)num_measurements * num_states;
+    kalman_batch_matrix_init(&batch->temporary.S_inv, num_measurements, num_measurements, next); next += (matrix_offset_t)num_measurements * num_measurements;
+
+    assert((uint_fast32_t)(next - buffer) == size);
+}
+
+/*!
+* \brief Copies a matrix into one lane of a batch matrix
+* \param[in] mat The source matrix
+* \param[in] target The target batch matrix
+* \param[in] lane The target lane
+*/
+static void kalman_batch_matrix_load(const matrix_t *const mat, const kalman_batch_matrix_t *const target, const matrix_index_t lane)
+{
+    matrix_offset_t i, j;
+    const matrix_index_t cols = target->cols;
+
+    assert(mat->rows == target->rows && mat->cols == target->cols);
+    if (matrix_is_packed(mat))
+    {
+        for (i = 0; i < target->rows; ++i)
+        {
+            for (j = 0; j < cols; ++j)
+            {
+                target->data[i * cols + j][lane] = matrix_get_packed(mat, i, j);
+            }
+        }
+        return;
+    }
+
+    for (i = 0; i < target->rows; ++i)
+    {
+        for (j = 0; j < cols; ++j)
+        {
+            target->data[i * cols + j][lane] = matrix_get(mat, i, j);
+        }
+    }
+}
+
+/*!
+* \brief Copies one lane of a batch matrix into a matrix
+* \param[in] mat The source batch matrix
+* \param[in] lane The source lane
+* \param[in] target The target matrix
+*/
+static void kalman_batch_matrix_store(const kalman_batch_matrix_t *const mat, const matrix_index_t lane, const matrix_t *const target)
+{
+    matrix_offset_t i, j;
+    const matrix_index_t cols = mat->cols;
+
+    assert(mat->rows == target->rows && mat->cols == target->cols);
+    if (matrix_is_packed(target))
+    {
+        for (i = 0; i < mat->rows; ++i)
+        {
+            for (j = i; j < cols; ++j)
+            {
+                matrix_set_packed((matrix_t*)target, i, j, mat->data[i * cols + j][lane]);
+            }
+        }
+        return;
+    }
+
+    for (i = 0; i < mat->rows; ++i)
+    {
+        for (j = 0; j < cols; ++j)
+        {
+            matrix_set((matrix_t*)target, i, j, mat->data[i * cols + j][lane]);
+        }
+    }
+}
+
+/*!
+* \brief Copies a filter and its measurement into one lane of a batch
+* \param[in] batch The batch
+* \param[in] lane The lane to load into
+* \param[in] kf The filter; its dimensions must match the batch, and deferred propagations must have been flushed (see {\ref kalman_flush_covariance}).
+* \param[in] kfm The measurement; its dimensions must match the batch. May be \c NULL.
+*/
+void kalman_batch_load(kalman_batch_t *batch, matrix_index_t lane, const kalman_t *kf, const kalman_measurement_t *kfm)
+{
+    assert(lane < KALMAN_BATCH_LANES);
+    assert(kf->pending == 0);
+
+    kalman_batch_matrix_load(&kf->x, &batch->x, lane);
+    kalman_batch_matrix_load(&kf->A, &batch->A, lane);
+    kalman_batch_matrix_load(&kf->P, &batch->P, lane);
+    if (batch->num_inputs > 0)
+    {
+        kalman_batch_matrix_load(&kf->B, &batch->B, lane);
+        kalman_batch_matrix_load(&kf->Q, &batch->Q, lane);
+    }
+
+    if (kfm != (kalman_measurement_t*)0)
+    {
+        kalman_batch_matrix_load(&kfm->z, &batch->z, lane);
+        kalman_batch_matrix_load(&kfm->H, &batch->H, lane);
+        kalman_batch_matrix_load(&kfm->R, &batch->R, lane);
+    }
+}
+
+/*!
+* \brief Copies state, covariance and gain of one lane of a batch back into a filter and its measurement
+* \param[in] batch The batch
+* \param[in] lane The lane to store from
+* \param[in] kf The filter to receive x and P
+* \param[in] kfm The measurement to receive y, S and K. May be \c NULL.
+*/
+void kalman_batch_store(const kalman_batch_t *batch, matrix_index_t lane, kalman_t *kf, kalman_measurement_t *kfm)
+{
+    assert(lane < KALMAN_BATCH_LANES);
+
+    kalman_batch_matrix_store(&batch->x, lane, &kf->x);
+    kalman_batch_matrix_store(&batch->P, lane, &kf->P);
+
+    if (kfm != (kalman_measurement_t*)0)
+    {
+        kalman_batch_matrix_store(&batch->y, lane, &kfm->y);
+        kalman_batch_matrix_store(&batch->S, lane, &kfm->S);
+        kalman_batch_matrix_store(&batch->K, lane, &kfm->K);
+    }
+}
+
+/*!
+* \brief Predicts the state vectors of all lanes
+* \param[in] batch The batch to predict with.
+*/
+static void kalman_batch_predict_x(kalman_batch_t *batch)
+{
+    matrix_offset_t i, l;
+
+    // x = A*x
+    kalman_batch_mult(&batch->A, &batch->x, &batch->temporary.x);
+    for (i = 0; i < batch->num_states; ++i)
+    {
+        matrix_data_t *RESTRICT const xv = batch->x.data[i];
+        const matrix_data_t *RESTRICT const pv = batch->temporary.x.data[i];
+        KALMAN_BATCH_FOREACH_LANE(l) xv[l] = pv[l];
+    }
+}
+
+/*!
+* \brief Performs the time update / prediction step for all filters of the batch.
+* \param[in] batch The batch to predict with.
+*/
+void kalman_batch_predict(kalman_batch_t *batch)
+{
+    kalman_batch_predict_tuned(batch, (matrix_data_t)1.0);
+}
+
+/*!
+* \brief Performs the time update / prediction step for all filters of the batch.
+* \param[in] batch The batch to predict with.
+* \param[in] lambda Lambda factor (\c 0 < {\ref lambda} <= \c 1) to forcibly reduce prediction certainty.
+*/
+void kalman_batch_predict_tuned(kalman_batch_t *batch, matrix_data_t lambda)
+{
+    /************************************************************************/
+    /* Predict next state using system dynamics                             */
+    /* x = A*x                                                              */
+    /************************************************************************/
+
+    kalman_batch_predict_x(batch);
+
+    /************************************************************************/
+    /* Predict next covariance using system dynamics and input              */
+    /* P = A*P*A' * 1/lambda^2 + B*Q*B'                                     */
+    /************************************************************************/
+
+    // lambda = 1/lambda^2
+    lambda = (matrix_data_t)1.0 / (lambda * lambda);
+
+    // P = A*P*A'
+    kalman_batch_mult(&batch->A, &batch->P, &batch->temporary.P);                       // temp = A*P
+    kalman_batch_mult_transb(&batch->temporary.P, &batch->A, lambda, 0, &batch->P);     // P = temp*A' * 1/(lambda^2)
+
+    // P = P + B*Q*B'
+    if (batch->num_inputs > 0)
+    {
+        kalman_batch_mult(&batch->B, &batch->Q, &batch->temporary.BQ);                  // temp = B*Q
+        kalman_batch_mult_transb(&batch->temporary.BQ, &batch->B, 1, 1, &batch->P);     // P += temp*B'
+    }
+}
+
+/*!
+* \brief Performs the measurement update step for all filters of the batch.
+* \param[in] batch The batch to correct.
+* \return Bit mask of the lanes whose residual covariance was not positive definite; these lanes are left unchanged.
+*/
+uint_fast32_t kalman_batch_correct(kalman_batch_t *batch)
+{
+    matrix_offset_t i, j, k, l;
+    const matrix_index_t n = batch->num_states;
+    const matrix_index_t m = batch->num_measurements;
+
+    kalman_batch_lane_t *const x = batch->x.data;
+    kalman_batch_lane_t *const P = batch->P.data;
+    kalman_batch_lane_t *const y = batch->y.data;
+    kalman_batch_lane_t *const K = batch->K.data;
+    kalman_batch_lane_t *const HP = batch->temporary.HP.data;
+    kalman_batch_lane_t *const Sinv = batch->temporary.S_inv.data;
+
+    /************************************************************************/
+    /* Calculate innovation and residual covariance                         */
+    /* y = z - H*x                                                          */
+    /* S = H*P*H' + R                                                       */
+    /************************************************************************/
+
+    // y = z - H*x
+    kalman_batch_mult(&batch->H, &batch->x, &batch->y);
+    for (i = 0; i < m; ++i)
+    {
+        const matrix_data_t *RESTRICT const zv = batch->z.data[i];
+        KALMAN_BATCH_FOREACH_LANE(l) y[i][l] = zv[l] - y[i][l];
+    }
+
+    // S = H*P*H' + R
+    kalman_batch_mult(&batch->H, &batch->P, &batch->temporary.HP);                  // temp = H*P
+    kalman_batch_mult_transb(&batch->temporary.HP, &batch->H, 1, 0, &batch->S);     // S = temp*H'
+    for (i = 0; i < (matrix_offset_t)m * m; ++i)
+    {
+        const matrix_data_t *RESTRICT const rv = batch->R.data[i];
+        KALMAN_BATCH_FOREACH_LANE(l) batch->S.data[i][l] += rv[l];                  // S += R
+    }
+
+    /************************************************************************/
+    /* Calculate Kalman gain                                                */
+    /* K = P*H' * S^-1                                                      */
+    /************************************************************************/
+
+    const uint_fast32_t failed = kalman_batch_cholesky_decompose_lower(&batch->S);
+    kalman_batch_invert_lower(&batch->S, &batch->temporary.S_inv);                  // Sinv = S^-1
+
+    // lanes that failed the decomposition get a zero gain and are thus left unchanged
+    matrix_data_t valid[KALMAN_BATCH_LANES];
+    KALMAN_BATCH_FOREACH_LANE(l) valid[l] = ((failed >> l) & 1) ? (matrix_data_t)0 : (matrix_data_t)1;
+
+    // K = (H*P)' * Sinv, using the symmetry of P
+    for (i = 0; i < n; ++i)
+    {
+        for (j = 0; j < m; ++j)
+        {
+            matrix_data_t total[KALMAN_BATCH_LANES];
+            KALMAN_BATCH_FOREACH_LANE(l) total[l] = 0;
+
+            for (k = 0; k < m; ++k)
+            {
+                const matrix_data_t *RESTRICT const hp = HP[k*n+i];
+                const matrix_data_t *RESTRICT const si = Sinv[k*m+j];
+                KALMAN_BATCH_FOREACH_LANE(l) total[l] += hp[l] * si[l];
+            }
+
+            KALMAN_BATCH_FOREACH_LANE(l) K[i*m+j][l] = total[l] * valid[l];
+        }
+    }
+
+    /************************************************************************/
+    /* Correct state prediction                                             */
+    /* x = x + K*y                                                          */
+    /************************************************************************/
+
+    for (i = 0; i < n; ++i)
+    {
+        for (k = 0; k < m; ++k)
+        {
+            const matrix_data_t *RESTRICT const kv = K[i*m+k];
+            const matrix_data_t *RESTRICT const yv = y[k];
+            KALMAN_BATCH_FOREACH_LANE(l) x[i][l] += kv[l] * yv[l];
+        }
+    }
+
+    /************************************************************************/
+    /* Correct state covariances                                            */
+    /* P = P - K*(H*P)                                                      */
+    /************************************************************************/
+
+    for (i = 0; i < n; ++i)
+    {
+        for (j = 0; j < n; ++j)
+        {
+            matrix_data_t *RESTRICT const pv = P[i*n+j];
+            for (k = 0; k < m; ++k)
+            {
+                const matrix_data_t *RESTRICT const kv = K[i*m+k];
+                const matrix_data_t *RESTRICT const hp = HP[k*n+j];
+                KALMAN_BATCH_FOREACH_LANE(l) pv[l] -= kv[l] * hp[l];
+            }
+        }
+    }
+
+    return failed;
+}
@@ -0,0 +1,498 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+/*!
+* \brief Micro-benchmarks of the matrix kernels
+*
+* Every kernel of matrix.h and cholesky.h is timed on square operands of a grid of sizes.
+* The results are written as JSON, one result object per line:
+*
+* \code
+* {
+*   "simd_level": 3,
+*   "results": [
+*     {"kernel": "matrix_mult", "size": 8, "ns_per_op": 61.2, "gflops": 16.73, "cycles_per_op": 122.4},
+*     ...
+*   ]
+* }
+* \endcode
+*
+* Usage: kalman_bench [--out FILE] [--compare BASELINE] [--threshold FRACTION] [--sizes N,N,...] [--min-time MS] [--simd LEVEL]
+*        kalman_bench --scenarios [--updates N] [--out FILE] [--simd LEVEL]
+*
+* In compare mode, every kernel that got slower than the baseline by more than the threshold
+* (default 0.10, i.e. 10%) is reported on stderr and the exit code is nonzero.
+*
+* With \c --scenarios, the end-to-end filter scenarios of kalman_bench_scenarios.c are run instead.
+*
+* \c --simd is only available if the library was built with \ref KALMAN_SIMD_TESTING.
+*/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EXTERN_INLINE_MATRIX static INLINE
+#include "cholesky.h"
+#include "matrix.h"
+#include "matrix_simd.h"
+#include "kalman_bench.h"
+
+/*!
+* \brief The largest benchmarked size; with blocking enabled, sizes above 64 exercise the cache-blocked products
+*/
+#define BENCH_MAX_SIZE      (MATRIX_MAX_DIMENSION < 256 ? MATRIX_MAX_DIMENSION : 256)
+
+/*!
+* \brief The maximum number of sizes in the grid
+*/
+#define BENCH_MAX_SIZES     (64)
+
+/*!
+* \brief The number of timed samples per kernel and size; the fastest one is reported
+*/
+#define BENCH_SAMPLES       (5)
+
+/*!
+* \brief The maximum number of results in a baseline file
+*/
+#define BENCH_MAX_RESULTS   (1024)
+
+/*!
+* \brief Operands shared by all kernels
+*/
+typedef struct
+{
+    matrix_t a, b, c, spd, lower, work, x, y;
+    matrix_data_t *aux;
+} bench_operands_t;
+
+/*!
+* \brief A benchmarked kernel
+*/
+typedef struct
+{
+    /*!
+    * \brief The name as reported in the results
+    */
+    const char *name;
+
+    /*!
+    * \brief Runs the kernel once
+    */
+    void (*run)(bench_operands_t *ops);
+
+    /*!
+    * \brief Number of floating point operations of one run on size \c n
+    */
+    double (*flops)(double n);
+} bench_kernel_t;
+
+/*!
+* \brief A single result
+*/
+typedef struct
+{
+    char kernel[64];
+    int size;
+    double ns_per_op;
+    double gflops;
+    double cycles_per_op;
+} bench_result_t;
+
+/************************************************************************/
+/* Operand buffers                                                      */
+/************************************************************************/
+
+static matrix_data_t buffer_a[BENCH_MAX_SIZE * BENCH_MAX_SIZE];
+static matrix_data_t buffer_b[BENCH_MAX_SIZE * BENCH_MAX_SIZE];
+static matrix_data_t buffer_c[BENCH_MAX_SIZE * BENCH_MAX_SIZE];
+static matrix_data_t buffer_spd[BENCH_MAX_SIZE * BENCH_MAX_SIZE];
+static matrix_data_t buffer_lower[BENCH_MAX_SIZE * BENCH_MAX_SIZE];
+static matrix_data_t buffer_work[BENCH_MAX_SIZE * BENCH_MAX_SIZE];
+static matrix_data_t buffer_x[BENCH_MAX_SIZE];
+static matrix_data_t buffer_y[BENCH_MAX_SIZE];
+static matrix_data_t buffer_aux[BENCH_MAX_SIZE];
+
+/*!
+* \brief Prepares the operands of size \c n
+* \param[in] ops The operands
+* \param[in] n The size
+*
+* A and B are filled with small values so that repeatedly accumulating kernels neither overflow nor
+* produce denormals within a benchmark run; \c spd is symmetric positive definite and \c lower its Cholesky factor.
+*/
+static void bench_prepare(bench_operands_t *ops, matrix_index_t n)
+{
+    matrix_offset_t i, j;
+    const matrix_data_t scale = (matrix_data_t)1.0 / (matrix_data_t)n;
+
+    matrix_init(&ops->a, n, n, buffer_a);
+    matrix_init(&ops->b, n, n, buffer_b);
+    matrix_init(&ops->c, n, n, buffer_c);
+    matrix_init(&ops->spd, n, n, buffer_spd);
+    matrix_init(&ops->lower, n, n, buffer_lower);
+    matrix_init(&ops->work, n, n, buffer_work);
+    matrix_init(&ops->x, n, 1, buffer_x);
+    matrix_init(&ops->y, n, 1, buffer_y);
+    ops->aux = buffer_aux;
+
+    for (i = 0; i < n; ++i)
+    {
+        buffer_x[i] = scale * (matrix_data_t)(i + 1);
+        buffer_y[i] = 0;
+        for (j = 0; j < n; ++j)
+        {
+            buffer_a[i * n + j] = scale * (matrix_data_t)((i + 2 * j) % 7 + 1);
+            buffer_b[i * n + j] = scale * (matrix_data_t)((3 * i + j) % 5 + 1);
+            buffer_c[i * n + j] = 0;
+
+            // diagonally dominant and symmetric
+            buffer_spd[i * n + j] = (i == j) ? (matrix_data_t)n : scale * (matrix_data_t)((i + j) % 3);
+        }
+    }
+
+    memcpy(buffer_lower, buffer_spd, sizeof(matrix_data_t) * n * n);
+    cholesky_decompose_lower(&ops->lower);
+}
+
+/************************************************************************/
+/* Kernels                                                              */
+/************************************************************************/
+
+static void run_mult_rowvector(bench_operands_t *ops)               { matrix_mult_rowvector(&ops->a, &ops->x, &ops->y); }
+static void run_multadd_rowvector(bench_operands_t *ops)            { matrix_multadd_rowvector(&ops->a, &ops->x, &ops->y); }
+static void run_mult(bench_operands_t *ops)                         { matrix_mult(&ops->a, &ops->b, &ops->c, ops->aux); }
+static void run_mult_transb(bench_operands_t *ops)                  { matrix_mult_transb(&ops->a, &ops->b, &ops->c); }
+static void run_multadd_transb(bench_operands_t *ops)               { matrix_multadd_transb(&ops->a, &ops->b, &ops->c); }
+static void run_multscale_transb(bench_operands_t *ops)             { matrix_multscale_transb(&ops->a, &ops->b, (matrix_data_t)0.5, &ops->c); }
+static void run_mult_transb_symmetric(bench_operands_t *ops)        { matrix_mult_transb_symmetric(&ops->a, &ops->a, &ops->c); }
+static void run_multadd_transb_symmetric(bench_operands_t *ops)     { matrix_multadd_transb_symmetric(&ops->a, &ops->a, &ops->c); }
+static void run_multscale_transb_symmetric(bench_operands_t *ops)   { matrix_multscale_transb_symmetric(&ops->a, &ops->a, (matrix_data_t)0.5, &ops->c); }
+static void run_multsub_symmetric(bench_operands_t *ops)            { matrix_multsub_symmetric(&ops->a, &ops->b, &ops->c); }
+static void run_copy(bench_operands_t *ops)                         { matrix_copy(&ops->a, &ops->c); }
+static void run_sub(bench_operands_t *ops)                          { matrix_sub(&ops->a, &ops->b, &ops->c); }
+static void run_sub_inplace_b(bench_operands_t *ops)                { matrix_sub_inplace_b(&ops->a, &ops->c); }
+static void run_add_inplace(bench_operands_t *ops)                  { matrix_add_inplace(&ops->c, &ops->a); }
+static void run_invert_lower(bench_operands_t *ops)                 { matrix_invert_lower(&ops->lower, &ops->c); }
+static void run_cholesky_solve_transb(bench_operands_t *ops)        { cholesky_solve_transb(&ops->lower, &ops->a, &ops->c); }
+
+/*!
+* \brief Decomposes a fresh copy of the SPD matrix; the n x n copy is part of the timing.
+*/
+static void run_cholesky_decompose_lower(bench_operands_t *ops)
+{
+    const matrix_index_t n = ops->spd.rows;
+    memcpy(ops->work.data, ops->spd.data, sizeof(matrix_data_t) * n * n);
+    cholesky_decompose_lower(&ops->work);
+}
+
+static double flops_none(double n)              { (void)n; return 0; }
+static double flops_elementwise(double n)       { return n * n; }
+static double flops_rowvector(double n)         { return 2 * n * n; }
+static double flops_mult(double n)              { return 2 * n * n * n; }
+static double flops_mult_scaled(double n)       { return 2 * n * n * n + n * n; }
+static double flops_symmetric(double n)         { return n * n * (n + 1); }
+static double flops_cholesky(double n)          { return n * n * n / 3; }
+static double flops_invert_lower(double n)      { return 2 * n * n * n / 3; }
+
+/*!
+* \brief All benchmarked kernels
+*/
+static const bench_kernel_t kernels[] = {
+    { "matrix_mult_rowvector",              run_mult_rowvector,             flops_rowvector },
+    { "matrix_multadd_rowvector",           run_multadd_rowvector,          flops_rowvector },
+    { "matrix_mult",                        run_mult,                       flops_mult },
+    { "matrix_mult_transb",                 run_mult_transb,                flops_mult },
+    { "matrix_multadd_transb",              run_multadd_transb,             flops_mult },
+    { "matrix_multscale_transb",            run_multscale_transb,           flops_mult_scaled },
+    { "matrix_mult_transb_symmetric",       run_mult_transb_symmetric,      flops_symmetric },
+    { "matrix_multadd_transb_symmetric",    run_multadd_transb_symmetric,   flops_symmetric },
+    { "matrix_multscale_transb_symmetric",  run_multscale_transb_symmetric, flops_symmetric },
+    { "matrix_multsub_symmetric",           run_multsub_symmetric,          flops_symmetric },
+    { "matrix_copy",                        run_copy,                       flops_none },
+    { "matrix_sub",                         run_sub,                        flops_elementwise },
+    { "matrix_sub_inplace_b",               run_sub_inplace_b,              flops_elementwise },
+    { "matrix_add_inplace",                 run_add_inplace,                flops_elementwise },
+    { "matrix_invert_lower",                run_invert_lower,               flops_invert_lower },
+    { "cholesky_decompose_lower",           run_cholesky_decompose_lower,   flops_cholesky },
+    { "cholesky_solve_transb",              run_cholesky_solve_transb,      flops_mult },
+};
+
+#define BENCH_NUM_KERNELS   (sizeof(kernels) / sizeof(kernels[0]))
+
+/************************************************************************/
+/* Timing                                                               */
+/************************************************************************/
+
+/*!
+* \brief Times a kernel on the prepared operands
+* \param[in] kernel The kernel
+* \param[in] ops The operands
+* \param[in] min_time_ns The minimum duration of one sample
+* \param[out] result The timing result; name and size are left untouched
+*/
+static void bench_time_kernel(const bench_kernel_t *kernel, bench_operands_t *ops, uint64_t min_time_ns, bench_result_t *result)
+{
+    // calling through a volatile pointer keeps the compiler from hoisting repeated runs
+    void (*volatile run)(bench_operands_t *) = kernel->run;
+    uint64_t iterations = 1, i;
+    int sample;
+
+    // calibrate the number of iterations per sample
+    for (;;)
+    {
+        const uint64_t start = kalman_bench_now_ns();
+        for (i = 0; i < iterations; ++i) run(ops);
+        const uint64_t elapsed = kalman_bench_now_ns() - start;
+
+        if (elapsed >= min_time_ns) break;
+        iterations *= (elapsed > 0 && elapsed < min_time_ns / 8) ? 8 : 2;
+    }
+
+    // keep the fastest sample
+    result->ns_per_op = 0;
+    result->cycles_per_op = 0;
+    for (sample = 0; sample < BENCH_SAMPLES; ++sample)
+    {
+        const uint64_t start_cycles = kalman_bench_cycles();
+        const uint64_t start = kalman_bench_now_ns();
+        for (i = 0; i < iterations; ++i) run(ops);
+        const uint64_t elapsed = kalman_bench_now_ns() - start;
+        const uint64_t elapsed_cycles = kalman_bench_cycles() - start_cycles;
+
+        const double ns_per_op = (double)elapsed / (double)iterations;
+        if (sample == 0 || ns_per_op < result->ns_per_op)
+        {
+            result->ns_per_op = ns_per_op;
+            result->cycles_per_op = (double)elapsed_cycles / (double)iterations;
+        }
+    }
+
+    // FLOP per nanosecond equals GFLOP per second
+    result->gflops = kernel->flops((double)ops->a.rows) / result->ns_per_op;
+}
+
+/************************************************************************/
+/* Baseline comparison                                                  */
+/************************************************************************/
+
+/*!
+* \brief Reads the results of a JSON file written by this benchmark
+* \param[in] path The file name
+* \param[out] results The results
+* \param[in] capacity The capacity of \c results
+* \return The number of results read, or -1 if the file could not be opened.
+*/
+static int bench_read_baseline(const char *path, bench_result_t *results, int capacity)
+{
+    char line[256];
+    int count = 0;
+
+    FILE *file = fopen(path, "r");
+    if (file == NULL) return -1;
+
+    while (count < capacity && fgets(line, sizeof(line), file) != NULL)
+    {
+        bench_result_t *result = &results[count];
+        if (sscanf(line, " {\"kernel\": \"%63[^\"]\", \"size\": %d, \"ns_per_op\": %lf, \"gflops\": %lf, \"cycles_per_op\": %lf",
+                   result->kernel, &result->size, &result->ns_per_op, &result->gflops, &result->cycles_per_op) == 5)
+        {
+            ++count;
+        }
+    }
+
+    fclose(file);
+    return count;
+}
+
+/*!
+* \brief Looks up a result in the baseline
+* \return The baseline result, or \c NULL if there is none.
+*/
+static const bench_result_t* bench_find(const bench_result_t *baseline, int count, const char *kernel, int size)
+{
+    int i;
+    for (i = 0; i < count; ++i)
+    {
+        if (baseline[i].size == size && strcmp(baseline[i].kernel, kernel) == 0) return &baseline[i];
+    }
+    return NULL;
+}
+
+/************************************************************************/
+/* Entry point                                                          */
+/************************************************************************/
+
+/*!
+* \brief Parses a comma separated list of sizes
+* \return The number of sizes, or -1 if the list is invalid.
+*/
+static int bench_parse_sizes(const char *list, int *sizes)
+{
+    int count = 0;
+    char *end;
+
+    while (*list != '\0' && count < BENCH_MAX_SIZES)
+    {
+        const long size = strtol(list, &end, 10);
+        if (end == list || size < 1 || size > BENCH_MAX_SIZE) return -1;
+        sizes[count++] = (int)size;
+
+        list = end;
+        if (*list == ',') ++list;
+    }
+
+    return count;
+}
+
+/*!
+* \brief Prints the usage
+*/
+static void bench_usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--out FILE] [--compare BASELINE] [--threshold FRACTION] [--sizes N,N,...] [--min-time MS] [--simd LEVEL]\n", program);
+    fprintf(stderr, "       %s --scenarios [--updates N] [--out FILE] [--simd LEVEL]\n", program);
+}
+
+/**
+* \brief Benchmark entry point
+*/
+int main(int argc, char **argv)
+{
+    static const int default_sizes[] = { 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+    static bench_result_t baseline[BENCH_MAX_RESULTS];
+
+    int sizes[BENCH_MAX_SIZES];
+    int num_sizes = (int)(sizeof(default_sizes) / sizeof(default_sizes[0]));
+    const char *out_path = NULL;
+    const char *compare_path = NULL;
+    double threshold = 0.10;
+    uint64_t min_time_ns = 20000000u;
+    int baseline_count = 0, regressions = 0, run_scenarios = 0;
+    uint_fast32_t updates = 100000;
+    int s, argi;
+    size_t k;
+
+    memcpy(sizes, default_sizes, sizeof(default_sizes));
+
+    for (argi = 1; argi < argc; ++argi)
+    {
+        const char *arg = argv[argi];
+        const char *value = (argi + 1 < argc) ? argv[argi + 1] : NULL;
+
+        if (strcmp(arg, "--scenarios") == 0)
+        {
+            run_scenarios = 1;
+            continue;
+        }
+
+        if (value == NULL)
+        {
+            bench_usage(argv[0]);
+            return 2;
+        }
+
+        if (strcmp(arg, "--out") == 0) out_path = value;
+        else if (strcmp(arg, "--compare") == 0) compare_path = value;
+        else if (strcmp(arg, "--threshold") == 0) threshold = atof(value);
+        else if (strcmp(arg, "--min-time") == 0) min_time_ns = (uint64_t)(atof(value) * 1e6);
+        else if (strcmp(arg, "--updates") == 0) updates = (uint_fast32_t)strtoul(value, NULL, 10);
+        else if (strcmp(arg, "--sizes") == 0)
+        {
+            num_sizes = bench_parse_sizes(value, sizes);
+            if (num_sizes <= 0)
+            {
+                fprintf(stderr, "invalid size list: %s (sizes must be in 1..%d)\n", value, BENCH_MAX_SIZE);
+                return 2;
+            }
+        }
+#if KALMAN_SIMD_TESTING
+        else if (strcmp(arg, "--simd") == 0)
+        {
+            if (matrix_simd_select((matrix_simd_level_t)atoi(value)) != 0)
+            {
+                fprintf(stderr, "SIMD level %s is not supported on this machine\n", value);
+                return 2;
+            }
+        }
+#endif
+        else
+        {
+            bench_usage(argv[0]);
+            return 2;
+        }
+        ++argi;
+    }
+
+    if (compare_path != NULL)
+    {
+        baseline_count = bench_read_baseline(compare_path, baseline, BENCH_MAX_RESULTS);
+        if (baseline_count < 0)
+        {
+            fprintf(stderr, "cannot read baseline %s\n", compare_path);
+            return 2;
+        }
+    }
+
+    FILE *out = stdout;
+    if (out_path != NULL)
+    {
+        out = fopen(out_path, "w");
+        if (out == NULL)
+        {
+            fprintf(stderr, "cannot write %s\n", out_path);
+            return 2;
+        }
+    }
+
+    if (run_scenarios)
+    {
+        const int status = (updates > 0) ? kalman_bench_scenarios(out, updates) : 2;
+        if (out != stdout) fclose(out);
+        return status;
+    }
+
+    fprintf(out, "{\n  \"simd_level\": %d,\n  \"results\": [\n", (int)matrix_simd_get_level());
+
+    for (k = 0; k < BENCH_NUM_KERNELS; ++k)
+    {
+        for (s = 0; s < num_sizes; ++s)
+        {
+            bench_operands_t ops;
+            bench_result_t result;
+
+            bench_prepare(&ops, (matrix_index_t)sizes[s]);
+            bench_time_kernel(&kernels[k], &ops, min_time_ns, &result);
+
+            const int last = (k + 1 == BENCH_NUM_KERNELS) && (s + 1 == num_sizes);
+            fprintf(out, "    {\"kernel\": \"%s\", \"size\": %d, \"ns_per_op\": %.3f, \"gflops\": %.4f, \"cycles_per_op\": %.1f}%s\n",
+                    kernels[k].name, sizes[s], result.ns_per_op, result.gflops, result.cycles_per_op, last ? "" : ",");
+
+            // flag regressions against the baseline
+            const bench_result_t *reference = bench_find(baseline, baseline_count, kernels[k].name, sizes[s]);
+            if (reference != NULL && result.ns_per_op > reference->ns_per_op * (1.0 + threshold))
+            {
+                fprintf(stderr, "REGRESSION %s size %d: %.3f ns -> %.3f ns (%+.1f%%)\n",
+                        kernels[k].name, sizes[s], reference->ns_per_op, result.ns_per_op,
+                        100.0 * (result.ns_per_op / reference->ns_per_op - 1.0));
+                ++regressions;
+            }
+        }
+    }
+
+    fprintf(out, "  ]\n}\n");
+    if (out != stdout) fclose(out);
+
+    if (compare_path != NULL)
+    {
+        fprintf(stderr, "%d regression(s) beyond %.1f%% against %s\n", regressions, 100.0 * threshold, compare_path);
+    }
+
+    return regressions > 0 ? 1 : 0;
+}
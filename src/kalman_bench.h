@@ -0,0 +1,55 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef KALMAN_BENCH_H_
+#define KALMAN_BENCH_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define KALMAN_BENCH_HAS_TSC 1
+#else
+#define KALMAN_BENCH_HAS_TSC 0
+#endif
+
+/*!
+* \brief Gets a monotonic timestamp.
+* \return The timestamp in nanoseconds.
+*/
+static inline uint64_t kalman_bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/*!
+* \brief Reads the CPU's cycle counter.
+* \return The cycle count, or zero where no cycle counter is available.
+*
+* On x86 this is the time stamp counter, which ticks at the nominal rather than the boosted clock.
+*/
+static inline uint64_t kalman_bench_cycles(void)
+{
+#if KALMAN_BENCH_HAS_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/*!
+* \brief Runs the end-to-end scenarios and writes their results as JSON
+* \param[in] out The output file
+* \param[in] updates The number of timed updates per scenario
+* \return Zero in case of success, nonzero if the latency buffer could not be allocated.
+*/
+int kalman_bench_scenarios(FILE *out, uint_fast32_t updates);
+
+#endif
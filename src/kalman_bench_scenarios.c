@@ -0,0 +1,581 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+/*!
+* \brief End-to-end benchmark scenarios
+*
+* Every scenario is a complete filter built with the factory headers, just like kalman_example_gravity.c,
+* and one update is a call to {\ref kalman_predict} followed by {\ref kalman_correct}:
+*
+* - \c scalar: 1-state random walk smoother with a scalar measurement
+* - \c cv_tracker: 6-state constant-velocity tracker (3D position and velocity) measuring position
+* - \c ins_error_state: 15-state INS error-state filter (position, velocity, attitude, accelerometer and
+*   gyroscope biases) aided by a 6-output GNSS position/velocity fix
+* - \c fusion: 30-state model of five constant-velocity targets, alternately corrected by a 15-output
+*   position sensor and a 15-output velocity sensor
+* - \c cv_tracker_batch: {\ref KALMAN_BATCH_LANES} copies of the constant-velocity tracker in one lane-interleaved
+*   batch (kalman_batch.h); one batch update advances every lane, and the updates/s count filter updates
+*/
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define EXTERN_INLINE_MATRIX static INLINE
+#define EXTERN_INLINE_KALMAN static INLINE
+#include "kalman.h"
+#include "kalman_batch.h"
+#include "kalman_bench.h"
+
+/*!
+* \brief Time step of all scenarios
+*/
+#define BENCH_DT        ((matrix_data_t)0.01)
+
+/*!
+* \brief Number of untimed updates before measuring
+*/
+#define BENCH_WARMUP    (1000)
+
+/************************************************************************/
+/* Filters                                                              */
+/************************************************************************/
+
+// 1-state scalar smoother
+#define KALMAN_NAME scalar
+#define KALMAN_NUM_STATES 1
+#define KALMAN_NUM_INPUTS 1
+#include "kalman_factory_filter.h"
+
+#define KALMAN_MEASUREMENT_NAME value
+#define KALMAN_NUM_MEASUREMENTS 1
+#include "kalman_factory_measurement.h"
+
+#include "kalman_factory_cleanup.h"
+
+// 6-state constant-velocity tracker
+#define KALMAN_NAME cv
+#define KALMAN_NUM_STATES 6
+#define KALMAN_NUM_INPUTS 3
+#include "kalman_factory_filter.h"
+
+#define KALMAN_MEASUREMENT_NAME position
+#define KALMAN_NUM_MEASUREMENTS 3
+#include "kalman_factory_measurement.h"
+
+#include "kalman_factory_cleanup.h"
+
+// 15-state INS error-state filter
+#define KALMAN_NAME ins
+#define KALMAN_NUM_STATES 15
+#define KALMAN_NUM_INPUTS 12
+#include "kalman_factory_filter.h"
+
+#define KALMAN_MEASUREMENT_NAME gnss
+#define KALMAN_NUM_MEASUREMENTS 6
+#include "kalman_factory_measurement.h"
+
+#include "kalman_factory_cleanup.h"
+
+// 30-state multi-sensor fusion
+#define KALMAN_NAME fusion
+#define KALMAN_NUM_STATES 30
+#define KALMAN_NUM_INPUTS 15
+#include "kalman_factory_filter.h"
+
+#define KALMAN_MEASUREMENT_NAME position
+#define KALMAN_NUM_MEASUREMENTS 15
+#include "kalman_factory_measurement.h"
+
+#define KALMAN_MEASUREMENT_NAME velocity
+#define KALMAN_NUM_MEASUREMENTS 15
+#include "kalman_factory_measurement.h"
+
+#include "kalman_factory_cleanup.h"
+
+/************************************************************************/
+/* Model setup                                                          */
+/************************************************************************/
+
+/*!
+* \brief Sets a square matrix to a scaled identity
+*/
+static void bench_set_diagonal(matrix_t *mat, matrix_data_t value)
+{
+    uint_fast8_t i, j;
+    for (i = 0; i < mat->rows; ++i)
+    {
+        for (j = 0; j < mat->cols; ++j)
+        {
+            matrix_set(mat, i, j, (i == j) ? value : 0);
+        }
+    }
+}
+
+/*!
+* \brief Sets up \c count constant-velocity axes starting at state \c first
+*
+* Every axis \c k has its position at state <tt>first + k</tt> and its velocity at state <tt>first + count + k</tt>
+* within a block of \c 2*count states and is driven by the acceleration input <tt>input + k</tt>.
+*/
+static void bench_setup_cv(kalman_t *kf, uint_fast8_t first, uint_fast8_t count, uint_fast8_t input)
+{
+    uint_fast8_t k;
+    for (k = 0; k < count; ++k)
+    {
+        const uint_fast8_t p = first + k;
+        const uint_fast8_t v = first + count + k;
+
+        matrix_set(&kf->A, p, v, BENCH_DT);
+        matrix_set(&kf->B, p, input + k, (matrix_data_t)0.5 * BENCH_DT * BENCH_DT);
+        matrix_set(&kf->B, v, input + k, BENCH_DT);
+    }
+}
+
+/*!
+* \brief Sets up the scalar smoother
+*/
+static void bench_init_scalar()
+{
+    kalman_t *kf = kalman_filter_scalar_init();
+    kalman_measurement_t *kfm = kalman_filter_scalar_measurement_value_init();
+
+    bench_set_diagonal(&kf->A, 1);
+    bench_set_diagonal(&kf->P, 1);
+    matrix_set(&kf->B, 0, 0, 1);
+    bench_set_diagonal(&kf->Q, (matrix_data_t)0.01);
+
+    matrix_set(&kfm->H, 0, 0, 1);
+    bench_set_diagonal(&kfm->R, 1);
+}
+
+/*!
+* \brief Sets up the constant-velocity tracker
+*/
+static void bench_init_cv()
+{
+    uint_fast8_t k;
+    kalman_t *kf = kalman_filter_cv_init();
+    kalman_measurement_t *kfm = kalman_filter_cv_measurement_position_init();
+
+    bench_set_diagonal(&kf->A, 1);
+    bench_set_diagonal(&kf->P, 10);
+    bench_setup_cv(kf, 0, 3, 0);
+    bench_set_diagonal(&kf->Q, 1);
+
+    for (k = 0; k < 3; ++k)
+    {
+        matrix_set(&kfm->H, k, k, 1);
+    }
+    bench_set_diagonal(&kfm->R, (matrix_data_t)0.25);
+}
+
+/*!
+* \brief Sets up the INS error-state filter
+*
+* States: position (0..2), velocity (3..5), attitude (6..8), accelerometer bias (9..11), gyroscope bias (12..14).
+* Inputs: accelerometer noise, gyroscope noise, accelerometer bias walk, gyroscope bias walk (three each).
+*/
+static void bench_init_ins()
+{
+    uint_fast8_t k;
+    kalman_t *kf = kalman_filter_ins_init();
+    kalman_measurement_t *kfm = kalman_filter_ins_measurement_gnss_init();
+
+    // specific force in the navigation frame, mostly gravity
+    const matrix_data_t f[3] = { (matrix_data_t)0.1, (matrix_data_t)-0.2, (matrix_data_t)-9.81 };
+
+    bench_set_diagonal(&kf->A, 1);
+    bench_set_diagonal(&kf->P, 1);
+    for (k = 0; k < 3; ++k)
+    {
+        const uint_fast8_t k1 = (k + 1) % 3;
+        const uint_fast8_t k2 = (k + 2) % 3;
+
+        // position integrates velocity
+        matrix_set(&kf->A, k, 3 + k, BENCH_DT);
+
+        // velocity error from attitude error (-[f x] phi) and accelerometer bias
+        matrix_set(&kf->A, 3 + k, 6 + k1, f[k2] * BENCH_DT);
+        matrix_set(&kf->A, 3 + k, 6 + k2, -f[k1] * BENCH_DT);
+        matrix_set(&kf->A, 3 + k, 9 + k, -BENCH_DT);
+
+        // attitude error from gyroscope bias
+        matrix_set(&kf->A, 6 + k, 12 + k, -BENCH_DT);
+
+        // noise inputs
+        matrix_set(&kf->B, 3 + k, k, BENCH_DT);
+        matrix_set(&kf->B, 6 + k, 3 + k, BENCH_DT);
+        matrix_set(&kf->B, 9 + k, 6 + k, BENCH_DT);
+        matrix_set(&kf->B, 12 + k, 9 + k, BENCH_DT);
+
+        // GNSS position and velocity
+        matrix_set(&kfm->H, k, k, 1);
+        matrix_set(&kfm->H, 3 + k, 3 + k, 1);
+    }
+
+    bench_set_diagonal(&kf->Q, (matrix_data_t)0.01);
+    bench_set_diagonal(&kfm->R, 1);
+}
+
+/*!
+* \brief Sets up the multi-sensor fusion model
+*
+* Five targets with three axes each: positions are states 0..14, velocities are states 15..29.
+*/
+static void bench_init_fusion()
+{
+    uint_fast8_t k;
+    kalman_t *kf = kalman_filter_fusion_init();
+    kalman_measurement_t *kfm_position = kalman_filter_fusion_measurement_position_init();
+    kalman_measurement_t *kfm_velocity = kalman_filter_fusion_measurement_velocity_init();
+
+    bench_set_diagonal(&kf->A, 1);
+    bench_set_diagonal(&kf->P, 10);
+    bench_setup_cv(kf, 0, 15, 0);
+    bench_set_diagonal(&kf->Q, 1);
+
+    for (k = 0; k < 15; ++k)
+    {
+        matrix_set(&kfm_position->H, k, k, 1);
+        matrix_set(&kfm_velocity->H, k, 15 + k, 1);
+    }
+    bench_set_diagonal(&kfm_position->R, (matrix_data_t)0.25);
+    bench_set_diagonal(&kfm_velocity->R, (matrix_data_t)0.5);
+}
+
+/************************************************************************/
+/* Scenarios                                                            */
+/************************************************************************/
+
+/*!
+* \brief A benchmark scenario
+*/
+typedef struct
+{
+    /*!
+    * \brief The name as reported in the results
+    */
+    const char *name;
+
+    /*!
+    * \brief Sets up the filter and its measurements
+    */
+    void (*init)();
+
+    /*!
+    * \brief The filter
+    */
+    kalman_t *kf;
+
+    /*!
+    * \brief The measurements, used round robin
+    */
+    kalman_measurement_t *kfm[2];
+
+    /*!
+    * \brief The number of measurements
+    */
+    uint_fast8_t num_measurements;
+} bench_scenario_t;
+
+static const bench_scenario_t scenarios[] = {
+    { "scalar",             bench_init_scalar,  &kalman_filter_scalar,  { &kalman_filter_scalar_measurement_value },   1 },
+    { "cv_tracker",         bench_init_cv,      &kalman_filter_cv,      { &kalman_filter_cv_measurement_position },    1 },
+    { "ins_error_state",    bench_init_ins,     &kalman_filter_ins,     { &kalman_filter_ins_measurement_gnss },       1 },
+    { "fusion",             bench_init_fusion,  &kalman_filter_fusion,  { &kalman_filter_fusion_measurement_position,
+                                                                          &kalman_filter_fusion_measurement_velocity }, 2 },
+};
+
+#define BENCH_NUM_SCENARIOS     (sizeof(scenarios) / sizeof(scenarios[0]))
+
+/*!
+* \brief The scenario the batch runs copies of and is compared to
+*/
+#define BENCH_BATCH_SCENARIO    (1)
+
+/*!
+* \brief The backing buffer of the batch scenario
+*/
+static kalman_batch_lane_t bench_batch_buffer[KALMAN_BATCH_BUFFER_SIZE(6, 3, 3)];
+
+/*!
+* \brief Gets the number of elements of a matrix
+*/
+static uint_fast32_t bench_elements(const matrix_t *mat)
+{
+    return (uint_fast32_t)mat->rows * mat->cols;
+}
+
+/*!
+* \brief Determines the number of bytes read or written by one update
+* \param[in] scenario The scenario
+* \return The size of all matrices the filter and the average measurement touch, including temporaries.
+*
+* Temporaries that share a backing field are counted once.
+*/
+static double bench_bytes_touched(const bench_scenario_t *scenario)
+{
+    const kalman_t *kf = scenario->kf;
+    uint_fast32_t filter, measurements = 0;
+    uint_fast8_t i;
+
+    const uint_fast32_t temp_P = bench_elements(&kf->temporary.P);
+    const uint_fast32_t temp_BQ = bench_elements(&kf->temporary.BQ);
+
+    filter = bench_elements(&kf->x) + bench_elements(&kf->A) + bench_elements(&kf->P)
+           + bench_elements(&kf->u) + bench_elements(&kf->B) + bench_elements(&kf->Q)
+           + bench_elements(&kf->temporary.predicted_x)
+           + (temp_P > temp_BQ ? temp_P : temp_BQ);
+
+    for (i = 0; i < scenario->num_measurements; ++i)
+    {
+        const kalman_measurement_t *kfm = scenario->kfm[i];
+        measurements += bench_elements(&kfm->z) + bench_elements(&kfm->H) + bench_elements(&kfm->R)
+                      + bench_elements(&kfm->y) + bench_elements(&kfm->S) + bench_elements(&kfm->K)
+                      + bench_elements(&kfm->temporary.HP);
+    }
+
+    return (double)sizeof(matrix_data_t) * ((double)filter + (double)measurements / scenario->num_measurements);
+}
+
+/*!
+* \brief Generates a pseudo-random measurement value in [-1, 1)
+*/
+static matrix_data_t bench_noise(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (matrix_data_t)(*state >> 8) / (matrix_data_t)(1u << 23) - 1;
+}
+
+/*!
+* \brief Performs one update of a scenario
+*/
+static void bench_update(const bench_scenario_t *scenario, kalman_measurement_t *kfm)
+{
+    kalman_predict(scenario->kf);
+    kalman_correct(scenario->kf, kfm);
+}
+
+/*!
+* \brief Fills the measurement vector
+*/
+static void bench_measure(kalman_measurement_t *kfm, uint32_t *seed)
+{
+    uint_fast8_t j;
+    for (j = 0; j < kfm->z.rows; ++j)
+    {
+        kfm->z.data[j] = bench_noise(seed);
+    }
+}
+
+/*!
+* \brief Compares two latencies for qsort
+*/
+static int bench_compare_latency(const void *a, const void *b)
+{
+    const uint32_t la = *(const uint32_t*)a;
+    const uint32_t lb = *(const uint32_t*)b;
+    return (la > lb) - (la < lb);
+}
+
+/*!
+* \brief Gets a percentile of sorted latencies
+*/
+static uint32_t bench_percentile(const uint32_t *sorted, uint_fast32_t count, double percentile)
+{
+    uint_fast32_t index = (uint_fast32_t)(percentile * (double)(count - 1) + 0.5);
+    return sorted[index];
+}
+
+/*!
+* \brief Fills the measurement vectors of all lanes of a batch
+*/
+static void bench_measure_batch(kalman_batch_t *batch, uint32_t *seed)
+{
+    matrix_index_t j, lane;
+    for (j = 0; j < batch->num_measurements; ++j)
+    {
+        for (lane = 0; lane < KALMAN_BATCH_LANES; ++lane)
+        {
+            kalman_batch_set(&batch->z, j, 0, lane, bench_noise(seed));
+        }
+    }
+}
+
+/*!
+* \brief Performs one update of all lanes of a batch
+*/
+static void bench_update_batch(kalman_batch_t *batch)
+{
+    kalman_batch_predict(batch);
+    kalman_batch_correct(batch);
+}
+
+/*!
+* \brief Runs the batch scenario and writes its result as JSON
+* \param[in] out The output file
+* \param[in] updates The number of timed batch updates
+* \param[in] latencies The buffer of \c updates latency samples
+* \param[in] overhead The overhead of reading the clock
+* \param[in] scalar_rate The updates/s of the same filter run on its own
+*/
+static void bench_run_batch(FILE *out, uint_fast32_t updates, uint32_t *latencies, uint64_t overhead, double scalar_rate)
+{
+    const bench_scenario_t *scenario = &scenarios[BENCH_BATCH_SCENARIO];
+    kalman_batch_t batch;
+    uint32_t seed = 42;
+    uint_fast32_t i;
+    matrix_index_t lane;
+
+    // every lane starts from the freshly set up filter
+    scenario->init();
+    kalman_batch_initialize(&batch, scenario->kf->x.rows, scenario->kf->B.cols, scenario->kfm[0]->z.rows, bench_batch_buffer);
+    for (lane = 0; lane < KALMAN_BATCH_LANES; ++lane)
+    {
+        kalman_batch_load(&batch, lane, scenario->kf, scenario->kfm[0]);
+    }
+
+    for (i = 0; i < BENCH_WARMUP; ++i)
+    {
+        bench_measure_batch(&batch, &seed);
+        bench_update_batch(&batch);
+    }
+
+    // throughput, without per-update timing
+    const uint64_t start = kalman_bench_now_ns();
+    for (i = 0; i < updates; ++i)
+    {
+        bench_measure_batch(&batch, &seed);
+        bench_update_batch(&batch);
+    }
+    const uint64_t elapsed = kalman_bench_now_ns() - start;
+
+    // latency distribution of a whole batch update
+    for (i = 0; i < updates; ++i)
+    {
+        bench_measure_batch(&batch, &seed);
+
+        const uint64_t update_start = kalman_bench_now_ns();
+        bench_update_batch(&batch);
+        const uint64_t update_elapsed = kalman_bench_now_ns() - update_start;
+
+        latencies[i] = (uint32_t)(update_elapsed > overhead ? update_elapsed - overhead : 0);
+    }
+    qsort(latencies, updates, sizeof(uint32_t), bench_compare_latency);
+
+    // single-threaded like the other scenarios, so the rate is per core
+    const double rate = (double)updates * KALMAN_BATCH_LANES * 1e9 / (double)elapsed;
+    fprintf(out, "    {\"scenario\": \"%s_batch\", \"states\": %d, \"lanes\": %d, \"updates_per_second\": %.0f, \"speedup_vs_scalar\": %.2f, \"p50_ns\": %u, \"p99_ns\": %u, \"p999_ns\": %u}\n",
+            scenario->name, (int)batch.num_states, (int)KALMAN_BATCH_LANES, rate, rate / scalar_rate,
+            (unsigned)bench_percentile(latencies, updates, 0.50),
+            (unsigned)bench_percentile(latencies, updates, 0.99),
+            (unsigned)bench_percentile(latencies, updates, 0.999));
+}
+
+/*!
+* \brief Runs all scenarios and writes their results as JSON
+* \param[in] out The output file
+* \param[in] updates The number of timed updates per scenario
+* \return Zero in case of success, nonzero if the latency buffer could not be allocated.
+*/
+int kalman_bench_scenarios(FILE *out, uint_fast32_t updates)
+{
+    uint_fast32_t i;
+    size_t s;
+    double batch_reference_rate = 0;
+
+    uint32_t *latencies = (uint32_t*)malloc(sizeof(uint32_t) * updates);
+    if (latencies == NULL) return 1;
+
+    // the overhead of reading the clock is subtracted from every latency sample
+    uint64_t overhead = UINT64_MAX;
+    for (i = 0; i < 1000; ++i)
+    {
+        const uint64_t start = kalman_bench_now_ns();
+        const uint64_t elapsed = kalman_bench_now_ns() - start;
+        if (elapsed < overhead) overhead = elapsed;
+    }
+
+    fprintf(out, "{\n  \"scenarios\": [\n");
+
+    for (s = 0; s < BENCH_NUM_SCENARIOS; ++s)
+    {
+        const bench_scenario_t *scenario = &scenarios[s];
+        uint32_t seed = 42;
+
+        scenario->init();
+        for (i = 0; i < BENCH_WARMUP; ++i)
+        {
+            kalman_measurement_t *kfm = scenario->kfm[i % scenario->num_measurements];
+            bench_measure(kfm, &seed);
+            bench_update(scenario, kfm);
+        }
+
+        // throughput, without per-update timing
+        const uint64_t start = kalman_bench_now_ns();
+        for (i = 0; i < updates; ++i)
+        {
+            kalman_measurement_t *kfm = scenario->kfm[i % scenario->num_measurements];
+            bench_measure(kfm, &seed);
+            bench_update(scenario, kfm);
+        }
+        const uint64_t elapsed = kalman_bench_now_ns() - start;
+        if (s == BENCH_BATCH_SCENARIO)
+        {
+            batch_reference_rate = (double)updates * 1e9 / (double)elapsed;
+        }
+
+        // latency distribution
+        for (i = 0; i < updates; ++i)
+        {
+            kalman_measurement_t *kfm = scenario->kfm[i % scenario->num_measurements];
+            bench_measure(kfm, &seed);
+
+            const uint64_t update_start = kalman_bench_now_ns();
+            bench_update(scenario, kfm);
+            const uint64_t update_elapsed = kalman_bench_now_ns() - update_start;
+
+            latencies[i] = (uint32_t)(update_elapsed > overhead ? update_elapsed - overhead : 0);
+        }
+        qsort(latencies, updates, sizeof(uint32_t), bench_compare_latency);
+
+        fprintf(out, "    {\"scenario\": \"%s\", \"states\": %d, \"updates_per_second\": %.0f, \"p50_ns\": %u, \"p99_ns\": %u, \"p999_ns\": %u, \"bytes_touched\": %.0f",
+                scenario->name, (int)scenario->kf->x.rows,
+                (double)updates * 1e9 / (double)elapsed,
+                (unsigned)bench_percentile(latencies, updates, 0.50),
+                (unsigned)bench_percentile(latencies, updates, 0.99),
+                (unsigned)bench_percentile(latencies, updates, 0.999),
+                bench_bytes_touched(scenario));
+
+#if KALMAN_PROFILE
+        // average ticks per call of every stage, accumulated over all runs of the scenario
+        {
+            kalman_stats_t stats;
+            int stage;
+
+            kalman_get_stats(scenario->kf, &stats);
+            fprintf(out, ", \"stage_ticks\": {");
+            for (stage = 0; stage < KALMAN_STAGE_COUNT; ++stage)
+            {
+                const double ticks = stats.calls[stage] ? (double)stats.ticks[stage] / (double)stats.calls[stage] : 0;
+                fprintf(out, "%s\"%s\": %.1f", stage ? ", " : "", kalman_profile_stage_name((kalman_stage_t)stage), ticks);
+            }
+            fprintf(out, "}");
+        }
+#endif
+
+        fprintf(out, "},\n");
+    }
+
+    bench_run_batch(out, updates, latencies, overhead, batch_reference_rate);
+
+    fprintf(out, "  ]\n}\n");
+
+    free(latencies);
+    return 0;
+}
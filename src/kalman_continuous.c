@@ -0,0 +1,355 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#include <stdint.h>
+#include <assert.h>
+#include <math.h>
+
+#define EXTERN_INLINE_MATRIX static INLINE
+#define EXTERN_INLINE_KALMAN static INLINE
+#include "kalman.h"
+#include "kalman_continuous.h"
+
+/*!
+* \brief Attaches a continuous-time model to a filter
+* \param[in] kf The Kalman Filter structure; its B and Q are G and Qc of the model.
+* \param[in] ct The model to initialize; F starts as zero. \c NULL detaches the current one.
+* \param[in] resolution The resolution time steps are rounded to
+* \param[in] buffer The buffer of {\ref KALMAN_CONTINUOUS_SIZE} elements
+* \param[in] size The number of elements of the buffer
+*/
+void kalman_continuous_init(kalman_t *kf, kalman_continuous_t *ct, matrix_data_t resolution, matrix_data_t *buffer, size_t size)
+{
+    if (ct == 0)
+    {
+        kf->cache.continuous = 0;
+        return;
+    }
+
+    const matrix_index_t n = kf->A.rows;
+    const matrix_index_t i = kf->B.cols;
+    const int packed = matrix_is_packed(&kf->P);
+
+    assert(buffer != 0 && size >= KALMAN_CONTINUOUS_SIZE(n, i));
+    assert(resolution > 0);
+    assert((matrix_index_t)(2 * n) == 2 * (size_t)n);
+
+    matrix_init(&ct->F, n, n, buffer);
+    for (size_t index = 0; index < (size_t)n * n; ++index)
+    {
+        buffer[index] = 0;
+    }
+    buffer += (size_t)n * n;
+    ct->resolution = resolution;
+
+    for (uint_fast8_t index = 0; index < KALMAN_CONTINUOUS_SLOTS; ++index)
+    {
+        kalman_continuous_slot_t *const slot = &ct->slots[index];
+        slot->ticks = 0;
+        slot->model_version = 0;
+        slot->last_used = 0;
+
+        matrix_init(&slot->A, n, n, buffer);
+        if (packed)
+        {
+            matrix_init_packed(&slot->Q, n, buffer + (size_t)n * n);
+        }
+        else
+        {
+            matrix_init(&slot->Q, n, n, buffer + (size_t)n * n);
+        }
+        buffer += 2 * (size_t)n * n;
+    }
+
+    for (uint_fast8_t index = 0; index < 3; ++index)
+    {
+        matrix_init(&ct->temporary[index], 2 * n, 2 * n, buffer);
+        buffer += 4 * (size_t)n * n;
+    }
+    matrix_init(&ct->temp, n, n, buffer);
+    buffer += (size_t)n * ((n > i) ? n : i);
+    ct->aux = buffer;
+    buffer += 2 * (size_t)n;
+    matrix_init(&ct->x, n, 1, buffer);
+
+    ct->clock = 0;
+    ct->hits = 0;
+    ct->misses = 0;
+
+    kf->cache.continuous = ct;
+}
+
+/*!
+* \brief Sets an element of the continuous-time system matrix F
+* \param[in] kf The Kalman Filter structure with a continuous-time model
+* \param[in] row The row
+* \param[in] column The column
+* \param[in] value The value
+*/
+void kalman_set_continuous_transition(kalman_t *kf, matrix_index_t row, matrix_index_t column, matrix_data_t value)
+{
+    assert(kf->cache.continuous != 0);
+
+    kalman_model_changed(kf);
+    matrix_set(&kf->cache.continuous->F, row, column, value);
+}
+
+/*!
+* \brief Calculates the matrix exponential by scaling and squaring a truncated Taylor series
+* \param[in] ct The model providing the temporaries; the argument is in its first temporary and is destroyed.
+* \return The temporary holding the exponential.
+*
+* The infinity norm of the argument must be at most 2^({\ref KALMAN_CONTINUOUS_MAX_SQUARINGS} - 1).
+*/
+static matrix_t* kalman_continuous_expm(kalman_continuous_t *ct)
+{
+    matrix_t *RESTRICT const M = &ct->temporary[0];
+    matrix_t *RESTRICT E = &ct->temporary[1];
+    matrix_t *RESTRICT T = &ct->temporary[2];
+    const matrix_index_t size = M->rows;
+
+    // scale M by 2^-s until its infinity norm is at most 1/2
+    matrix_data_t norm = 0;
+    for (matrix_index_t row = 0; row < size; ++row)
+    {
+        matrix_data_t sum = 0;
+        for (matrix_index_t column = 0; column < size; ++column)
+        {
+            sum += (matrix_data_t)fabs(matrix_get(M, row, column));
+        }
+        norm = (sum > norm) ? sum : norm;
+    }
+
+    const size_t count = (size_t)size * size;
+
+    // the number of squarings is bounded; a larger, infinite or NaN norm is not scaled down far enough
+    uint_fast8_t squarings = 0;
+    matrix_data_t scale = 1;
+    while (norm > (matrix_data_t)0.5 && squarings < KALMAN_CONTINUOUS_MAX_SQUARINGS)
+    {
+        norm *= (matrix_data_t)0.5;
+        scale *= (matrix_data_t)0.5;
+        ++squarings;
+    }
+    assert(norm <= (matrix_data_t)0.5);
+
+    for (size_t index = 0; index < count; ++index)
+    {
+        M->data[index] *= scale;
+    }
+
+    // T = I + M/1*(I + M/2*(... (I + M/q)))
+    for (size_t index = 0; index < count; ++index)
+    {
+        T->data[index] = 0;
+    }
+    for (matrix_index_t row = 0; row < size; ++row)
+    {
+        matrix_set(T, row, row, 1);
+    }
+
+    for (uint_fast8_t order = KALMAN_CONTINUOUS_TAYLOR_ORDER; order > 0; --order)
+    {
+        matrix_mult(M, T, E, ct->aux);                      // E = M*T
+
+        const matrix_data_t factor = (matrix_data_t)1 / (matrix_data_t)order;
+        for (size_t index = 0; index < count; ++index)
+        {
+            E->data[index] *= factor;
+        }
+        for (matrix_index_t row = 0; row < size; ++row)
+        {
+            matrix_set(E, row, row, matrix_get(E, row, row) + 1);
+        }
+
+        matrix_t *const swap = T; T = E; E = swap;
+    }
+
+    // e^M = (e^(M*2^-s))^(2^s)
+    for (; squarings > 0; --squarings)
+    {
+        matrix_mult(T, T, E, ct->aux);                      // E = T*T
+        matrix_t *const swap = T; T = E; E = swap;
+    }
+
+    return T;
+}
+
+/*!
+* \brief Discretizes the model for a time step by Van Loan's method
+* \param[in] kf The Kalman Filter structure
+* \param[in] ct The model
+* \param[in] slot The slot to calculate
+* \param[in] dt The time step
+*/
+static void kalman_continuous_discretize(const kalman_t *kf, kalman_continuous_t *ct, kalman_continuous_slot_t *slot, matrix_data_t dt)
+{
+    const matrix_index_t n = kf->A.rows;
+    const matrix_index_t i = kf->B.cols;
+    matrix_t *RESTRICT const M = &ct->temporary[0];
+    const matrix_t *const F = &ct->F;
+
+    /************************************************************************/
+    /* Van Loan matrix                                                      */
+    /* M = [-F G*Qc*G'; 0 F']*dt                                            */
+    /************************************************************************/
+
+    for (size_t index = 0; index < 4 * (size_t)n * n; ++index)
+    {
+        M->data[index] = 0;
+    }
+
+    matrix_t block;
+    matrix_view_submatrix(M, 0, n, n, n, &block);
+    if (i > 0)
+    {
+        matrix_t BQ;
+        matrix_init(&BQ, n, i, ct->temp.data);
+        matrix_mult(&kf->B, &kf->Q, &BQ, ct->aux);          // temp = G*Qc, Qc may be packed
+        matrix_mult_transb(&BQ, &kf->B, &block);            // block = temp*G'
+    }
+
+    for (matrix_index_t row = 0; row < n; ++row)
+    {
+        for (matrix_index_t column = 0; column < n; ++column)
+        {
+            const matrix_data_t f = matrix_get(F, row, column) * dt;
+            matrix_set(M, row, column, -f);
+            matrix_set(M, n + column, n + row, f);
+            matrix_set(&block, row, column, matrix_get(&block, row, column) * dt);
+        }
+    }
+
+    /************************************************************************/
+    /* e^M = [* A^-1*Qd; 0 A']                                              */
+    /************************************************************************/
+
+    const matrix_t *const E = kalman_continuous_expm(ct);
+
+    // A = (A')'
+    for (matrix_index_t row = 0; row < n; ++row)
+    {
+        for (matrix_index_t column = 0; column < n; ++column)
+        {
+            matrix_set(&slot->A, row, column, matrix_get(E, n + column, n + row));
+        }
+    }
+
+    // Qd = A*(A^-1*Qd), symmetrized
+    for (matrix_index_t row = 0; row < n; ++row)
+    {
+        for (matrix_index_t column = row; column < n; ++column)
+        {
+            matrix_data_t upper = 0, lower = 0;
+            for (matrix_index_t k = 0; k < n; ++k)
+            {
+                upper += matrix_get(&slot->A, row, k) * matrix_get(E, k, n + column);
+                lower += matrix_get(&slot->A, column, k) * matrix_get(E, k, n + row);
+            }
+            matrix_set_symmetric(&slot->Q, row, column, (matrix_data_t)0.5 * (upper + lower));
+        }
+    }
+
+    slot->model_version = kf->model_version;
+}
+
+/*!
+* \brief Finds the discretization of a quantized time step, calculating it in the least recently used slot if needed
+* \param[in] kf The Kalman Filter structure
+* \param[in] ct The model
+* \param[in] ticks The time step in multiples of the resolution
+* \return The slot
+*/
+static const kalman_continuous_slot_t* kalman_continuous_lookup(const kalman_t *kf, kalman_continuous_t *ct, uint_fast32_t ticks)
+{
+    kalman_continuous_slot_t *victim = &ct->slots[0];
+    ++ct->clock;
+
+    for (uint_fast8_t index = 0; index < KALMAN_CONTINUOUS_SLOTS; ++index)
+    {
+        kalman_continuous_slot_t *const slot = &ct->slots[index];
+        if (slot->ticks == ticks && slot->model_version == kf->model_version)
+        {
+            ++ct->hits;
+            slot->last_used = ct->clock;
+            return slot;
+        }
+
+        // empty slots go first, then the least recently used one
+        if (victim->ticks != 0 && (slot->ticks == 0 || slot->last_used < victim->last_used))
+        {
+            victim = slot;
+        }
+    }
+
+    ++ct->misses;
+    kalman_continuous_discretize(kf, ct, victim, (matrix_data_t)ticks * ct->resolution);
+    victim->ticks = ticks;
+    victim->last_used = ct->clock;
+    return victim;
+}
+
+/*!
+* \brief Performs the time update / prediction step over a time step of the continuous-time model
+* \param[in] kf The Kalman Filter structure with a continuous-time model
+* \param[in] dt The time step, rounded to the resolution of the model
+*/
+void kalman_predict_dt(kalman_t *kf, matrix_data_t dt)
+{
+    kalman_continuous_t *const ct = kf->cache.continuous;
+    assert(ct != 0);
+    assert(dt >= 0);
+
+    // the conversion is undefined for quotients out of range, including infinite ones
+    const matrix_data_t quotient = dt / ct->resolution + (matrix_data_t)0.5;
+    assert(isfinite(quotient) && quotient < (matrix_data_t)UINT32_MAX);
+
+    const uint_fast32_t ticks = (uint_fast32_t)quotient;
+    if (ticks == 0)
+    {
+        return;
+    }
+
+    // a gain converged for the discrete model does not hold for the time step; the deferred and skipped propagations used the discrete model
+    kf->flags &= (uint_fast8_t)~KALMAN_FLAG_STEADY_STATE;
+    if (kf->pending != 0)
+    {
+        kalman_flush_covariance(kf);
+    }
+
+    const kalman_continuous_slot_t *const slot = kalman_continuous_lookup(kf, ct, ticks);
+    matrix_t *RESTRICT const P = &kf->P;
+
+    /************************************************************************/
+    /* Predict next state using the discretized dynamics                    */
+    /* x = A*x                                                              */
+    /************************************************************************/
+
+    KALMAN_PROFILE_BEGIN();
+
+    matrix_mult_rowvector(&slot->A, &kf->x, &ct->x);
+    matrix_copy(&ct->x, &kf->x);
+
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_PREDICT_X);
+
+    /************************************************************************/
+    /* Predict next covariance using the discretized dynamics and noise     */
+    /* P = A*P*A' + Qd                                                      */
+    /************************************************************************/
+
+    matrix_mult(&slot->A, P, &ct->temp, ct->aux);          // temp = A*P, P may be packed
+    if (matrix_is_packed(P))
+    {
+        matrix_mult_transb_packed(&ct->temp, &slot->A, P);      // P = temp*A'
+    }
+    else
+    {
+        matrix_mult_transb_symmetric(&ct->temp, &slot->A, P);   // P = temp*A'
+    }
+    matrix_add_inplace(P, &slot->Q);                        // P += Qd, both stored alike
+
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_PREDICT_Q);
+}
@@ -0,0 +1,321 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define EXTERN_INLINE_MATRIX static INLINE
+#define EXTERN_INLINE_KALMAN static INLINE
+#include "kalman_fleet.h"
+
+/*!
+* \brief Rounds a size up to a multiple of {\ref KALMAN_ARENA_ALIGNMENT}
+*/
+#define KALMAN_FLEET_ROUND(size)    (((size) + KALMAN_ARENA_ALIGNMENT - 1) & ~(size_t)(KALMAN_ARENA_ALIGNMENT - 1))
+
+/*!
+* \brief Gets the number of bytes {\ref kalman_fleet_create} requests for a fleet
+* \param[in] max_filters The largest number of filters
+* \param[in] max_jobs The largest number of jobs queued between two runs
+* \return The size of the block holding the structure, the filter table, and two run lists and job storages.
+*/
+size_t kalman_fleet_create_size(uint_fast32_t max_filters, uint_fast32_t max_jobs)
+{
+    return KALMAN_FLEET_ROUND(sizeof(kalman_fleet_t))
+         + KALMAN_FLEET_ROUND(sizeof(kalman_fleet_filter_t) * (size_t)max_filters)
+         + 2 * KALMAN_FLEET_ROUND(sizeof(kalman_fleet_slot_t) * (size_t)max_filters)
+         + 2 * KALMAN_FLEET_ROUND(sizeof(kalman_fleet_job_t) * (size_t)max_jobs);
+}
+
+/*!
+* \brief Creates a fleet in an arena
+* \param[in] arena The arena to allocate from
+* \param[in] max_filters The largest number of filters; at most the largest {\ref matrix_offset_t}.
+* \param[in] max_jobs The largest number of jobs queued between two runs
+* \return The empty fleet, or \c NULL if the arena is exhausted.
+*/
+kalman_fleet_t* kalman_fleet_create(kalman_arena_t *arena, uint_fast32_t max_filters, uint_fast32_t max_jobs)
+{
+    assert((uint_fast32_t)(matrix_offset_t)max_filters == max_filters);
+
+    const size_t size = kalman_fleet_create_size(max_filters, max_jobs);
+    uint8_t *block = (uint8_t*)kalman_arena_alloc(arena, size);
+    if (block == NULL) return NULL;
+    memset(block, 0, size);
+
+    kalman_fleet_t *fleet = (kalman_fleet_t*)block;
+    uint8_t *cursor = block + KALMAN_FLEET_ROUND(sizeof(kalman_fleet_t));
+
+    fleet->filters = (kalman_fleet_filter_t*)cursor;
+    cursor += KALMAN_FLEET_ROUND(sizeof(kalman_fleet_filter_t) * (size_t)max_filters);
+    fleet->slots = (kalman_fleet_slot_t*)cursor;
+    cursor += KALMAN_FLEET_ROUND(sizeof(kalman_fleet_slot_t) * (size_t)max_filters);
+    fleet->running_slots = (kalman_fleet_slot_t*)cursor;
+    cursor += KALMAN_FLEET_ROUND(sizeof(kalman_fleet_slot_t) * (size_t)max_filters);
+    fleet->jobs = (kalman_fleet_job_t*)cursor;
+    cursor += KALMAN_FLEET_ROUND(sizeof(kalman_fleet_job_t) * (size_t)max_jobs);
+    fleet->running_jobs = (kalman_fleet_job_t*)cursor;
+    cursor += KALMAN_FLEET_ROUND(sizeof(kalman_fleet_job_t) * (size_t)max_jobs);
+    assert(cursor == block + size);
+
+    fleet->max_filters = max_filters;
+    fleet->max_jobs = max_jobs;
+    pthread_mutex_init(&fleet->lock, NULL);
+    pthread_mutex_init(&fleet->run_lock, NULL);
+    return fleet;
+}
+
+/*!
+* \brief Releases a fleet created by {\ref kalman_fleet_create}
+* \param[in] arena The arena the fleet was created in
+* \param[in] fleet The fleet; may be \c NULL. The registered filters are not released.
+*/
+void kalman_fleet_destroy(kalman_arena_t *arena, kalman_fleet_t *fleet)
+{
+    if (fleet == NULL) return;
+
+    pthread_mutex_destroy(&fleet->run_lock);
+    pthread_mutex_destroy(&fleet->lock);
+    kalman_arena_free(arena, fleet, kalman_fleet_create_size(fleet->max_filters, fleet->max_jobs));
+}
+
+/*!
+* \brief Determines whether a measurement structure is registered with another filter than the given one
+* \param[in] fleet The fleet; its lock must be held.
+* \param[in] id The id of the filter, or {\ref KALMAN_FLEET_INVALID}
+* \param[in] kfm The measurement structure
+* \return Nonzero if another filter owns the measurement structure.
+*/
+static int kalman_fleet_foreign(const kalman_fleet_t *fleet, uint_fast32_t id, const kalman_measurement_t *kfm)
+{
+    for (uint_fast32_t other = 0; other < fleet->num_filters; ++other)
+    {
+        if (other != id && fleet->filters[other].kfm == kfm) return 1;
+    }
+    return 0;
+}
+
+/*!
+* \brief Registers a filter and its measurement with a fleet
+* \param[in] fleet The fleet
+* \param[in] kf The filter; it must only be updated through the fleet from now on.
+* \param[in] kfm The measurement used by jobs that do not name one; it must not belong to another filter.
+* \return The id of the filter, or {\ref KALMAN_FLEET_INVALID} if the fleet is full or \c kfm is registered with another filter.
+*/
+uint_fast32_t kalman_fleet_register(kalman_fleet_t *fleet, kalman_t *kf, kalman_measurement_t *kfm)
+{
+    uint_fast32_t id = KALMAN_FLEET_INVALID;
+
+    pthread_mutex_lock(&fleet->lock);
+    if (fleet->num_filters < fleet->max_filters && (kfm == NULL || !kalman_fleet_foreign(fleet, KALMAN_FLEET_INVALID, kfm)))
+    {
+        id = fleet->num_filters++;
+
+        kalman_fleet_filter_t *filter = &fleet->filters[id];
+        filter->kf = kf;
+        filter->kfm = kfm;
+        filter->shape = ((uint_fast32_t)kf->A.rows << 16) | ((kfm != NULL) ? kfm->H.rows : 0);
+        filter->head = KALMAN_FLEET_INVALID;
+        filter->tail = KALMAN_FLEET_INVALID;
+    }
+    pthread_mutex_unlock(&fleet->lock);
+
+    return id;
+}
+
+/*!
+* \brief Queues a measurement for a filter
+* \param[in] fleet The fleet
+* \param[in] id The id of the filter
+* \param[in] kfm The measurement structure to correct with; \c NULL uses the registered one. It must not be
+*            used for jobs of other filters.
+* \param[in] z The measured values; they must stay valid until the {\ref kalman_fleet_run} executing the job returns.
+* \param[in] flags Combination of {\ref KALMAN_FLEET_PREDICT}
+* \return Zero in case of success, nonzero if the id is unknown, the job storage is full or \c kfm is registered
+*         with another filter.
+*/
+int kalman_fleet_submit(kalman_fleet_t *fleet, uint_fast32_t id, kalman_measurement_t *kfm, const matrix_data_t *z, uint_fast8_t flags)
+{
+    int result = 1;
+
+    pthread_mutex_lock(&fleet->lock);
+    if (id < fleet->num_filters && fleet->num_jobs < fleet->max_jobs
+        && (kfm == NULL || kfm == fleet->filters[id].kfm || !kalman_fleet_foreign(fleet, id, kfm)))
+    {
+        kalman_fleet_filter_t *filter = &fleet->filters[id];
+        const uint_fast32_t index = fleet->num_jobs++;
+
+        kalman_fleet_job_t *job = &fleet->jobs[index];
+        job->kfm = (kfm != NULL) ? kfm : filter->kfm;
+        job->z = z;
+        job->next = KALMAN_FLEET_INVALID;
+        job->flags = flags;
+        assert(job->kfm != NULL && job->kfm->H.cols == filter->kf->A.rows);
+
+        // the first job of a filter puts it on the run list
+        if (filter->head == KALMAN_FLEET_INVALID)
+        {
+            kalman_fleet_slot_t *slot = &fleet->slots[fleet->num_pending++];
+            slot->shape = filter->shape;
+            slot->id = id;
+            filter->head = index;
+        }
+        else
+        {
+            fleet->jobs[filter->tail].next = index;
+        }
+        filter->tail = index;
+
+        result = 0;
+    }
+    pthread_mutex_unlock(&fleet->lock);
+
+    return result;
+}
+
+/*!
+* \brief Sets the scratch area a thread attaches while it executes jobs
+* \param[in] fleet The fleet
+* \param[in] thread The index of the thread within the pool
+* \param[in] scratch The scratch area; \c NULL keeps the one attached to the thread.
+*/
+void kalman_fleet_set_scratch(kalman_fleet_t *fleet, uint_fast8_t thread, kalman_scratch_t *scratch)
+{
+    assert(thread < KALMAN_POOL_MAX_THREADS);
+
+    pthread_mutex_lock(&fleet->run_lock);
+    fleet->workers[thread].scratch = scratch;
+    pthread_mutex_unlock(&fleet->run_lock);
+}
+
+/*!
+* \brief Orders the run list by shape, then by id
+*/
+static int kalman_fleet_compare(const void *a, const void *b)
+{
+    const kalman_fleet_slot_t *lhs = (const kalman_fleet_slot_t*)a;
+    const kalman_fleet_slot_t *rhs = (const kalman_fleet_slot_t*)b;
+
+    if (lhs->shape != rhs->shape) return (lhs->shape < rhs->shape) ? -1 : 1;
+    return (lhs->id < rhs->id) ? -1 : (lhs->id > rhs->id);
+}
+
+/*!
+* \brief Executes one job
+* \param[in] kf The filter
+* \param[in] job The job
+*/
+static void kalman_fleet_execute(kalman_t *kf, const kalman_fleet_job_t *job)
+{
+    kalman_measurement_t *const kfm = job->kfm;
+    const matrix_index_t rows = kfm->z.rows;
+
+    if (job->flags & KALMAN_FLEET_PREDICT)
+    {
+        kalman_predict(kf);
+    }
+
+    for (matrix_index_t row = 0; row < rows; ++row)
+    {
+        matrix_set(&kfm->z, row, 0, job->z[row]);
+    }
+    kalman_correct(kf, kfm);
+}
+
+/*!
+* \brief Executes the jobs of a range of the run list
+* \param[in] context The fleet; the run list and job storage of the run in progress are executed.
+* \param[in] begin The first slot
+* \param[in] end One past the last slot
+*/
+static void kalman_fleet_task(void *context, matrix_offset_t begin, matrix_offset_t end)
+{
+    kalman_fleet_t *const fleet = (kalman_fleet_t*)context;
+    const kalman_fleet_slot_t *const slots = fleet->running_slots;
+    const kalman_fleet_job_t *const jobs = fleet->running_jobs;
+    const int self = kalman_pool_thread_index();
+    assert(self >= 0 && self < (int)KALMAN_POOL_MAX_THREADS);
+
+    // only this thread writes its record
+    kalman_fleet_worker_t *const worker = &fleet->workers[self];
+    kalman_scratch_t *const previous = (worker->scratch != NULL) ? kalman_scratch_attach(worker->scratch) : NULL;
+
+    for (matrix_offset_t s = begin; s < end; ++s)
+    {
+        const kalman_fleet_filter_t *filter = &fleet->filters[slots[s].id];
+        if (filter->shape != worker->shape)
+        {
+            worker->shape = filter->shape;
+            ++worker->shape_changes;
+        }
+
+        for (uint_fast32_t index = slots[s].head; index != KALMAN_FLEET_INVALID; index = jobs[index].next)
+        {
+            kalman_fleet_execute(filter->kf, &jobs[index]);
+            ++worker->jobs;
+        }
+        ++worker->filters;
+    }
+
+    if (worker->scratch != NULL)
+    {
+        kalman_scratch_attach(previous);
+    }
+}
+
+/*!
+* \brief Executes all queued jobs
+* \param[in] fleet The fleet
+* \param[in] pool The pool to execute on; if \c NULL, the jobs run on the calling thread.
+*/
+void kalman_fleet_run(kalman_fleet_t *fleet, kalman_pool_t *pool)
+{
+    // a filter must not be updated by two runs at once
+    pthread_mutex_lock(&fleet->run_lock);
+
+    // take over the queued jobs; jobs submitted from now on go into the other buffers
+    pthread_mutex_lock(&fleet->lock);
+
+    const uint_fast32_t num_pending = fleet->num_pending;
+    for (uint_fast32_t s = 0; s < num_pending; ++s)
+    {
+        kalman_fleet_slot_t *slot = &fleet->slots[s];
+        kalman_fleet_filter_t *filter = &fleet->filters[slot->id];
+        slot->head = filter->head;
+        filter->head = KALMAN_FLEET_INVALID;
+        filter->tail = KALMAN_FLEET_INVALID;
+    }
+
+    kalman_fleet_slot_t *const slots = fleet->slots;
+    fleet->slots = fleet->running_slots;
+    fleet->running_slots = slots;
+
+    kalman_fleet_job_t *const jobs = fleet->jobs;
+    fleet->jobs = fleet->running_jobs;
+    fleet->running_jobs = jobs;
+
+    fleet->num_pending = 0;
+    fleet->num_jobs = 0;
+
+    pthread_mutex_unlock(&fleet->lock);
+
+    for (uint_fast8_t t = 0; t < KALMAN_POOL_MAX_THREADS; ++t)
+    {
+        kalman_fleet_worker_t *worker = &fleet->workers[t];
+        worker->jobs = 0;
+        worker->filters = 0;
+        worker->shape_changes = 0;
+        worker->shape = 0;
+    }
+
+    // filters of the same shape end up in the same chunks
+    qsort(slots, num_pending, sizeof(kalman_fleet_slot_t), kalman_fleet_compare);
+    kalman_pool_parallel_for(pool, (matrix_offset_t)num_pending, KALMAN_FLEET_GRAIN, kalman_fleet_task, fleet);
+
+    pthread_mutex_unlock(&fleet->run_lock);
+}
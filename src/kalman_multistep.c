@@ -0,0 +1,320 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#include <stdint.h>
+#include <assert.h>
+
+#define EXTERN_INLINE_MATRIX static INLINE
+#define EXTERN_INLINE_KALMAN static INLINE
+#include "kalman.h"
+#include "kalman_multistep.h"
+
+/*!
+* \brief Points the matrices of a slot into a buffer
+* \param[in] slot The slot
+* \param[in] n The number of states
+* \param[in] packed Nonzero if the accumulated noise is stored packed like P
+* \param[in] buffer The buffer of \c 2*n*n elements
+*/
+static void kalman_multistep_init_slot(kalman_multistep_slot_t *slot, matrix_index_t n, int packed, matrix_data_t *buffer)
+{
+    slot->steps = 0;
+    slot->model_version = 0;
+    slot->last_used = 0;
+
+    matrix_init(&slot->A, n, n, buffer);
+    if (packed)
+    {
+        matrix_init_packed(&slot->N, n, buffer + (size_t)n * n);
+    }
+    else
+    {
+        matrix_init(&slot->N, n, n, buffer + (size_t)n * n);
+    }
+}
+
+/*!
+* \brief Attaches a multi-step cache to a filter
+* \param[in] kf The Kalman Filter structure
+* \param[in] ms The cache to initialize; \c NULL detaches the current one.
+* \param[in] buffer The buffer of {\ref KALMAN_MULTISTEP_SIZE} elements
+* \param[in] size The number of elements of the buffer
+*/
+void kalman_cache_multistep(kalman_t *kf, kalman_multistep_t *ms, matrix_data_t *buffer, size_t size)
+{
+    if (ms == 0)
+    {
+        kf->cache.multistep = 0;
+        return;
+    }
+
+    const matrix_index_t n = kf->A.rows;
+    const matrix_index_t i = kf->B.cols;
+    const int packed = matrix_is_packed(&kf->P);
+
+    assert(buffer != 0 && size >= KALMAN_MULTISTEP_SIZE(n, i));
+
+    for (uint_fast8_t slot = 0; slot < KALMAN_MULTISTEP_SLOTS; ++slot)
+    {
+        kalman_multistep_init_slot(&ms->slots[slot], n, packed, buffer);
+        buffer += 2 * (size_t)n * n;
+    }
+    kalman_multistep_init_slot(&ms->power, n, packed, buffer);
+    buffer += 2 * (size_t)n * n;
+
+    matrix_init(&ms->temp, n, n, buffer);
+    buffer += (size_t)n * ((n > i) ? n : i);
+    ms->aux = buffer;
+    buffer += (n > i) ? n : i;
+    matrix_init(&ms->x, n, 1, buffer);
+
+    ms->clock = 0;
+    ms->hits = 0;
+    ms->misses = 0;
+
+    kf->cache.multistep = ms;
+}
+
+/*!
+* \brief Appends the steps of one propagation to another
+* \param[in] ms The cache providing the temporaries
+* \param[in] first The propagation to extend, i.e. A1 = A2*A1 and N1 = A2*N1*A2' + N2
+* \param[in] then The propagation appended; may be \c first.
+*/
+static void kalman_multistep_append(kalman_multistep_t *ms, kalman_multistep_slot_t *first, const kalman_multistep_slot_t *then)
+{
+    matrix_t *RESTRICT const temp = &ms->temp;
+
+    // N1 = A2*N1*A2' + N2
+    matrix_mult(&then->A, &first->N, temp, ms->aux);        // temp = A2*N1, N1 may be packed
+    if (first != then)
+    {
+        matrix_copy(&then->N, &first->N);
+    }
+    if (matrix_is_packed(&first->N))
+    {
+        matrix_multadd_transb_packed(temp, &then->A, &first->N);    // N1 += temp*A2'
+    }
+    else
+    {
+        matrix_multadd_transb_symmetric(temp, &then->A, &first->N); // N1 += temp*A2'
+    }
+
+    // A1 = A2*A1, powers of A commute
+    matrix_mult(&then->A, &first->A, temp, ms->aux);
+    matrix_copy(temp, &first->A);
+
+    first->steps += then->steps;
+}
+
+/*!
+* \brief Calculates the propagation of a number of steps by repeated squaring
+* \param[in] kf The Kalman Filter structure
+* \param[in] ms The cache
+* \param[in] slot The slot to calculate
+* \param[in] steps The number of steps
+*/
+static void kalman_multistep_calculate(const kalman_t *kf, kalman_multistep_t *ms, kalman_multistep_slot_t *slot, uint_fast32_t steps)
+{
+    kalman_multistep_slot_t *RESTRICT const power = &ms->power;
+    const matrix_index_t n = kf->A.rows;
+    const matrix_index_t i = kf->B.cols;
+
+    // a single step: A and B*Q*B'
+    matrix_copy(&kf->A, &power->A);
+    if (i > 0)
+    {
+        matrix_t BQ;
+        matrix_init(&BQ, n, i, ms->temp.data);
+        matrix_mult(&kf->B, &kf->Q, &BQ, ms->aux);          // temp = B*Q, Q may be packed
+        if (matrix_is_packed(&power->N))
+        {
+            matrix_mult_transb_packed(&BQ, &kf->B, &power->N);      // N = temp*B'
+        }
+        else
+        {
+            matrix_mult_transb_symmetric(&BQ, &kf->B, &power->N);   // N = temp*B'
+        }
+    }
+    else
+    {
+        const size_t count = matrix_is_packed(&power->N) ? MATRIX_PACKED_SIZE((size_t)n) : (size_t)n * n;
+        for (size_t index = 0; index < count; ++index)
+        {
+            power->N.data[index] = 0;
+        }
+    }
+    power->steps = 1;
+
+    // combine the powers A^(2^j) of the set bits
+    slot->steps = 0;
+    for (;;)
+    {
+        if (steps & 1u)
+        {
+            if (slot->steps == 0)
+            {
+                matrix_copy(&power->A, &slot->A);
+                matrix_copy(&power->N, &slot->N);
+                slot->steps = power->steps;
+            }
+            else
+            {
+                kalman_multistep_append(ms, slot, power);
+            }
+        }
+
+        steps >>= 1;
+        if (steps == 0)
+        {
+            break;
+        }
+        kalman_multistep_append(ms, power, power);
+    }
+
+    slot->model_version = kf->model_version;
+}
+
+/*!
+* \brief Finds the slot of a number of steps, calculating it in the least recently used slot if needed
+* \param[in] kf The Kalman Filter structure
+* \param[in] ms The cache
+* \param[in] steps The number of steps
+* \return The slot
+*/
+static kalman_multistep_slot_t* kalman_multistep_lookup(const kalman_t *kf, kalman_multistep_t *ms, uint_fast32_t steps)
+{
+    kalman_multistep_slot_t *victim = &ms->slots[0];
+    ++ms->clock;
+
+    for (uint_fast8_t index = 0; index < KALMAN_MULTISTEP_SLOTS; ++index)
+    {
+        kalman_multistep_slot_t *const slot = &ms->slots[index];
+        if (slot->steps == steps && slot->model_version == kf->model_version)
+        {
+            ++ms->hits;
+            slot->last_used = ms->clock;
+            return slot;
+        }
+
+        // empty slots go first, then the least recently used one
+        if (victim->steps != 0 && (slot->steps == 0 || slot->last_used < victim->last_used))
+        {
+            victim = slot;
+        }
+    }
+
+    ++ms->misses;
+    kalman_multistep_calculate(kf, ms, victim, steps);
+    victim->last_used = ms->clock;
+    return victim;
+}
+
+/*!
+* \brief Propagates the covariance over the steps of a slot
+* \param[in] kf The Kalman Filter structure
+* \param[in] ms The cache providing the temporaries
+* \param[in] slot The slot
+*/
+static void kalman_multistep_propagate(kalman_t *kf, kalman_multistep_t *ms, const kalman_multistep_slot_t *slot)
+{
+    matrix_t *RESTRICT const P = &kf->P;
+
+    /************************************************************************/
+    /* Predict the covariance k steps ahead                                 */
+    /* P = A^k*P*A^k' + sum A^i*B*Q*B'*A^i'                                 */
+    /************************************************************************/
+
+    matrix_mult(&slot->A, P, &ms->temp, ms->aux);          // temp = A^k*P, P may be packed
+    if (matrix_is_packed(P))
+    {
+        matrix_mult_transb_packed(&ms->temp, &slot->A, P);      // P = temp*A^k'
+    }
+    else
+    {
+        matrix_mult_transb_symmetric(&ms->temp, &slot->A, P);   // P = temp*A^k'
+    }
+    matrix_add_inplace(P, &slot->N);                        // P += N, both stored alike
+}
+
+/*!
+* \brief Performs a number of prediction steps of only the state covariance matrix at once
+* \param[in] kf The Kalman Filter structure to predict with.
+* \param[in] steps The number of steps
+*/
+void kalman_predict_Q_n(kalman_t *kf, uint_fast32_t steps)
+{
+    kalman_multistep_t *const ms = kf->cache.multistep;
+
+    // a converged covariance does not change until the steady state is left
+    if (kf->flags & KALMAN_FLAG_STEADY_STATE)
+    {
+        kf->pending += steps;
+        return;
+    }
+
+    if (ms == 0 || steps < 2)
+    {
+        for (; steps > 0; --steps)
+        {
+            kalman_predict_Q(kf);
+        }
+        return;
+    }
+
+    const kalman_multistep_slot_t *const slot = kalman_multistep_lookup(kf, ms, steps);
+
+    KALMAN_PROFILE_BEGIN();
+
+    kalman_multistep_propagate(kf, ms, slot);
+
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_PREDICT_Q);
+}
+
+/*!
+* \brief Performs a number of prediction steps at once
+* \param[in] kf The Kalman Filter structure to predict with.
+* \param[in] steps The number of steps
+*/
+void kalman_predict_n(kalman_t *kf, uint_fast32_t steps)
+{
+    kalman_multistep_t *const ms = kf->cache.multistep;
+
+    // a single step is cheaper than the multi-step propagation
+    if (ms == 0 || steps < 2)
+    {
+        for (; steps > 0; --steps)
+        {
+            kalman_predict(kf);
+        }
+        return;
+    }
+
+    const kalman_multistep_slot_t *const slot = kalman_multistep_lookup(kf, ms, steps);
+
+    /************************************************************************/
+    /* Predict the state k steps ahead                                      */
+    /* x = A^k*x                                                            */
+    /************************************************************************/
+
+    KALMAN_PROFILE_BEGIN();
+
+    matrix_mult_rowvector(&slot->A, &kf->x, &ms->x);
+    matrix_copy(&ms->x, &kf->x);
+
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_PREDICT_X);
+
+    // deferred like the single steps, or skipped while the covariance has converged
+    if (kf->flags & (KALMAN_FLAG_LAZY | KALMAN_FLAG_STEADY_STATE))
+    {
+        kf->pending += steps;
+        return;
+    }
+
+    kalman_multistep_propagate(kf, ms, slot);
+
+    KALMAN_PROFILE_STAGE(kf, KALMAN_STAGE_PREDICT_Q);
+}
@@ -0,0 +1,522 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#include <stdint.h>
+#include <assert.h>
+#include <unistd.h>
+
+#define EXTERN_INLINE_MATRIX static INLINE
+#include "kalman_pool.h"
+
+/*!
+* \brief The pool used by the prediction and correction steps; \c NULL runs them on the calling thread.
+*/
+static kalman_pool_t *kalman_pool_attached = 0;
+
+/*!
+* \brief Index of the calling thread within the loop it is executing, or -1 outside of a loop
+*/
+static _Thread_local int kalman_pool_index = -1;
+
+/*!
+* \brief Takes the next chunk from the front of the own queue
+* \param[in] queue The queue
+* \param[out] chunk The chunk
+* \return Nonzero if a chunk was taken.
+*/
+static int kalman_pool_pop(kalman_pool_queue_t *queue, matrix_offset_t *chunk)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->head < queue->tail)
+    {
+        *chunk = queue->head++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return found;
+}
+
+/*!
+* \brief Takes the last chunk from the back of another thread's queue
+* \param[in] queue The queue to steal from
+* \param[out] chunk The chunk
+* \return Nonzero if a chunk was taken.
+*/
+static int kalman_pool_steal(kalman_pool_queue_t *queue, matrix_offset_t *chunk)
+{
+    int found = 0;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->head < queue->tail)
+    {
+        *chunk = --queue->tail;
+        found = 1;
+    }
+    pthread_mutex_unlock(&queue->lock);
+
+    return found;
+}
+
+/*!
+* \brief Executes chunks of the current loop until all queues are empty
+* \param[in] pool The pool
+* \param[in] self The index of the executing thread
+*/
+static void kalman_pool_work(kalman_pool_t *pool, uint_fast8_t self)
+{
+    const uint_fast8_t num_threads = pool->num_threads;
+    const matrix_offset_t count = pool->count;
+    const matrix_offset_t grain = pool->grain;
+    matrix_offset_t chunk;
+
+    kalman_pool_index = (int)self;
+    for (;;)
+    {
+        int found = kalman_pool_pop(&pool->queues[self], &chunk);
+
+        // steal from the others, starting with the next thread
+        for (uint_fast8_t i = 1; !found && i < num_threads; ++i)
+        {
+            found = kalman_pool_steal(&pool->queues[(self + i) % num_threads], &chunk);
+        }
+
+        if (!found) break;
+
+        const matrix_offset_t begin = chunk * grain;
+        const matrix_offset_t end = (count - begin < grain) ? count : begin + grain;
+        pool->task(pool->context, begin, end);
+    }
+    kalman_pool_index = -1;
+}
+
+/*!
+* \brief Main loop of a started thread
+* \param[in] argument The pool
+* \return Always \c NULL.
+*/
+static void* kalman_pool_thread(void *argument)
+{
+    kalman_pool_t *pool = (kalman_pool_t*)argument;
+    uint_fast8_t self = 0;
+
+    // the generation at the time the pool was initialized; a thread that starts late still takes part in the first loop
+    uint_fast32_t seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+
+    // the index of this thread is the position of its handle
+    for (uint_fast8_t i = 1; i < pool->num_threads; ++i)
+    {
+        if (pthread_equal(pool->threads[i], pthread_self())) self = i;
+    }
+
+    for (;;)
+    {
+        while (pool->generation == seen && !pool->shutdown)
+        {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->shutdown) break;
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        kalman_pool_work(pool, self);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busy == 0)
+        {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return 0;
+}
+
+/*!
+* \brief Initializes a pool and starts its threads
+* \param[in] pool The pool to initialize
+* \param[in] num_threads The number of threads including the calling thread, at most {\ref KALMAN_POOL_MAX_THREADS}.
+* \return Zero in case of success, nonzero if the threads could not be started.
+*/
+int kalman_pool_init(kalman_pool_t *pool, uint_fast8_t num_threads)
+{
+    uint_fast8_t i;
+
+    assert(num_threads > 0 && num_threads <= KALMAN_POOL_MAX_THREADS);
+
+    pool->num_threads = 1;
+    pool->generation = 0;
+    pool->busy = 0;
+    pool->shutdown = 0;
+    pool->task = 0;
+    pool->context = 0;
+    pool->count = 0;
+    pool->grain = 1;
+
+    pthread_mutex_init(&pool->submit, 0);
+    pthread_mutex_init(&pool->lock, 0);
+    pthread_cond_init(&pool->start, 0);
+    pthread_cond_init(&pool->done, 0);
+
+    for (i = 0; i < KALMAN_POOL_MAX_THREADS; ++i)
+    {
+        pthread_mutex_init(&pool->queues[i].lock, 0);
+        pool->queues[i].head = pool->queues[i].tail = 0;
+    }
+
+    // the threads look up their index under the lock, so all handles must be stored first
+    pthread_mutex_lock(&pool->lock);
+    for (i = 1; i < num_threads; ++i)
+    {
+        if (pthread_create(&pool->threads[i], 0, kalman_pool_thread, pool) != 0) break;
+        pool->num_threads = i + 1;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (pool->num_threads != num_threads)
+    {
+        kalman_pool_destroy(pool);
+        return 1;
+    }
+
+    return 0;
+}
+
+/*!
+* \brief Stops the threads of a pool
+* \param[in] pool The pool; it must not be attached.
+*/
+void kalman_pool_destroy(kalman_pool_t *pool)
+{
+    uint_fast8_t i;
+
+    assert(pool != kalman_pool_attached);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 1; i < pool->num_threads; ++i)
+    {
+        pthread_join(pool->threads[i], 0);
+    }
+
+    for (i = 0; i < KALMAN_POOL_MAX_THREADS; ++i)
+    {
+        pthread_mutex_destroy(&pool->queues[i].lock);
+    }
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->submit);
+    pool->num_threads = 0;
+}
+
+/*!
+* \brief The built-in pool
+*/
+static kalman_pool_t kalman_pool_builtin;
+
+/*!
+* \brief Nonzero if the built-in pool was started
+*/
+static int kalman_pool_builtin_started = 0;
+
+/*!
+* \brief Starts the built-in pool
+*/
+static void kalman_pool_builtin_start(void)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) cpus = 1;
+    if (cpus > (long)KALMAN_POOL_MAX_THREADS) cpus = KALMAN_POOL_MAX_THREADS;
+
+    kalman_pool_builtin_started = (kalman_pool_init(&kalman_pool_builtin, (uint_fast8_t)cpus) == 0);
+}
+
+/*!
+* \brief Gets the built-in pool with one thread per online CPU, starting it on first use
+* \return The pool, or \c NULL if it could not be started.
+*/
+kalman_pool_t* kalman_pool_default(void)
+{
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once(&once, kalman_pool_builtin_start);
+    return kalman_pool_builtin_started ? &kalman_pool_builtin : 0;
+}
+
+/*!
+* \brief Runs a task over the range <tt>[0, count)</tt> in chunks of \c grain indices on all threads of a pool
+* \param[in] pool The pool; if \c NULL, the task runs on the calling thread.
+* \param[in] count The number of indices
+* \param[in] grain The number of indices per chunk
+* \param[in] task The task
+* \param[in] context The context passed to the task
+*/
+void kalman_pool_parallel_for(kalman_pool_t *pool, matrix_offset_t count, matrix_offset_t grain, kalman_pool_task_t task, void *context)
+{
+    uint_fast8_t i;
+
+    assert(grain > 0);
+    if (count == 0) return;
+
+    const matrix_offset_t chunks = (count + grain - 1) / grain;
+    if (pool == 0 || pool->num_threads == 1 || chunks == 1 || kalman_pool_index >= 0
+        || pthread_mutex_trylock(&pool->submit) != 0)
+    {
+        // nested loops run on the thread that is already part of a loop, and so do loops finding the pool busy
+        const int outer = kalman_pool_index;
+        kalman_pool_index = (outer >= 0) ? outer : 0;
+        task(context, 0, count);
+        kalman_pool_index = outer;
+        return;
+    }
+
+    const uint_fast8_t num_threads = pool->num_threads;
+
+    pthread_mutex_lock(&pool->lock);
+    assert(pool->busy == 0);
+
+    pool->task = task;
+    pool->context = context;
+    pool->count = count;
+    pool->grain = grain;
+
+    // deal out contiguous runs of chunks so that neighboring rows stay on one thread unless stolen
+    for (i = 0; i < num_threads; ++i)
+    {
+        kalman_pool_queue_t *queue = &pool->queues[i];
+        pthread_mutex_lock(&queue->lock);
+        queue->head = (chunks * i) / num_threads;
+        queue->tail = (chunks * (i + 1u)) / num_threads;
+        pthread_mutex_unlock(&queue->lock);
+    }
+
+    pool->busy = num_threads - 1;
+    ++pool->generation;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    kalman_pool_work(pool, 0);
+
+    // the queues are empty, but other threads may still be executing their last chunk
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busy > 0)
+    {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    pthread_mutex_unlock(&pool->submit);
+}
+
+/*!
+* \brief Attaches a pool to the prediction and correction steps
+* \param[in] pool The pool; \c NULL detaches.
+*/
+void kalman_pool_attach(kalman_pool_t *pool)
+{
+    kalman_pool_attached = pool;
+}
+
+/*!
+* \brief Gets the pool to use for a filter
+* \param[in] num_states The number of states of the filter
+* \return The attached pool, or \c NULL if none is attached, the filter is too small or the calling thread already executes a task.
+*/
+kalman_pool_t* kalman_pool_for(matrix_index_t num_states)
+{
+    // a filter updated from within a loop, e.g. by the fleet executor, stays on its thread
+    return (num_states >= KALMAN_POOL_THRESHOLD && kalman_pool_index < 0) ? kalman_pool_attached : 0;
+}
+
+/*!
+* \brief Gets the index of the calling thread within the loop it is executing
+* \return The index in <tt>[0, num_threads)</tt>, or -1 if the thread is not executing a task.
+*/
+int kalman_pool_thread_index(void)
+{
+    return kalman_pool_index;
+}
+
+/************************************************************************/
+/* Row block tasks                                                      */
+/************************************************************************/
+
+/*!
+* \brief Operands of the row block tasks
+*/
+typedef struct
+{
+    const matrix_t *a;
+    const matrix_t *b;
+    const matrix_t *c;
+    matrix_data_t scale;
+} kalman_pool_operands_t;
+
+/*!
+* \brief temp = A*P for a block of rows, using P = P'
+*/
+static void kalman_pool_task_AP(void *context, matrix_offset_t begin, matrix_offset_t end)
+{
+    const kalman_pool_operands_t *ops = (const kalman_pool_operands_t*)context;
+    matrix_t A_rows, temp_rows;
+
+    matrix_view_rows(ops->a, (matrix_index_t)begin, (matrix_index_t)(end - begin), &A_rows);
+    matrix_view_rows(ops->c, (matrix_index_t)begin, (matrix_index_t)(end - begin), &temp_rows);
+    matrix_mult_transb(&A_rows, ops->b, &temp_rows);
+}
+
+/*!
+* \brief P = temp*A' * scale for the upper triangle of a block of rows
+*/
+static void kalman_pool_task_APAt(void *context, matrix_offset_t begin, matrix_offset_t end)
+{
+    const kalman_pool_operands_t *ops = (const kalman_pool_operands_t*)context;
+    const matrix_index_t n = ops->c->cols;
+    matrix_t temp_rows, A_rows, P_block;
+
+    // rows begin..end of the result only need the columns from begin on
+    matrix_view_rows(ops->a, (matrix_index_t)begin, (matrix_index_t)(end - begin), &temp_rows);
+    matrix_view_rows(ops->b, (matrix_index_t)begin, (matrix_index_t)(n - begin), &A_rows);
+    matrix_view_submatrix(ops->c, (matrix_index_t)begin, (matrix_index_t)begin, (matrix_index_t)(end - begin), (matrix_index_t)(n - begin), &P_block);
+
+    if (ops->scale == (matrix_data_t)1)
+    {
+        matrix_mult_transb(&temp_rows, &A_rows, &P_block);
+    }
+    else
+    {
+        matrix_multscale_transb(&temp_rows, &A_rows, ops->scale, &P_block);
+    }
+}
+
+/*!
+* \brief Copies the upper triangle of a block of rows into the lower triangle
+*/
+static void kalman_pool_task_mirror(void *context, matrix_offset_t begin, matrix_offset_t end)
+{
+    const kalman_pool_operands_t *ops = (const kalman_pool_operands_t*)context;
+    const matrix_offset_t stride = ops->c->stride;
+    matrix_data_t *const data = ops->c->data;
+    matrix_offset_t i, j;
+
+    for (i = begin; i < end; ++i)
+    {
+        for (j = 0; j < i; ++j)
+        {
+            data[i * stride + j] = data[j * stride + i];
+        }
+    }
+}
+
+/*!
+* \brief HP = H*P for a block of columns of HP, i.e. rows of P, using P = P'
+*/
+static void kalman_pool_task_HP(void *context, matrix_offset_t begin, matrix_offset_t end)
+{
+    const kalman_pool_operands_t *ops = (const kalman_pool_operands_t*)context;
+    matrix_t P_rows, HP_cols;
+
+    matrix_view_rows(ops->b, (matrix_index_t)begin, (matrix_index_t)(end - begin), &P_rows);
+    matrix_view_columns(ops->c, (matrix_index_t)begin, (matrix_index_t)(end - begin), &HP_cols);
+    matrix_mult_transb(ops->a, &P_rows, &HP_cols);
+}
+
+/*!
+* \brief P = P - K*HP for the upper triangle of a block of rows, in the order of {\ref matrix_multsub_symmetric}
+*/
+static void kalman_pool_task_KHP(void *context, matrix_offset_t begin, matrix_offset_t end)
+{
+    const kalman_pool_operands_t *ops = (const kalman_pool_operands_t*)context;
+    const matrix_index_t m = ops->a->cols;
+    const matrix_index_t n = ops->c->cols;
+    const matrix_offset_t kstride = ops->a->stride;
+    const matrix_offset_t hstride = ops->b->stride;
+    const matrix_offset_t pstride = ops->c->stride;
+    const matrix_data_t *const kdata = ops->a->data;
+    const matrix_data_t *const hdata = ops->b->data;
+    matrix_data_t *const pdata = ops->c->data;
+    matrix_offset_t i, j, k;
+
+    for (i = begin; i < end; ++i)
+    {
+        matrix_data_t *RESTRICT const prow = &pdata[i * pstride];
+        for (k = 0; k < m; ++k)
+        {
+            const matrix_data_t factor = kdata[i * kstride + k];
+            const matrix_data_t *RESTRICT const hrow = &hdata[k * hstride];
+            for (j = i; j < n; ++j)
+            {
+                prow[j] -= factor * hrow[j];
+            }
+        }
+    }
+}
+
+/*!
+* \brief Calculates P = A*P*A' * scale for a dense, symmetric P on a pool
+* \param[in] pool The pool
+* \param[in] A The state transition matrix
+* \param[in] P The state covariance matrix
+* \param[in] temp The temporary matrix of the size of P
+* \param[in] scale Scaling factor
+*
+* The rows of the upper triangle get shorter towards the bottom; work stealing evens out the row blocks.
+*/
+void kalman_pool_predict_P(kalman_pool_t *pool, const matrix_t *A, const matrix_t *P, const matrix_t *temp, matrix_data_t scale)
+{
+    const matrix_index_t n = P->rows;
+    kalman_pool_operands_t ops = { A, P, temp, scale };
+
+    assert(!matrix_is_packed(P));
+
+    // temp = A*P
+    kalman_pool_parallel_for(pool, n, KALMAN_POOL_GRAIN, kalman_pool_task_AP, &ops);
+
+    // upper triangle of P = temp*A' * scale
+    ops.a = temp;
+    ops.b = A;
+    ops.c = P;
+    kalman_pool_parallel_for(pool, n, KALMAN_POOL_GRAIN, kalman_pool_task_APAt, &ops);
+    kalman_pool_parallel_for(pool, n, KALMAN_POOL_GRAIN, kalman_pool_task_mirror, &ops);
+}
+
+/*!
+* \brief Calculates HP = H*P for a dense, symmetric P on a pool
+* \param[in] pool The pool
+* \param[in] H The measurement transformation matrix
+* \param[in] P The state covariance matrix
+* \param[in] HP The result
+*/
+void kalman_pool_mult_HP(kalman_pool_t *pool, const matrix_t *H, const matrix_t *P, const matrix_t *HP)
+{
+    kalman_pool_operands_t ops = { H, P, HP, (matrix_data_t)1 };
+
+    assert(!matrix_is_packed(P));
+    kalman_pool_parallel_for(pool, P->rows, KALMAN_POOL_GRAIN, kalman_pool_task_HP, &ops);
+}
+
+/*!
+* \brief Calculates P = P - K*HP for a dense P on a pool, assuming that K*HP is symmetric
+* \param[in] pool The pool
+* \param[in] K The Kalman gain
+* \param[in] HP The product H*P
+* \param[in] P The state covariance matrix
+*/
+void kalman_pool_update_P(kalman_pool_t *pool, const matrix_t *K, const matrix_t *HP, const matrix_t *P)
+{
+    kalman_pool_operands_t ops = { K, HP, P, (matrix_data_t)1 };
+
+    assert(!matrix_is_packed(P));
+    kalman_pool_parallel_for(pool, P->rows, KALMAN_POOL_GRAIN, kalman_pool_task_KHP, &ops);
+    kalman_pool_parallel_for(pool, P->rows, KALMAN_POOL_GRAIN, kalman_pool_task_mirror, &ops);
+}
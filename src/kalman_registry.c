@@ -0,0 +1,97 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#include "kalman_registry.h"
+
+#if KALMAN_THREADS
+#include <pthread.h>
+
+/*!
+* \brief Guards the list of entries
+*/
+static pthread_mutex_t kalman_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/*!
+* \brief The first registered entry
+*/
+static kalman_registry_entry_t *kalman_registry_head = 0;
+
+/*!
+* \brief The last registered entry
+*/
+static kalman_registry_entry_t *kalman_registry_tail = 0;
+
+/*!
+* \brief Adds an entry to the registry
+* \param[in] entry The entry; it must stay valid for the lifetime of the program. Entries already registered are skipped.
+*/
+void kalman_registry_add(kalman_registry_entry_t *entry)
+{
+#if KALMAN_THREADS
+    pthread_mutex_lock(&kalman_registry_lock);
+#endif
+
+    // initializing a filter again must not link its entry twice
+    if (!entry->registered)
+    {
+        entry->registered = 1;
+        entry->next = 0;
+
+        if (kalman_registry_tail == 0)
+        {
+            kalman_registry_head = entry;
+        }
+        else
+        {
+            kalman_registry_tail->next = entry;
+        }
+        kalman_registry_tail = entry;
+    }
+
+#if KALMAN_THREADS
+    pthread_mutex_unlock(&kalman_registry_lock);
+#endif
+}
+
+/*!
+* \brief Gets the first registered entry
+* \return The entry registered first, or \c NULL.
+*/
+const kalman_registry_entry_t* kalman_registry_first(void)
+{
+#if KALMAN_THREADS
+    pthread_mutex_lock(&kalman_registry_lock);
+#endif
+    const kalman_registry_entry_t *const head = kalman_registry_head;
+#if KALMAN_THREADS
+    pthread_mutex_unlock(&kalman_registry_lock);
+#endif
+
+    return head;
+}
+
+/*!
+* \brief Gets the number of bytes of all registered entries
+* \return The sum of the footprints of all registered filters and measurements.
+*/
+size_t kalman_registry_total_bytes(void)
+{
+    size_t bytes = 0;
+
+#if KALMAN_THREADS
+    pthread_mutex_lock(&kalman_registry_lock);
+#endif
+    for (const kalman_registry_entry_t *entry = kalman_registry_head; entry != 0; entry = entry->next)
+    {
+        bytes += entry->bytes;
+    }
+#if KALMAN_THREADS
+    pthread_mutex_unlock(&kalman_registry_lock);
+#endif
+
+    return bytes;
+}
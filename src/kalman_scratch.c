@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#define EXTERN_INLINE_MATRIX static INLINE
+#define EXTERN_INLINE_KALMAN static INLINE
+#include "kalman.h"
+#include "kalman_scratch.h"
+
+/*!
+* \brief The scratch area of the calling thread
+*/
+#if KALMAN_THREADS
+static _Thread_local kalman_scratch_t *kalman_scratch_attached = 0;
+#else
+static kalman_scratch_t *kalman_scratch_attached = 0;
+#endif
+
+/*!
+* \brief Initializes a scratch area over a buffer
+* \param[in] scratch The scratch area to initialize
+* \param[in] buffer The buffer
+* \param[in] size The number of elements of the buffer, e.g. {\ref KALMAN_SCRATCH_SIZE}
+*/
+void kalman_scratch_init(kalman_scratch_t *scratch, matrix_data_t *buffer, size_t size)
+{
+    scratch->buffer = buffer;
+    scratch->size = size;
+}
+
+/*!
+* \brief Attaches a scratch area to the calling thread
+* \param[in] scratch The scratch area; \c NULL detaches.
+* \return The previously attached scratch area.
+*/
+kalman_scratch_t* kalman_scratch_attach(kalman_scratch_t *scratch)
+{
+    kalman_scratch_t *const previous = kalman_scratch_attached;
+    kalman_scratch_attached = scratch;
+    return previous;
+}
+
+/*!
+* \brief Gets the scratch area attached to the calling thread
+* \return The scratch area, or \c NULL if none is attached.
+*/
+kalman_scratch_t* kalman_scratch_current(void)
+{
+    return kalman_scratch_attached;
+}
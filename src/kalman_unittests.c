@@ -0,0 +1,1503 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+/*!
+* \brief Unit tests of the filter operations
+*
+* Most tests run the gravity filter of kalman_example_gravity.c in some variant and compare it to the plain filter.
+* The checks do not use assert() and hence also run in builds with \c NDEBUG.
+*/
+
+#define EXTERN_INLINE_MATRIX static INLINE
+#define EXTERN_INLINE_KALMAN static INLINE
+
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include "kalman_unittests.h"
+#include "kalman_batch.h"
+#include "kalman_arena.h"
+
+#include "kalman_scratch.h"
+#include "kalman_registry.h"
+#include "kalman_multistep.h"
+#include "kalman_continuous.h"
+
+#if KALMAN_THREADS
+#include "kalman_pool.h"
+#include "kalman_fleet.h"
+#endif
+
+// the gravity filter for reference
+#define KALMAN_NAME gravity
+#define KALMAN_NUM_STATES 3
+#define KALMAN_NUM_INPUTS 0
+#include "kalman_factory_filter.h"
+
+#define KALMAN_MEASUREMENT_NAME position
+#define KALMAN_NUM_MEASUREMENTS 1
+#include "kalman_factory_measurement.h"
+
+#include "kalman_factory_cleanup.h"
+
+// the same filter with a packed state covariance
+#define KALMAN_NAME gravity_packed
+#define KALMAN_NUM_STATES 3
+#define KALMAN_NUM_INPUTS 0
+#define KALMAN_PACKED_COVARIANCE 1
+#include "kalman_factory_filter.h"
+
+#define KALMAN_MEASUREMENT_NAME position
+#define KALMAN_NUM_MEASUREMENTS 1
+#include "kalman_factory_measurement.h"
+
+#include "kalman_factory_cleanup.h"
+
+// the same filter taking its temporaries from the scratch area
+#define KALMAN_NAME gravity_shared
+#define KALMAN_NUM_STATES 3
+#define KALMAN_NUM_INPUTS 0
+#define KALMAN_SHARED_SCRATCH 1
+#include "kalman_factory_filter.h"
+
+#define KALMAN_MEASUREMENT_NAME position
+#define KALMAN_NUM_MEASUREMENTS 1
+#include "kalman_factory_measurement.h"
+
+#include "kalman_factory_cleanup.h"
+
+// the same filter with three position measurements sharing one set of temporaries
+#define KALMAN_FOOTPRINT_LIMIT 4096
+#define KALMAN_NAME gravity_fused
+#define KALMAN_NUM_STATES 3
+#define KALMAN_NUM_INPUTS 0
+#include "kalman_factory_filter.h"
+
+#define KALMAN_MEASUREMENT_NAME single
+#define KALMAN_NUM_MEASUREMENTS 1
+#include "kalman_factory_measurement.h"
+
+#define KALMAN_MEASUREMENT_NAME quad
+#define KALMAN_NUM_MEASUREMENTS 4
+#include "kalman_factory_measurement.h"
+
+#define KALMAN_MEASUREMENT_NAME pair
+#define KALMAN_NUM_MEASUREMENTS 2
+#include "kalman_factory_measurement.h"
+
+#include "kalman_factory_cleanup.h"
+#undef KALMAN_FOOTPRINT_LIMIT
+
+// keep the largest measurement of the fused filter within a budget
+KALMAN_STATIC_ASSERT_FOOTPRINT(KALMAN_MEASUREMENT_BYTES(gravity_fused, quad), 1024);
+
+// sixteen instances of the gravity filter in one block
+#define KALMAN_NAME gravity_many
+#define KALMAN_NUM_STATES 3
+#define KALMAN_NUM_INPUTS 0
+#define KALMAN_NUM_INSTANCES 16
+#include "kalman_factory_filter.h"
+
+#define KALMAN_MEASUREMENT_NAME position
+#define KALMAN_NUM_MEASUREMENTS 1
+#include "kalman_factory_measurement.h"
+
+#include "kalman_factory_cleanup.h"
+
+/*!
+* \brief The number of failed checks
+*/
+static int failures = 0;
+
+/*!
+* \brief Records a failed check
+* \param[in] passed Nonzero if the check passed
+* \param[in] condition The checked condition
+* \param[in] file The source file of the check
+* \param[in] line The line of the check
+*/
+static void expect(int passed, const char *condition, const char *file, int line)
+{
+    if (passed) return;
+
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, condition);
+    ++failures;
+}
+
+/*!
+* \def EXPECT Checks a condition and reports it if it does not hold
+*/
+#define EXPECT(condition) expect((condition) ? 1 : 0, #condition, __FILE__, __LINE__)
+
+/*!
+* \brief Number of position measurements of the gravity filter
+*/
+#define MEAS_COUNT (15)
+
+/*!
+* \brief True positions of a body falling from rest, s = g*0.5*T^2
+*/
+static const matrix_data_t real_distance[MEAS_COUNT] = {
+    (matrix_data_t)0,
+    (matrix_data_t)4.905,
+    (matrix_data_t)19.62,
+    (matrix_data_t)44.145,
+    (matrix_data_t)78.48,
+    (matrix_data_t)122.63,
+    (matrix_data_t)176.58,
+    (matrix_data_t)240.35,
+    (matrix_data_t)313.92,
+    (matrix_data_t)397.31,
+    (matrix_data_t)490.5,
+    (matrix_data_t)593.51,
+    (matrix_data_t)706.32,
+    (matrix_data_t)828.94,
+    (matrix_data_t)961.38 };
+
+/*!
+* \brief Measurement noise with variance 0.5
+*/
+static const matrix_data_t measurement_error[MEAS_COUNT] = {
+    (matrix_data_t)0.13442,
+    (matrix_data_t)0.45847,
+    (matrix_data_t)-0.56471,
+    (matrix_data_t)0.21554,
+    (matrix_data_t)0.079691,
+    (matrix_data_t)-0.32692,
+    (matrix_data_t)-0.1084,
+    (matrix_data_t)0.085656,
+    (matrix_data_t)0.8946,
+    (matrix_data_t)0.69236,
+    (matrix_data_t)-0.33747,
+    (matrix_data_t)0.75873,
+    (matrix_data_t)0.18135,
+    (matrix_data_t)-0.015764,
+    (matrix_data_t)0.17869 };
+
+/*!
+* \brief Sets up the model of the gravity filter, s = s + v*T + g*0.5*T^2, v = v + g*T, g = g with T = 1s
+* \param[in] kf The zero-initialized filter with 3 states and 0 inputs
+* \param[in] kfm The zero-initialized measurement with 1 output
+*/
+static void setup_gravity(kalman_t *kf, kalman_measurement_t *kfm)
+{
+    // the initial estimation of g is 6 m/s^2
+    kf->x.data[2] = 6;
+
+    matrix_set(&kf->A, 0, 0, 1);
+    matrix_set(&kf->A, 0, 1, 1);
+    matrix_set(&kf->A, 0, 2, (matrix_data_t)0.5);
+    matrix_set(&kf->A, 1, 1, 1);
+    matrix_set(&kf->A, 1, 2, 1);
+    matrix_set(&kf->A, 2, 2, 1);
+
+    matrix_set_symmetric(&kf->P, 0, 0, (matrix_data_t)0.1);
+    matrix_set_symmetric(&kf->P, 1, 1, 1);
+    matrix_set_symmetric(&kf->P, 2, 2, 1);
+
+    // z = s with var(s) = 0.5
+    matrix_set(&kfm->H, 0, 0, 1);
+    matrix_set(&kfm->R, 0, 0, (matrix_data_t)0.5);
+}
+
+/*!
+* \brief Runs the gravity filter over all measurements
+* \return The filter
+*/
+static const kalman_t* run_gravity()
+{
+    kalman_t *kf = kalman_filter_gravity_init();
+    kalman_measurement_t *kfm = kalman_filter_gravity_measurement_position_init();
+    setup_gravity(kf, kfm);
+
+    for (int i = 0; i < MEAS_COUNT; ++i)
+    {
+        kalman_predict(kf);
+        matrix_set(&kfm->z, 0, 0, real_distance[i] + measurement_error[i]);
+        kalman_correct(kf, kfm);
+    }
+
+    return kf;
+}
+
+/*!
+* \brief Tests the batch engine with the gravity filter in all lanes
+*/
+void test_kalman_batch()
+{
+    static kalman_batch_lane_t buffer[KALMAN_BATCH_BUFFER_SIZE(3, 0, 1)];
+    kalman_batch_t batch;
+    matrix_index_t lane;
+
+    // replicate the initialized filter into every lane
+    kalman_t *kf = kalman_filter_gravity_init();
+    kalman_measurement_t *kfm = kalman_filter_gravity_measurement_position_init();
+    setup_gravity(kf, kfm);
+
+    kalman_batch_initialize(&batch, 3, 0, 1, buffer);
+    for (lane = 0; lane < KALMAN_BATCH_LANES; ++lane)
+    {
+        kalman_batch_load(&batch, lane, kf, kfm);
+    }
+
+    for (int i = 0; i < MEAS_COUNT; ++i)
+    {
+        kalman_batch_predict(&batch);
+
+        // every lane sees the noise sequence rotated by its lane index
+        for (lane = 0; lane < KALMAN_BATCH_LANES; ++lane)
+        {
+            matrix_data_t measurement = real_distance[i] + measurement_error[(i + lane) % MEAS_COUNT];
+            kalman_batch_set(&batch.z, 0, 0, lane, measurement);
+        }
+
+        EXPECT(kalman_batch_correct(&batch) == 0);
+    }
+
+    for (lane = 0; lane < KALMAN_BATCH_LANES; ++lane)
+    {
+        matrix_data_t g_estimated = kalman_batch_get(&batch.x, 2, 0, lane);
+        EXPECT(g_estimated > 9 && g_estimated < 10);
+    }
+
+    // lane 0 sees the same measurements as the scalar filter
+    const kalman_t *reference = run_gravity();
+    EXPECT(fabs(kalman_batch_get(&batch.x, 2, 0, 0) - reference->x.data[2]) < 1e-3);
+}
+
+/*!
+* \brief Tests the sequential processing of a measurement with a diagonal R
+*/
+void test_kalman_sequential()
+{
+    const matrix_data_t g_reference = run_gravity()->x.data[2];
+
+    kalman_t *kf = kalman_filter_gravity_init();
+    kalman_measurement_t *kfm = kalman_filter_gravity_measurement_position_init();
+    setup_gravity(kf, kfm);
+
+    // R is a scalar and thus diagonal
+    EXPECT(kalman_measurement_detect_diagonal_R(kfm));
+    EXPECT(kfm->flags & KALMAN_MEASUREMENT_FLAG_DIAGONAL_R);
+
+    for (int i = 0; i < MEAS_COUNT; ++i)
+    {
+        kalman_predict(kf);
+        matrix_set(&kfm->z, 0, 0, real_distance[i] + measurement_error[i]);
+        kalman_correct(kf, kfm);
+    }
+
+    // the scalar updates see the same values as the joint one
+    EXPECT(kf->x.data[2] > 9 && kf->x.data[2] < 10);
+    EXPECT(fabs(kf->x.data[2] - g_reference) < 1e-3);
+}
+
+#if KALMAN_UNITTESTS_CPP
+
+/*!
+* \brief Runs the gravity Kalman filter through the C++ front end.
+* \param[in] measurements The position measurements
+* \param[in] count The number of measurements
+* \return The estimated gravity constant
+*
+* Defined in kalman_unittests_cpp.cpp.
+*/
+matrix_data_t kalman_gravity_filter_cpp(const matrix_data_t *measurements, int count);
+
+/*!
+* \brief Tests the C++ front end against the C filter
+*/
+void test_kalman_cpp()
+{
+    matrix_data_t measurements[MEAS_COUNT];
+    for (int i = 0; i < MEAS_COUNT; ++i)
+    {
+        measurements[i] = real_distance[i] + measurement_error[i];
+    }
+
+    const matrix_data_t g_estimated = kalman_gravity_filter_cpp(measurements, MEAS_COUNT);
+    EXPECT(g_estimated > 9 && g_estimated < 10);
+
+    // the C filter sees the same measurements
+    EXPECT(fabs(g_estimated - run_gravity()->x.data[2]) < 1e-3);
+}
+
+#endif
+
+/*!
+* \brief Tests the per-stage statistics of the profiling
+*/
+void test_kalman_profile()
+{
+    kalman_stats_t stats;
+    uint_fast8_t stage;
+
+    // the filter is freshly initialized, hence the statistics are reset
+    const kalman_t *kf = run_gravity();
+    kalman_get_stats(kf, &stats);
+    for (stage = 0; stage < KALMAN_STAGE_COUNT; ++stage)
+    {
+#if KALMAN_PROFILE
+        EXPECT(stats.calls[stage] == MEAS_COUNT);
+#else
+        EXPECT(stats.calls[stage] == 0 && stats.ticks[stage] == 0);
+#endif
+    }
+
+    kalman_reset_stats(&kalman_filter_gravity);
+    kalman_get_stats(kf, &stats);
+    for (stage = 0; stage < KALMAN_STAGE_COUNT; ++stage)
+    {
+        EXPECT(stats.calls[stage] == 0 && stats.ticks[stage] == 0);
+    }
+}
+
+/*!
+* \brief Tests creating filters at runtime in an arena
+*/
+void test_kalman_arena()
+{
+    static uint8_t buffer[8192];
+    kalman_arena_t arena;
+
+    kalman_arena_init(&arena, buffer, sizeof(buffer));
+
+    kalman_t *kf = kalman_create(&arena, 3, 0);
+    kalman_measurement_t *kfm = kalman_measurement_create(&arena, 3, 1);
+    EXPECT(kf != NULL && kfm != NULL);
+    if (kf == NULL || kfm == NULL) return;
+    EXPECT(((uintptr_t)kf->A.data % KALMAN_ARENA_ALIGNMENT) == 0);
+    EXPECT(((uintptr_t)kfm->H.data % KALMAN_ARENA_ALIGNMENT) == 0);
+
+    setup_gravity(kf, kfm);
+    for (int i = 0; i < MEAS_COUNT; ++i)
+    {
+        kalman_predict(kf);
+        matrix_set(&kfm->z, 0, 0, real_distance[i] + measurement_error[i]);
+        kalman_correct(kf, kfm);
+    }
+
+    // the factory filter sees the same measurements
+    EXPECT(fabs(kf->x.data[2] - run_gravity()->x.data[2]) < 1e-6);
+
+    // released blocks are reused
+    const size_t used = arena.used;
+    kalman_t *released = kf;
+    kalman_measurement_destroy(&arena, kfm);
+    kalman_destroy(&arena, kf);
+
+    kf = kalman_create(&arena, 3, 0);
+    EXPECT(kf == released && arena.used == used);
+    EXPECT(kf != NULL && kf->x.data[2] == 0);
+    kalman_destroy(&arena, kf);
+
+    // exhausting the arena fails gracefully
+    EXPECT(kalman_create(&arena, 64, 0) == NULL);
+}
+
+/*!
+* \brief Tests the gravity filter with a packed state covariance
+*/
+void test_kalman_packed()
+{
+    const kalman_t *reference = run_gravity();
+
+    kalman_t *kf = kalman_filter_gravity_packed_init();
+    kalman_measurement_t *kfm = kalman_filter_gravity_packed_measurement_position_init();
+    EXPECT(matrix_is_packed(&kf->P) && sizeof(kalman_filter_gravity_packed_P_buffer) == 6 * sizeof(matrix_data_t));
+
+    setup_gravity(kf, kfm);
+    for (int i = 0; i < MEAS_COUNT; ++i)
+    {
+        kalman_predict(kf);
+        matrix_set(&kfm->z, 0, 0, real_distance[i] + measurement_error[i]);
+        kalman_correct(kf, kfm);
+    }
+
+    // the packed kernels see the same values as the symmetric ones
+    EXPECT(fabs(kf->x.data[2] - reference->x.data[2]) < 1e-4);
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            EXPECT(fabs(matrix_get_packed(&kf->P, i, j) - matrix_get(&reference->P, i, j)) < 1e-4);
+        }
+    }
+
+    // sequential processing and lambda tuning work on the packed covariance as well
+    kf = kalman_filter_gravity_packed_init();
+    kfm = kalman_filter_gravity_packed_measurement_position_init();
+    setup_gravity(kf, kfm);
+    kalman_measurement_detect_diagonal_R(kfm);
+
+    for (int i = 0; i < MEAS_COUNT; ++i)
+    {
+        kalman_predict_tuned(kf, (matrix_data_t)0.9);
+        matrix_set(&kfm->z, 0, 0, real_distance[i] + measurement_error[i]);
+        kalman_correct(kf, kfm);
+    }
+
+    EXPECT(kf->x.data[2] > 9 && kf->x.data[2] < 10);
+}
+
+/*!
+* \brief Number of independent gravity filters tiled into one large filter
+*/
+#define TILES (64)
+
+/*!
+* \brief Sets up a filter that estimates gravity in {\ref TILES} independent blocks of the 3-state model
+* \param[in] kf The zero-initialized filter with 3*{\ref TILES} states and 0 inputs
+* \param[in] kfm The zero-initialized measurement with {\ref TILES} outputs
+*/
+static void setup_gravity_tiled(kalman_t *kf, kalman_measurement_t *kfm)
+{
+    kalman_t *model = kalman_filter_gravity_init();
+    kalman_measurement_t *model_measurement = kalman_filter_gravity_measurement_position_init();
+    setup_gravity(model, model_measurement);
+
+    for (int tile = 0; tile < TILES; ++tile)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            matrix_set(&kf->x, 3 * tile + i, 0, matrix_get(&model->x, i, 0));
+            for (int j = 0; j < 3; ++j)
+            {
+                matrix_set(&kf->A, 3 * tile + i, 3 * tile + j, matrix_get(&model->A, i, j));
+                matrix_set(&kf->P, 3 * tile + i, 3 * tile + j, matrix_get(&model->P, i, j));
+            }
+            matrix_set(&kfm->H, tile, 3 * tile + i, matrix_get(&model_measurement->H, 0, i));
+        }
+        matrix_set(&kfm->R, tile, tile, matrix_get(&model_measurement->R, 0, 0));
+    }
+}
+
+#if KALMAN_THREADS
+
+/*!
+* \brief Sums up 0..i for every index i of a range, which takes longer for larger indices
+*/
+static void triangle_task(void *context, matrix_offset_t begin, matrix_offset_t end)
+{
+    uint64_t *sums = (uint64_t*)context;
+    for (matrix_offset_t i = begin; i < end; ++i)
+    {
+        uint64_t sum = 0;
+        for (matrix_offset_t k = 0; k <= i; ++k)
+        {
+            sum += k;
+        }
+        sums[i] = sum;
+    }
+}
+
+/*!
+* \brief The sums of the triangle task run from another thread
+*/
+static uint64_t triangle_thread_sums[1000];
+
+/*!
+* \brief Runs the triangle task on a pool from another thread
+*/
+static void* triangle_thread(void *argument)
+{
+    kalman_pool_parallel_for((kalman_pool_t*)argument, 1000, 7, triangle_task, triangle_thread_sums);
+    return NULL;
+}
+
+/*!
+* \brief Checks the sums of the triangle task
+* \param[in] sums The sums of 0..i for i < 1000
+*/
+static void expect_triangle(const uint64_t *sums)
+{
+    for (int i = 0; i < 1000; ++i)
+    {
+        EXPECT(sums[i] == (uint64_t)i * (i + 1) / 2);
+    }
+}
+
+#endif
+
+/*!
+* \brief Tests {\ref TILES} gravity filters as one large filter, with and without a thread pool
+*/
+void test_kalman_pool()
+{
+    static uint8_t buffer[2u << 20];
+    kalman_arena_t arena;
+
+    kalman_arena_init(&arena, buffer, sizeof(buffer));
+
+    kalman_t *kf_serial = kalman_create(&arena, 3 * TILES, 0);
+    kalman_measurement_t *kfm_serial = kalman_measurement_create(&arena, 3 * TILES, TILES);
+    kalman_t *kf_pool = kalman_create(&arena, 3 * TILES, 0);
+    kalman_measurement_t *kfm_pool = kalman_measurement_create(&arena, 3 * TILES, TILES);
+    EXPECT(kf_serial != NULL && kfm_serial != NULL && kf_pool != NULL && kfm_pool != NULL);
+    if (kf_serial == NULL || kfm_serial == NULL || kf_pool == NULL || kfm_pool == NULL) return;
+
+    setup_gravity_tiled(kf_serial, kfm_serial);
+    setup_gravity_tiled(kf_pool, kfm_pool);
+
+#if KALMAN_THREADS
+    // a caller-provided pool balances uneven chunks
+    static uint64_t sums[1000];
+    kalman_pool_t pool;
+    EXPECT(kalman_pool_init(&pool, 3) == 0);
+    kalman_pool_parallel_for(&pool, 1000, 7, triangle_task, sums);
+    expect_triangle(sums);
+
+    // loops submitted while the pool is busy run on their own thread
+    pthread_t submitter;
+    const int created = pthread_create(&submitter, NULL, triangle_thread, &pool);
+    EXPECT(created == 0);
+    kalman_pool_parallel_for(&pool, 1000, 7, triangle_task, sums);
+    if (created == 0)
+    {
+        pthread_join(submitter, NULL);
+        expect_triangle(triangle_thread_sums);
+    }
+    expect_triangle(sums);
+
+    // the built-in pool has one thread per CPU
+    kalman_pool_t *const builtin = kalman_pool_default();
+    EXPECT(builtin != NULL && builtin->num_threads >= 1);
+    EXPECT(3 * TILES >= KALMAN_POOL_THRESHOLD);
+#endif
+
+    for (int i = 0; i < MEAS_COUNT; ++i)
+    {
+        for (int tile = 0; tile < TILES; ++tile)
+        {
+            const matrix_data_t measurement = real_distance[i] + measurement_error[(i + tile) % MEAS_COUNT];
+            matrix_set(&kfm_serial->z, tile, 0, measurement);
+            matrix_set(&kfm_pool->z, tile, 0, measurement);
+        }
+
+        kalman_predict(kf_serial);
+        kalman_correct(kf_serial, kfm_serial);
+
+#if KALMAN_THREADS
+        kalman_pool_attach(&pool);
+#endif
+        kalman_predict(kf_pool);
+        kalman_correct(kf_pool, kfm_pool);
+#if KALMAN_THREADS
+        kalman_pool_attach(NULL);
+#endif
+    }
+
+    // every tile estimates gravity, and the row blocks see the same values as the serial kernels
+    for (int tile = 0; tile < TILES; ++tile)
+    {
+        const matrix_data_t g_estimated = matrix_get(&kf_pool->x, 3 * tile + 2, 0);
+        EXPECT(g_estimated > 9 && g_estimated < 10);
+    }
+    for (int i = 0; i < 3 * TILES; ++i)
+    {
+        EXPECT(fabs(matrix_get(&kf_pool->x, i, 0) - matrix_get(&kf_serial->x, i, 0)) < 1e-4);
+        for (int j = 0; j < 3 * TILES; ++j)
+        {
+            EXPECT(fabs(matrix_get(&kf_pool->P, i, j) - matrix_get(&kf_serial->P, i, j)) < 1e-4);
+            EXPECT(matrix_get(&kf_pool->P, i, j) == matrix_get(&kf_pool->P, j, i));
+        }
+    }
+
+#if KALMAN_THREADS
+    kalman_pool_destroy(&pool);
+#endif
+
+    kalman_measurement_destroy(&arena, kfm_pool);
+    kalman_destroy(&arena, kf_pool);
+    kalman_measurement_destroy(&arena, kfm_serial);
+    kalman_destroy(&arena, kf_serial);
+}
+
+#if KALMAN_THREADS
+
+/*!
+* \brief Number of filters per shape of the fleet test
+*/
+#define FLEET_FILTERS (24)
+
+/*!
+* \brief Tests gravity filters of two shapes run through a fleet executor against the plain filter
+*
+* Half of the filters measure the position once, the other half measure it with two sensors of the same variance.
+* The latter take their temporaries from one scratch area per thread.
+*/
+void test_kalman_fleet()
+{
+    static uint8_t buffer[256u << 10];
+    static matrix_data_t positions[MEAS_COUNT];
+    static matrix_data_t pairs[MEAS_COUNT][2];
+    static matrix_data_t scratch_buffers[3][KALMAN_SCRATCH_SIZE(3, 0, 2)];
+    kalman_scratch_t scratch[3];
+    kalman_arena_t arena;
+
+    kalman_arena_init(&arena, buffer, sizeof(buffer));
+
+    kalman_fleet_t *fleet = kalman_fleet_create(&arena, 2 * FLEET_FILTERS, 2 * FLEET_FILTERS * MEAS_COUNT);
+    EXPECT(fleet != NULL);
+    if (fleet == NULL) return;
+
+    // interleave the shapes so that the run list has to order them
+    uint_fast32_t ids[2 * FLEET_FILTERS];
+    for (int f = 0; f < 2 * FLEET_FILTERS; ++f)
+    {
+        const matrix_index_t outputs = (f & 1) ? 2 : 1;
+        kalman_t *kf = (f & 1) ? kalman_create_shared(&arena, 3, 0) : kalman_create(&arena, 3, 0);
+        kalman_measurement_t *kfm = (f & 1) ? kalman_measurement_create_shared(&arena, 3, outputs) : kalman_measurement_create(&arena, 3, outputs);
+        EXPECT(kf != NULL && kfm != NULL);
+        if (kf == NULL || kfm == NULL) return;
+
+        setup_gravity(kf, kfm);
+        if (outputs == 2)
+        {
+            matrix_set(&kfm->H, 1, 0, 1);
+            matrix_set(&kfm->R, 1, 1, (matrix_data_t)0.5);
+        }
+
+        ids[f] = kalman_fleet_register(fleet, kf, kfm);
+        EXPECT(ids[f] == (uint_fast32_t)f);
+    }
+    EXPECT(kalman_fleet_register(fleet, fleet->filters[0].kf, NULL) == KALMAN_FLEET_INVALID);
+
+    // queue all measurements at once; every filter still sees its own in order
+    for (int i = 0; i < MEAS_COUNT; ++i)
+    {
+        positions[i] = real_distance[i] + measurement_error[i];
+        pairs[i][0] = positions[i];
+        pairs[i][1] = positions[i];
+
+        for (int f = 0; f < 2 * FLEET_FILTERS; ++f)
+        {
+            EXPECT(kalman_fleet_submit(fleet, ids[f], NULL, (f & 1) ? pairs[i] : &positions[i], KALMAN_FLEET_PREDICT) == 0);
+        }
+    }
+    EXPECT(kalman_fleet_submit(fleet, ids[0], NULL, positions, 0) != 0);
+    EXPECT(kalman_fleet_submit(fleet, 2 * FLEET_FILTERS, NULL, positions, 0) != 0);
+
+    for (uint_fast8_t t = 0; t < 3; ++t)
+    {
+        kalman_scratch_init(&scratch[t], scratch_buffers[t], KALMAN_SCRATCH_SIZE(3, 0, 2));
+        kalman_fleet_set_scratch(fleet, t, &scratch[t]);
+    }
+
+    kalman_pool_t pool;
+    EXPECT(kalman_pool_init(&pool, 3) == 0);
+    kalman_fleet_run(fleet, &pool);
+    EXPECT(kalman_scratch_current() == NULL);
+    kalman_pool_destroy(&pool);
+
+    // all jobs ran exactly once, and the shape changed at most once per chunk
+    uint_fast32_t jobs = 0, filters = 0, shape_changes = 0;
+    for (uint_fast8_t t = 0; t < KALMAN_POOL_MAX_THREADS; ++t)
+    {
+        jobs += fleet->workers[t].jobs;
+        filters += fleet->workers[t].filters;
+        shape_changes += fleet->workers[t].shape_changes;
+    }
+    EXPECT(jobs == 2 * FLEET_FILTERS * MEAS_COUNT && filters == 2 * FLEET_FILTERS);
+    EXPECT(shape_changes <= (2 * FLEET_FILTERS + KALMAN_FLEET_GRAIN - 1) / KALMAN_FLEET_GRAIN + 1);
+    EXPECT(fleet->num_jobs == 0 && fleet->num_pending == 0);
+
+    // the single-sensor filters match the plain filter, the dual-sensor filters are at least as certain
+    const kalman_t *reference = run_gravity();
+    for (int f = 0; f < 2 * FLEET_FILTERS; ++f)
+    {
+        const kalman_t *kf = fleet->filters[ids[f]].kf;
+        const matrix_data_t g_estimated = kf->x.data[2];
+        EXPECT(g_estimated > 9 && g_estimated < 10);
+        if (f & 1)
+        {
+            EXPECT(matrix_get(&kf->P, 2, 2) <= matrix_get(&reference->P, 2, 2));
+        }
+        else
+        {
+            EXPECT(fabs(g_estimated - reference->x.data[2]) < 1e-6);
+        }
+    }
+
+    // an empty run does nothing, and jobs can be queued again
+    kalman_fleet_run(fleet, NULL);
+    EXPECT(fleet->workers[0].jobs == 0);
+    EXPECT(kalman_fleet_submit(fleet, ids[0], NULL, &positions[0], 0) == 0);
+    kalman_fleet_run(fleet, NULL);
+    EXPECT(fleet->workers[0].jobs == 1);
+
+    // a measurement structure belongs to one filter
+    EXPECT(kalman_fleet_submit(fleet, ids[0], fleet->filters[ids[2]].kfm, &positions[0], 0) != 0);
+    EXPECT(fleet->num_jobs == 0);
+
+    for (int f = 2 * FLEET_FILTERS - 1; f >= 0; --f)
+    {
+        kalman_measurement_destroy(&arena, fleet->filters[ids[f]].kfm);
+        kalman_destroy(&arena, fleet->filters[ids[f]].kf);
+    }
+    kalman_fleet_destroy(&arena, fleet);
+}
+
+#endif
+
+/*!
+* \brief Tests gravity filters that take their temporaries from a shared scratch area
+*/
+void test_kalman_scratch()
+{
+    static matrix_data_t scratch_buffer[KALMAN_SCRATCH_SIZE(3, 0, 1)];
+    static uint8_t buffer[8192];
+    kalman_scratch_t scratch;
+    kalman_arena_t arena;
+
+    const kalman_t *reference = run_gravity();
+
+    kalman_scratch_init(&scratch, scratch_buffer, sizeof(scratch_buffer) / sizeof(scratch_buffer[0]));
+    kalman_scratch_t *const previous = kalman_scratch_attach(&scratch);
+    EXPECT(kalman_scratch_current() == &scratch);
+
+    // two filters from the factory and the arena share the area; neither keeps state in it
+    kalman_t *kf_static = kalman_filter_gravity_shared_init();
+    kalman_measurement_t *kfm_static = kalman_filter_gravity_shared_measurement_position_init();
+    EXPECT((kf_static->flags & KALMAN_FLAG_SCRATCH) && (kfm_static->flags & KALMAN_MEASUREMENT_FLAG_SCRATCH));
+
+    kalman_arena_init(&arena, buffer, sizeof(buffer));
+    kalman_t *kf_arena = kalman_create_shared(&arena, 3, 0);
+    kalman_measurement_t *kfm_arena = kalman_measurement_create_shared(&arena, 3, 1);
+    EXPECT(kf_arena != NULL && kfm_arena != NULL);
+    EXPECT(kalman_create_shared_size(3, 0) < kalman_create_size(3, 0));
+    EXPECT(kalman_measurement_create_shared_size(3, 1) < kalman_measurement_create_size(3, 1));
+    if (kf_arena == NULL || kfm_arena == NULL)
+    {
+        kalman_scratch_attach(previous);
+        return;
+    }
+
+    setup_gravity(kf_static, kfm_static);
+    setup_gravity(kf_arena, kfm_arena);
+
+    for (int i = 0; i < MEAS_COUNT; ++i)
+    {
+        kalman_predict(kf_static);
+        kalman_predict(kf_arena);
+
+        matrix_set(&kfm_static->z, 0, 0, real_distance[i] + measurement_error[i]);
+        matrix_set(&kfm_arena->z, 0, 0, real_distance[i] + measurement_error[i]);
+
+        kalman_correct(kf_static, kfm_static);
+        kalman_correct(kf_arena, kfm_arena);
+    }
+
+    EXPECT(kf_static->temporary.P.data == scratch_buffer + KALMAN_SCRATCH_AUX(3));
+    EXPECT(kfm_arena->temporary.aux == scratch_buffer);
+    for (int i = 0; i < 3; ++i)
+    {
+        EXPECT(fabs(kf_static->x.data[i] - reference->x.data[i]) < 1e-6);
+        EXPECT(fabs(kf_arena->x.data[i] - reference->x.data[i]) < 1e-6);
+        for (int j = 0; j < 3; ++j)
+        {
+            EXPECT(fabs(matrix_get(&kf_static->P, i, j) - matrix_get(&reference->P, i, j)) < 1e-6);
+            EXPECT(fabs(matrix_get(&kf_arena->P, i, j) - matrix_get(&reference->P, i, j)) < 1e-6);
+        }
+    }
+
+    // the blocks are released by their flagged size
+    kalman_measurement_destroy(&arena, kfm_arena);
+    kalman_destroy(&arena, kf_arena);
+    EXPECT(kalman_create_shared(&arena, 3, 0) == kf_arena);
+
+    kalman_scratch_attach(previous);
+}
+
+/*!
+* \brief Tests the gravity filter with three measurements that share the temporaries of the filter
+*/
+void test_kalman_fused()
+{
+    kalman_t *kf = kalman_filter_gravity_fused_init();
+    kalman_measurement_t *kfm[3] =
+    {
+        kalman_filter_gravity_fused_measurement_single_init(),
+        kalman_filter_gravity_fused_measurement_quad_init(),
+        kalman_filter_gravity_fused_measurement_pair_init()
+    };
+
+    // one auxiliary vector for the 4 outputs of the largest measurement, one temporary for P (3x3) and the largest HP (4x3)
+    EXPECT(sizeof(kalman_filter_gravity_fused_aux_buffer) == 4 * sizeof(matrix_data_t));
+    EXPECT(sizeof(kalman_filter_gravity_fused_tempPBQ_buffer) == 12 * sizeof(matrix_data_t));
+    for (int k = 0; k < 3; ++k)
+    {
+        EXPECT(kfm[k]->temporary.aux == kf->temporary.aux);
+        EXPECT(kfm[k]->temporary.HP.data == kf->temporary.P.data);
+    }
+
+    // the footprint covers the structures, the persistent matrices of all measurements and the shared buffers
+    const size_t persistent = sizeof(kalman_t) + 3 * sizeof(kalman_measurement_t)
+                            + sizeof(matrix_data_t) * ((9 + 9 + 3)                        // A, P, x
+                                                     + (1 * 3 + 1 + 1 + 3 + 1 + 1)        // H, R, z, K, S, y
+                                                     + (4 * 3 + 16 + 4 + 12 + 16 + 4)
+                                                     + (2 * 3 + 4 + 2 + 6 + 4 + 2));
+    EXPECT(KALMAN_FILTER_BYTES(gravity_fused) == persistent + sizeof(kalman_filter_gravity_fused_aux_buffer)
+                                                 + sizeof(kalman_filter_gravity_fused_tempPBQ_buffer));
+
+    setup_gravity(kf, kfm[0]);
+    for (int k = 1; k < 3; ++k)
+    {
+        for (matrix_index_t row = 0; row < kfm[k]->H.rows; ++row)
+        {
+            matrix_set(&kfm[k]->H, row, 0, 1);
+            matrix_set(&kfm[k]->R, row, row, (matrix_data_t)0.5);
+        }
+    }
+
+    // the measurements take turns
+    for (int i = 0; i < MEAS_COUNT; ++i)
+    {
+        kalman_measurement_t *const measurement = kfm[i % 3];
+
+        kalman_predict(kf);
+        for (matrix_index_t row = 0; row < measurement->z.rows; ++row)
+        {
+            matrix_set(&measurement->z, row, 0, real_distance[i] + measurement_error[i]);
+        }
+        kalman_correct(kf, measurement);
+    }
+
+    EXPECT(kf->x.data[2] > 9 && kf->x.data[2] < 10);
+}
+
+/*!
+* \brief Tests sixteen instances of the gravity filter from one factory definition against the plain filter
+*/
+void test_kalman_instances()
+{
+    const kalman_t *reference = run_gravity();
+
+    EXPECT(kalman_filter_gravity_many_num_instances == 16);
+    for (int n = 0; n < kalman_filter_gravity_many_num_instances; ++n)
+    {
+        kalman_t *kf = kalman_filter_gravity_many_init(n);
+        kalman_measurement_t *kfm = kalman_filter_gravity_many_measurement_position_init(n);
+        setup_gravity(kf, kfm);
+
+        // the buffers of consecutive instances follow each other in one aligned block
+        EXPECT(kf == kalman_filter_gravity_many_get(n));
+        EXPECT(kf->A.data == kalman_filter_gravity_many_instances_buffer[n].A);
+        EXPECT(kfm->H.data == kalman_filter_gravity_many_measurement_position_instances_buffer[n].H);
+        EXPECT(kf->temporary.P.data == kalman_filter_gravity_many_get(0)->temporary.P.data);
+    }
+    EXPECT(((uintptr_t)kalman_filter_gravity_many_instances_buffer & 63) == 0);
+    EXPECT(sizeof(kalman_filter_gravity_many_instance_t) == (9 + 9 + 3) * sizeof(matrix_data_t));
+
+    // the footprint counts the persistent buffers once per instance, the temporaries once
+    EXPECT(KALMAN_FILTER_BYTES(gravity_many) == 16 * (sizeof(kalman_t) + sizeof(kalman_measurement_t)
+                                                      + sizeof(kalman_filter_gravity_many_instance_t)
+                                                      + sizeof(kalman_filter_gravity_many_measurement_position_instance_t))
+                                                + sizeof(kalman_filter_gravity_many_aux_buffer)
+                                                + sizeof(kalman_filter_gravity_many_tempPBQ_buffer));
+
+    // every step walks the instances in memory order
+    for (int i = 0; i < MEAS_COUNT; ++i)
+    {
+        for (int n = 0; n < kalman_filter_gravity_many_num_instances; ++n)
+        {
+            kalman_t *kf = kalman_filter_gravity_many_get(n);
+            kalman_measurement_t *kfm = kalman_filter_gravity_many_measurement_position_get(n);
+
+            kalman_predict(kf);
+            matrix_set(&kfm->z, 0, 0, real_distance[i] + measurement_error[i]);
+            kalman_correct(kf, kfm);
+        }
+    }
+
+    for (int n = 0; n < kalman_filter_gravity_many_num_instances; ++n)
+    {
+        const kalman_t *kf = &kalman_filter_gravity_many[n];
+        for (int i = 0; i < 3; ++i)
+        {
+            EXPECT(fabs(kf->x.data[i] - reference->x.data[i]) < 1e-6);
+            for (int j = 0; j < 3; ++j)
+            {
+                EXPECT(fabs(matrix_get(&kf->P, i, j) - matrix_get(&reference->P, i, j)) < 1e-6);
+            }
+        }
+    }
+}
+
+#if KALMAN_REGISTRY
+
+/*!
+* \brief Finds an entry of the runtime registry
+* \param[in] filter The name of the filter
+* \param[in] measurement The name of the measurement, or \c NULL for the filter itself
+* \param[out] count Receives the number of matching entries
+* \return The first matching entry, or \c NULL.
+*/
+static const kalman_registry_entry_t* find_registry_entry(const char *filter, const char *measurement, int *count)
+{
+    const kalman_registry_entry_t *found = NULL;
+    *count = 0;
+
+    for (const kalman_registry_entry_t *entry = kalman_registry_first(); entry != NULL; entry = entry->next)
+    {
+        if (strcmp(entry->filter, filter) != 0) continue;
+        if ((entry->measurement == NULL) != (measurement == NULL)) continue;
+        if (measurement != NULL && strcmp(entry->measurement, measurement) != 0) continue;
+
+        if (found == NULL) found = entry;
+        ++*count;
+    }
+    return found;
+}
+
+#endif
+
+/*!
+* \brief Tests the static footprints of factory filters and, if enabled, the runtime registry
+*/
+void test_kalman_footprint()
+{
+    // the filter alone and its measurements add up to the total
+    EXPECT(KALMAN_FILTER_BYTES(gravity_fused) == KALMAN_FILTER_ONLY_BYTES(gravity_fused)
+                                                 + KALMAN_MEASUREMENT_BYTES(gravity_fused, single)
+                                                 + KALMAN_MEASUREMENT_BYTES(gravity_fused, quad)
+                                                 + KALMAN_MEASUREMENT_BYTES(gravity_fused, pair));
+    EXPECT(KALMAN_MEASUREMENT_BYTES(gravity_fused, single) == sizeof(kalman_measurement_t) + (3 + 1 + 1 + 3 + 1 + 1) * sizeof(matrix_data_t));
+    EXPECT(KALMAN_FILTER_ONLY_BYTES(gravity_fused) == sizeof(kalman_t) + (9 + 9 + 3 + 4 + 12) * sizeof(matrix_data_t));
+
+    // instances are counted in full, the shared scratch area not at all
+    EXPECT(KALMAN_MEASUREMENT_BYTES(gravity_many, position) == 16 * KALMAN_MEASUREMENT_BYTES(gravity, position));
+    EXPECT(KALMAN_FILTER_ONLY_BYTES(gravity_shared) == sizeof(kalman_t) + (9 + 9 + 3) * sizeof(matrix_data_t));
+
+#if KALMAN_REGISTRY
+    // initializing again registers nothing twice
+    kalman_filter_gravity_fused_init();
+    kalman_filter_gravity_fused_measurement_quad_init();
+    kalman_filter_gravity_many_init(0);
+    kalman_filter_gravity_many_measurement_position_init(0);
+
+    int count;
+    const kalman_registry_entry_t *filter = find_registry_entry("gravity_fused", NULL, &count);
+    EXPECT(filter != NULL && count == 1);
+    if (filter != NULL)
+    {
+        EXPECT(filter->structure == &kalman_filter_gravity_fused);
+        EXPECT(filter->num_states == 3 && filter->num_inputs == 0 && filter->num_instances == 1);
+        EXPECT(filter->bytes == KALMAN_FILTER_ONLY_BYTES(gravity_fused));
+    }
+
+    const kalman_registry_entry_t *quad = find_registry_entry("gravity_fused", "quad", &count);
+    EXPECT(quad != NULL && count == 1);
+    if (quad != NULL)
+    {
+        EXPECT(quad->num_states == 3 && quad->num_measurements == 4);
+        EXPECT(quad->bytes == KALMAN_MEASUREMENT_BYTES(gravity_fused, quad));
+    }
+
+    const kalman_registry_entry_t *many = find_registry_entry("gravity_many", NULL, &count);
+    EXPECT(many != NULL && count == 1);
+    if (many != NULL)
+    {
+        EXPECT(many->num_instances == 16);
+        EXPECT(many->structure == &kalman_filter_gravity_many[0]);
+    }
+
+    size_t total = 0;
+    for (const kalman_registry_entry_t *entry = kalman_registry_first(); entry != NULL; entry = entry->next)
+    {
+        total += entry->bytes;
+    }
+    EXPECT(total == kalman_registry_total_bytes());
+    EXPECT(total >= KALMAN_FILTER_BYTES(gravity_fused) + KALMAN_FILTER_BYTES(gravity_many));
+#endif
+}
+
+/*!
+* \brief Sets up a constant velocity model with T = 0.1s, driven by white acceleration noise and measuring the position
+* \param[in] kf The zero-initialized filter with 2 states and 1 input
+* \param[in] kfm The zero-initialized measurement with 1 output
+*/
+static void setup_tracker(kalman_t *kf, kalman_measurement_t *kfm)
+{
+    const matrix_data_t T = (matrix_data_t)0.1;
+
+    // s = s + v*T, v = v
+    matrix_set(&kf->A, 0, 0, 1);
+    matrix_set(&kf->A, 0, 1, T);
+    matrix_set(&kf->A, 1, 1, 1);
+
+    // the acceleration enters position and velocity
+    matrix_set(&kf->B, 0, 0, (matrix_data_t)0.5*T*T);
+    matrix_set(&kf->B, 1, 0, T);
+    matrix_set(&kf->Q, 0, 0, (matrix_data_t)0.5);
+
+    matrix_set_symmetric(&kf->P, 0, 0, 10);
+    matrix_set_symmetric(&kf->P, 1, 1, 10);
+
+    // z = s
+    matrix_set(&kfm->H, 0, 0, 1);
+    matrix_set(&kfm->R, 0, 0, (matrix_data_t)0.25);
+}
+
+/*!
+* \brief Gets an arena for the filters of one tracker test, reusing the buffer of the previous one
+*
+* The tests take up to eight blocks of at most 2 KiB; the extra bytes cover aligning the start of the buffer.
+*/
+static kalman_arena_t* tracker_arena()
+{
+    static uint8_t buffer[16384 + KALMAN_ARENA_ALIGNMENT];
+    static kalman_arena_t arena;
+
+    kalman_arena_init(&arena, buffer, sizeof(buffer));
+    return &arena;
+}
+
+/*!
+* \brief Creates constant velocity trackers, see {\ref setup_tracker}
+* \param[in] arena The arena
+* \param[in] count The number of trackers
+* \param[out] kf The filters
+* \param[out] kfm Their measurements
+* \return Nonzero if all trackers were created
+*/
+static int create_trackers(kalman_arena_t *arena, int count, kalman_t *kf[], kalman_measurement_t *kfm[])
+{
+    for (int k = 0; k < count; ++k)
+    {
+        kf[k] = kalman_create(arena, 2, 1);
+        kfm[k] = kalman_measurement_create(arena, 2, 1);
+        EXPECT(kf[k] != NULL && kfm[k] != NULL);
+        if (kf[k] == NULL || kfm[k] == NULL) return 0;
+
+        setup_tracker(kf[k], kfm[k]);
+    }
+    return 1;
+}
+
+/*!
+* \brief Gets the measured position of the tracked target, moving at 2 units per second with some noise
+* \param[in] i The index of the measurement, taken every 0.1 seconds
+*/
+static matrix_data_t target_position(int i)
+{
+    return (matrix_data_t)(2.0 * 0.1 * i + 0.3 * sin(1.7 * i));
+}
+
+/*!
+* \brief Checks that two trackers agree, relative to the magnitude of their covariances
+* \param[in] a The reference
+* \param[in] b The filter to check
+* \param[in] x_tolerance The largest difference of the states
+* \param[in] P_tolerance The largest difference of the covariances, relative to the reference
+*/
+static void expect_same(const kalman_t *a, const kalman_t *b, double x_tolerance, double P_tolerance)
+{
+    for (int i = 0; i < 2; ++i)
+    {
+        EXPECT(fabs(a->x.data[i] - b->x.data[i]) < x_tolerance);
+        for (int j = 0; j < 2; ++j)
+        {
+            const matrix_data_t expected = matrix_get(&a->P, i, j);
+            EXPECT(fabs(matrix_get(&b->P, i, j) - expected) <= P_tolerance * (1 + fabs(expected)));
+        }
+    }
+}
+
+/*!
+* \brief Tests a time-invariant filter running into its steady state, detected at runtime and solved up front
+*/
+void test_kalman_steady_state()
+{
+    static matrix_data_t previous_K[2][2];
+    kalman_arena_t *const arena = tracker_arena();
+
+    // reference without tracking, one filter that detects convergence, one that starts in the steady state
+    kalman_t *kf[3];
+    kalman_measurement_t *kfm[3];
+    if (!create_trackers(arena, 3, kf, kfm)) return;
+
+    kalman_measurement_track_steady_state(kfm[1], previous_K[0], (matrix_data_t)1e-5, 5);
+    kalman_measurement_track_steady_state(kfm[2], previous_K[1], (matrix_data_t)1e-5, 5);
+    EXPECT(kalman_solve_steady_state(kf[2], kfm[2], 1000) == 0);
+    EXPECT((kf[2]->flags & KALMAN_FLAG_STEADY_STATE) && (kfm[2]->flags & KALMAN_MEASUREMENT_FLAG_STEADY_STATE));
+    EXPECT(kf[2]->x.data[0] == 0 && kf[2]->x.data[1] == 0);
+
+    int entered = -1;
+    for (int i = 0; i < 400; ++i)
+    {
+        const matrix_data_t position = target_position(i);
+        for (int k = 0; k < 3; ++k)
+        {
+            kalman_predict(kf[k]);
+            matrix_set(&kfm[k]->z, 0, 0, position);
+            kalman_correct(kf[k], kfm[k]);
+        }
+
+        if (entered < 0 && (kf[1]->flags & KALMAN_FLAG_STEADY_STATE))
+        {
+            entered = i;
+        }
+    }
+
+    // the detector switched once the gain settled, and both steady filters apply the reference's converged gain
+    EXPECT(entered > 5 && entered < 400);
+    EXPECT(!(kf[0]->flags & KALMAN_FLAG_STEADY_STATE));
+    EXPECT(kf[0]->tracked == NULL && kf[1]->tracked == kfm[1] && kf[2]->tracked == kfm[2]);
+    for (int i = 0; i < 2; ++i)
+    {
+        EXPECT(fabs(kfm[1]->K.data[i] - kfm[0]->K.data[i]) < 1e-4);
+        EXPECT(fabs(kfm[2]->K.data[i] - kfm[0]->K.data[i]) < 1e-4);
+    }
+    expect_same(kf[0], kf[1], 1e-2, 1e-4);
+    EXPECT(fabs(kf[1]->x.data[1] - 2) < 0.2);
+
+    // the steady filter that started from zero has caught up with the measurements
+    expect_same(kf[0], kf[2], 1e-2, 1e-4);
+
+    // leaving the steady state propagates P again, and the next correction recomputes the gain
+    const matrix_data_t p00 = matrix_get(&kf[2]->P, 0, 0);
+    kalman_leave_steady_state(kf[2]);
+    kalman_predict(kf[2]);
+    EXPECT(matrix_get(&kf[2]->P, 0, 0) > p00);
+    kalman_correct(kf[2], kfm[2]);
+    EXPECT(!(kfm[2]->flags & KALMAN_MEASUREMENT_FLAG_STEADY_STATE));
+    EXPECT(fabs(matrix_get(&kf[2]->P, 0, 0) - p00) < 1e-4);
+
+    // reading the model keeps the steady state
+    EXPECT(kalman_read_state_transition(kf[1]) == &kf[1]->A && kalman_get_input_covariance(kf[1]) == &kf[1]->Q);
+    EXPECT(kalman_read_process_noise(kfm[1]) == &kfm[1]->R && kalman_get_measurement_transformation(kfm[1]) == &kfm[1]->H);
+    EXPECT((kf[1]->flags & KALMAN_FLAG_STEADY_STATE) && (kfm[1]->flags & KALMAN_MEASUREMENT_FLAG_STEADY_STATE));
+
+    // predictions in the steady state skip P; correcting with another measurement first runs what was skipped
+    EXPECT(kf[1]->flags & KALMAN_FLAG_STEADY_STATE);
+    kalman_measurement_t *velocity[2];
+    for (int k = 0; k < 2; ++k)
+    {
+        velocity[k] = kalman_measurement_create(arena, 2, 1);
+        EXPECT(velocity[k] != NULL);
+        if (velocity[k] == NULL) return;
+
+        matrix_set(&velocity[k]->H, 0, 1, 1);
+        matrix_set(&velocity[k]->R, 0, 0, (matrix_data_t)0.1);
+        matrix_set(&velocity[k]->z, 0, 0, 2);
+
+        for (int i = 0; i < 3; ++i)
+        {
+            kalman_predict(kf[k]);
+        }
+    }
+    EXPECT(kf[1]->pending == 3);
+    kalman_correct(kf[0], velocity[0]);
+    kalman_correct(kf[1], velocity[1]);
+    EXPECT(!(kf[1]->flags & KALMAN_FLAG_STEADY_STATE) && kf[1]->pending == 0);
+    expect_same(kf[0], kf[1], 1e-2, 1e-4);
+
+    // changing R leaves the steady state of the measurement and then of the filter
+    kalman_set_process_noise(kfm[1], 0, 0, 1);
+    EXPECT(!(kfm[1]->flags & KALMAN_MEASUREMENT_FLAG_STEADY_STATE) && kfm[1]->steady.count == 0);
+    kalman_predict(kf[1]);
+    kalman_correct(kf[1], kfm[1]);
+    EXPECT(!(kf[1]->flags & KALMAN_FLAG_STEADY_STATE));
+
+    // a prediction without fading is skipped like a plain one, a fading factor leaves the steady state
+    EXPECT(kalman_solve_steady_state(kf[2], kfm[2], 1000) == 0);
+    kalman_predict_tuned(kf[2], 1);
+    EXPECT((kf[2]->flags & KALMAN_FLAG_STEADY_STATE) && kf[2]->pending == 1);
+    const matrix_data_t p11 = matrix_get(&kf[2]->P, 1, 1);
+    kalman_predict_tuned(kf[2], (matrix_data_t)0.9);
+    EXPECT(!(kf[2]->flags & KALMAN_FLAG_STEADY_STATE) && kf[2]->pending == 0);
+    EXPECT(!(kfm[2]->flags & KALMAN_MEASUREMENT_FLAG_STEADY_STATE) && kfm[2]->steady.count == 0);
+    EXPECT(matrix_get(&kf[2]->P, 1, 1) > p11 / (0.9 * 0.9));
+}
+
+/*!
+* \brief Tests the cached input noise B*Q*B' following the model
+*/
+void test_kalman_cache()
+{
+    static matrix_data_t BQB[2*2];
+
+    // one filter calculating B*Q*B' in every prediction, one keeping it
+    kalman_t *kf[2];
+    kalman_measurement_t *kfm[2];
+    if (!create_trackers(tracker_arena(), 2, kf, kfm)) return;
+
+    kalman_cache_input_noise(kf[1], BQB);
+    kalman_set_lambda(kf[1], (matrix_data_t)0.98);
+
+    // filter! halfway through, the input noise is raised on both filters
+    for (int i = 0; i < 200; ++i)
+    {
+        const matrix_data_t position = target_position(i);
+        if (i == 100)
+        {
+            const uint_fast32_t version = kf[1]->model_version;
+            kalman_set_input_covariance(kf[0], 0, 0, 2);
+            kalman_set_input_covariance(kf[1], 0, 0, 2);
+            EXPECT(kf[1]->model_version != version && kf[1]->cache.BQB_version == version);
+        }
+
+        for (int k = 0; k < 2; ++k)
+        {
+            kalman_predict_tuned(kf[k], (matrix_data_t)0.98);
+            matrix_set(&kfm[k]->z, 0, 0, position);
+            kalman_correct(kf[k], kfm[k]);
+        }
+    }
+
+    // the cache follows the model, and both filters agree
+    EXPECT(kf[1]->cache.BQB_version == kf[1]->model_version);
+    EXPECT(fabs(kf[1]->cache.lambda_scale - 1 / (0.98 * 0.98)) < 1e-5);
+    EXPECT(fabs(matrix_get(&kf[1]->cache.BQB, 1, 1) - 2 * 0.1 * 0.1) < 1e-6);
+    expect_same(kf[0], kf[1], 1e-4, 1e-5);
+}
+
+/*!
+* \brief Tests multi-step predictions bridging sensor outages against predicting step by step
+*/
+void test_kalman_multistep()
+{
+    static matrix_data_t cache_buffer[KALMAN_MULTISTEP_SIZE(2, 1)];
+    kalman_multistep_t ms;
+
+    // one filter predicting step by step, one bridging outages at once
+    kalman_t *kf[2];
+    kalman_measurement_t *kfm[2];
+    if (!create_trackers(tracker_arena(), 2, kf, kfm)) return;
+    kalman_cache_multistep(kf[1], &ms, cache_buffer, sizeof(cache_buffer) / sizeof(cache_buffer[0]));
+
+    // outages of varying length between runs of 20 measurements; the input noise is raised before the last one
+    const uint_fast32_t outages[] = { 100, 37, 100, 5, 100, 100 };
+    int i = 0;
+    for (size_t outage = 0; outage < sizeof(outages) / sizeof(outages[0]); ++outage)
+    {
+        for (int step = 0; step < 20; ++step, ++i)
+        {
+            const matrix_data_t position = target_position(i);
+            for (int k = 0; k < 2; ++k)
+            {
+                kalman_predict(kf[k]);
+                matrix_set(&kfm[k]->z, 0, 0, position);
+                kalman_correct(kf[k], kfm[k]);
+            }
+        }
+
+        if (outage == 5)
+        {
+            kalman_set_input_covariance(kf[0], 0, 0, 2);
+            kalman_set_input_covariance(kf[1], 0, 0, 2);
+        }
+
+        for (uint_fast32_t step = 0; step < outages[outage]; ++step)
+        {
+            kalman_predict(kf[0]);
+        }
+        kalman_predict_n(kf[1], outages[outage]);
+        i += (int)outages[outage];
+
+        expect_same(kf[0], kf[1], 1e-3, 1e-4);
+    }
+
+    // 100 steps were calculated once per model, 37 and 5 once each
+    EXPECT(ms.misses == 4 && ms.hits == 2);
+
+    // the filters still track the target after the outages
+    EXPECT(fabs(kf[1]->x.data[1] - 2) < 0.2);
+}
+
+/*!
+* \brief Tests the continuous-time model with irregular time steps against a closed-form discretization
+*/
+void test_kalman_continuous()
+{
+    static matrix_data_t model_buffer[KALMAN_CONTINUOUS_SIZE(2, 1)];
+    kalman_continuous_t ct;
+    kalman_arena_t *const arena = tracker_arena();
+
+    // a reference discretized by hand with B = I, and a filter with the continuous-time model
+    kalman_t *kf[2];
+    kalman_measurement_t *kfm[2];
+    for (int k = 0; k < 2; ++k)
+    {
+        kf[k] = kalman_create(arena, 2, (matrix_index_t)(2 - k));
+        kfm[k] = kalman_measurement_create(arena, 2, 1);
+        EXPECT(kf[k] != NULL && kfm[k] != NULL);
+        if (kf[k] == NULL || kfm[k] == NULL) return;
+
+        matrix_set_symmetric(&kf[k]->P, 0, 0, 10);
+        matrix_set_symmetric(&kf[k]->P, 1, 1, 10);
+        matrix_set(&kfm[k]->H, 0, 0, 1);
+        matrix_set(&kfm[k]->R, 0, 0, (matrix_data_t)0.25);
+    }
+    kalman_set_input_transition(kf[0], 0, 0, 1);
+    kalman_set_input_transition(kf[0], 1, 1, 1);
+
+    // ds/dt = v, dv/dt = w, with white acceleration noise w of density q
+    matrix_data_t q = (matrix_data_t)0.5;
+    kalman_continuous_init(kf[1], &ct, (matrix_data_t)1e-3, model_buffer, sizeof(model_buffer) / sizeof(model_buffer[0]));
+    kalman_set_continuous_transition(kf[1], 0, 1, 1);
+    kalman_set_input_transition(kf[1], 1, 0, 1);
+    kalman_set_input_covariance(kf[1], 0, 0, q);
+
+    // filter! irregular timestamps jittering around 100 ms; the noise density is raised halfway through
+    matrix_data_t t = 0;
+    for (int i = 0; i < 200; ++i)
+    {
+        if (i == 100)
+        {
+            q = 2;
+            kalman_set_input_covariance(kf[1], 0, 0, q);
+        }
+
+        const matrix_data_t dt = (matrix_data_t)(0.1 + 0.002 * ((i * 7) % 5 - 2));
+        t += dt;
+
+        // A = [1 dt; 0 1], Qd = q*[dt^3/3 dt^2/2; dt^2/2 dt] for the rounded time step
+        const matrix_data_t T = (matrix_data_t)((uint_fast32_t)(dt / (matrix_data_t)1e-3 + (matrix_data_t)0.5)) * (matrix_data_t)1e-3;
+        kalman_set_state_transition(kf[0], 0, 0, 1);
+        kalman_set_state_transition(kf[0], 0, 1, T);
+        kalman_set_state_transition(kf[0], 1, 1, 1);
+        kalman_set_input_covariance(kf[0], 0, 0, q*T*T*T / 3);
+        kalman_set_input_covariance(kf[0], 0, 1, q*T*T / 2);
+        kalman_set_input_covariance(kf[0], 1, 1, q*T);
+
+        kalman_predict(kf[0]);
+        kalman_predict_dt(kf[1], dt);
+
+        const matrix_data_t position = (matrix_data_t)(2.0 * t + 0.3 * sin(1.7 * i));
+        for (int k = 0; k < 2; ++k)
+        {
+            matrix_set(&kfm[k]->z, 0, 0, position);
+            kalman_correct(kf[k], kfm[k]);
+        }
+    }
+
+    // the exponential matches the closed form
+    expect_same(kf[0], kf[1], 1e-3, 1e-3);
+    EXPECT(fabs(kf[1]->x.data[1] - 2) < 0.2);
+
+    // five distinct time steps, discretized once before and once after the change of the noise
+    EXPECT(ct.misses == 10 && ct.hits == 190);
+
+    // a time step rounding to zero does nothing
+    const matrix_data_t s = kf[1]->x.data[0];
+    kalman_predict_dt(kf[1], (matrix_data_t)1e-4);
+    EXPECT(kf[1]->x.data[0] == s && ct.misses == 10);
+
+    // a long time step within the bound of the squarings is still exact
+    const matrix_data_t v = kf[1]->x.data[1];
+    kalman_predict_dt(kf[1], 50);
+    EXPECT(fabs(kf[1]->x.data[0] - (s + 50 * v)) < 1e-2 * (1 + fabs(s)));
+    EXPECT(fabs(kf[1]->x.data[1] - v) < 1e-4 * (1 + fabs(v)));
+}
+
+/*!
+* \brief Tests the lazy covariance propagation against propagating in every prediction
+*/
+void test_kalman_lazy()
+{
+    static matrix_data_t cache_buffer[KALMAN_MULTISTEP_SIZE(2, 1)];
+    kalman_multistep_t ms;
+
+    // one filter propagating P in every prediction, one deferring it until P is needed
+    kalman_t *kf[2];
+    kalman_measurement_t *kfm[2];
+    if (!create_trackers(tracker_arena(), 2, kf, kfm)) return;
+    kalman_cache_multistep(kf[1], &ms, cache_buffer, sizeof(cache_buffer) / sizeof(cache_buffer[0]));
+    kalman_set_lazy(kf[1], 1);
+
+    // filter! ten predictions per measurement, each one read by a consumer of x only
+    for (int i = 0; i < 400; ++i)
+    {
+        for (int k = 0; k < 2; ++k)
+        {
+            kalman_predict(kf[k]);
+        }
+        EXPECT(fabs(kf[1]->x.data[0] - kf[0]->x.data[0]) < 1e-3);
+
+        if (i == 200)
+        {
+            // a model change runs the pending propagations with the old model first
+            EXPECT(kf[1]->pending == 1);
+            kalman_set_input_covariance(kf[0], 0, 0, 2);
+            kalman_set_input_covariance(kf[1], 0, 0, 2);
+            EXPECT(kf[1]->pending == 0);
+        }
+
+        if (i % 10 == 9)
+        {
+            const matrix_data_t position = target_position(i);
+            for (int k = 0; k < 2; ++k)
+            {
+                matrix_set(&kfm[k]->z, 0, 0, position);
+                kalman_correct(kf[k], kfm[k]);
+            }
+            EXPECT(kf[1]->pending == 0);
+            expect_same(kf[0], kf[1], 1e-3, 1e-4);
+        }
+    }
+
+    // ten propagations were coalesced for every measurement but the one interrupted by the model change
+    EXPECT(ms.hits + ms.misses == 40);
+    EXPECT(ms.misses == 3);
+
+    // fetching P runs the pending propagations
+    kalman_predict(kf[0]);
+    kalman_predict(kf[0]);
+    kalman_predict(kf[1]);
+    kalman_predict(kf[1]);
+    EXPECT(kf[1]->pending == 2);
+    const matrix_t *const P = kalman_get_system_covariance(kf[1]);
+    EXPECT(P == &kf[1]->P && kf[1]->pending == 0);
+    expect_same(kf[0], kf[1], 1e-3, 1e-4);
+    EXPECT(fabs(kf[1]->x.data[1] - 2) < 0.2);
+
+    // tuned predictions defer without fading, and run the pending propagations before fading
+    kalman_predict_tuned(kf[1], 1);
+    EXPECT(kf[1]->pending == 1);
+    kalman_predict_tuned(kf[0], 1);
+    kalman_predict_tuned(kf[0], (matrix_data_t)0.98);
+    kalman_predict_tuned(kf[1], (matrix_data_t)0.98);
+    EXPECT(kf[1]->pending == 0);
+    expect_same(kf[0], kf[1], 1e-3, 1e-4);
+
+    // leaving the lazy mode
+    kalman_predict(kf[1]);
+    kalman_set_lazy(kf[1], 0);
+    EXPECT(kf[1]->pending == 0 && !(kf[1]->flags & KALMAN_FLAG_LAZY));
+}
+
+/*!
+* \brief Unit tests for the filter operations
+* \return The number of failed checks
+*/
+int kalman_unittests()
+{
+    test_kalman_batch();
+    test_kalman_sequential();
+#if KALMAN_UNITTESTS_CPP
+    test_kalman_cpp();
+#endif
+    test_kalman_profile();
+    test_kalman_arena();
+    test_kalman_packed();
+    test_kalman_pool();
+#if KALMAN_THREADS
+    test_kalman_fleet();
+#endif
+    test_kalman_scratch();
+    test_kalman_fused();
+    test_kalman_instances();
+    test_kalman_footprint();
+    test_kalman_steady_state();
+    test_kalman_cache();
+    test_kalman_multistep();
+    test_kalman_continuous();
+    test_kalman_lazy();
+
+    return failures;
+}
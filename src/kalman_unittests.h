@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#ifndef KALMAN_UNITTESTS_H_
+#define KALMAN_UNITTESTS_H_
+
+/*!
+* \brief Unit tests for the filter operations
+* \return The number of failed checks
+*/
+int kalman_unittests();
+
+#endif
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+/*!
+* \brief The gravity filter of the unit tests, using the C++ front end.
+*/
+
+#include "kalman.hpp"
+
+/*!
+* \brief Runs the gravity Kalman filter through the C++ front end.
+* \param[in] measurements The position measurements
+* \param[in] count The number of measurements
+* \return The estimated gravity constant, or zero if a correction failed
+*
+* The first half of the measurements is processed by the C++ kernels, the second half by the
+* C functions operating on the very same state.
+*/
+extern "C" matrix_data_t kalman_gravity_filter_cpp(const matrix_data_t *measurements, int count)
+{
+    kalman::Filter<3> filter;
+    kalman::Measurement<kalman::Filter<3>, 1> position;
+
+    // set initial state
+    filter.x()[2] = 6; // g_i
+
+    // set state transition
+    const matrix_data_t T = 1;
+    auto &A = filter.A();
+    A(0, 0) = 1;    A(0, 1) = T;    A(0, 2) = (matrix_data_t)0.5*T*T;
+                    A(1, 1) = 1;    A(1, 2) = T;
+                                    A(2, 2) = 1;
+
+    // set covariance
+    auto &P = filter.P();
+    P(0, 0) = (matrix_data_t)0.1;
+    P(1, 1) = 1;
+    P(2, 2) = 1;
+
+    // set measurement transformation and process noise
+    position.H()(0, 0) = 1;
+    position.R()(0, 0) = (matrix_data_t)0.5;
+
+    for (int i = 0; i < count; ++i)
+    {
+        position.z()[0] = measurements[i];
+
+        if (i < count / 2)
+        {
+            filter.predict();
+            if (!filter.correct(position)) return 0;
+        }
+        else
+        {
+            kalman_predict(&filter.c_filter());
+            kalman_correct(&filter.c_filter(), &position.c_measurement());
+        }
+    }
+
+    return filter.x()[2];
+}
@@ -9,6 +9,64 @@
 
 #define EXTERN_INLINE_MATRIX static INLINE
 #include "matrix.h"
+#include "matrix_simd.h"
+
+#if MATRIX_SIMD_X86
+
+/*!
+* \brief The selected kernels; all \c NULL selects the scalar kernels.
+*/
+static matrix_simd_kernels_t matrix_simd_kernels = { 0 };
+
+#endif
+
+/*!
+* \brief The selected SIMD level.
+*/
+static matrix_simd_level_t matrix_simd_level = MATRIX_SIMD_SCALAR;
+
+#if MATRIX_SIMD_X86
+
+/*!
+* \brief Selects the best supported kernels once at program start, before any thread can multiply.
+*/
+static __attribute__((constructor)) void matrix_simd_startup(void)
+{
+    matrix_simd_level = matrix_simd_detect();
+    matrix_simd_kernels = *matrix_simd_kernels_of(matrix_simd_level);
+}
+
+#endif
+
+/*!
+* \brief Gets the SIMD level selected at program start.
+* \return The selected level.
+*/
+matrix_simd_level_t matrix_simd_get_level(void)
+{
+    return matrix_simd_level;
+}
+
+#if KALMAN_SIMD_TESTING
+
+/*!
+* \brief Selects the kernels of the given SIMD level.
+* \param[in] level The level to select.
+* \return Zero in case of success, nonzero if the level is not supported. In that case the selection is left unchanged.
+*/
+int matrix_simd_select(matrix_simd_level_t level)
+{
+    const matrix_simd_kernels_t *const kernels = matrix_simd_kernels_of(level);
+    if (kernels == 0) return 1;
+
+#if MATRIX_SIMD_X86
+    matrix_simd_kernels = *kernels;
+#endif
+    matrix_simd_level = level;
+    return 0;
+}
+
+#endif
 
 /**
 * \brief Initializes a matrix structure.
@@ -17,13 +75,90 @@
 * \param[in] cols The number of columns
 * \param[in] buffer The data buffer (of size {\see rows} x {\see cols}).
 */
-void matrix_init(matrix_t * mat, uint_fast8_t rows, uint_fast8_t cols, matrix_data_t * buffer)
+void matrix_init(matrix_t * mat, matrix_index_t rows, matrix_index_t cols, matrix_data_t * buffer)
+{
+    mat->cols = cols;
+    mat->rows = rows;
+    mat->stride = cols;
+    mat->data = buffer;
+}
+
+/**
+* \brief Initializes a matrix structure with padded rows.
+* \param[in] mat The matrix to initialize
+* \param[in] rows The number of rows
+* \param[in] cols The number of columns
+* \param[in] stride The distance in elements between the starts of two consecutive rows; must not be less than {\see cols}.
+* \param[in] buffer The data buffer (of size {\see rows} x {\see stride}).
+*/
+void matrix_init_strided(matrix_t * mat, matrix_index_t rows, matrix_index_t cols, matrix_offset_t stride, matrix_data_t * buffer)
 {
+    assert(stride >= cols);
+
     mat->cols = cols;
     mat->rows = rows;
+    mat->stride = stride;
+    mat->data = buffer;
+}
+
+/**
+* \brief Initializes a symmetric matrix structure stored as its packed upper triangle.
+* \param[in] mat The matrix to initialize
+* \param[in] n The number of rows and columns
+* \param[in] buffer The data buffer (of size {\ref MATRIX_PACKED_SIZE} of {\see n}).
+*/
+void matrix_init_packed(matrix_t * mat, matrix_index_t n, matrix_data_t * buffer)
+{
+    mat->cols = n;
+    mat->rows = n;
+    mat->stride = MATRIX_STRIDE_PACKED;
     mat->data = buffer;
 }
 
+/**
+* \brief Creates a view of a rectangular block of a matrix without copying.
+* \param[in] mat The matrix to view into
+* \param[in] row The first row of the block
+* \param[in] col The first column of the block
+* \param[in] rows The number of rows of the block
+* \param[in] cols The number of columns of the block
+* \param[out] view The view; it shares the data and the stride of {\ref mat}.
+*/
+void matrix_view_submatrix(const matrix_t *const mat, matrix_index_t row, matrix_index_t col, matrix_index_t rows, matrix_index_t cols, matrix_t *const view)
+{
+    assert(row + rows <= mat->rows);
+    assert(col + cols <= mat->cols);
+
+    view->cols = cols;
+    view->rows = rows;
+    view->stride = mat->stride;
+    view->data = &mat->data[row * mat->stride + col];
+}
+
+/**
+* \brief Creates a view of consecutive rows of a matrix without copying.
+* \param[in] mat The matrix to view into
+* \param[in] row The first row of the block
+* \param[in] rows The number of rows of the block
+* \param[out] view The view; it shares the data and the stride of {\ref mat}.
+*/
+void matrix_view_rows(const matrix_t *const mat, matrix_index_t row, matrix_index_t rows, matrix_t *const view)
+{
+    matrix_view_submatrix(mat, row, 0, rows, mat->cols, view);
+}
+
+/**
+* \brief Creates a view of consecutive columns of a matrix without copying.
+* \param[in] mat The matrix to view into
+* \param[in] col The first column of the block
+* \param[in] cols The number of columns of the block
+* \param[out] view The view; it shares the data and the stride of {\ref mat}.
+*/
+void matrix_view_columns(const matrix_t *const mat, matrix_index_t col, matrix_index_t cols, matrix_t *const view)
+{
+    matrix_view_submatrix(mat, 0, col, mat->rows, cols, view);
+}
+
 /**
 * \brief Inverts a lower triangular matrix.
 * \param[in] lower The lower triangular matrix to be inverted.
@@ -33,8 +168,10 @@ void matrix_init(matrix_t * mat, uint_fast8_t rows, uint_fast8_t cols, matrix_da
 */
 void matrix_invert_lower(const matrix_t *RESTRICT const lower, matrix_t *RESTRICT inverse)
 {
-    int_fast8_t i, j, k;
-    const uint_fast8_t n = lower->rows;
+    matrix_soffset_t i, j, k;
+    const matrix_index_t n = lower->rows;
+    const matrix_offset_t ts = lower->stride;
+    const matrix_offset_t as = inverse->stride;
     const matrix_data_t *const  t = lower->data;
     matrix_data_t *a = inverse->data;
 
@@ -42,32 +179,268 @@ void matrix_invert_lower(const matrix_t *RESTRICT const lower, matrix_t *RESTRIC
 
     // inverts the lower triangular system and saves the result
     // in the upper triangle to minimize cache misses
-    for(i =0; i < n; ++i )
+    for(i =0; i < (matrix_soffset_t)n; ++i )
     {
-        const matrix_data_t el_ii = t[i*n+i];
+        const matrix_data_t el_ii = t[i*ts+i];
         for(j = 0; j <= i; ++j )
         {
             matrix_data_t sum = (i==j) ? (matrix_data_t)1.0 : (matrix_data_t)0;
             for(k=i-1; k >=j; --k )
             {
-                sum -= t[i*n+k]*a[j*n+k];
+                sum -= t[i*ts+k]*a[j*as+k];
             }
-            a[j*n+i] = sum / el_ii;
+            a[j*as+i] = sum / el_ii;
         }
     }
     // solve the system and handle the previous solution being in the upper triangle
     // takes advantage of symmetry
     for(i=n-1; i>=0; --i )
     {
-        const matrix_data_t el_ii = t[i*n+i];
+        const matrix_data_t el_ii = t[i*ts+i];
         for(j = 0; j <= i; ++j )
         {
-            matrix_data_t sum = (i<j) ? 0 : a[j*n+i];
-            for(k=i+1; k<n; ++k)
+            matrix_data_t sum = (i<j) ? 0 : a[j*as+i];
+            for(k=i+1; k<(matrix_soffset_t)n; ++k)
+            {
+                sum -= t[k*ts+i]*a[j*as+k];
+            }
+            a[i*as+j] = a[j*as+i] = sum / el_ii;
+        }
+    }
+}
+
+/************************************************************************/
+/* Cache-blocked products                                               */
+/************************************************************************/
+
+/*!
+* \brief Flags of {\ref matrix_gemm_blocked}
+*/
+typedef enum
+{
+    /*!
+    * \brief B is used transposed, i.e. C = A * B'
+    */
+    MATRIX_GEMM_TRANSB = 1,
+
+    /*!
+    * \brief The product is added to C instead of overwriting it
+    */
+    MATRIX_GEMM_ACCUMULATE = 2,
+
+    /*!
+    * \brief Only the upper triangle of the square result is calculated and then mirrored into the lower one
+    */
+    MATRIX_GEMM_SYMMETRIC = 4
+} matrix_gemm_flags_t;
+
+/*!
+* \brief Determines whether a product of the given size is calculated by {\ref matrix_gemm_blocked}
+* \param[in] m The number of rows of the result
+* \param[in] n The number of columns of the result
+* \param[in] k The shared dimension
+* \return Nonzero if the blocked kernel is used.
+*/
+STATIC_INLINE PURE int matrix_gemm_use_blocked(matrix_index_t m, matrix_index_t n, matrix_index_t k)
+{
+#if MATRIX_BLOCK_THRESHOLD > 0
+    return (m >= MATRIX_BLOCK_THRESHOLD) && (n >= MATRIX_BLOCK_THRESHOLD) && (k >= MATRIX_BLOCK_THRESHOLD);
+#else
+    (void)m; (void)n; (void)k;
+    return 0;
+#endif
+}
+
+/*!
+* \brief Packs a block of A into panels of {\ref MATRIX_BLOCK_MR} rows, stored column by column
+* \param[in] a Matrix A
+* \param[in] row The first row of the block
+* \param[in] rows The number of rows of the block
+* \param[in] col The first column of the block
+* \param[in] cols The number of columns of the block
+* \param[out] packed The panels; rows beyond the block are zero padded.
+*/
+static void matrix_gemm_pack_a(const matrix_t *RESTRICT const a, matrix_offset_t row, matrix_offset_t rows,
+                               matrix_offset_t col, matrix_offset_t cols, matrix_data_t *RESTRICT packed)
+{
+    register matrix_offset_t i, p, r;
+    const matrix_offset_t astride = a->stride;
+    const matrix_data_t *const adata = a->data;
+
+    for (i = 0; i < rows; i += MATRIX_BLOCK_MR)
+    {
+        for (p = 0; p < cols; ++p)
+        {
+            for (r = 0; r < MATRIX_BLOCK_MR; ++r)
             {
-                sum -= t[k*n+i]*a[j*n+k];
+                *packed++ = (i + r < rows) ? adata[(row + i + r) * astride + col + p] : (matrix_data_t)0;
+            }
+        }
+    }
+}
+
+/*!
+* \brief Packs a block of op(B) into panels of {\ref MATRIX_BLOCK_NR} columns, stored row by row
+* \param[in] b Matrix B
+* \param[in] transb Nonzero if op(B) = B', zero if op(B) = B
+* \param[in] row The first row of the block of op(B)
+* \param[in] rows The number of rows of the block of op(B)
+* \param[in] col The first column of the block of op(B)
+* \param[in] cols The number of columns of the block of op(B)
+* \param[out] packed The panels; columns beyond the block are zero padded.
+*/
+static void matrix_gemm_pack_b(const matrix_t *RESTRICT const b, int transb, matrix_offset_t row, matrix_offset_t rows,
+                               matrix_offset_t col, matrix_offset_t cols, matrix_data_t *RESTRICT packed)
+{
+    register matrix_offset_t j, p, r;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_data_t *const bdata = b->data;
+
+    for (j = 0; j < cols; j += MATRIX_BLOCK_NR)
+    {
+        for (p = 0; p < rows; ++p)
+        {
+            for (r = 0; r < MATRIX_BLOCK_NR; ++r)
+            {
+                const matrix_offset_t n = col + j + r;
+                const matrix_offset_t k = row + p;
+                *packed++ = (j + r >= cols) ? (matrix_data_t)0
+                          : transb ? bdata[n * bstride + k] : bdata[k * bstride + n];
+            }
+        }
+    }
+}
+
+/*!
+* \brief Multiplies a packed panel of A with a packed panel of B into an MR x NR register block
+* \param[in] depth The number of packed columns of A and rows of B
+* \param[in] apanel The panel of A, {\ref MATRIX_BLOCK_MR} values per column
+* \param[in] bpanel The panel of B, {\ref MATRIX_BLOCK_NR} values per row
+* \param[out] acc The product
+*/
+static void matrix_gemm_micro(matrix_offset_t depth, const matrix_data_t *RESTRICT apanel, const matrix_data_t *RESTRICT bpanel,
+                              matrix_data_t acc[MATRIX_BLOCK_MR][MATRIX_BLOCK_NR])
+{
+    register matrix_offset_t p, r, s;
+
+    for (r = 0; r < MATRIX_BLOCK_MR; ++r)
+    {
+        for (s = 0; s < MATRIX_BLOCK_NR; ++s)
+        {
+            acc[r][s] = 0;
+        }
+    }
+
+    for (p = 0; p < depth; ++p)
+    {
+        for (r = 0; r < MATRIX_BLOCK_MR; ++r)
+        {
+            const matrix_data_t value = apanel[r];
+            for (s = 0; s < MATRIX_BLOCK_NR; ++s)
+            {
+                acc[r][s] += value * bpanel[s];
+            }
+        }
+
+        apanel += MATRIX_BLOCK_MR;
+        bpanel += MATRIX_BLOCK_NR;
+    }
+}
+
+/*!
+* \brief Calculates C = scale * A * op(B) (or adds it to C) by a cache-tiled, register-blocked product
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] flags A combination of {\ref matrix_gemm_flags_t}
+* \param[in] scale Scaling factor of the product
+* \param[in] c Resulting matrix C
+*
+* The shared dimension is split into passes of {\ref MATRIX_BLOCK_KC}. Per pass, blocks of
+* {\ref MATRIX_BLOCK_NC} columns of op(B) and {\ref MATRIX_BLOCK_MC} rows of A are copied into contiguous
+* panels, so that the inner loops read memory linearly no matter the strides or the transposition, and
+* every element of a panel is reused from the cache for a whole block of the result. The product of
+* two panels is accumulated in a {\ref MATRIX_BLOCK_MR} x {\ref MATRIX_BLOCK_NR} block kept in registers.
+*
+* The function is never inlined so that the panels only occupy the stack while a large product runs.
+*/
+static NOINLINE void matrix_gemm_blocked(const matrix_t *const a, const matrix_t *const b, uint_fast8_t flags,
+                                         const matrix_data_t scale, const matrix_t *RESTRICT c)
+{
+    matrix_data_t apack[MATRIX_BLOCK_MC * MATRIX_BLOCK_KC];
+    matrix_data_t bpack[MATRIX_BLOCK_KC * MATRIX_BLOCK_NC];
+    matrix_data_t acc[MATRIX_BLOCK_MR][MATRIX_BLOCK_NR];
+
+    register matrix_offset_t ic, jc, pc, ir, jr, r, s;
+    const int transb = (flags & MATRIX_GEMM_TRANSB) != 0;
+    const int symmetric = (flags & MATRIX_GEMM_SYMMETRIC) != 0;
+    const matrix_offset_t m = a->rows;
+    const matrix_offset_t n = c->cols;
+    const matrix_offset_t k = a->cols;
+    const matrix_offset_t cstride = c->stride;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    for (pc = 0; pc < k; pc += MATRIX_BLOCK_KC)
+    {
+        const matrix_offset_t kc = (k - pc < MATRIX_BLOCK_KC) ? k - pc : MATRIX_BLOCK_KC;
+        const int overwrite = (pc == 0) && ((flags & MATRIX_GEMM_ACCUMULATE) == 0);
+
+        for (jc = 0; jc < n; jc += MATRIX_BLOCK_NC)
+        {
+            const matrix_offset_t nc = (n - jc < MATRIX_BLOCK_NC) ? n - jc : MATRIX_BLOCK_NC;
+
+            matrix_gemm_pack_b(b, transb, pc, kc, jc, nc, bpack);
+
+            for (ic = 0; ic < m; ic += MATRIX_BLOCK_MC)
+            {
+                const matrix_offset_t mc = (m - ic < MATRIX_BLOCK_MC) ? m - ic : MATRIX_BLOCK_MC;
+
+                // blocks entirely below the diagonal are not needed for a symmetric result
+                if (symmetric && ic >= jc + nc) break;
+                matrix_gemm_pack_a(a, ic, mc, pc, kc, apack);
+
+                for (jr = 0; jr < nc; jr += MATRIX_BLOCK_NR)
+                {
+                    const matrix_offset_t nr = (nc - jr < MATRIX_BLOCK_NR) ? nc - jr : MATRIX_BLOCK_NR;
+                    for (ir = 0; ir < mc; ir += MATRIX_BLOCK_MR)
+                    {
+                        const matrix_offset_t mr = (mc - ir < MATRIX_BLOCK_MR) ? mc - ir : MATRIX_BLOCK_MR;
+                        const matrix_offset_t row = ic + ir;
+                        const matrix_offset_t col = jc + jr;
+                        if (symmetric && row >= col + nr) break;
+
+#if MATRIX_SIMD_X86
+                        if (matrix_simd_kernels.gemm_micro != 0)
+                        {
+                            matrix_simd_kernels.gemm_micro(kc, &apack[ir * kc], &bpack[jr * kc], &acc[0][0]);
+                        }
+                        else
+#endif
+                        {
+                            matrix_gemm_micro(kc, &apack[ir * kc], &bpack[jr * kc], acc);
+                        }
+
+                        for (r = 0; r < mr; ++r)
+                        {
+                            matrix_data_t *RESTRICT const crow = &cdata[(row + r) * cstride + col];
+                            for (s = (symmetric && row + r > col) ? row + r - col : 0; s < nr; ++s)
+                            {
+                                crow[s] = overwrite ? acc[r][s] * scale : crow[s] + acc[r][s] * scale;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (symmetric)
+    {
+        for (r = 1; r < m; ++r)
+        {
+            for (s = 0; s < r; ++s)
+            {
+                cdata[r * cstride + s] = cdata[s * cstride + r];
             }
-            a[i*n+j] = a[j*n+i] = sum / el_ii;
         }
     }
 }
@@ -83,11 +456,12 @@ void matrix_invert_lower(const matrix_t *RESTRICT const lower, matrix_t *RESTRIC
 */
 void matrix_mult(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c, matrix_data_t *const baux)
 {
-    register int_fast16_t i, j, k;
-    const uint_fast8_t bcols = b->cols;
-    const uint_fast8_t ccols = c->cols;
-    const uint_fast8_t brows = b->rows;
-    const uint_fast8_t arows = a->rows;
+    register matrix_soffset_t i, j, k;
+    const matrix_index_t bcols = b->cols;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t cstride = c->stride;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
 
     matrix_data_t *RESTRICT const adata = a->data;
     matrix_data_t *RESTRICT const cdata = c->data;
@@ -105,21 +479,36 @@ void matrix_mult(const matrix_t *const a, const matrix_t *const b, const matrix_
     assert(a->rows == c->rows);
     assert(b->cols == c->cols);
 
+    // a packed B is gathered column by column below
+    if (!matrix_is_packed(b) && matrix_gemm_use_blocked(a->rows, b->cols, a->cols))
+    {
+        matrix_gemm_blocked(a, b, 0, (matrix_data_t)1, c);
+        return;
+    }
+
+#if MATRIX_SIMD_X86
+    if (matrix_simd_kernels.mult != 0)
+    {
+        matrix_simd_kernels.mult(a, b, c, baux);
+        return;
+    }
+#endif
+
     //for (j = 0; j < bcols; ++j)
     for (j = bcols-1; j >= 0; --j)
     {
         // create a copy of the column in B to avoid cache issues
         matrix_get_column_copy(b, j, baux);
 
-        uint_fast16_t indexA = 0;
-        for (i = 0; i < arows; ++i)
+        for (i = 0; i < (matrix_soffset_t)arows; ++i)
         {
+            const matrix_data_t *RESTRICT const arow = &adata[i*astride];
             matrix_data_t total = (matrix_data_t)0;
-            for (k = 0; k < brows;)
+            for (k = 0; k < (matrix_soffset_t)brows; ++k)
             {
-                total += adata[indexA++]*baux[k++];
+                total += arow[k]*baux[k];
             }
-            cdata[i*ccols + j] = total;
+            cdata[i*cstride + j] = total;
         }
     }
 }
@@ -135,36 +524,48 @@ void matrix_mult(const matrix_t *const a, const matrix_t *const b, const matrix_
 */
 void matrix_mult_transb(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
 {
-    register uint_fast16_t xA, xB, indexA, indexB, end;
-    const uint_fast8_t bcols = b->cols;
-    const uint_fast8_t brows = b->rows;
-    const uint_fast8_t arows = a->rows;
-    const uint_fast8_t acols = a->cols;
+    register matrix_offset_t xA, xB, k;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
 
     matrix_data_t *const adata = a->data;
     matrix_data_t *const bdata = b->data;
     matrix_data_t *RESTRICT const cdata = c->data;
 
-    uint_fast16_t cIndex = 0;
-    uint_fast16_t aIndexStart = 0;
+    if (matrix_gemm_use_blocked(arows, brows, bcols))
+    {
+        matrix_gemm_blocked(a, b, MATRIX_GEMM_TRANSB, (matrix_data_t)1, c);
+        return;
+    }
+
+#if MATRIX_SIMD_X86
+    if (matrix_simd_kernels.mult_transb != 0)
+    {
+        matrix_simd_kernels.mult_transb(a, b, c);
+        return;
+    }
+#endif
 
     for (xA = 0; xA < arows; ++xA)
     {
-        end = aIndexStart + bcols;
-        indexB = 0;
+        const matrix_data_t *const arow = &adata[xA * astride];
+        matrix_data_t *RESTRICT const crow = &cdata[xA * cstride];
         for (xB = 0; xB < brows; ++xB)
         {
-            indexA = aIndexStart;
+            const matrix_data_t *const brow = &bdata[xB * bstride];
             matrix_data_t total = 0;
 
-            while (indexA < end)
+            for (k = 0; k < bcols; ++k)
             {
-                total += adata[indexA++] * bdata[indexB++];
+                total += arow[k] * brow[k];
             }
 
-            cdata[cIndex++] = total;
+            crow[xB] = total;
         }
-        aIndexStart += acols;
     }
 }
 
@@ -179,36 +580,48 @@ void matrix_mult_transb(const matrix_t *const a, const matrix_t *const b, const
 */
 void matrix_multadd_transb(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
 {
-    register uint_fast16_t xA, xB, indexA, indexB, end;
-    const uint_fast8_t bcols = b->cols;
-    const uint_fast8_t brows = b->rows;
-    const uint_fast8_t arows = a->rows;
-    const uint_fast8_t acols = a->cols;
+    register matrix_offset_t xA, xB, k;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
 
     matrix_data_t *const adata = a->data;
     matrix_data_t *const bdata = b->data;
     matrix_data_t *RESTRICT const cdata = c->data;
 
-    uint_fast16_t cIndex = 0;
-    uint_fast16_t aIndexStart = 0;
+    if (matrix_gemm_use_blocked(arows, brows, bcols))
+    {
+        matrix_gemm_blocked(a, b, MATRIX_GEMM_TRANSB | MATRIX_GEMM_ACCUMULATE, (matrix_data_t)1, c);
+        return;
+    }
+
+#if MATRIX_SIMD_X86
+    if (matrix_simd_kernels.multadd_transb != 0)
+    {
+        matrix_simd_kernels.multadd_transb(a, b, c);
+        return;
+    }
+#endif
 
     for (xA = 0; xA < arows; ++xA)
     {
-        end = aIndexStart + bcols;
-        indexB = 0;
+        const matrix_data_t *const arow = &adata[xA * astride];
+        matrix_data_t *RESTRICT const crow = &cdata[xA * cstride];
         for (xB = 0; xB < brows; ++xB)
         {
-            indexA = aIndexStart;
+            const matrix_data_t *const brow = &bdata[xB * bstride];
             matrix_data_t total = 0;
 
-            while (indexA < end)
+            for (k = 0; k < bcols; ++k)
             {
-                total += adata[indexA++] * bdata[indexB++];
+                total += arow[k] * brow[k];
             }
 
-            cdata[cIndex++] += total;
+            crow[xB] += total;
         }
-        aIndexStart += acols;
     }
 }
 
@@ -223,36 +636,481 @@ void matrix_multadd_transb(const matrix_t *const a, const matrix_t *const b, con
 */
 void matrix_multscale_transb(const matrix_t *const a, const matrix_t *const b, register const matrix_data_t scale, const matrix_t *RESTRICT c)
 {
-    register uint_fast16_t xA, xB, indexA, indexB, end;
-    const uint_fast8_t bcols = b->cols;
-    const uint_fast8_t brows = b->rows;
-    const uint_fast8_t arows = a->rows;
-    const uint_fast8_t acols = a->cols;
+    register matrix_offset_t xA, xB, k;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
 
     matrix_data_t *const adata = a->data;
     matrix_data_t *const bdata = b->data;
     matrix_data_t *RESTRICT const cdata = c->data;
 
-    uint_fast16_t cIndex = 0;
-    uint_fast16_t aIndexStart = 0;
+    if (matrix_gemm_use_blocked(arows, brows, bcols))
+    {
+        matrix_gemm_blocked(a, b, MATRIX_GEMM_TRANSB, scale, c);
+        return;
+    }
+
+#if MATRIX_SIMD_X86
+    if (matrix_simd_kernels.multscale_transb != 0)
+    {
+        matrix_simd_kernels.multscale_transb(a, b, scale, c);
+        return;
+    }
+#endif
 
     for (xA = 0; xA < arows; ++xA)
     {
-        end = aIndexStart + bcols;
-        indexB = 0;
+        const matrix_data_t *const arow = &adata[xA * astride];
+        matrix_data_t *RESTRICT const crow = &cdata[xA * cstride];
         for (xB = 0; xB < brows; ++xB)
         {
-            indexA = aIndexStart;
+            const matrix_data_t *const brow = &bdata[xB * bstride];
             matrix_data_t total = 0;
 
-            while (indexA < end)
+            for (k = 0; k < bcols; ++k)
             {
-                total += adata[indexA++] * bdata[indexB++];
+                total += arow[k] * brow[k];
             }
 
-            cdata[cIndex++] = total * scale;
+            crow[xB] = total * scale;
+        }
+    }
+}
+
+/*!
+* \brief Performs a matrix multiplication with transposed B with a symmetric result such that {\ref c} = {\ref a} * {\ref b'}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting symmetric matrix C (will be overwritten)
+*
+* Only the upper triangle of {\ref c} is calculated and then mirrored into the lower triangle,
+* which halves the work and keeps {\ref c} exactly symmetric. The caller must guarantee that
+* {\ref a} * {\ref b'} is symmetric, e.g. because it is of the form A*P*A' with a symmetric P.
+*/
+void matrix_mult_transb_symmetric(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
+{
+    register matrix_offset_t xA, xB, k;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    matrix_data_t *const adata = a->data;
+    matrix_data_t *const bdata = b->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    // the result must be square
+    assert(arows == brows);
+    assert(c->rows == arows && c->cols == brows);
+
+    if (matrix_gemm_use_blocked(arows, brows, bcols))
+    {
+        matrix_gemm_blocked(a, b, MATRIX_GEMM_TRANSB | MATRIX_GEMM_SYMMETRIC, (matrix_data_t)1, c);
+        return;
+    }
+
+#if MATRIX_SIMD_X86
+    if (matrix_simd_kernels.mult_transb_symmetric != 0)
+    {
+        matrix_simd_kernels.mult_transb_symmetric(a, b, c);
+        return;
+    }
+#endif
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        for (xB = xA; xB < brows; ++xB)
+        {
+            const matrix_data_t *const brow = &bdata[xB * bstride];
+            matrix_data_t total = 0;
+
+            for (k = 0; k < bcols; ++k)
+            {
+                total += arow[k] * brow[k];
+            }
+
+            cdata[xA*cstride + xB] = total;
+            cdata[xB*cstride + xA] = cdata[xA*cstride + xB];
+        }
+    }
+}
+
+/*!
+* \brief Performs a matrix multiplication with transposed B with a symmetric result and adds it to {\ref c} such that {\ref c} = {\ref c} + {\ref a} * {\ref b'}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting symmetric matrix C (will be added to)
+*
+* Only the upper triangle of {\ref c} is calculated and then mirrored into the lower triangle,
+* which halves the work and keeps {\ref c} exactly symmetric. The caller must guarantee that
+* {\ref a} * {\ref b'} is symmetric, e.g. because it is of the form A*P*A' with a symmetric P.
+*/
+void matrix_multadd_transb_symmetric(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
+{
+    register matrix_offset_t xA, xB, k;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    matrix_data_t *const adata = a->data;
+    matrix_data_t *const bdata = b->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    // the result must be square
+    assert(arows == brows);
+    assert(c->rows == arows && c->cols == brows);
+
+    if (matrix_gemm_use_blocked(arows, brows, bcols))
+    {
+        matrix_gemm_blocked(a, b, MATRIX_GEMM_TRANSB | MATRIX_GEMM_ACCUMULATE | MATRIX_GEMM_SYMMETRIC, (matrix_data_t)1, c);
+        return;
+    }
+
+#if MATRIX_SIMD_X86
+    if (matrix_simd_kernels.multadd_transb_symmetric != 0)
+    {
+        matrix_simd_kernels.multadd_transb_symmetric(a, b, c);
+        return;
+    }
+#endif
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        for (xB = xA; xB < brows; ++xB)
+        {
+            const matrix_data_t *const brow = &bdata[xB * bstride];
+            matrix_data_t total = 0;
+
+            for (k = 0; k < bcols; ++k)
+            {
+                total += arow[k] * brow[k];
+            }
+
+            cdata[xA*cstride + xB] += total;
+            cdata[xB*cstride + xA] = cdata[xA*cstride + xB];
+        }
+    }
+}
+
+/*!
+* \brief Performs a matrix multiplication with transposed B with a symmetric result and scales it such that {\ref c} = {\ref a} * {\ref b'} * {\ref scale}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] scale Scaling factor
+* \param[in] c Resulting symmetric matrix C (will be overwritten)
+*
+* Only the upper triangle of {\ref c} is calculated and then mirrored into the lower triangle,
+* which halves the work and keeps {\ref c} exactly symmetric. The caller must guarantee that
+* {\ref a} * {\ref b'} is symmetric, e.g. because it is of the form A*P*A' with a symmetric P.
+*/
+void matrix_multscale_transb_symmetric(const matrix_t *const a, const matrix_t *const b, register const matrix_data_t scale, const matrix_t *RESTRICT c)
+{
+    register matrix_offset_t xA, xB, k;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    matrix_data_t *const adata = a->data;
+    matrix_data_t *const bdata = b->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    // the result must be square
+    assert(arows == brows);
+    assert(c->rows == arows && c->cols == brows);
+
+    if (matrix_gemm_use_blocked(arows, brows, bcols))
+    {
+        matrix_gemm_blocked(a, b, MATRIX_GEMM_TRANSB | MATRIX_GEMM_SYMMETRIC, scale, c);
+        return;
+    }
+
+#if MATRIX_SIMD_X86
+    if (matrix_simd_kernels.multscale_transb_symmetric != 0)
+    {
+        matrix_simd_kernels.multscale_transb_symmetric(a, b, scale, c);
+        return;
+    }
+#endif
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        for (xB = xA; xB < brows; ++xB)
+        {
+            const matrix_data_t *const brow = &bdata[xB * bstride];
+            matrix_data_t total = 0;
+
+            for (k = 0; k < bcols; ++k)
+            {
+                total += arow[k] * brow[k];
+            }
+
+            cdata[xA*cstride + xB] = total * scale;
+            cdata[xB*cstride + xA] = cdata[xA*cstride + xB];
+        }
+    }
+}
+
+/*!
+* \brief Performs a matrix multiplication with a symmetric result and subtracts it from {\ref c} such that {\ref c} = {\ref c} - {\ref a} * {\ref b}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting symmetric matrix C (will be subtracted from)
+*
+* Only the upper triangle of {\ref c} is calculated and then mirrored into the lower triangle.
+* The caller must guarantee that {\ref a} * {\ref b} is symmetric, e.g. because it is of the form
+* K*(H*P) with K = (H*P)' * S^-1. Every row of the upper triangle is accumulated as a sequence of
+* scaled rows of {\ref b}, so no column copies are required.
+*/
+void matrix_multsub_symmetric(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
+{
+    matrix_offset_t i, j, k;
+    const matrix_index_t acols = a->cols;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t crows = c->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    // the result must be square
+    assert(a->cols == b->rows);
+    assert(c->rows == a->rows && c->cols == b->cols);
+    assert(c->rows == c->cols);
+
+    for (i = 0; i < crows; ++i)
+    {
+        matrix_data_t *RESTRICT const crow = &cdata[i * cstride];
+
+        // c(i, i:end) -= sum_k a(i, k) * b(k, i:end)
+        for (k = 0; k < acols; ++k)
+        {
+            const matrix_data_t factor = adata[i * astride + k];
+            const matrix_data_t *RESTRICT const brow = &bdata[k * bstride];
+            for (j = i; j < bcols; ++j)
+            {
+                crow[j] -= factor * brow[j];
+            }
+        }
+
+        // mirror the finished row into the lower triangle
+        for (j = i + 1; j < bcols; ++j)
+        {
+            cdata[j * cstride + i] = crow[j];
+        }
+    }
+}
+
+/*!
+* \brief Performs a matrix multiplication with transposed B into a packed symmetric result such that {\ref c} = {\ref a} * {\ref b'}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting packed symmetric matrix C (will be overwritten)
+*
+* Like {\ref matrix_mult_transb_symmetric}, but only the upper triangle is stored, so no mirroring is required.
+*/
+void matrix_mult_transb_packed(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
+{
+    register matrix_offset_t xA, xB, k;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+
+    // the result must be square and packed
+    assert(arows == brows);
+    assert(matrix_is_packed(c) && c->rows == arows);
+
+#if MATRIX_SIMD_X86
+    if (matrix_simd_kernels.mult_transb_packed != 0)
+    {
+        matrix_simd_kernels.mult_transb_packed(a, b, c);
+        return;
+    }
+#endif
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        matrix_data_t *RESTRICT const crow = matrix_packed_row(c, xA);
+        for (xB = xA; xB < brows; ++xB)
+        {
+            const matrix_data_t *const brow = &bdata[xB * bstride];
+            matrix_data_t total = 0;
+
+            for (k = 0; k < bcols; ++k)
+            {
+                total += arow[k] * brow[k];
+            }
+
+            crow[xB] = total;
+        }
+    }
+}
+
+/*!
+* \brief Performs a matrix multiplication with transposed B and adds it to a packed symmetric result such that {\ref c} = {\ref c} + {\ref a} * {\ref b'}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting packed symmetric matrix C (will be added to)
+*
+* Like {\ref matrix_multadd_transb_symmetric}, but only the upper triangle is stored, so no mirroring is required.
+*/
+void matrix_multadd_transb_packed(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
+{
+    register matrix_offset_t xA, xB, k;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+
+    // the result must be square and packed
+    assert(arows == brows);
+    assert(matrix_is_packed(c) && c->rows == arows);
+
+#if MATRIX_SIMD_X86
+    if (matrix_simd_kernels.multadd_transb_packed != 0)
+    {
+        matrix_simd_kernels.multadd_transb_packed(a, b, c);
+        return;
+    }
+#endif
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        matrix_data_t *RESTRICT const crow = matrix_packed_row(c, xA);
+        for (xB = xA; xB < brows; ++xB)
+        {
+            const matrix_data_t *const brow = &bdata[xB * bstride];
+            matrix_data_t total = 0;
+
+            for (k = 0; k < bcols; ++k)
+            {
+                total += arow[k] * brow[k];
+            }
+
+            crow[xB] += total;
+        }
+    }
+}
+
+/*!
+* \brief Performs a matrix multiplication with transposed B into a scaled packed symmetric result such that {\ref c} = {\ref a} * {\ref b'} * {\ref scale}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] scale Scaling factor
+* \param[in] c Resulting packed symmetric matrix C (will be overwritten)
+*
+* Like {\ref matrix_multscale_transb_symmetric}, but only the upper triangle is stored, so no mirroring is required.
+*/
+void matrix_multscale_transb_packed(const matrix_t *const a, const matrix_t *const b, register const matrix_data_t scale, const matrix_t *RESTRICT c)
+{
+    register matrix_offset_t xA, xB, k;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+
+    // the result must be square and packed
+    assert(arows == brows);
+    assert(matrix_is_packed(c) && c->rows == arows);
+
+#if MATRIX_SIMD_X86
+    if (matrix_simd_kernels.multscale_transb_packed != 0)
+    {
+        matrix_simd_kernels.multscale_transb_packed(a, b, scale, c);
+        return;
+    }
+#endif
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        matrix_data_t *RESTRICT const crow = matrix_packed_row(c, xA);
+        for (xB = xA; xB < brows; ++xB)
+        {
+            const matrix_data_t *const brow = &bdata[xB * bstride];
+            matrix_data_t total = 0;
+
+            for (k = 0; k < bcols; ++k)
+            {
+                total += arow[k] * brow[k];
+            }
+
+            crow[xB] = total * scale;
+        }
+    }
+}
+
+/*!
+* \brief Performs a matrix multiplication and subtracts it from a packed symmetric matrix such that {\ref c} = {\ref c} - {\ref a} * {\ref b}
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] c Resulting packed symmetric matrix C (will be subtracted from)
+*
+* Like {\ref matrix_multsub_symmetric}, but only the upper triangle is stored, so no mirroring is required.
+*/
+void matrix_multsub_packed(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
+{
+    matrix_offset_t i, j, k;
+    const matrix_index_t acols = a->cols;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t crows = c->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+
+    // the result must be square and packed
+    assert(a->cols == b->rows);
+    assert(c->rows == a->rows && c->cols == b->cols);
+    assert(matrix_is_packed(c));
+
+    for (i = 0; i < crows; ++i)
+    {
+        matrix_data_t *RESTRICT const crow = matrix_packed_row(c, i);
+
+        // c(i, i:end) -= sum_k a(i, k) * b(k, i:end)
+        for (k = 0; k < acols; ++k)
+        {
+            const matrix_data_t factor = adata[i * astride + k];
+            const matrix_data_t *RESTRICT const brow = &bdata[k * bstride];
+            for (j = i; j < bcols; ++j)
+            {
+                crow[j] -= factor * brow[j];
+            }
         }
-        aIndexStart += acols;
     }
 }
 
@@ -266,28 +1124,39 @@ void matrix_multscale_transb(const matrix_t *const a, const matrix_t *const b, r
 */
 void matrix_mult_rowvector(const matrix_t *RESTRICT const a, const matrix_t *RESTRICT const x, matrix_t *RESTRICT const c)
 {
-    uint_fast16_t i, j;
-    const uint_fast8_t arows = a->rows;
-    const uint_fast8_t acols = a->cols;
+    matrix_offset_t i, j;
+    const matrix_index_t arows = a->rows;
+    const matrix_index_t acols = a->cols;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t xstride = x->stride;
+    const matrix_offset_t cstride = c->stride;
 
     const matrix_data_t *RESTRICT const adata = a->data;
     const matrix_data_t *RESTRICT const xdata = x->data;
     matrix_data_t *RESTRICT const cdata = c->data;
 
-    uint_fast16_t indexA = 0;
-    uint_fast16_t cIndex = 0;
+#if MATRIX_SIMD_X86
+    // the vectorized kernel requires a contiguous vector x
+    if (matrix_simd_kernels.mult_rowvector != 0 && matrix_is_dense(x))
+    {
+        matrix_simd_kernels.mult_rowvector(a, x, c);
+        return;
+    }
+#endif
+
     matrix_data_t b0 = xdata[0];
 
     for (i = 0; i < arows; ++i)
     {
-        matrix_data_t total = adata[indexA++] * b0;
+        const matrix_data_t *RESTRICT const arow = &adata[i * astride];
+        matrix_data_t total = arow[0] * b0;
 
         for (j = 1; j < acols; ++j)
         {
-            total += adata[indexA++] * xdata[j];
+            total += arow[j] * xdata[j * xstride];
         }
 
-        cdata[cIndex++] = total;
+        cdata[i * cstride] = total;
     }
 }
 
@@ -302,27 +1171,38 @@ void matrix_mult_rowvector(const matrix_t *RESTRICT const a, const matrix_t *RES
 */
 void matrix_multadd_rowvector(const matrix_t *RESTRICT const a, const matrix_t *RESTRICT const x, matrix_t *RESTRICT const c)
 {
-    uint_fast16_t i, j;
-    const uint_fast8_t arows = a->rows;
-    const uint_fast8_t acols = a->cols;
+    matrix_offset_t i, j;
+    const matrix_index_t arows = a->rows;
+    const matrix_index_t acols = a->cols;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t xstride = x->stride;
+    const matrix_offset_t cstride = c->stride;
 
     const matrix_data_t *RESTRICT const adata = a->data;
     const matrix_data_t *RESTRICT const xdata = x->data;
     matrix_data_t *RESTRICT const cdata = c->data;
 
-    uint_fast16_t indexA = 0;
-    uint_fast16_t cIndex = 0;
+#if MATRIX_SIMD_X86
+    // the vectorized kernel requires a contiguous vector x
+    if (matrix_simd_kernels.multadd_rowvector != 0 && matrix_is_dense(x))
+    {
+        matrix_simd_kernels.multadd_rowvector(a, x, c);
+        return;
+    }
+#endif
+
     matrix_data_t b0 = xdata[0];
 
     for (i = 0; i < arows; ++i)
     {
-        matrix_data_t total = adata[indexA++] * b0;
+        const matrix_data_t *RESTRICT const arow = &adata[i * astride];
+        matrix_data_t total = arow[0] * b0;
 
         for (j = 1; j < acols; ++j)
         {
-            total += adata[indexA++] * xdata[j];
+            total += arow[j] * xdata[j * xstride];
         }
 
-        cdata[cIndex++] += total;
+        cdata[i * cstride] += total;
     }
 }
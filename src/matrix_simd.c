@@ -0,0 +1,315 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#include <stdint.h>
+
+#define EXTERN_INLINE_MATRIX static INLINE
+#include "matrix_simd.h"
+
+#if MATRIX_SIMD_X86
+
+#include <immintrin.h>
+
+_Static_assert(sizeof(matrix_data_t) == sizeof(float), "the SIMD kernels require matrix_data_t to be float");
+
+/************************************************************************/
+/* Dot products                                                         */
+/************************************************************************/
+
+/*!
+* \brief Calculates the dot product of two vectors using SSE2.
+* \param[in] a Vector a
+* \param[in] b Vector b
+* \param[in] n The number of elements
+* \return The dot product.
+*/
+static __attribute__((target("sse2"))) INLINE matrix_data_t matrix_dot_sse2(const matrix_data_t *RESTRICT const a, const matrix_data_t *RESTRICT const b, const matrix_offset_t n)
+{
+    matrix_offset_t k = 0;
+    __m128 acc = _mm_setzero_ps();
+
+    for (; k + 4 <= n; k += 4)
+    {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&a[k]), _mm_loadu_ps(&b[k])));
+    }
+
+    // horizontal sum of the four lanes
+    __m128 shuf = _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(acc, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+
+    matrix_data_t total = _mm_cvtss_f32(sums);
+    for (; k < n; ++k)
+    {
+        total += a[k] * b[k];
+    }
+    return total;
+}
+
+/*!
+* \brief Calculates the dot product of two vectors using AVX2 and FMA.
+* \param[in] a Vector a
+* \param[in] b Vector b
+* \param[in] n The number of elements
+* \return The dot product.
+*/
+static __attribute__((target("avx2,fma"))) INLINE matrix_data_t matrix_dot_avx2(const matrix_data_t *RESTRICT const a, const matrix_data_t *RESTRICT const b, const matrix_offset_t n)
+{
+    matrix_offset_t k = 0;
+    __m256 acc8 = _mm256_setzero_ps();
+
+    for (; k + 8 <= n; k += 8)
+    {
+        acc8 = _mm256_fmadd_ps(_mm256_loadu_ps(&a[k]), _mm256_loadu_ps(&b[k]), acc8);
+    }
+
+    // fold to four lanes and pick up a remaining block of four
+    __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc8), _mm256_extractf128_ps(acc8, 1));
+    if (k + 4 <= n)
+    {
+        acc = _mm_fmadd_ps(_mm_loadu_ps(&a[k]), _mm_loadu_ps(&b[k]), acc);
+        k += 4;
+    }
+
+    // horizontal sum of the four lanes
+    __m128 shuf = _mm_movehdup_ps(acc);
+    __m128 sums = _mm_add_ps(acc, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+
+    matrix_data_t total = _mm_cvtss_f32(sums);
+    for (; k < n; ++k)
+    {
+        total += a[k] * b[k];
+    }
+    return total;
+}
+
+/*!
+* \brief Calculates the dot product of two vectors using AVX-512F.
+* \param[in] a Vector a
+* \param[in] b Vector b
+* \param[in] n The number of elements
+* \return The dot product.
+*/
+static __attribute__((target("avx512f,avx2,fma"))) INLINE matrix_data_t matrix_dot_avx512(const matrix_data_t *RESTRICT const a, const matrix_data_t *RESTRICT const b, const matrix_offset_t n)
+{
+    matrix_offset_t k = 0;
+    __m512 acc = _mm512_setzero_ps();
+
+    for (; k + 16 <= n; k += 16)
+    {
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(&a[k]), _mm512_loadu_ps(&b[k]), acc);
+    }
+
+    // the tail is handled with masked loads, which zero the unused lanes
+    if (k < n)
+    {
+        const __mmask16 mask = (__mmask16)((1u << (n - k)) - 1u);
+        acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, &a[k]), _mm512_maskz_loadu_ps(mask, &b[k]), acc);
+    }
+
+    return _mm512_reduce_add_ps(acc);
+}
+
+/************************************************************************/
+/* Micro-kernels of the blocked products                                */
+/************************************************************************/
+
+_Static_assert(MATRIX_BLOCK_MR == 4 && MATRIX_BLOCK_NR == 16, "the micro-kernels are written for 4x16 register blocks");
+
+/*!
+* \brief Multiplies a packed 4-row panel of A with a packed 16-column panel of B using SSE2.
+* \param[in] depth The number of packed columns of A and rows of B
+* \param[in] apanel The panel of A, four values per column
+* \param[in] bpanel The panel of B, sixteen values per row
+* \param[out] acc The 4x16 product, row by row
+*
+* Sixteen accumulators would exhaust the register file, so the panel is processed in two halves of eight columns.
+*/
+static __attribute__((target("sse2"))) void matrix_gemm_micro_sse2(matrix_offset_t depth, const matrix_data_t *RESTRICT apanel, const matrix_data_t *RESTRICT bpanel, matrix_data_t *RESTRICT acc)
+{
+    matrix_offset_t p, half;
+
+    for (half = 0; half < 16; half += 8)
+    {
+        __m128 c00 = _mm_setzero_ps(), c01 = _mm_setzero_ps();
+        __m128 c10 = _mm_setzero_ps(), c11 = _mm_setzero_ps();
+        __m128 c20 = _mm_setzero_ps(), c21 = _mm_setzero_ps();
+        __m128 c30 = _mm_setzero_ps(), c31 = _mm_setzero_ps();
+
+        for (p = 0; p < depth; ++p)
+        {
+            const matrix_data_t *const a = &apanel[p * 4];
+            const __m128 b0 = _mm_loadu_ps(&bpanel[p * 16 + half]);
+            const __m128 b1 = _mm_loadu_ps(&bpanel[p * 16 + half + 4]);
+            __m128 value;
+
+            value = _mm_set1_ps(a[0]); c00 = _mm_add_ps(c00, _mm_mul_ps(value, b0)); c01 = _mm_add_ps(c01, _mm_mul_ps(value, b1));
+            value = _mm_set1_ps(a[1]); c10 = _mm_add_ps(c10, _mm_mul_ps(value, b0)); c11 = _mm_add_ps(c11, _mm_mul_ps(value, b1));
+            value = _mm_set1_ps(a[2]); c20 = _mm_add_ps(c20, _mm_mul_ps(value, b0)); c21 = _mm_add_ps(c21, _mm_mul_ps(value, b1));
+            value = _mm_set1_ps(a[3]); c30 = _mm_add_ps(c30, _mm_mul_ps(value, b0)); c31 = _mm_add_ps(c31, _mm_mul_ps(value, b1));
+        }
+
+        _mm_storeu_ps(&acc[0 * 16 + half], c00); _mm_storeu_ps(&acc[0 * 16 + half + 4], c01);
+        _mm_storeu_ps(&acc[1 * 16 + half], c10); _mm_storeu_ps(&acc[1 * 16 + half + 4], c11);
+        _mm_storeu_ps(&acc[2 * 16 + half], c20); _mm_storeu_ps(&acc[2 * 16 + half + 4], c21);
+        _mm_storeu_ps(&acc[3 * 16 + half], c30); _mm_storeu_ps(&acc[3 * 16 + half + 4], c31);
+    }
+}
+
+/*!
+* \brief Multiplies a packed 4-row panel of A with a packed 16-column panel of B using AVX2 and FMA.
+* \param[in] depth The number of packed columns of A and rows of B
+* \param[in] apanel The panel of A, four values per column
+* \param[in] bpanel The panel of B, sixteen values per row
+* \param[out] acc The 4x16 product, row by row
+*/
+static __attribute__((target("avx2,fma"))) void matrix_gemm_micro_avx2(matrix_offset_t depth, const matrix_data_t *RESTRICT apanel, const matrix_data_t *RESTRICT bpanel, matrix_data_t *RESTRICT acc)
+{
+    matrix_offset_t p;
+    __m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+    __m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+    __m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+    __m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+
+    for (p = 0; p < depth; ++p)
+    {
+        const __m256 b0 = _mm256_loadu_ps(&bpanel[0]);
+        const __m256 b1 = _mm256_loadu_ps(&bpanel[8]);
+        __m256 value;
+
+        value = _mm256_broadcast_ss(&apanel[0]); c00 = _mm256_fmadd_ps(value, b0, c00); c01 = _mm256_fmadd_ps(value, b1, c01);
+        value = _mm256_broadcast_ss(&apanel[1]); c10 = _mm256_fmadd_ps(value, b0, c10); c11 = _mm256_fmadd_ps(value, b1, c11);
+        value = _mm256_broadcast_ss(&apanel[2]); c20 = _mm256_fmadd_ps(value, b0, c20); c21 = _mm256_fmadd_ps(value, b1, c21);
+        value = _mm256_broadcast_ss(&apanel[3]); c30 = _mm256_fmadd_ps(value, b0, c30); c31 = _mm256_fmadd_ps(value, b1, c31);
+
+        apanel += 4;
+        bpanel += 16;
+    }
+
+    _mm256_storeu_ps(&acc[0], c00);  _mm256_storeu_ps(&acc[8], c01);
+    _mm256_storeu_ps(&acc[16], c10); _mm256_storeu_ps(&acc[24], c11);
+    _mm256_storeu_ps(&acc[32], c20); _mm256_storeu_ps(&acc[40], c21);
+    _mm256_storeu_ps(&acc[48], c30); _mm256_storeu_ps(&acc[56], c31);
+}
+
+/*!
+* \brief Multiplies a packed 4-row panel of A with a packed 16-column panel of B using AVX-512F.
+* \param[in] depth The number of packed columns of A and rows of B
+* \param[in] apanel The panel of A, four values per column
+* \param[in] bpanel The panel of B, sixteen values per row
+* \param[out] acc The 4x16 product, row by row
+*
+* A row of the block fits one register; even and odd steps accumulate separately to hide the FMA latency.
+*/
+static __attribute__((target("avx512f,avx2,fma"))) void matrix_gemm_micro_avx512(matrix_offset_t depth, const matrix_data_t *RESTRICT apanel, const matrix_data_t *RESTRICT bpanel, matrix_data_t *RESTRICT acc)
+{
+    matrix_offset_t p = 0;
+    __m512 c0 = _mm512_setzero_ps(), d0 = _mm512_setzero_ps();
+    __m512 c1 = _mm512_setzero_ps(), d1 = _mm512_setzero_ps();
+    __m512 c2 = _mm512_setzero_ps(), d2 = _mm512_setzero_ps();
+    __m512 c3 = _mm512_setzero_ps(), d3 = _mm512_setzero_ps();
+
+    for (; p + 2 <= depth; p += 2)
+    {
+        const __m512 b0 = _mm512_loadu_ps(&bpanel[0]);
+        const __m512 b1 = _mm512_loadu_ps(&bpanel[16]);
+
+        c0 = _mm512_fmadd_ps(_mm512_set1_ps(apanel[0]), b0, c0);
+        c1 = _mm512_fmadd_ps(_mm512_set1_ps(apanel[1]), b0, c1);
+        c2 = _mm512_fmadd_ps(_mm512_set1_ps(apanel[2]), b0, c2);
+        c3 = _mm512_fmadd_ps(_mm512_set1_ps(apanel[3]), b0, c3);
+        d0 = _mm512_fmadd_ps(_mm512_set1_ps(apanel[4]), b1, d0);
+        d1 = _mm512_fmadd_ps(_mm512_set1_ps(apanel[5]), b1, d1);
+        d2 = _mm512_fmadd_ps(_mm512_set1_ps(apanel[6]), b1, d2);
+        d3 = _mm512_fmadd_ps(_mm512_set1_ps(apanel[7]), b1, d3);
+
+        apanel += 8;
+        bpanel += 32;
+    }
+
+    if (p < depth)
+    {
+        const __m512 b0 = _mm512_loadu_ps(&bpanel[0]);
+        c0 = _mm512_fmadd_ps(_mm512_set1_ps(apanel[0]), b0, c0);
+        c1 = _mm512_fmadd_ps(_mm512_set1_ps(apanel[1]), b0, c1);
+        c2 = _mm512_fmadd_ps(_mm512_set1_ps(apanel[2]), b0, c2);
+        c3 = _mm512_fmadd_ps(_mm512_set1_ps(apanel[3]), b0, c3);
+    }
+
+    _mm512_storeu_ps(&acc[0], _mm512_add_ps(c0, d0));
+    _mm512_storeu_ps(&acc[16], _mm512_add_ps(c1, d1));
+    _mm512_storeu_ps(&acc[32], _mm512_add_ps(c2, d2));
+    _mm512_storeu_ps(&acc[48], _mm512_add_ps(c3, d3));
+}
+
+/************************************************************************/
+/* Kernels                                                              */
+/************************************************************************/
+
+#define MATRIX_SIMD_ISA     sse2
+#define MATRIX_SIMD_TARGET  __attribute__((target("sse2")))
+#define MATRIX_SIMD_DOT     matrix_dot_sse2
+#include "matrix_simd_kernels.h"
+
+#define MATRIX_SIMD_ISA     avx2
+#define MATRIX_SIMD_TARGET  __attribute__((target("avx2,fma")))
+#define MATRIX_SIMD_DOT     matrix_dot_avx2
+#include "matrix_simd_kernels.h"
+
+#define MATRIX_SIMD_ISA     avx512
+#define MATRIX_SIMD_TARGET  __attribute__((target("avx512f,avx2,fma")))
+#define MATRIX_SIMD_DOT     matrix_dot_avx512
+#include "matrix_simd_kernels.h"
+
+#endif
+
+/*!
+* \brief Determines the best SIMD level supported by both the build and the executing CPU.
+* \return The detected level; \ref MATRIX_SIMD_SCALAR if SIMD support was not compiled in.
+*/
+matrix_simd_level_t matrix_simd_detect(void)
+{
+#if MATRIX_SIMD_X86
+    // required when called from a constructor
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f")) return MATRIX_SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return MATRIX_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return MATRIX_SIMD_SSE2;
+#endif
+    return MATRIX_SIMD_SCALAR;
+}
+
+/*!
+* \brief Gets the kernels of the given SIMD level.
+* \param[in] level The level to look up.
+* \return The kernel table; all \c NULL for \ref MATRIX_SIMD_SCALAR, \c NULL if the level is not supported.
+*/
+const matrix_simd_kernels_t *matrix_simd_kernels_of(matrix_simd_level_t level)
+{
+    static const matrix_simd_kernels_t scalar = { 0 };
+
+    if (level > matrix_simd_detect()) return 0;
+
+    switch (level)
+    {
+#if MATRIX_SIMD_X86
+    case MATRIX_SIMD_SSE2:
+        return &matrix_simd_kernels_sse2;
+    case MATRIX_SIMD_AVX2:
+        return &matrix_simd_kernels_avx2;
+    case MATRIX_SIMD_AVX512:
+        return &matrix_simd_kernels_avx512;
+#endif
+    case MATRIX_SIMD_SCALAR:
+        return &scalar;
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,401 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+/*!
+* \brief Instantiates the vectorized matrix kernels for one instruction set.
+*
+* This include requires the three defines {\ref MATRIX_SIMD_ISA}, {\ref MATRIX_SIMD_TARGET} and
+* {\ref MATRIX_SIMD_DOT} to be set to the name suffix of the generated functions, the function target
+* attribute and the dot product helper respectively. The kernels mirror the loop structure of the
+* scalar kernels in matrix.c and only replace the innermost dot product. Like the scalar kernels, they
+* honor the row stride of every operand; the vector kernels additionally require a contiguous vector x.
+* The register-blocked micro-kernel of the blocked products is not generic and must be defined as
+* <tt>matrix_gemm_micro_</tt>{\ref MATRIX_SIMD_ISA} prior to inclusion.
+*
+* \code{.c}
+* #define MATRIX_SIMD_ISA     avx2
+* #define MATRIX_SIMD_TARGET  __attribute__((target("avx2,fma")))
+* #define MATRIX_SIMD_DOT     matrix_dot_avx2
+* #include "matrix_simd_kernels.h"
+* \endcode
+*
+* All three defines are removed at the end of this file.
+*/
+
+#ifndef MATRIX_SIMD_ISA
+#error MATRIX_SIMD_ISA needs to be defined prior to inclusion of this file.
+#endif
+
+#ifndef MATRIX_SIMD_TARGET
+#error MATRIX_SIMD_TARGET needs to be defined prior to inclusion of this file.
+#endif
+
+#ifndef MATRIX_SIMD_DOT
+#error MATRIX_SIMD_DOT needs to be defined prior to inclusion of this file.
+#endif
+
+/************************************************************************/
+/* Name helper macro                                                    */
+/************************************************************************/
+
+#define MATRIX_SIMD_FUNCTION_HELPER2(name, isa)     name ## _ ## isa
+#define MATRIX_SIMD_FUNCTION_HELPER(name, isa)      MATRIX_SIMD_FUNCTION_HELPER2(name, isa)
+#define MATRIX_SIMD_FUNCTION_NAME(name)             MATRIX_SIMD_FUNCTION_HELPER(name, MATRIX_SIMD_ISA)
+
+/************************************************************************/
+/* Kernels                                                              */
+/************************************************************************/
+
+/*!
+* \brief Vectorized {\ref matrix_mult}
+*/
+static MATRIX_SIMD_TARGET void MATRIX_SIMD_FUNCTION_NAME(matrix_mult)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c, matrix_data_t *const baux)
+{
+    matrix_soffset_t i, j;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    const matrix_data_t *RESTRICT const adata = a->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    for (j = bcols-1; j >= 0; --j)
+    {
+        // create a copy of the column in B to avoid cache issues
+        matrix_get_column_copy(b, j, baux);
+
+        for (i = 0; i < (matrix_soffset_t)arows; ++i)
+        {
+            cdata[i*cstride + j] = MATRIX_SIMD_DOT(&adata[i*astride], baux, brows);
+        }
+    }
+}
+
+/*!
+* \brief Vectorized {\ref matrix_mult_transb}
+*/
+static MATRIX_SIMD_TARGET void MATRIX_SIMD_FUNCTION_NAME(matrix_mult_transb)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
+{
+    matrix_offset_t xA, xB;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        matrix_data_t *RESTRICT const crow = &cdata[xA * cstride];
+        for (xB = 0; xB < brows; ++xB)
+        {
+            crow[xB] = MATRIX_SIMD_DOT(arow, &bdata[xB * bstride], bcols);
+        }
+    }
+}
+
+/*!
+* \brief Vectorized {\ref matrix_multadd_transb}
+*/
+static MATRIX_SIMD_TARGET void MATRIX_SIMD_FUNCTION_NAME(matrix_multadd_transb)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
+{
+    matrix_offset_t xA, xB;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        matrix_data_t *RESTRICT const crow = &cdata[xA * cstride];
+        for (xB = 0; xB < brows; ++xB)
+        {
+            crow[xB] += MATRIX_SIMD_DOT(arow, &bdata[xB * bstride], bcols);
+        }
+    }
+}
+
+/*!
+* \brief Vectorized {\ref matrix_multscale_transb}
+*/
+static MATRIX_SIMD_TARGET void MATRIX_SIMD_FUNCTION_NAME(matrix_multscale_transb)(const matrix_t *const a, const matrix_t *const b, const matrix_data_t scale, const matrix_t *RESTRICT c)
+{
+    matrix_offset_t xA, xB;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        matrix_data_t *RESTRICT const crow = &cdata[xA * cstride];
+        for (xB = 0; xB < brows; ++xB)
+        {
+            crow[xB] = MATRIX_SIMD_DOT(arow, &bdata[xB * bstride], bcols) * scale;
+        }
+    }
+}
+
+/*!
+* \brief Vectorized {\ref matrix_mult_transb_symmetric}
+*/
+static MATRIX_SIMD_TARGET void MATRIX_SIMD_FUNCTION_NAME(matrix_mult_transb_symmetric)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
+{
+    matrix_offset_t xA, xB;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        for (xB = xA; xB < brows; ++xB)
+        {
+            cdata[xA*cstride + xB] = MATRIX_SIMD_DOT(arow, &bdata[xB * bstride], bcols);
+            cdata[xB*cstride + xA] = cdata[xA*cstride + xB];
+        }
+    }
+}
+
+/*!
+* \brief Vectorized {\ref matrix_multadd_transb_symmetric}
+*/
+static MATRIX_SIMD_TARGET void MATRIX_SIMD_FUNCTION_NAME(matrix_multadd_transb_symmetric)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
+{
+    matrix_offset_t xA, xB;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        for (xB = xA; xB < brows; ++xB)
+        {
+            cdata[xA*cstride + xB] += MATRIX_SIMD_DOT(arow, &bdata[xB * bstride], bcols);
+            cdata[xB*cstride + xA] = cdata[xA*cstride + xB];
+        }
+    }
+}
+
+/*!
+* \brief Vectorized {\ref matrix_multscale_transb_symmetric}
+*/
+static MATRIX_SIMD_TARGET void MATRIX_SIMD_FUNCTION_NAME(matrix_multscale_transb_symmetric)(const matrix_t *const a, const matrix_t *const b, const matrix_data_t scale, const matrix_t *RESTRICT c)
+{
+    matrix_offset_t xA, xB;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        for (xB = xA; xB < brows; ++xB)
+        {
+            cdata[xA*cstride + xB] = MATRIX_SIMD_DOT(arow, &bdata[xB * bstride], bcols) * scale;
+            cdata[xB*cstride + xA] = cdata[xA*cstride + xB];
+        }
+    }
+}
+
+/*!
+* \brief Vectorized {\ref matrix_mult_transb_packed}
+*/
+static MATRIX_SIMD_TARGET void MATRIX_SIMD_FUNCTION_NAME(matrix_mult_transb_packed)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
+{
+    matrix_offset_t xA, xB;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        matrix_data_t *RESTRICT const crow = matrix_packed_row(c, xA);
+        for (xB = xA; xB < brows; ++xB)
+        {
+            crow[xB] = MATRIX_SIMD_DOT(arow, &bdata[xB * bstride], bcols);
+        }
+    }
+}
+
+/*!
+* \brief Vectorized {\ref matrix_multadd_transb_packed}
+*/
+static MATRIX_SIMD_TARGET void MATRIX_SIMD_FUNCTION_NAME(matrix_multadd_transb_packed)(const matrix_t *const a, const matrix_t *const b, const matrix_t *RESTRICT c)
+{
+    matrix_offset_t xA, xB;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        matrix_data_t *RESTRICT const crow = matrix_packed_row(c, xA);
+        for (xB = xA; xB < brows; ++xB)
+        {
+            crow[xB] += MATRIX_SIMD_DOT(arow, &bdata[xB * bstride], bcols);
+        }
+    }
+}
+
+/*!
+* \brief Vectorized {\ref matrix_multscale_transb_packed}
+*/
+static MATRIX_SIMD_TARGET void MATRIX_SIMD_FUNCTION_NAME(matrix_multscale_transb_packed)(const matrix_t *const a, const matrix_t *const b, const matrix_data_t scale, const matrix_t *RESTRICT c)
+{
+    matrix_offset_t xA, xB;
+    const matrix_index_t bcols = b->cols;
+    const matrix_index_t brows = b->rows;
+    const matrix_index_t arows = a->rows;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t bstride = b->stride;
+
+    const matrix_data_t *const adata = a->data;
+    const matrix_data_t *const bdata = b->data;
+
+    for (xA = 0; xA < arows; ++xA)
+    {
+        const matrix_data_t *const arow = &adata[xA * astride];
+        matrix_data_t *RESTRICT const crow = matrix_packed_row(c, xA);
+        for (xB = xA; xB < brows; ++xB)
+        {
+            crow[xB] = MATRIX_SIMD_DOT(arow, &bdata[xB * bstride], bcols) * scale;
+        }
+    }
+}
+
+/*!
+* \brief Vectorized {\ref matrix_mult_rowvector}
+*/
+static MATRIX_SIMD_TARGET void MATRIX_SIMD_FUNCTION_NAME(matrix_mult_rowvector)(const matrix_t *RESTRICT const a, const matrix_t *RESTRICT const x, matrix_t *RESTRICT const c)
+{
+    matrix_offset_t i;
+    const matrix_index_t arows = a->rows;
+    const matrix_index_t acols = a->cols;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    const matrix_data_t *RESTRICT const adata = a->data;
+    const matrix_data_t *RESTRICT const xdata = x->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    for (i = 0; i < arows; ++i)
+    {
+        cdata[i * cstride] = MATRIX_SIMD_DOT(&adata[i * astride], xdata, acols);
+    }
+}
+
+/*!
+* \brief Vectorized {\ref matrix_multadd_rowvector}
+*/
+static MATRIX_SIMD_TARGET void MATRIX_SIMD_FUNCTION_NAME(matrix_multadd_rowvector)(const matrix_t *RESTRICT const a, const matrix_t *RESTRICT const x, matrix_t *RESTRICT const c)
+{
+    matrix_offset_t i;
+    const matrix_index_t arows = a->rows;
+    const matrix_index_t acols = a->cols;
+    const matrix_offset_t astride = a->stride;
+    const matrix_offset_t cstride = c->stride;
+
+    const matrix_data_t *RESTRICT const adata = a->data;
+    const matrix_data_t *RESTRICT const xdata = x->data;
+    matrix_data_t *RESTRICT const cdata = c->data;
+
+    for (i = 0; i < arows; ++i)
+    {
+        cdata[i * cstride] += MATRIX_SIMD_DOT(&adata[i * astride], xdata, acols);
+    }
+}
+
+/************************************************************************/
+/* Kernel table                                                         */
+/************************************************************************/
+
+/*!
+* \brief The kernel table for this instruction set
+*/
+static const matrix_simd_kernels_t MATRIX_SIMD_FUNCTION_NAME(matrix_simd_kernels) =
+{
+    MATRIX_SIMD_FUNCTION_NAME(matrix_mult),
+    MATRIX_SIMD_FUNCTION_NAME(matrix_mult_transb),
+    MATRIX_SIMD_FUNCTION_NAME(matrix_multadd_transb),
+    MATRIX_SIMD_FUNCTION_NAME(matrix_multscale_transb),
+    MATRIX_SIMD_FUNCTION_NAME(matrix_mult_transb_symmetric),
+    MATRIX_SIMD_FUNCTION_NAME(matrix_multadd_transb_symmetric),
+    MATRIX_SIMD_FUNCTION_NAME(matrix_multscale_transb_symmetric),
+    MATRIX_SIMD_FUNCTION_NAME(matrix_mult_transb_packed),
+    MATRIX_SIMD_FUNCTION_NAME(matrix_multadd_transb_packed),
+    MATRIX_SIMD_FUNCTION_NAME(matrix_multscale_transb_packed),
+    MATRIX_SIMD_FUNCTION_NAME(matrix_mult_rowvector),
+    MATRIX_SIMD_FUNCTION_NAME(matrix_multadd_rowvector),
+    MATRIX_SIMD_FUNCTION_NAME(matrix_gemm_micro)
+};
+
+/************************************************************************/
+/* Clean up                                                             */
+/************************************************************************/
+
+#undef MATRIX_SIMD_FUNCTION_NAME
+#undef MATRIX_SIMD_FUNCTION_HELPER
+#undef MATRIX_SIMD_FUNCTION_HELPER2
+
+#undef MATRIX_SIMD_ISA
+#undef MATRIX_SIMD_TARGET
+#undef MATRIX_SIMD_DOT
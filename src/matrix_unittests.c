@@ -6,11 +6,14 @@
 
 #include <stdio.h>
 #include <assert.h>
+#include <math.h>
+#include <float.h>
 
 #define EXTERN_INLINE_MATRIX static INLINE
 
 #include "matrix.h"
 #include "cholesky.h"
+#include "matrix_simd.h"
 #include "matrix_unittests.h"
 
 /**
@@ -48,6 +51,61 @@ void test_matrix_inverse()
     assert(test >= 1.3);
 }
 
+/**
+* \brief Tests solving against a Cholesky factor
+*/
+void test_cholesky_solve_transb()
+{
+    int result;
+
+    // data buffer for the original and decomposed matrix
+    matrix_data_t d[3 * 3] = { 4, 2, 0,
+        2, 5, 1,
+        0, 1, 3 };
+
+    // data buffer for the inverted matrix
+    matrix_data_t di[3 * 3] = { 0, 0, 0,
+        0, 0, 0,
+        0, 0, 0 };
+
+    // right-hand side, 3 x 2
+    matrix_data_t bd[3 * 2] = { 1, 2,
+        3, 4,
+        5, 6 };
+
+    // solution and reference, 2 x 3
+    matrix_data_t xd[2 * 3] = { 0 };
+    matrix_data_t rd[2 * 3] = { 0 };
+    matrix_data_t aux[3] = { 0 };
+
+    // prepare matrix structures
+    matrix_t m, mi, b, bt, x, r;
+    matrix_data_t btd[2 * 3] = { 1, 3, 5,
+        2, 4, 6 };
+
+    // initialize the matrices
+    matrix_init(&m, 3, 3, d);
+    matrix_init(&mi, 3, 3, di);
+    matrix_init(&b, 3, 2, bd);
+    matrix_init(&bt, 2, 3, btd);
+    matrix_init(&x, 2, 3, xd);
+    matrix_init(&r, 2, 3, rd);
+
+    // decompose matrix to lower triangular
+    result = cholesky_decompose_lower(&m);
+    assert(result == 0);
+
+    // solve and compare against multiplication with the explicit inverse
+    cholesky_solve_transb(&m, &b, &x);
+    matrix_invert_lower(&m, &mi);
+    matrix_mult(&bt, &mi, &r, aux);
+
+    for (int i = 0; i < 2 * 3; ++i)
+    {
+        assert(fabs(xd[i] - rd[i]) < 1e-5);
+    }
+}
+
 /*!
 * \brief Tests column and row fetching
 */
@@ -224,6 +282,134 @@ void test_matrix_multadd_transb()
     assert(cd[8] == 11 + 90);
 }
 
+/*!
+*  \brief Tests symmetric matrix multiplication with transposed B
+*/
+void test_matrix_mult_transb_symmetric()
+{
+    // A*P with P = [2 1 0; 1 3 0; 0 0 1]
+    matrix_data_t ad[2 * 3] = { 1, 2, 0,
+        0, 1, 1 };
+
+    matrix_data_t pd[3 * 3] = { 2, 1, 0,
+        1, 3, 0,
+        0, 0, 1 };
+
+    matrix_data_t apd[2 * 3] = { 0, 0, 0,
+        0, 0, 0 };
+
+    matrix_data_t cd[2 * 2] = { 0, 0,
+        0, 0 };
+
+    matrix_data_t aux[3] = { 0, 0, 0 };
+
+    // prepare matrix structures
+    matrix_t a, p, ap, c;
+
+    // initialize the matrices
+    matrix_init(&a, 2, 3, ad);
+    matrix_init(&p, 3, 3, pd);
+    matrix_init(&ap, 2, 3, apd);
+    matrix_init(&c, 2, 2, cd);
+
+    // multiply
+    matrix_mult(&a, &p, &ap, aux);
+    matrix_mult_transb_symmetric(&ap, &a, &c);
+    assert(cd[0] == 18);
+    assert(cd[1] == 7);
+    assert(cd[2] == 7);
+    assert(cd[3] == 4);
+}
+
+/*!
+*  \brief Tests symmetric matrix multiplication with transposed B
+*/
+void test_matrix_multadd_transb_symmetric()
+{
+    matrix_data_t ad[2 * 3] = { 1, 2, 0,
+        0, 1, 1 };
+
+    matrix_data_t cd[2 * 2] = { 10, 20,
+        20, 40 };
+
+    // prepare matrix structures
+    matrix_t a, c;
+
+    // initialize the matrices
+    matrix_init(&a, 2, 3, ad);
+    matrix_init(&c, 2, 2, cd);
+
+    // multiply
+    matrix_multadd_transb_symmetric(&a, &a, &c);
+    assert(cd[0] == 5 + 10);
+    assert(cd[1] == 2 + 20);
+    assert(cd[2] == 2 + 20);
+    assert(cd[3] == 2 + 40);
+}
+
+/*!
+*  \brief Tests symmetric matrix multiplication with transposed B
+*/
+void test_matrix_multscale_transb_symmetric()
+{
+    matrix_data_t ad[2 * 3] = { 1, 2, 0,
+        0, 1, 1 };
+
+    matrix_data_t cd[2 * 2] = { 0, 0,
+        0, 0 };
+
+    // prepare matrix structures
+    matrix_t a, c;
+
+    // initialize the matrices
+    matrix_init(&a, 2, 3, ad);
+    matrix_init(&c, 2, 2, cd);
+
+    // multiply
+    matrix_multscale_transb_symmetric(&a, &a, 2, &c);
+    assert(cd[0] == 5 * 2);
+    assert(cd[1] == 2 * 2);
+    assert(cd[2] == 2 * 2);
+    assert(cd[3] == 2 * 2);
+}
+
+/*!
+*  \brief Tests symmetric matrix multiply-subtract
+*/
+void test_matrix_multsub_symmetric()
+{
+    matrix_data_t ad[3 * 2] = { 1, 0,
+        2, 1,
+        0, 1 };
+
+    matrix_data_t bd[2 * 3] = { 1, 2, 0,
+        0, 1, 1 };
+
+    matrix_data_t cd[3 * 3] = { 10, 0, 0,
+        0, 10, 0,
+        0, 0, 10 };
+
+    // prepare matrix structures
+    matrix_t a, b, c;
+
+    // initialize the matrices
+    matrix_init(&a, 3, 2, ad);
+    matrix_init(&b, 2, 3, bd);
+    matrix_init(&c, 3, 3, cd);
+
+    // multiply and subtract; a*b = b'*b is symmetric
+    matrix_multsub_symmetric(&a, &b, &c);
+    assert(cd[0] == 9);
+    assert(cd[1] == -2);
+    assert(cd[2] == 0);
+    assert(cd[3] == -2);
+    assert(cd[4] == 5);
+    assert(cd[5] == -1);
+    assert(cd[6] == 0);
+    assert(cd[7] == -1);
+    assert(cd[8] == 9);
+}
+
 /*!
 *  \brief Tests matrix multiplication
 */
@@ -392,21 +578,599 @@ void test_matrix_copy()
     assert(ad[8] == 11);
 }
 
+#if KALMAN_SIMD_TESTING
+
+/*!
+* \brief Asserts that two results agree within the documented SIMD tolerance
+* \param[in] expected The scalar result
+* \param[in] actual The vectorized result
+* \param[in] count The number of elements
+* \param[in] bound The tolerance (n * FLT_EPSILON * sum(|a_ik * b_kj|))
+*/
+static void assert_simd_tolerance(const matrix_data_t *expected, const matrix_data_t *actual, int count, matrix_data_t bound)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        assert(fabs(expected[i] - actual[i]) <= bound);
+    }
+}
+
+/*!
+*  \brief Tests that every supported SIMD level matches the scalar kernels
+*/
+void test_matrix_simd_dispatch()
+{
+    // odd dimensions exercise both the vector bodies and the scalar tails
+    enum { R = 13, K = 19 };
+    matrix_data_t ad[R * K], bd[K * R], btd[R * K], xd[K];
+    matrix_data_t ref[R * R], out[R * R], vref[R], vout[R];
+    matrix_data_t aux[K];
+    matrix_t a, b, bt, x, c_ref, c_out, v_ref, v_out;
+
+    for (int i = 0; i < R * K; ++i)
+    {
+        ad[i] = (matrix_data_t)((i * 7) % 11) - (matrix_data_t)5.25;
+        bd[i] = (matrix_data_t)((i * 5) % 13) * (matrix_data_t)0.125;
+        btd[i] = (matrix_data_t)((i * 3) % 7) - (matrix_data_t)2.5;
+    }
+    for (int i = 0; i < K; ++i)
+    {
+        xd[i] = (matrix_data_t)(i % 5) - (matrix_data_t)1.5;
+    }
+
+    matrix_init(&a, R, K, ad);
+    matrix_init(&b, K, R, bd);
+    matrix_init(&bt, R, K, btd);
+    matrix_init(&x, K, 1, xd);
+    matrix_init(&c_ref, R, R, ref);
+    matrix_init(&c_out, R, R, out);
+    matrix_init(&v_ref, R, 1, vref);
+    matrix_init(&v_out, R, 1, vout);
+
+    // all operands are bounded by 6 in magnitude
+    const matrix_data_t bound = (matrix_data_t)(K * FLT_EPSILON * K * 6 * 6);
+    const matrix_simd_level_t detected = matrix_simd_get_level();
+
+    for (int level = MATRIX_SIMD_SSE2; level <= MATRIX_SIMD_AVX512; ++level)
+    {
+        if (matrix_simd_select(MATRIX_SIMD_SCALAR) != 0) assert(0);
+        matrix_mult(&a, &b, &c_ref, aux);
+        if (matrix_simd_select((matrix_simd_level_t)level) != 0) continue;
+        matrix_mult(&a, &b, &c_out, aux);
+        assert_simd_tolerance(ref, out, R * R, bound);
+
+        matrix_simd_select(MATRIX_SIMD_SCALAR);
+        matrix_mult_transb(&a, &bt, &c_ref);
+        matrix_simd_select((matrix_simd_level_t)level);
+        matrix_mult_transb(&a, &bt, &c_out);
+        assert_simd_tolerance(ref, out, R * R, bound);
+
+        matrix_simd_select(MATRIX_SIMD_SCALAR);
+        matrix_multadd_transb(&a, &bt, &c_ref);
+        matrix_simd_select((matrix_simd_level_t)level);
+        matrix_multadd_transb(&a, &bt, &c_out);
+        assert_simd_tolerance(ref, out, R * R, 2 * bound);
+
+        matrix_simd_select(MATRIX_SIMD_SCALAR);
+        matrix_multscale_transb(&a, &bt, (matrix_data_t)0.5, &c_ref);
+        matrix_simd_select((matrix_simd_level_t)level);
+        matrix_multscale_transb(&a, &bt, (matrix_data_t)0.5, &c_out);
+        assert_simd_tolerance(ref, out, R * R, bound);
+
+        matrix_simd_select(MATRIX_SIMD_SCALAR);
+        matrix_mult_transb_symmetric(&a, &a, &c_ref);
+        matrix_simd_select((matrix_simd_level_t)level);
+        matrix_mult_transb_symmetric(&a, &a, &c_out);
+        assert_simd_tolerance(ref, out, R * R, bound);
+
+        matrix_simd_select(MATRIX_SIMD_SCALAR);
+        matrix_multadd_transb_symmetric(&a, &a, &c_ref);
+        matrix_simd_select((matrix_simd_level_t)level);
+        matrix_multadd_transb_symmetric(&a, &a, &c_out);
+        assert_simd_tolerance(ref, out, R * R, 2 * bound);
+
+        matrix_simd_select(MATRIX_SIMD_SCALAR);
+        matrix_multscale_transb_symmetric(&a, &a, (matrix_data_t)0.5, &c_ref);
+        matrix_simd_select((matrix_simd_level_t)level);
+        matrix_multscale_transb_symmetric(&a, &a, (matrix_data_t)0.5, &c_out);
+        assert_simd_tolerance(ref, out, R * R, bound);
+
+        matrix_simd_select(MATRIX_SIMD_SCALAR);
+        matrix_mult_rowvector(&a, &x, &v_ref);
+        matrix_multadd_rowvector(&a, &x, &v_ref);
+        matrix_simd_select((matrix_simd_level_t)level);
+        matrix_mult_rowvector(&a, &x, &v_out);
+        matrix_multadd_rowvector(&a, &x, &v_out);
+        assert_simd_tolerance(vref, vout, R, 2 * bound);
+    }
+
+    matrix_simd_select(detected);
+}
+
+#endif
+
+/*!
+* \brief Selects the kernels of a SIMD level
+* \param[in] level The level to select
+* \return Nonzero if the level is selected; without \ref KALMAN_SIMD_TESTING only the level selected at program start is.
+*/
+static int select_simd_level(int level)
+{
+#if KALMAN_SIMD_TESTING
+    return matrix_simd_select((matrix_simd_level_t)level) == 0;
+#else
+    return level == (int)matrix_simd_get_level();
+#endif
+}
+
+/*!
+*  \brief Tests views into a matrix with padded rows
+*/
+void test_matrix_views()
+{
+    // a 3x4 matrix padded to a stride of 6; the padding holds a sentinel
+    matrix_data_t pd[3 * 6] = { 1, 2, 3, 4, -99, -99,
+        5, 6, 7, 8, -99, -99,
+        9, 10, 11, 12, -99, -99 };
+
+    matrix_data_t cd[2 * 2] = { 0 };
+
+    matrix_t p, block, rows, cols, c;
+    matrix_init_strided(&p, 3, 4, 6, pd);
+    matrix_init(&c, 2, 2, cd);
+    assert(c.stride == 2);
+    assert(matrix_is_dense(&c) && !matrix_is_dense(&p));
+
+    assert(matrix_get(&p, 2, 3) == 12);
+
+    // the lower right 2x2 block
+    matrix_view_submatrix(&p, 1, 2, 2, 2, &block);
+    assert(block.rows == 2 && block.cols == 2 && block.stride == 6);
+    assert(matrix_get(&block, 0, 0) == 7);
+    assert(matrix_get(&block, 1, 1) == 12);
+
+    // writes go through to the parent
+    matrix_set(&block, 1, 0, 42);
+    assert(pd[2 * 6 + 2] == 42);
+
+    matrix_copy(&block, &c);
+    assert(cd[0] == 7 && cd[1] == 8 && cd[2] == 42 && cd[3] == 12);
+
+    matrix_add_inplace(&block, &c);
+    assert(pd[1 * 6 + 2] == 14 && pd[2 * 6 + 3] == 24);
+
+    matrix_sub_inplace_b(&block, &c);
+    assert(cd[0] == 7 && cd[3] == 12);
+
+    matrix_sub(&block, &c, &block);
+    assert(pd[1 * 6 + 2] == 7 && pd[2 * 6 + 3] == 12);
+
+    matrix_view_rows(&p, 1, 2, &rows);
+    assert(rows.rows == 2 && rows.cols == 4 && matrix_get(&rows, 0, 0) == 5);
+
+    matrix_view_columns(&p, 1, 2, &cols);
+    assert(cols.rows == 3 && cols.cols == 2 && matrix_get(&cols, 2, 1) == 42);
+
+    matrix_data_t column[3], row[2];
+    matrix_get_column_copy(&cols, 1, column);
+    assert(column[0] == 3 && column[1] == 7 && column[2] == 42);
+    matrix_get_row_copy(&block, 0, row);
+    assert(row[0] == 7 && row[1] == 8);
+
+    // the padding was never touched
+    for (int i = 0; i < 3; ++i)
+    {
+        assert(pd[i * 6 + 4] == -99 && pd[i * 6 + 5] == -99);
+    }
+}
+
+/*!
+* \brief Copies a dense matrix into a view
+*/
+static void copy_into_view(const matrix_data_t *dense, const matrix_t *view)
+{
+    for (matrix_index_t i = 0; i < view->rows; ++i)
+    {
+        for (matrix_index_t j = 0; j < view->cols; ++j)
+        {
+            view->data[i * view->stride + j] = dense[i * view->cols + j];
+        }
+    }
+}
+
+/*!
+* \brief Asserts that a view holds exactly the values of a dense matrix
+*/
+static void assert_view_equals(const matrix_data_t *dense, const matrix_t *view)
+{
+    for (matrix_index_t i = 0; i < view->rows; ++i)
+    {
+        for (matrix_index_t j = 0; j < view->cols; ++j)
+        {
+            assert(view->data[i * view->stride + j] == dense[i * view->cols + j]);
+        }
+    }
+}
+
+/*!
+*  \brief Tests that every kernel on every SIMD level gives identical results on views and dense matrices
+*/
+void test_matrix_strided_kernels()
+{
+    enum { R = 5, K = 7, PAD = 3, S = K + PAD };
+    matrix_data_t ad[R * K], bd[K * R], btd[R * K], xd[K];
+    matrix_data_t ref[R * R], vref[R], aux[K];
+    matrix_data_t apd[(R + 1) * S], bpd[(K + 1) * S], btpd[(R + 1) * S], xpd[K * 2], cpd[(R + 1) * S], vpd[R * 3];
+    matrix_t a, b, bt, x, c_ref, v_ref;
+    matrix_t ap, bp, btp, xp, cp, vp;
+    matrix_t av, bv, btv, xv, cv, vv;
+
+    for (int i = 0; i < R * K; ++i)
+    {
+        ad[i] = (matrix_data_t)((i * 7) % 11) - (matrix_data_t)5.25;
+        bd[i] = (matrix_data_t)((i * 5) % 13) * (matrix_data_t)0.125;
+        btd[i] = (matrix_data_t)((i * 3) % 7) - (matrix_data_t)2.5;
+    }
+    for (int i = 0; i < K; ++i)
+    {
+        xd[i] = (matrix_data_t)(i % 5) - (matrix_data_t)1.5;
+    }
+
+    matrix_init(&a, R, K, ad);
+    matrix_init(&b, K, R, bd);
+    matrix_init(&bt, R, K, btd);
+    matrix_init(&x, K, 1, xd);
+    matrix_init(&c_ref, R, R, ref);
+    matrix_init(&v_ref, R, 1, vref);
+
+    // every operand is a view starting at (1, 1) of a padded parent; vectors are columns of wider parents
+    matrix_init_strided(&ap, R + 1, K + 1, S, apd);
+    matrix_init_strided(&bp, K + 1, R + 1, S, bpd);
+    matrix_init_strided(&btp, R + 1, K + 1, S, btpd);
+    matrix_init(&xp, K, 2, xpd);
+    matrix_init_strided(&cp, R + 1, R + 1, S, cpd);
+    matrix_init(&vp, R, 3, vpd);
+    matrix_view_submatrix(&ap, 1, 1, R, K, &av);
+    matrix_view_submatrix(&bp, 1, 1, K, R, &bv);
+    matrix_view_submatrix(&btp, 1, 1, R, K, &btv);
+    matrix_view_columns(&xp, 1, 1, &xv);
+    matrix_view_submatrix(&cp, 1, 1, R, R, &cv);
+    matrix_view_columns(&vp, 2, 1, &vv);
+    copy_into_view(ad, &av);
+    copy_into_view(bd, &bv);
+    copy_into_view(btd, &btv);
+    copy_into_view(xd, &xv);
+
+    const matrix_simd_level_t detected = matrix_simd_get_level();
+
+    for (int level = MATRIX_SIMD_SCALAR; level <= MATRIX_SIMD_AVX512; ++level)
+    {
+        if (!select_simd_level(level)) continue;
+
+        matrix_mult(&a, &b, &c_ref, aux);
+        matrix_mult(&av, &bv, &cv, aux);
+        assert_view_equals(ref, &cv);
+
+        matrix_mult_transb(&a, &bt, &c_ref);
+        matrix_mult_transb(&av, &btv, &cv);
+        assert_view_equals(ref, &cv);
+
+        matrix_multadd_transb(&a, &bt, &c_ref);
+        matrix_multadd_transb(&av, &btv, &cv);
+        assert_view_equals(ref, &cv);
+
+        matrix_multscale_transb(&a, &bt, (matrix_data_t)0.5, &c_ref);
+        matrix_multscale_transb(&av, &btv, (matrix_data_t)0.5, &cv);
+        assert_view_equals(ref, &cv);
+
+        matrix_mult_transb_symmetric(&a, &a, &c_ref);
+        matrix_mult_transb_symmetric(&av, &av, &cv);
+        assert_view_equals(ref, &cv);
+
+        matrix_multadd_transb_symmetric(&a, &a, &c_ref);
+        matrix_multadd_transb_symmetric(&av, &av, &cv);
+        assert_view_equals(ref, &cv);
+
+        matrix_multscale_transb_symmetric(&a, &a, (matrix_data_t)0.5, &c_ref);
+        matrix_multscale_transb_symmetric(&av, &av, (matrix_data_t)0.5, &cv);
+        assert_view_equals(ref, &cv);
+
+        matrix_multsub_symmetric(&bt, &b, &c_ref);
+        matrix_multsub_symmetric(&btv, &bv, &cv);
+        assert_view_equals(ref, &cv);
+
+        // a strided vector x is served by the scalar kernel on every level
+        matrix_mult_rowvector(&a, &x, &v_ref);
+        matrix_multadd_rowvector(&a, &x, &v_ref);
+        matrix_mult_rowvector(&av, &xv, &vv);
+        matrix_multadd_rowvector(&av, &xv, &vv);
+        assert_view_equals(vref, &vv);
+    }
+
+    select_simd_level(detected);
+
+    // decompose and solve on a view: A*A' + 10*I is positive definite
+    matrix_data_t ld[R * R], kd[K * R], kpd[K * S];
+    matrix_t l, k, kp, kv;
+    matrix_init(&l, R, R, ld);
+    matrix_init(&k, K, R, kd);
+    matrix_init_strided(&kp, K, R, S, kpd);
+    matrix_view_columns(&kp, 0, R, &kv);
+
+    matrix_mult_transb_symmetric(&a, &a, &l);
+    matrix_mult_transb_symmetric(&av, &av, &cv);
+    for (int i = 0; i < R; ++i)
+    {
+        ld[i * R + i] += 10;
+        cv.data[i * cv.stride + i] += 10;
+    }
+
+    assert(cholesky_decompose_lower(&l) == 0);
+    assert(cholesky_decompose_lower(&cv) == 0);
+    assert_view_equals(ld, &cv);
+
+    cholesky_solve_transb(&l, &bt, &k);
+    cholesky_solve_transb(&cv, &btv, &kv);
+    assert_view_equals(kd, &kv);
+}
+
+/*!
+*  \brief Tests the accessors of packed symmetric matrices
+*/
+void test_matrix_packed_storage()
+{
+    matrix_data_t pd[MATRIX_PACKED_SIZE(3)] = { 0 };
+    matrix_data_t qd[MATRIX_PACKED_SIZE(3)] = { 0 };
+    matrix_data_t dd[3 * 3] = { 1, 1, 1,
+        1, 1, 1,
+        1, 1, 1 };
+    matrix_data_t column[3];
+
+    matrix_t p, q, d, e;
+    matrix_init_packed(&p, 3, pd);
+    matrix_init_packed(&q, 3, qd);
+    matrix_init(&d, 3, 3, dd);
+    matrix_init(&e, 3, 0, dd);
+    assert(matrix_is_packed(&p) && !matrix_is_packed(&d) && !matrix_is_packed(&e));
+
+    // set 1 2 3
+    //     2 4 5
+    //     3 5 6
+    matrix_set_symmetric(&p, 0, 0, 1);
+    matrix_set_symmetric(&p, 0, 1, 2);
+    matrix_set_symmetric(&p, 2, 0, 3);
+    matrix_set_packed(&p, 1, 1, 4);
+    matrix_set_packed(&p, 2, 1, 5);
+    matrix_set_packed(&p, 2, 2, 6);
+    for (int i = 0; i < 6; ++i)
+    {
+        assert(pd[i] == (matrix_data_t)(i + 1));
+    }
+    assert(matrix_get_packed(&p, 1, 2) == 5 && matrix_get_packed(&p, 2, 1) == 5);
+
+    matrix_get_column_copy(&p, 1, column);
+    assert(column[0] == 2 && column[1] == 4 && column[2] == 5);
+    matrix_get_row_copy(&p, 2, column);
+    assert(column[0] == 3 && column[1] == 5 && column[2] == 6);
+
+    matrix_copy(&p, &q);
+    matrix_add_inplace(&q, &p);
+    assert(qd[0] == 2 && qd[5] == 12);
+
+    // mixed storage
+    matrix_add_inplace(&d, &p);
+    assert(dd[0] == 2 && dd[1] == 3 && dd[3] == 3 && dd[7] == 6 && dd[8] == 7);
+    matrix_add_inplace(&q, &d);
+    assert(qd[0] == 4 && qd[1] == 7 && qd[4] == 16 && qd[5] == 19);
+}
+
+/*!
+* \brief Asserts that a packed matrix holds exactly the values of a dense symmetric matrix
+*/
+static void assert_packed_equals(const matrix_t *dense, const matrix_t *packed)
+{
+    for (matrix_index_t i = 0; i < dense->rows; ++i)
+    {
+        for (matrix_index_t j = 0; j < dense->cols; ++j)
+        {
+            assert(matrix_get_packed(packed, i, j) == matrix_get(dense, i, j));
+        }
+    }
+}
+
+/*!
+*  \brief Tests that the packed kernels match the symmetric kernels on every SIMD level
+*/
+void test_matrix_packed_kernels()
+{
+    enum { N = 9, K = 11 };
+    matrix_data_t ad[N * K], kd[N * K], hpd[K * N];
+    matrix_data_t dense[N * N], packed[MATRIX_PACKED_SIZE(N)], pm[N * N], pmd[N * N], aux[N];
+    matrix_t a, kg, hp, d, p, c, cd;
+
+    for (int i = 0; i < N * K; ++i)
+    {
+        ad[i] = (matrix_data_t)((i * 7) % 11) - (matrix_data_t)5.25;
+    }
+
+    matrix_init(&a, N, K, ad);
+    matrix_init(&kg, N, K, kd);
+    matrix_init(&hp, K, N, hpd);
+    matrix_init(&d, N, N, dense);
+    matrix_init_packed(&p, N, packed);
+    matrix_init(&c, N, N, pm);
+    matrix_init(&cd, N, N, pmd);
+
+    // K*HP is symmetric for HP = 0.5*K'
+    for (int i = 0; i < N; ++i)
+    {
+        for (int j = 0; j < K; ++j)
+        {
+            kd[i * K + j] = ad[i * K + j];
+            hpd[j * N + i] = ad[i * K + j] * (matrix_data_t)0.5;
+        }
+    }
+
+    const matrix_simd_level_t detected = matrix_simd_get_level();
+
+    for (int level = MATRIX_SIMD_SCALAR; level <= MATRIX_SIMD_AVX512; ++level)
+    {
+        if (!select_simd_level(level)) continue;
+
+        matrix_mult_transb_symmetric(&a, &a, &d);
+        matrix_mult_transb_packed(&a, &a, &p);
+        assert_packed_equals(&d, &p);
+
+        matrix_multadd_transb_symmetric(&a, &a, &d);
+        matrix_multadd_transb_packed(&a, &a, &p);
+        assert_packed_equals(&d, &p);
+
+        matrix_multscale_transb_symmetric(&a, &a, (matrix_data_t)0.5, &d);
+        matrix_multscale_transb_packed(&a, &a, (matrix_data_t)0.5, &p);
+        assert_packed_equals(&d, &p);
+
+        matrix_multsub_symmetric(&kg, &hp, &d);
+        matrix_multsub_packed(&kg, &hp, &p);
+        assert_packed_equals(&d, &p);
+
+        // a packed operand B is gathered column by column
+        matrix_mult(&d, &d, &cd, aux);
+        matrix_mult(&d, &p, &c, aux);
+        for (int i = 0; i < N * N; ++i)
+        {
+            assert(pm[i] == pmd[i]);
+        }
+    }
+
+    select_simd_level(detected);
+}
+
+/*!
+* \brief Compares a product against a reference calculated in double precision
+* \param[in] a Matrix A
+* \param[in] b Matrix B
+* \param[in] transb Nonzero if the product is A * B'
+* \param[in] scale Scaling factor of the product
+* \param[in] initial Value every element of C held before the product was added to it
+* \param[in] c The result to check
+*/
+static void assert_blocked_product(const matrix_t *a, const matrix_t *b, int transb, double scale, double initial, const matrix_t *c)
+{
+    const int k = a->cols;
+    const double bound = (double)k * k * FLT_EPSILON;
+
+    for (int i = 0; i < (int)c->rows; ++i)
+    {
+        for (int j = 0; j < (int)c->cols; ++j)
+        {
+            double total = 0;
+            for (int p = 0; p < k; ++p)
+            {
+                total += (double)matrix_get(a, i, p) * (double)(transb ? matrix_get(b, j, p) : matrix_get(b, p, j));
+            }
+            assert(fabs(initial + scale * total - (double)matrix_get(c, i, j)) <= bound);
+        }
+    }
+}
+
+/*!
+*  \brief Tests the cache-blocked products on sizes spanning several blocks, with partial edge blocks
+*/
+void test_matrix_blocked_kernels()
+{
+    // more than 255 rows when the large matrix configuration is built
+    enum { M = (MATRIX_MAX_DIMENSION > UINT8_MAX) ? 261 : 101, N = 133, K = 141, CS = N + 3 };
+    static matrix_data_t ad[M * K], bd[K * N], btd[N * K], cd[M * CS], sd[M * M], aux[K];
+    matrix_t a, b, bt, c, s;
+
+    assert(M >= MATRIX_BLOCK_THRESHOLD && N >= MATRIX_BLOCK_THRESHOLD && K >= MATRIX_BLOCK_THRESHOLD);
+
+    for (int i = 0; i < M * K; ++i)
+    {
+        ad[i] = (matrix_data_t)((i * 7) % 13) / 13 - (matrix_data_t)0.5;
+    }
+    for (int i = 0; i < K * N; ++i)
+    {
+        bd[i] = (matrix_data_t)((i * 5) % 11) / 11 - (matrix_data_t)0.5;
+        btd[i] = (matrix_data_t)((i * 3) % 17) / 17 - (matrix_data_t)0.5;
+    }
+
+    matrix_init(&a, M, K, ad);
+    matrix_init(&b, K, N, bd);
+    matrix_init(&bt, N, K, btd);
+    matrix_init_strided(&c, M, N, CS, cd);
+    matrix_init(&s, M, M, sd);
+
+    const matrix_simd_level_t detected = matrix_simd_get_level();
+
+    for (int level = MATRIX_SIMD_SCALAR; level <= MATRIX_SIMD_AVX512; ++level)
+    {
+        if (!select_simd_level(level)) continue;
+
+        matrix_mult(&a, &b, &c, aux);
+        assert_blocked_product(&a, &b, 0, 1, 0, &c);
+
+        matrix_mult_transb(&a, &bt, &c);
+        assert_blocked_product(&a, &bt, 1, 1, 0, &c);
+
+        matrix_multscale_transb(&a, &bt, (matrix_data_t)0.5, &c);
+        assert_blocked_product(&a, &bt, 1, 0.5, 0, &c);
+
+        for (int i = 0; i < M * CS; ++i) cd[i] = 1;
+        matrix_multadd_transb(&a, &bt, &c);
+        assert_blocked_product(&a, &bt, 1, 1, 1, &c);
+
+        // A*A' is symmetric; the mirrored lower triangle must match exactly
+        matrix_mult_transb_symmetric(&a, &a, &s);
+        assert_blocked_product(&a, &a, 1, 1, 0, &s);
+
+        matrix_multscale_transb_symmetric(&a, &a, (matrix_data_t)2, &s);
+        assert_blocked_product(&a, &a, 1, 2, 0, &s);
+
+        for (int i = 0; i < M * M; ++i) sd[i] = 1;
+        matrix_multadd_transb_symmetric(&a, &a, &s);
+        assert_blocked_product(&a, &a, 1, 1, 1, &s);
+
+        for (int i = 0; i < M; ++i)
+        {
+            for (int j = 0; j < i; ++j)
+            {
+                assert(sd[i * M + j] == sd[j * M + i]);
+            }
+        }
+    }
+
+    select_simd_level(detected);
+}
+
 /*!
 * \brief Unit tests for matrix operations
 */
 void matrix_unittests()
 {
     test_matrix_inverse();
+    test_cholesky_solve_transb();
     test_matrix_copy_cols_and_rows();
     test_matrix_multiply_aux();
     test_matrix_multiply_transb();
     test_matrix_multscale_transb();
     test_matrix_multadd_transb();
+    test_matrix_mult_transb_symmetric();
+    test_matrix_multadd_transb_symmetric();
+    test_matrix_multscale_transb_symmetric();
+    test_matrix_multsub_symmetric();
     test_matrix_multiply_vector();
     test_matrix_multiplyadd_vector();
     test_matrix_add_inplace();
     test_matrix_sub_inplace_b();
     test_matrix_sub();
     test_matrix_copy();
+#if KALMAN_SIMD_TESTING
+    test_matrix_simd_dispatch();
+#endif
+    test_matrix_views();
+    test_matrix_strided_kernels();
+    test_matrix_packed_storage();
+    test_matrix_packed_kernels();
+    test_matrix_blocked_kernels();
 }
@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright (c) 2014-2024 Markus Mayer
+//
+// Part of kalman-clib — https://github.com/sunsided/kalman-clib
+// Licensed under the MIT License. See LICENSE.md in the project root for details.
+
+#include <stdio.h>
+
+#include "matrix_unittests.h"
+#include "kalman_unittests.h"
+
+/**
+* \brief Entry point of the unit tests
+* \return Zero if all checks passed
+*/
+int main(void)
+{
+    matrix_unittests();
+
+    const int failures = kalman_unittests();
+    if (failures != 0)
+    {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+
+    return 0;
+}